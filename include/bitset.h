@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Dense bitsets as arrays of 64-bit words. The bulk kernels work on whole
+// words and are vectorised with AVX2 when the compiler targets it
+// (e.g. -mavx2 or -march=native); otherwise they fall back to scalar loops.
+
+#define BITSET_WORD_BITS 64
+
+static inline size_t bitset_words(size_t bits) {
+    return (bits + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+}
+
+static inline int bitset_test(const uint64_t *set, size_t bit) {
+    return (int)((set[bit / BITSET_WORD_BITS] >> (bit % BITSET_WORD_BITS)) & 1u);
+}
+
+static inline void bitset_set(uint64_t *set, size_t bit) {
+    set[bit / BITSET_WORD_BITS] |= (uint64_t)1 << (bit % BITSET_WORD_BITS);
+}
+
+static inline void bitset_reset(uint64_t *set, size_t bit) {
+    set[bit / BITSET_WORD_BITS] &= ~((uint64_t)1 << (bit % BITSET_WORD_BITS));
+}
+
+void bitset_clear(uint64_t *dst, size_t words);
+// Sets the first `bits` bits and clears the padding above them
+void bitset_fill(uint64_t *dst, size_t bits, size_t words);
+void bitset_copy(uint64_t *dst, const uint64_t *src, size_t words);
+size_t bitset_count(const uint64_t *set, size_t words);
+
+// The kernels below return nonzero if dst changed
+int bitset_union_into(uint64_t *dst, const uint64_t *src, size_t words);
+int bitset_intersect_into(uint64_t *dst, const uint64_t *src, size_t words);
+// dst = a & ~b
+int bitset_difference(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t words);
+// dst = gen | (src & ~kill), the usual gen/kill transfer function
+int bitset_transfer(uint64_t *dst, const uint64_t *gen, const uint64_t *src,
+                    const uint64_t *kill, size_t words);
+
+// One bitset per row, stored contiguously
+typedef struct BitMatrix {
+    size_t    rows;
+    size_t    words;          // words per row
+    uint64_t *bits;
+} BitMatrix;
+
+void bitmatrix_init(BitMatrix *m, size_t rows, size_t bits);
+void bitmatrix_free(BitMatrix *m);
+
+static inline uint64_t *bitmatrix_row(const BitMatrix *m, size_t row) {
+    return m->bits + row * m->words;
+}
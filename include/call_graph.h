@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Who calls whom, by function index in the program. Calls are by name
+// (TAC_CALL with a variable callee); a function named anywhere else, say
+// pushed as a value, counts as called from there too. Calls to names no
+// function defines are not edges.
+typedef struct CallGraph {
+    size_t  count;            // functions of the program
+    int    *name;             // interned name per function, -1 for code outside functions
+    int    *by_sym;           // interned name -> function, or -1
+    size_t  sym_count;
+
+    int    *callee_start;     // distinct callees of each function, CSR
+    int    *callees;
+    size_t  call_count;       // call sites, with repeats
+
+    // Strongly connected components (Tarjan), numbered callees first: a
+    // component only calls components with a lower or equal number
+    int    *scc;
+    size_t  scc_count;
+    unsigned char *recursive; // in a cycle of calls, possibly just itself
+
+    unsigned char *reachable; // set by call_graph_mark_reachable
+} CallGraph;
+
+CallGraph *call_graph_build(const TACProgram *program);
+void call_graph_free(CallGraph *graph);
+
+// Function with the given interned name, or -1
+int call_graph_find(const CallGraph *graph, int sym);
+const int *call_graph_callees(const CallGraph *graph, int function, size_t *count);
+
+// Fills order (graph->count entries) with the functions by component,
+// callees first, so each comes after everything it calls outside its cycle
+void call_graph_callees_first(const CallGraph *graph, int *order);
+
+// Marks what the roots reach, code outside functions always being a root.
+// Root names that are not functions are ignored. Returns how many
+// functions are reachable.
+size_t call_graph_mark_reachable(CallGraph *graph, const char *const *roots, size_t root_count);
+
+// Drops the functions unreachable from the roots, or from "main" when
+// none are given. Without any root that names a function nothing is
+// dropped: the program's entry point is unknown. Returns how many
+// functions were removed.
+size_t call_graph_remove_dead(TACProgram *program, const char *const *roots, size_t root_count);
@@ -6,20 +6,12 @@
 
 typedef struct CFGBlock CFGBblock;
 
-typedef struct CFGBlockList {
-    struct CFGBlock **items;
-    size_t count;
-    size_t capacity;
-} CFGBlockList;
-
 typedef struct CFGBlock {
     int id;
     int is_entry;
     int is_exit;
-    TACInstr *instructions;
-
-    CFGBlockList successors;
-    CFGBlockList predecessors;
+    TACInstr *instructions;   // view into the function's instruction array
+    size_t    count;
 } CFGBlock;
 
 typedef struct CFGBlockArray {
@@ -28,23 +20,56 @@ typedef struct CFGBlockArray {
     size_t capacity;
 } CFGBlockArray;
 
+// An edge between block ids, used while the CFG is being built
+typedef struct CFGEdge {
+    int from;
+    int to;
+} CFGEdge;
+
+typedef struct CFGEdgeArray {
+    CFGEdge *items;
+    size_t count;
+    size_t capacity;
+} CFGEdgeArray;
+
 typedef struct CFG {
     CFGBlockArray blocks;
-} CFG;
 
+    // Adjacency in compressed sparse row form: the successors of block b
+    // are succ[succ_start[b] .. succ_start[b + 1]), likewise for preds.
+    // Both are NULL until cfg_freeze_edges runs.
+    int    *succ_start;
+    int    *succ;
+    int    *pred_start;
+    int    *pred;
+    size_t  edge_count;
+
+    int    *label_block;      // label id -> id of the block it starts, or -1
+    size_t  label_count;
+} CFG;
 
-void add_successor(CFGBlock *from, CFGBlock *to);
-void add_predecessor(CFGBlock *to, CFGBlock *from);
-void push_block(CFGBlockList *list, CFGBlock *block);
 
 CFGBlock *create_block(int id, int is_entry, int is_exit);
 
 void push_block_array(CFGBlockArray *array, CFGBlock *block);
+void push_edge(CFGEdgeArray *array, int from, int to);
 void init_cfg(CFG *cfg);
 void free_cfg(CFG *cfg);
 void free_cfg_block(CFGBlock *block);
-void free_cfg_block_list(CFGBlockList *list);
 void free_cfg_block_array(CFGBlockArray *array);
 
+// Groups pairs by `from` (or by `to` if by_target) with a counting sort:
+// the partners of key k are (*out_items)[(*out_start)[k] .. (*out_start)[k + 1]).
+// Keys must be below n; both arrays are malloc'd.
+void cfg_pairs_to_csr(size_t n, const CFGEdge *pairs, size_t count, int by_target,
+                      int **out_start, int **out_items);
+// Replaces the adjacency of cfg with the given edges, stored as CSR
+void cfg_freeze_edges(CFG *cfg, const CFGEdge *edges, size_t count);
+// Successor / predecessor block ids of block `id`; *count receives how many
+const int *cfg_successors(const CFG *cfg, int id, size_t *count);
+const int *cfg_predecessors(const CFG *cfg, int id, size_t *count);
+// Block a label starts, or -1
+int cfg_label_block(const CFG *cfg, int label);
+
 CFG *create_cfg(void);
-void print_cfg(CFG *cfg);
\ No newline at end of file
+void print_cfg(CFG *cfg);
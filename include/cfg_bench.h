@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Fills fn with a synthetic function of roughly `blocks` basic blocks:
+// nested while loops (with early exits) and if/else diamonds, generated
+// from a fixed seed so runs are comparable. Each loop keeps a temp live
+// from its preheader to its latch.
+void cfg_bench_generate(TACFunction *fn, size_t blocks);
+
+// Times CFG construction, dominators, frontiers and the loop forest on
+// synthetic functions of increasing size up to max_blocks, printing the
+// cost per block so non-linear growth stands out.
+void cfg_benchmark(size_t max_blocks);
+
+// Times live-variable analysis on the same functions. The sets are dense
+// (blocks x temps bits), so keep max_blocks in the tens of thousands.
+void liveness_benchmark(size_t max_blocks);
@@ -1,7 +1,10 @@
 #pragma once
 #include "cfg.h"
 
-CFG *build_from_tac(TACInstr *tac);
+// NULL (reported on stderr) if a jump goes to a label fn does not define
+CFG *build_from_tac(TACFunction *fn);
+// goto, ifz, if_<rel>, return and endfun end a basic block
+int is_block_terminator(TACInstr *instr);
 
 void free_cfg_builder(CFG *cfg);
-CFG *extract_functions(TACInstr *tac);
\ No newline at end of file
+CFG *extract_functions(TACProgram *program);
\ No newline at end of file
@@ -5,9 +5,34 @@
 #include "parser.h"
 #include "parse_statements.h"
 #include "ast_print.h"
+#include "intern.h"
+#include "lambda_lift.h"
 #include "tac.h"
 #include "tac_emit.h"
 #include "tac_parse.h"
 #include "tac_print.h"
+#include "tac_bytecode.h"
+#include "tac_read.h"
 #include "cfg.h"
-#include "cfg_builder.h"
\ No newline at end of file
+#include "cfg_builder.h"
+#include "call_graph.h"
+#include "tail_call.h"
+#include "inliner.h"
+#include "if_convert.h"
+#include "dominance.h"
+#include "loops.h"
+#include "bitset.h"
+#include "dataflow.h"
+#include "liveness.h"
+#include "ssa.h"
+#include "def_use.h"
+#include "ssa_simplify.h"
+#include "sccp.h"
+#include "lvn.h"
+#include "licm.h"
+#include "induction.h"
+#include "pre.h"
+#include "unroll.h"
+#include "rotate.h"
+#include "peephole.h"
+#include "cfg_bench.h"
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include "bitset.h"
+#include "cfg.h"
+#include "dominance.h"
+
+typedef enum {
+    DATAFLOW_FORWARD,         // in = meet(out of preds), out = f(in)
+    DATAFLOW_BACKWARD         // out = meet(in of succs), in = f(out)
+} DataflowDirection;
+
+typedef enum {
+    DATAFLOW_UNION,           // may problems (liveness, reaching definitions)
+    DATAFLOW_INTERSECT        // must problems (available expressions)
+} DataflowMeet;
+
+// A gen/kill problem over a dense lattice of `bits` facts per block.
+// The client fills gen and kill (one row per block) after dataflow_init;
+// dataflow_solve leaves the fixed point in `in` and `out`.
+typedef struct DataflowProblem {
+    DataflowDirection direction;
+    DataflowMeet      meet;
+    size_t            bits;
+
+    BitMatrix gen;
+    BitMatrix kill;
+    BitMatrix in;
+    BitMatrix out;
+
+    // Value flowing into blocks without neighbours on the meet side (the
+    // entry going forward, exits going backward). NULL means empty.
+    const uint64_t *boundary;
+
+    size_t visits;            // blocks evaluated by the last solve
+} DataflowProblem;
+
+void dataflow_init(DataflowProblem *problem, const CFG *cfg,
+                   DataflowDirection direction, DataflowMeet meet, size_t bits);
+void dataflow_free(DataflowProblem *problem);
+
+// Worklist solver: blocks are taken in reverse postorder (postorder when
+// going backward) and only requeued when a neighbour's value changed.
+// Blocks unreachable from the entry are left untouched.
+void dataflow_solve(DataflowProblem *problem, const CFG *cfg, const DomTree *dom);
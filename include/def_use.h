@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Where a temp or variable is defined or read: an instruction of the
+// function and which of its operands.
+typedef struct DefUseSite {
+    int instr;
+    int operand;      // DEF_USE_DST, DEF_USE_ARG1..3 or DEF_USE_PHI_ARG(k)
+} DefUseSite;
+
+#define DEF_USE_DST        0
+#define DEF_USE_ARG1       1
+#define DEF_USE_ARG2       2
+#define DEF_USE_ARG3       3
+#define DEF_USE_PHI_ARG(k) (4 + (int)(k))
+
+// One list of sites, a window [start, start + count) of the pool
+typedef struct DefUseList {
+    size_t   start;
+    unsigned count;
+    unsigned capacity;
+} DefUseList;
+
+typedef struct DefUseChain {
+    DefUseList defs;
+    DefUseList uses;
+} DefUseChain;
+
+// Def-use and use-def chains of one function: for every temp (indexed by
+// its number) and variable (by interned name) the instructions writing
+// it and the operands reading it, in no particular order. The lists share
+// one pool, laid out back to back when built; a list that outgrows its
+// window moves to the end of the pool with twice the room.
+//
+// The index follows edits instead of being rebuilt: unlink an instruction
+// before changing it and link it again afterwards. Deleted instructions
+// stay in place, marked dead, until def_use_compact drops them all at
+// once, so site indices stay valid while a pass runs.
+typedef struct DefUse {
+    DefUseChain   *temps;
+    size_t         temp_count;
+    DefUseChain   *vars;
+    size_t         var_count;
+
+    DefUseSite    *pool;
+    size_t         pool_count;
+    size_t         pool_capacity;
+
+    unsigned char *dead;          // per instruction, set by def_use_delete
+    size_t         instr_count;
+    size_t         dead_count;
+} DefUse;
+
+DefUse *def_use_build(const TACFunction *fn);
+void def_use_free(DefUse *du);
+
+// Sites defining / reading op (a temp or variable); NULL with *count 0 otherwise
+const DefUseSite *def_use_defs(const DefUse *du, TACOperand op, size_t *count);
+const DefUseSite *def_use_uses(const DefUse *du, TACOperand op, size_t *count);
+// The only instruction defining op, or -1 if there are none or several
+int def_use_single_def(const DefUse *du, TACOperand op);
+// The operand a site names
+TACOperand *def_use_operand(const TACFunction *fn, DefUseSite site);
+
+// Removes / adds the sites of instruction `index` as it currently reads
+void def_use_unlink(DefUse *du, const TACFunction *fn, size_t index);
+void def_use_link(DefUse *du, const TACFunction *fn, size_t index);
+// Points every use of `from` at `to` (any operand, including a literal).
+// Costs the number of uses of `from`, plus growing the list of `to`.
+void def_use_replace_uses(DefUse *du, TACFunction *fn, TACOperand from, TACOperand to);
+// Unlinks instruction `index` and marks it dead
+void def_use_delete(DefUse *du, const TACFunction *fn, size_t index);
+int def_use_is_dead(const DefUse *du, size_t index);
+// Removes the dead instructions from fn and renumbers the sites
+void def_use_compact(DefUse *du, TACFunction *fn);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include "cfg.h"
+
+// Dominator tree and dominance frontiers of a CFG, rooted at block 0.
+// Blocks unreachable from the entry have no dominator (idom -1) and are
+// left out of every other table.
+typedef struct DomTree {
+    size_t block_count;
+
+    int    *rpo;              // reachable blocks in reverse postorder
+    size_t  rpo_count;
+    int    *rpo_index;        // block -> position in rpo, or -1
+
+    int    *idom;             // block -> immediate dominator (entry: itself), or -1
+
+    int    *child_start;      // dominator tree children, CSR
+    int    *children;
+    int    *pre;              // preorder / postorder numbers in the dominator
+    int    *post;             // tree, for constant time dominance queries
+
+    int    *df_start;         // dominance frontiers, CSR
+    int    *df;
+} DomTree;
+
+// Cooper-Harvey-Kennedy: iterate idom = intersect(preds) over reverse
+// postorder until nothing changes. No recursion anywhere.
+DomTree *dom_compute(const CFG *cfg);
+void dom_free(DomTree *dom);
+
+// True if a dominates b (every block dominates itself)
+int dom_dominates(const DomTree *dom, int a, int b);
+const int *dom_children(const DomTree *dom, int block, size_t *count);
+const int *dom_frontier(const DomTree *dom, int block, size_t *count);
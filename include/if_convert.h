@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Most instructions an if-conversion may execute speculatively
+// (both arms together). Arms that are a single copy cost nothing,
+// the copied value goes straight into the select.
+#define IF_CONVERT_MAX_SPECULATED 4
+
+/*
+ * Collapses small side-effect-free diamonds
+ *
+ *   ifz c goto L0          x ← select c a b
+ *   x ← a           =>
+ *   goto L1
+ *   L0:
+ *   x ← b
+ *   L1:
+ *
+ * and triangles (an if without else, giving select c a x) into TAC_SELECT.
+ * A fused if_<rel> branch first materializes its relation into a temp.
+ * Functions in SSA form are left alone. Returns the number of branches removed.
+ */
+size_t if_convert_function(TACFunction *fn, size_t max_speculated);
+size_t if_convert_program(TACProgram *program, size_t max_speculated);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Induction variables and strength reduction on SSA form.
+//
+// A basic induction variable is a header phi whose value around the back
+// edge is itself plus or minus a literal step. A product of one with a
+// loop-invariant factor gets an induction variable of its own, started in
+// the preheader and stepped next to the original, so the multiplication
+// becomes an addition:
+//
+//   L0:                          t9 ← i * 4      (preheader, or a literal)
+//   i.1 ← phi i i.2              L0:
+//   if_ge i.1 n goto L1          i.1 ← phi i i.2
+//   t3 ← i.1 * 4         =>      t8 ← phi t9 t10
+//   ...                          if_ge i.1 n goto L1
+//   i.2 ← i.1 + 1                t3 ← t8
+//   goto L0                      ...
+//                                i.2 ← i.1 + 1
+//                                t10 ← t8 + 4
+//                                goto L0
+//
+// When the header's exit test compares the variable with a literal and
+// its range shows the scaled values cannot overflow, the test moves to
+// the reduced variable instead (linear function test replacement), and
+// the original variable goes away if nothing else reads it.
+//
+// Afterwards multiplications by a power of two become left shifts, and
+// divisions by one become arithmetic right shifts where the dividend is an
+// induction variable whose range is known not to go below zero.
+//
+// Only loops with one entering edge and one latch are handled; they are
+// given a preheader (see licm_make_preheader) when they need one.
+typedef struct InductionStats {
+    size_t ivs;               // basic induction variables found
+    size_t reduced;           // multiplications replaced by additions
+    size_t replaced_tests;    // exit tests moved to a reduced variable
+    size_t shifts;            // multiplications and divisions made shifts
+} InductionStats;
+
+// stats may be NULL; counts are added to it
+void induction(TACFunction *fn, InductionStats *stats);
+void induction_program(TACProgram *program, InductionStats *stats);
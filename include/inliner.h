@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Largest callee (in instructions) inlined at a call outside loops
+#define INLINE_MAX_SIZE 16
+
+// Allowance added per level of loop nesting around the call, up to
+// INLINE_MAX_DEPTH levels: calls in loops run more often
+#define INLINE_LOOP_BONUS 16
+#define INLINE_MAX_DEPTH 3
+
+// Largest callee inlined at its only call, which leaves it dead
+#define INLINE_ONCE_MAX_SIZE 128
+
+// The program grows by at most this many percent of its size, or by
+// INLINE_MIN_BUDGET instructions if that is more
+#define INLINE_GROWTH_PERCENT 50
+#define INLINE_MIN_BUDGET 64
+
+// Inlining before SSA form. A call and the pushes of its arguments
+//
+//   push a                   x.i1 ← a
+//   push 1                   y.i1 ← 1
+//   t4 ← call add 2    =>    t9 ← x.i1 + y.i1
+//                            t4 ← t9
+//
+// become the callee's body: each pop becomes a copy of the matching
+// argument where it was pushed, each return a copy into the call's result
+// and, unless it ends the body, a jump past it. Temps and labels get
+// fresh numbers, and the variables the callee writes fresh names; as
+// elsewhere (see lvn.h) those are taken to be its own, the rest global.
+// A call is not inlined where the caller has a variable of its own named
+// like a global the callee reads, which would take the global's place.
+//
+// Functions are done callees first, so what is inlined has already had
+// its own calls inlined. At each call the callee's size is weighed against
+// an allowance that grows with the loop depth of the call, and against
+// what is left of the program's growth budget; deeper calls go first.
+// Calls into recursive cycles stay calls unless `recursive` is set, when
+// such a body is inlined once at each call present when the pass starts.
+// Callees left without calls are dropped by call_graph_remove_dead.
+typedef struct InlineStats {
+    size_t inlined;           // calls replaced by the callee's body
+    size_t added;             // instructions the program grew by
+} InlineStats;
+
+// stats may be NULL; counts are added to it
+void inline_program(TACProgram *program, int recursive, InlineStats *stats);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+
+// Global string interner. Every distinct name is stored once and referred
+// to by a small dense id, so operands can hold names without allocating.
+
+// Returns the id for name, adding it on first use
+int intern(const char *name);
+// Same as intern() for a name that is not NUL-terminated
+int intern_n(const char *name, size_t len);
+// The string for an id returned by intern(); NULL if the id is unknown
+const char *interned_name(int id);
+// Number of names interned so far (ids are 0 .. count-1)
+size_t intern_count(void);
+void intern_free(void);
@@ -0,0 +1,10 @@
+#pragma once
+#include "ast.h"
+
+// Hoists every nested function definition in `program` (the root AST_BLOCK)
+// to the top level. Variables a nested function reads from its enclosing
+// functions become extra trailing parameters, and every call site is
+// rewritten to pass them. Lifted functions are renamed "outer.inner".
+// Captures are resolved lexically: a caller declaring x that must pass on
+// outer's x to its callee takes that one in as "x.outer".
+void lambda_lift(AstNode *program);
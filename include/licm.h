@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Loop-invariant code motion on SSA form. A while loop is lowered as
+//
+//   L0:                          t5 ← a * b       (preheader)
+//   ifz c goto L1                L0:
+//   t5 ← a * b          =>       ifz c goto L1
+//   x ← x + t5                   x ← x + t5
+//   goto L0                      goto L0
+//   L1:                          L1:
+//
+// so everything in it runs once per iteration. An instruction is
+// invariant when each operand is a literal, is defined outside the loop
+// or is defined by an instruction already hoisted; such instructions move
+// into the loop's preheader, in their original order. Loops are done
+// innermost first, so code leaves a nest one level per loop, and
+// each loop gets a preheader only when something is hoisted.
+//
+// The preheader is code right in front of the header that only the
+// edges entering the loop reach: they are retargeted to it, and when
+// there are several of them the header's phis gather their values there.
+//
+// Hoisted code may run although the loop body never does, so only
+// instructions that cannot trap or have effects move: arithmetic (division
+// and remainder by a literal other than 0 and -1), copies, selects and
+// calls of functions proven pure (see licm_program), along with the pushes
+// of their arguments. Variables the function never writes count as
+// varying in loops that call anything else, as in lvn.h.
+typedef struct LICMStats {
+    size_t loops;             // loops code was hoisted out of
+    size_t hoisted;           // instructions moved, pushes included
+    size_t calls;             // pure calls among them
+    size_t preheaders;        // new blocks made to hold the code
+} LICMStats;
+
+// pure: per interned name, nonzero for functions whose calls may be
+// hoisted; NULL hoists no calls. stats may be NULL; counts are added to it
+void licm(TACFunction *fn, const unsigned char *pure, LICMStats *stats);
+
+// Makes sure the loop whose header is labelled header_label is entered
+// from a single block that has no other successor, adding one in front of
+// the header if needed. Returns 0 if there is no such loop or it cannot
+// have one (a latch falls through into the header), 1 if it already had
+// one and 2 if it was added.
+int licm_make_preheader(TACFunction *fn, int header_label);
+
+// A function is pure when its result depends only on its arguments and
+// calling it cannot trap or fail to return: it reads only its own
+// variables, divides only by safe literals, has no loops, is not
+// recursive and only calls pure functions.
+void licm_program(TACProgram *program, LICMStats *stats);
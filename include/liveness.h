@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include "bitset.h"
+#include "cfg.h"
+#include "dominance.h"
+#include "tac.h"
+
+// Live variables of one function, which must not contain phis. Facts are numbered temps first
+// (0 .. temp_count-1), then one slot per named variable the function
+// mentions. Variables the function never defines (globals, captured
+// names) are treated as read by every call and live at every exit.
+typedef struct Liveness {
+    size_t  temp_count;
+    size_t  slot_count;
+    int    *slot_sym;         // slot -> interned name
+    int    *sym_slot;         // interned name -> slot, or -1
+    size_t  sym_count;
+
+    BitMatrix live_in;        // per block
+    BitMatrix live_out;
+    uint64_t *shared;         // the variables the function never writes
+
+    // Per instruction of the function: TAC_USE_ARG* bits of the operands
+    // whose value is not live afterwards (the last use on that path)
+    unsigned char *last_use;
+    size_t         instr_count;
+
+    size_t  visits;           // blocks evaluated by the solver
+} Liveness;
+
+Liveness *liveness_compute(const TACFunction *fn, const CFG *cfg, const DomTree *dom);
+void liveness_free(Liveness *lv);
+
+// Moves `live` from just after instr to just before it: the def dies, the
+// uses become live. Returns the TAC_USE_ARG* bits of uses that were dead.
+unsigned liveness_step(const Liveness *lv, const TACInstr *instr, uint64_t *live);
+
+// Fact number of a temp or variable operand, or -1 if it is not tracked
+int liveness_index(const Liveness *lv, TACOperand op);
+int liveness_live_in(const Liveness *lv, int block, TACOperand op);
+int liveness_live_out(const Liveness *lv, int block, TACOperand op);
+
+void liveness_print(const Liveness *lv, const CFG *cfg);
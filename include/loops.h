@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include "cfg.h"
+#include "dominance.h"
+
+// A natural loop: the header plus every block that reaches one of its
+// latches (a block with a back edge to the header) without passing the header
+typedef struct Loop {
+    int header;
+    int parent;               // enclosing loop, or -1
+    int depth;                // 1 for an outermost loop
+    int pre;                  // preorder interval in the loop tree:
+    int last;                 // nested loops have pre in (pre, last]
+} Loop;
+
+// Loop-nest forest of one CFG. Loops are stored innermost first, so a
+// loop's parent always has a higher index. Retreating edges whose target
+// does not dominate the source (irreducible flow) do not form loops.
+typedef struct LoopForest {
+    Loop   *loops;
+    size_t  count;
+
+    size_t  block_count;
+    int    *block_loop;       // innermost loop containing each block, or -1
+    int    *block_depth;      // 0 outside of any loop
+
+    int    *latch_start;      // latches of each loop, CSR
+    int    *latches;
+    int    *exit_start;       // exit blocks (outside, reached from inside), CSR
+    int    *exits;
+} LoopForest;
+
+LoopForest *loops_compute(const CFG *cfg, const DomTree *dom);
+void loops_free(LoopForest *forest);
+
+// True if `block` is in `loop` or in a loop nested inside it
+int loop_contains(const LoopForest *forest, int loop, int block);
+const int *loop_latches(const LoopForest *forest, int loop, size_t *count);
+const int *loop_exits(const LoopForest *forest, int loop, size_t *count);
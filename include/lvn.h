@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Local value numbering: within each basic block, an operator applied to
+// operands already known to hold the same values as an earlier
+// computation becomes a copy of that computation's result.
+//
+//   t0 ← a * b                   t0 ← a * b
+//   t1 ← b * a         =>        t1 ← t0
+//   t2 ← t1 + 1                  t2 ← t1 + 1
+//
+// Values are numbered as the block is scanned: a name takes the number of
+// whatever was last assigned to it, so a reassigned operand simply
+// stops matching, and a result whose name is overwritten is no longer
+// offered for reuse. Commutative operators sort their operands and
+// a > b is looked up as b < a. A call may change the variables the
+// function never writes itself, so their numbers end at each call.
+// Each block costs time linear in its length (one hash lookup per
+// instruction).
+typedef struct LVNStats {
+    size_t instructions;      // instructions looked at
+    size_t redundant;         // computations replaced by copies
+} LVNStats;
+
+// stats may be NULL; counts are added to it
+void lvn(TACFunction *fn, LVNStats *stats);
+void lvn_program(TACProgram *program, LVNStats *stats);
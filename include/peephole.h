@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Longest window of instructions a rule looks at
+#define PEEPHOLE_MAX_WINDOW 3
+
+// Rules peephole_rules may hold, for the counters in PeepholeStats
+#define PEEPHOLE_MAX_RULES 32
+
+// In a rule's kinds: any instruction but labels, function bounds and phis
+#define PEEPHOLE_ANY TAC_KIND_COUNT
+
+// Runs of the pass a rule takes part in: the one right after the front
+// end, the one after the other passes, or both
+#define PEEPHOLE_EARLY 1u
+#define PEEPHOLE_LATE  2u
+
+// Peephole optimisation over windows of adjacent instructions, as in
+//
+//   t1 ← a * 1                   x ← a
+//   x ← t1               =>
+//   goto L3                      L3:
+//   L3:
+//
+// Rules live in a table (see peephole_rules.c); each names the kinds of
+// the instructions in its window and a rewrite that, given those, fills in
+// what replaces them or declines. Rules are found by the kind of the
+// window's first instruction, so only those that can match are tried, and
+// the first that applies wins. Sweeps repeat until none applies; every
+// rule must leave the code shorter or simpler, so this ends.
+//
+// Rules see how often each temp is read in the function, kept current as
+// windows are replaced, so a temp read once can be folded into its use.
+// Rules turning multiplications into cheaper forms only run late, as
+// induction.h reduces the ones in loops better.
+typedef struct PeepholeWindow {
+    const TACInstr *in;               // the matched instructions
+    const int      *temp_uses;        // reads per temp in the function
+    TACInstr        out[PEEPHOLE_MAX_WINDOW];
+    size_t          out_count;        // instructions replacing the window
+} PeepholeWindow;
+
+typedef struct PeepholeRule {
+    const char *name;
+    size_t      length;               // instructions in the window
+    TACOpKind   kinds[PEEPHOLE_MAX_WINDOW];
+    unsigned    runs;                 // PEEPHOLE_EARLY and/or PEEPHOLE_LATE
+    int       (*rewrite)(PeepholeWindow *w);   // 1 and w->out filled if it applies
+} PeepholeRule;
+
+extern const PeepholeRule peephole_rules[];
+extern const size_t peephole_rule_count;
+
+typedef struct PeepholeStats {
+    size_t hits[PEEPHOLE_MAX_RULES];  // per rule of peephole_rules
+    size_t rewrites;                  // windows replaced, all rules
+    size_t rounds;                    // sweeps over functions, the last changing nothing
+} PeepholeStats;
+
+// run (PEEPHOLE_EARLY or PEEPHOLE_LATE) picks the rules; stats may be
+// NULL, counts are added to it
+void peephole(TACFunction *fn, unsigned run, PeepholeStats *stats);
+void peephole_program(TACProgram *program, unsigned run, PeepholeStats *stats);
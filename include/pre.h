@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Partial redundancy elimination by lazy code motion (Knoop, Rüthing and
+// Steffen, in the edge-based form of Drechsler and Stadel). An expression
+// computed on some paths to a point and recomputed there is evaluated
+// once on the paths that lacked it, into a fresh temp, and the
+// recomputation reads the temp:
+//
+//   ifz c goto L1                ifz c goto L1
+//   x ← a * b                    t9 ← a * b
+//   goto L2                      x ← t9
+//   L1:                 =>       goto L2
+//   ...                          L1:
+//   L2:                          ...
+//   y ← a * b                    t9 ← a * b
+//                                L2:
+//                                y ← t9
+//
+// Loop-invariant computations are the special case where the missing path
+// is the loop entry. Placement is as late as possible without losing any
+// redundancy, so temps live no longer than they must: anticipability
+// (backward) and availability (forward) are solved with the bitset
+// dataflow solver, earliest placements are derived per edge and pushed
+// down while nothing uses them. Code for an edge goes at the end of its
+// source or the start of its target when the other has no other edges;
+// otherwise the edge is split.
+//
+// Expressions are lexical (operator and operand names), so the pass runs
+// on code out of SSA form. Division and remainder are only moved when the
+// divisor is a literal other than 0 and -1. A call may change the
+// variables the function never writes, as in lvn.h.
+typedef struct PREStats {
+    size_t expressions;       // expressions given a temp
+    size_t inserted;          // computations placed on edges
+    size_t deleted;           // redundant computations replaced by copies
+    size_t split_edges;       // edges split to hold new code
+} PREStats;
+
+// stats may be NULL; counts are added to it
+void pre(TACFunction *fn, PREStats *stats);
+void pre_program(TACProgram *program, PREStats *stats);
@@ -12,4 +12,5 @@
 #define REGEX_BRACE_CLOSE   "[\\}]"
 #define REGEX_COMPARISON    "(==|!=|<=|>=|<|>)"
 #define REGEX_LOGICAL       "(&&|\\|\\|)"
-#define REGEX_COMMA         "[,]"
\ No newline at end of file
+#define REGEX_COMMA         "[,]"
+#define REGEX_STRING        "\"[^\"\n]*\""
\ No newline at end of file
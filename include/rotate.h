@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Most instructions of a loop's test that rotation copies to the bottom
+#define ROTATE_MAX_TEST 4
+
+// Loop rotation, after SSA form is gone. A lowered while loop jumps
+// twice per iteration, back to the test and past it:
+//
+//   L0:                          L0:
+//   t1 ← i < n                   t1 ← i < n
+//   ifz t1 goto L1               ifz t1 goto L1
+//   ...                  =>      L2:
+//   goto L0                      ...
+//   L1:                          t1 ← i < n
+//                                if_ne t1 0 goto L2
+//                                L1:
+//
+// The test stays in front as a guard, and a copy of it at the bottom
+// branches back to the top of the body while the loop goes on, so each
+// iteration takes one branch. The body is now the loop's header and its
+// only latch ends in the test, the do-while shape.
+//
+// Loops whose test is a single block of at most ROTATE_MAX_TEST
+// instructions, ending in the jump out, and that have a single latch
+// ending in `goto` to it are rotated. The test runs as often as before.
+typedef struct RotateStats {
+    size_t loops;             // loops rotated
+    size_t copied;            // test instructions copied to the bottom
+} RotateStats;
+
+// stats may be NULL; counts are added to it
+void rotate(TACFunction *fn, RotateStats *stats);
+void rotate_program(TACProgram *program, RotateStats *stats);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Sparse conditional constant propagation (Wegman-Zadeck) on SSA form.
+// Each temp and variable is undetermined, one constant, or varying;
+// blocks are only evaluated once an edge into them is known to run, so
+// constants flowing around a loop or past a decided branch are found.
+//
+// Arithmetic folds with the wrap-around of 32-bit ints. Division or
+// remainder by zero and INT_MIN / -1 are left for run time. x * 0,
+// x && 0 and x || (nonzero) fold whatever x is.
+//
+// Afterwards reads of constants become literals, branches that always go
+// one way become a goto or disappear, selects on a constant become
+// copies, unreachable blocks are deleted and phis lose the arguments of
+// edges that never run. The definitions of the constants are left for
+// ssa_simplify to delete.
+typedef struct SCCPStats {
+    size_t constants;         // temps and variables found constant
+    size_t branches;          // conditional jumps decided
+    size_t blocks;            // unreachable blocks removed
+} SCCPStats;
+
+// stats may be NULL; counts are added to it
+void sccp(TACFunction *fn, SCCPStats *stats);
+void sccp_program(TACProgram *program, SCCPStats *stats);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+/*
+ * Pruned SSA form for the temps and variables a function writes.
+ *
+ *   fun f:                       fun f:
+ *   define i = 0                 define i = 0
+ *   L0:                  =>      L0:
+ *   if_ge i n goto L1            i.1 ← phi i i.2
+ *   i ← i + 1                    if_ge i.1 n goto L1
+ *   goto L0                      i.2 ← i.1 + 1
+ *                                goto L0
+ *
+ * The first definition of a name keeps it; later ones get a fresh temp,
+ * or "name.N" for variables. Phis are placed on the iterated dominance
+ * frontiers of the definitions, only where the value is live. Variables
+ * the function never writes are left alone, and reads of a renamed value
+ * that no definition reaches become the literal 0.
+ *
+ * Only functions with a TAC_FUNCTION header are converted; construction
+ * also drops blocks unreachable from the entry, so phi arguments line up
+ * with the predecessors of the rebuilt CFG.
+ */
+void ssa_construct(TACFunction *fn);
+void ssa_construct_program(TACProgram *program);
+
+// Replaces phis with copies at the end of each predecessor. Copies on an
+// edge from a conditional jump go into a new block (the edge is split);
+// each edge's copies are ordered so none overwrites a value another still
+// reads, breaking cycles (swaps) through a temp. Versions of a variable
+// that never overlap then share its name again, and copies between temps
+// are coalesced the same way, so untouched code gets its names back.
+void ssa_destruct(TACFunction *fn);
+void ssa_destruct_program(TACProgram *program);
+
+// Checks single assignment, phi placement and arity, and that every use
+// is dominated by its definition. Prints each problem to stderr and
+// returns how many there were.
+size_t ssa_verify(const TACFunction *fn);
+size_t ssa_verify_program(const TACProgram *program);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Cleanups on SSA form, driven by the def-use chains (def_use.h) so each
+// rewrite costs only the uses it touches:
+//   - copy propagation: readers of x ← y (or define x = y) read y instead
+//   - a phi whose arguments are all one value, or the phi itself, is
+//     replaced by that value
+//   - instructions without side effects whose result is never read are
+//     deleted, and then whatever only they read
+// A block following a conditional jump keeps its last instruction, so the
+// shape of the CFG (and the phi arguments of its successors) is unchanged.
+typedef struct SSASimplifyStats {
+    size_t copies;        // copies propagated
+    size_t phis;          // trivial phis replaced
+    size_t dead;          // unused instructions deleted
+} SSASimplifyStats;
+
+// stats may be NULL; counts are added to it
+void ssa_simplify(TACFunction *fn, SSASimplifyStats *stats);
+void ssa_simplify_program(TACProgram *program, SSASimplifyStats *stats);
@@ -1,17 +1,22 @@
 #pragma once
 
+#include <stddef.h>
+
 typedef enum {
+    TAC_OP_NONE,      // absent operand
     TAC_OP_TEMP,
     TAC_OP_VAR,
     TAC_OP_LITERAL,
     TAC_OP_LABEL
 } TACOperandType;
 
+// Operands are small values stored inline in each instruction.
+// Variable names are interned (see intern.h), so no operand owns memory.
 typedef struct {
     TACOperandType type;
     union {
-        char *name;        // for TEMP/VAR/LABEL
-        int literal;      // for LITERAL
+        int sym;          // for VAR: interned name id
+        int literal;      // for LITERAL, and the number of a TEMP/LABEL
     };
 } TACOperand;
 
@@ -24,17 +29,22 @@ typedef enum {
     TAC_IFZ,          // ifz cond goto label
     TAC_PUSH,
     TAC_POP,          // push/pop for stack management
-    TAC_CALL,         // t = call f, n_args
+    TAC_CALL,         // t = call f, n_args (t = tail call f, n_args if op.tail)
     TAC_RETURN,       // return t or return
-    TAC_FUNCTION,     // fun name
+    TAC_FUNCTION,     // fun name (arg1/arg2: literal temp and label counts)
     TAC_END_FUNCTION, // End of function definition
-    TAC_DEFINE
+    TAC_DEFINE,
+    TAC_IF_CMP,       // if_<rel> a b goto label (relation in op.binop, label in dst)
+    TAC_SELECT,       // t = select c a b  (a if c != 0, else b; b in arg3)
+    TAC_PHI,          // t = phi a b ...   (arguments in the phi pool, see tac_emit.h)
+    TAC_KIND_COUNT    // number of instruction kinds, keep last
 } TACOpKind;
 
 typedef enum {
     TAC_ADD, TAC_SUB, TAC_MUL, TAC_DIV, TAC_MOD,
     TAC_EQ, TAC_NEQ, TAC_LT, TAC_LTE, TAC_GT, TAC_GTE,
-    TAC_AND, TAC_OR
+    TAC_AND, TAC_OR,
+    TAC_SHL, TAC_SHR          // a << b, a >> b (arithmetic); b is taken modulo 32
 } TACBinOp;
 
 typedef enum {
@@ -45,14 +55,39 @@ typedef enum {
 typedef struct TACInstr {
     TACOpKind kind;
 
-    TACOperand *dst;
-    TACOperand *arg1;
-    TACOperand *arg2; 
+    TACOperand dst;
+    TACOperand arg1;
+    TACOperand arg2;
+    TACOperand arg3;      // only used by TAC_SELECT
 
     union {
         TACBinOp binop;
         TACUnaryOp unop;
+        int tail;         // TAC_CALL: directly returned, see tail_call.h
     } op;
-
-    struct TACInstr *next; // Pointer to the next instruction in the list
 } TACInstr;
+
+#define TAC_NO_LABEL ((size_t)-1)
+
+// The instructions of one function, stored contiguously.
+// A function body is bracketed by TAC_FUNCTION and TAC_END_FUNCTION;
+// code outside of any function lives in a segment without those markers.
+typedef struct TACFunction {
+    TACInstr *instrs;
+    size_t    count;
+    size_t    capacity;
+
+    size_t   *label_pos;      // label id -> index of its TAC_LABEL, or TAC_NO_LABEL
+    size_t    label_capacity;
+
+    // Temps and labels are numbered densely per function: 0 .. count-1.
+    // A TAC_FUNCTION header carries the same counts as literal operands.
+    int       temp_count;
+    int       label_count;
+} TACFunction;
+
+typedef struct TACProgram {
+    TACFunction *functions;
+    size_t       count;
+    size_t       capacity;
+} TACProgram;
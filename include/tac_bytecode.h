@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "tac.h"
+
+/*
+ * Compact binary form of a TACProgram.
+ *
+ *   header    "TACB", u8 version, u64 source hash (little endian)
+ *   names     varint count, then (varint length, bytes) per name
+ *   functions varint count, then per function:
+ *               varint instr count, varint temp count, varint label count
+ *               instructions
+ *   instr     u8 opcode, [u8 binop/unop/relation/tail], u8 operand kinds, operands
+ *
+ * The kinds byte packs the TACOperandType of dst, arg1 and arg2 in base 5;
+ * TAC_SELECT follows its operands with one more kind byte and arg3.
+ * TAC_PHI is u8 opcode, u8 dst kind, dst, varint argument count, then
+ * (u8 kind, operand) per argument.
+ * Temps, labels and name indices are unsigned varints, literals are
+ * zigzag varints.
+ */
+
+#define TAC_BYTECODE_VERSION 5
+
+uint64_t tac_hash_source(const char *source, size_t len);
+
+// Encodes program into a malloc'd buffer; *out_len receives its size
+unsigned char *tac_encode(const TACProgram *program, uint64_t source_hash, size_t *out_len);
+// Decodes straight from data (e.g. a mapped file); NULL if it is malformed
+TACProgram *tac_decode(const unsigned char *data, size_t len, uint64_t *source_hash);
+
+// Writes the cache after checking that it decodes back to `program`.
+// Returns 0 on success.
+int tac_write_cache(const char *path, const TACProgram *program, uint64_t source_hash);
+// Returns NULL if the cache is missing, stale or unreadable
+TACProgram *tac_load_cache(const char *path, uint64_t source_hash);
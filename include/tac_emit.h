@@ -1,36 +1,95 @@
 #pragma once
 #include "tac.h"
 
+#define TAC_NO_FUNCTION ((size_t)-1)
+
+// Appends instructions to the function currently being lowered.
+typedef struct TACBuilder {
+    TACProgram *program;
+    size_t      function;      // index into program->functions, or TAC_NO_FUNCTION
+    size_t      global;        // segment collecting code outside functions
+} TACBuilder;
+
+
+#define TAC_NONE ((TACOperand){ .type = TAC_OP_NONE })
+
+TACOperand tac_create_operand(TACOperandType type, const char *name, int literal);
+TACOperand tac_temp(int id);
+TACOperand tac_label(int id);
+TACOperand tac_literal(int value);
+TACOperand tac_var(const char *name);
+int tac_operand_equal(TACOperand a, TACOperand b);
+
+// Phi arguments live in one process-wide pool, like interned names: a
+// TAC_PHI holds the index of its first argument in arg1 and the argument
+// count in arg2 (both literals), one argument per predecessor of its block
+// in cfg_predecessors order. Copying a phi shares its arguments.
+// Returns the index of `count` new, empty arguments
+int tac_phi_alloc(size_t count);
+// The arguments of a phi; valid until the next tac_phi_alloc
+TACOperand *tac_phi_args(const TACInstr *phi);
+size_t tac_phi_arg_count(const TACInstr *phi);
+void tac_phi_free(void);
+
+TACProgram *tac_program_create(void);
+// The returned pointer is valid until the next function is added
+TACFunction *tac_program_add_function(TACProgram *program);
+void tac_program_free(TACProgram *program);
+
+// Appends a copy of instr
+TACInstr *tac_function_push(TACFunction *fn, TACInstr instr);
+// Index of the instruction defining `label`, or TAC_NO_LABEL
+size_t tac_function_label_index(const TACFunction *fn, int label);
+void tac_function_free(TACFunction *fn);
+// Next unused temp / label id of the function
+int tac_function_new_temp(TACFunction *fn);
+int tac_function_new_label(TACFunction *fn);
+// Copies temp_count and label_count into the TAC_FUNCTION header, if any
+void tac_function_sync_header(TACFunction *fn);
+// Sets the counts from the highest ids used (for TAC that was not lowered here)
+void tac_function_recount(TACFunction *fn);
+
+void tac_builder_init(TACBuilder *b, TACProgram *program);
+TACFunction *tac_builder_function(TACBuilder *b);
+// Last instruction of the current function, or NULL if it is empty
+TACInstr *tac_builder_tail(TACBuilder *b);
+size_t tac_builder_count(TACBuilder *b);
+int tac_builder_new_temp(TACBuilder *b);
+int tac_builder_new_label(TACBuilder *b);
+// Starts a new function and returns the index of the enclosing one
+size_t tac_builder_begin_function(TACBuilder *b);
+void tac_builder_end_function(TACBuilder *b, size_t enclosing);
 
-TACOperand *tac_create_operand(TACOperandType type, const char *name, int literal);
 // t = a + b, t = a * b, etc.
-TACInstr *tac_emit_binary_op(TACBinOp binop, TACOperand *dst, TACOperand *arg1, TACOperand *arg2);
+TACInstr *tac_emit_binary_op(TACBuilder *b, TACBinOp binop, TACOperand dst, TACOperand arg1, TACOperand arg2);
 // t = -a
-TACInstr *tac_emit_unary_op(TACUnaryOp unop, TACOperand *dst, TACOperand *arg1);
+TACInstr *tac_emit_unary_op(TACBuilder *b, TACUnaryOp unop, TACOperand dst, TACOperand arg1);
 // t = a
-TACInstr *tac_emit_copy(TACOperand *dst, TACOperand *arg1);
+TACInstr *tac_emit_copy(TACBuilder *b, TACOperand dst, TACOperand arg1);
 // label:
-TACInstr *tac_emit_label(TACOperand *dst);
+TACInstr *tac_emit_label(TACBuilder *b, TACOperand dst);
 // goto label
-TACInstr *tac_emit_goto(TACOperand *arg1);
+TACInstr *tac_emit_goto(TACBuilder *b, TACOperand arg1);
 // t0 = a < b
 // ifz t0 goto label
-TACInstr *tac_emit_ifz(TACOperand *arg1, TACOperand *arg2);
+TACInstr *tac_emit_ifz(TACBuilder *b, TACOperand arg1, TACOperand arg2);
+// if_lt a b goto label (jumps when `a rel b` holds)
+TACInstr *tac_emit_if_cmp(TACBuilder *b, TACBinOp rel, TACOperand arg1, TACOperand arg2, TACOperand label);
+// t = select c a b
+TACInstr *tac_emit_select(TACBuilder *b, TACOperand dst, TACOperand cond, TACOperand if_true, TACOperand if_false);
+// t = phi a b ...
+TACInstr *tac_emit_phi(TACBuilder *b, TACOperand dst, const TACOperand *args, size_t count);
 // push x
-TACInstr *tac_emit_param(TACOperand *arg1);
+TACInstr *tac_emit_param(TACBuilder *b, TACOperand arg1);
 // pop x
-TACInstr *tac_emit_arg(TACOperand *arg1);
+TACInstr *tac_emit_arg(TACBuilder *b, TACOperand arg1);
 // t = call f, n_args
-TACInstr *tac_emit_call(TACOperand *dst, TACOperand *arg1, int n_args);
+TACInstr *tac_emit_call(TACBuilder *b, TACOperand dst, TACOperand arg1, int n_args);
 // return t or return
-TACInstr *tac_emit_return(TACOperand *arg1);
+TACInstr *tac_emit_return(TACBuilder *b, TACOperand arg1);
 // fun name
-TACInstr *tac_emit_function(TACOperand *dst);
+TACInstr *tac_emit_function(TACBuilder *b, TACOperand dst);
 // End of function definition
-TACInstr *tac_emit_end_function(void);
+TACInstr *tac_emit_end_function(TACBuilder *b);
 // Define a new variable or temporary
-TACInstr *tac_emit_define(TACOperand *dst, TACOperand *arg1);
-
-void tac_free_operand(TACOperand *operand);
-
-void tac_free_instr(TACInstr *instr);
\ No newline at end of file
+TACInstr *tac_emit_define(TACBuilder *b, TACOperand dst, TACOperand arg1);
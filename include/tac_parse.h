@@ -1,7 +1,15 @@
 #pragma once
 #include "tac.h"
+#include "tac_emit.h"
 #include "ast.h"
 
-TACInstr *tac_parse_expression(AstNode *ast, int *temp_counter);
-TACInstr *tac_parse(AstNode *ast, int *temp_counter);
-void tac_print_list(TACInstr *head);
\ No newline at end of file
+// Lowers a whole program; every function gets its own instruction array
+// and its own dense temp and label numbering
+TACProgram *tac_parse(AstNode *ast);
+// Lowers one AST node, appending to the builder's current function
+void tac_parse_node(AstNode *ast, TACBuilder *b);
+// Lowers an expression and returns the operand holding its value.
+// With a destination (anything but TAC_NONE) the value is computed straight
+// into it; without one, literals and variables come back as themselves and
+// everything else gets a new temp.
+TACOperand tac_parse_expression(AstNode *ast, TACBuilder *b, TACOperand dest);
@@ -2,4 +2,5 @@
 #include "tac.h"
 void tac_print_operand(const TACOperand *op);
 void tac_print_instr(const TACInstr *p);
-void tac_print_list(TACInstr *head);
\ No newline at end of file
+void tac_print_list(const TACInstr *instrs, size_t count);
+void tac_print_program(const TACProgram *program);
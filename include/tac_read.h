@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+/*
+ * Reads TAC in the textual form printed by tac_print_instr / tac_print_list:
+ *
+ *   fun f:            t1 ← a + b        ifz t1 goto L2     push x
+ *   endfun            t1 ← - a          goto L3            pop x
+ *   L2:               t1 ← a            return [x]         t1 ← call f 2
+ *   define x [= a]    if_lt a b goto L2  t1 ← select c a b
+ *
+ * `=` is accepted in place of `←`, the "N: " line numbers and indentation
+ * of tac_print_list are skipped, and `;` starts a comment. Lines outside
+ * fun/endfun go to the global segment, like lowered code does. The
+ * "; N temps, M labels" tac_print writes after "fun f:" sets the counts of
+ * f; without it they follow from the highest ids used. Every jump must go
+ * to a label defined in the same function.
+ */
+
+// Returns NULL (after reporting filename:line) if the text is malformed
+TACProgram *tac_read(const char *text, size_t len, const char *filename);
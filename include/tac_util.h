@@ -8,3 +8,30 @@ TACUnaryOp tac_get_unop(AstNode *ast);
 const char *tac_binop_str(TACBinOp o);
 const char *tac_unop_str(TACUnaryOp o);
 
+// ==, !=, <, <=, >, >=
+int tac_is_relational(TACBinOp o);
+// The relation that holds exactly when `o` does not (< becomes >=, ...)
+TACBinOp tac_negate_relation(TACBinOp o);
+// "lt", "ge", ... as used in the if_<rel> mnemonics
+const char *tac_relation_mnemonic(TACBinOp o);
+// Label a goto/ifz/if_<rel> may jump to, or -1 for other instructions
+int tac_jump_target(const TACInstr *instr);
+// Points a goto / ifz / if_<rel> at another label
+void tac_set_jump_target(TACInstr *instr, int label);
+
+// Operand fields an instruction reads as values (function names and
+// labels are not values). Literal operands may be included.
+#define TAC_USE_ARG1 1u
+#define TAC_USE_ARG2 2u
+#define TAC_USE_ARG3 4u
+unsigned tac_use_mask(const TACInstr *instr);
+// The operand an instruction writes, or NULL
+const TACOperand *tac_def_operand(const TACInstr *instr);
+// Fills pushes with the indices of the pushes the call at `call` takes,
+// in push order: the latest in its block not taken by calls in between.
+// Returns the argument count, or -1 if they are not all in the block or
+// there are more than capacity.
+int tac_call_pushes(const TACFunction *fn, size_t call, size_t *pushes, size_t capacity);
+
+// Structural equality of two programs (same functions, instructions and operands)
+int tac_program_equal(const TACProgram *a, const TACProgram *b);
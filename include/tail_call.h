@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Tail calls, calls whose result is returned right away:
+//
+//   t5 ← call f 2
+//   return t5
+//
+// A function calling itself this way needs no new frame. Before SSA form,
+// tail_call_eliminate turns such calls into a loop:
+//
+//   fun fact:                    fun fact:
+//   pop n                        pop n
+//   pop acc                      pop acc
+//   ...                          L4:
+//   push t2                      ...
+//   push t3              =>      t6 ← t2
+//   t4 ← call fact 2             t7 ← t3
+//   return t4                    n ← t6
+//   ...                          acc ← t7
+//                                goto L4
+//                                ...
+//
+// Each argument is saved where it was pushed, as the pushes it replaces
+// took the value there, and the parameters (the pops right after `fun`)
+// are set only at the call, as later arguments may read them. The loop
+// then runs in one frame and the scalar passes see it as any other loop.
+//
+// tail_call_mark, run once the other passes are done, sets op.tail on the
+// remaining calls followed directly by a return of their result (or a
+// plain return), which a backend can emit as jumps; it clears it on all
+// other calls.
+typedef struct TailCallStats {
+    size_t self;              // self tail calls turned into jumps
+    size_t marked;            // other tail calls marked
+} TailCallStats;
+
+// stats may be NULL; counts are added to it
+void tail_call_eliminate(TACFunction *fn, TailCallStats *stats);
+void tail_call_eliminate_program(TACProgram *program, TailCallStats *stats);
+void tail_call_mark(TACFunction *fn, TailCallStats *stats);
+void tail_call_mark_program(TACProgram *program, TailCallStats *stats);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include "tac.h"
+
+// Copies of the body a partially unrolled loop runs per test (--unroll=N)
+#define UNROLL_DEFAULT_FACTOR 4
+
+// Loops running at most this many times are unrolled completely
+#define UNROLL_FULL_MAX_TRIPS 8
+
+// Most instructions unrolling one loop may add. A function grows by at
+// most its own size, or this much if it is smaller
+#define UNROLL_MAX_GROWTH 64
+
+// Loop unrolling, after SSA form is gone. Counted loops are those laid
+// out as lowered while loops,
+//
+//   L0:
+//   if_ge i n goto L1
+//   ...                      (no other writes of i or n)
+//   i ← i + 2
+//   goto L0
+//   L1:
+//
+// whose test compares an induction variable, stepped by a literal once
+// per iteration, with a literal or a loop-invariant bound.
+//
+// When i starts at a literal the trip count is known; loops running at
+// most UNROLL_FULL_MAX_TRIPS times become straight-line copies of their
+// body. Others run `factor` copies per test of whether that many
+// iterations remain (i < n - 6 above), then finish in the original loop.
+// A remainder loop is left out when the trip count is a known multiple of
+// the factor. Bounds that are not literals are adjusted in front of the
+// loop, with a guard sending values the adjustment would overflow
+// straight to the remainder.
+typedef struct UnrollStats {
+    size_t full;              // loops replaced by copies of their body
+    size_t partial;           // loops running several copies per test
+    size_t remainders;        // remainder loops among them
+    size_t copies;            // bodies copied
+} UnrollStats;
+
+// factor below 2 leaves out partial unrolling, 0 turns the pass off.
+// stats may be NULL; counts are added to it
+void unroll(TACFunction *fn, int factor, UnrollStats *stats);
+void unroll_program(TACProgram *program, int factor, UnrollStats *stats);
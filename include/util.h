@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stddef.h>
+
+// Zeroed memory for count items of size, at least one so count may be 0;
+// exits with a message if there is none
+void *xcalloc(size_t count, size_t size);
@@ -0,0 +1,142 @@
+#include "bitset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#define BITSET_LANE_WORDS 4   // words per 256-bit vector
+#endif
+
+void bitset_clear(uint64_t *dst, size_t words) {
+    memset(dst, 0, words * sizeof(uint64_t));
+}
+
+void bitset_fill(uint64_t *dst, size_t bits, size_t words) {
+    memset(dst, 0xff, words * sizeof(uint64_t));
+    if (bits % BITSET_WORD_BITS && words > 0) {
+        dst[words - 1] = ((uint64_t)1 << (bits % BITSET_WORD_BITS)) - 1;
+    }
+}
+
+void bitset_copy(uint64_t *dst, const uint64_t *src, size_t words) {
+    memcpy(dst, src, words * sizeof(uint64_t));
+}
+
+size_t bitset_count(const uint64_t *set, size_t words) {
+    size_t count = 0;
+    for (size_t i = 0; i < words; i++) count += (size_t)__builtin_popcountll(set[i]);
+    return count;
+}
+
+// Each kernel XORs old and new words into an accumulator instead of
+// branching per word; the accumulator is tested once at the end.
+
+int bitset_union_into(uint64_t *dst, const uint64_t *src, size_t words) {
+    size_t i = 0;
+    uint64_t diff = 0;
+#ifdef __AVX2__
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + BITSET_LANE_WORDS <= words; i += BITSET_LANE_WORDS) {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i r = _mm256_or_si256(d, s);
+        acc = _mm256_or_si256(acc, _mm256_xor_si256(r, d));
+        _mm256_storeu_si256((__m256i *)(dst + i), r);
+    }
+    diff |= !_mm256_testz_si256(acc, acc);
+#endif
+    for (; i < words; i++) {
+        uint64_t r = dst[i] | src[i];
+        diff |= r ^ dst[i];
+        dst[i] = r;
+    }
+    return diff != 0;
+}
+
+int bitset_intersect_into(uint64_t *dst, const uint64_t *src, size_t words) {
+    size_t i = 0;
+    uint64_t diff = 0;
+#ifdef __AVX2__
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + BITSET_LANE_WORDS <= words; i += BITSET_LANE_WORDS) {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i r = _mm256_and_si256(d, s);
+        acc = _mm256_or_si256(acc, _mm256_xor_si256(r, d));
+        _mm256_storeu_si256((__m256i *)(dst + i), r);
+    }
+    diff |= !_mm256_testz_si256(acc, acc);
+#endif
+    for (; i < words; i++) {
+        uint64_t r = dst[i] & src[i];
+        diff |= r ^ dst[i];
+        dst[i] = r;
+    }
+    return diff != 0;
+}
+
+int bitset_difference(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t words) {
+    size_t i = 0;
+    uint64_t diff = 0;
+#ifdef __AVX2__
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + BITSET_LANE_WORDS <= words; i += BITSET_LANE_WORDS) {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i r = _mm256_andnot_si256(vb, va);
+        acc = _mm256_or_si256(acc, _mm256_xor_si256(r, d));
+        _mm256_storeu_si256((__m256i *)(dst + i), r);
+    }
+    diff |= !_mm256_testz_si256(acc, acc);
+#endif
+    for (; i < words; i++) {
+        uint64_t r = a[i] & ~b[i];
+        diff |= r ^ dst[i];
+        dst[i] = r;
+    }
+    return diff != 0;
+}
+
+int bitset_transfer(uint64_t *dst, const uint64_t *gen, const uint64_t *src,
+                    const uint64_t *kill, size_t words) {
+    size_t i = 0;
+    uint64_t diff = 0;
+#ifdef __AVX2__
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + BITSET_LANE_WORDS <= words; i += BITSET_LANE_WORDS) {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i g = _mm256_loadu_si256((const __m256i *)(gen + i));
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i k = _mm256_loadu_si256((const __m256i *)(kill + i));
+        __m256i r = _mm256_or_si256(g, _mm256_andnot_si256(k, s));
+        acc = _mm256_or_si256(acc, _mm256_xor_si256(r, d));
+        _mm256_storeu_si256((__m256i *)(dst + i), r);
+    }
+    diff |= !_mm256_testz_si256(acc, acc);
+#endif
+    for (; i < words; i++) {
+        uint64_t r = gen[i] | (src[i] & ~kill[i]);
+        diff |= r ^ dst[i];
+        dst[i] = r;
+    }
+    return diff != 0;
+}
+
+void bitmatrix_init(BitMatrix *m, size_t rows, size_t bits) {
+    m->rows = rows;
+    m->words = bitset_words(bits);
+    size_t total = rows * m->words;
+    m->bits = calloc(total ? total : 1, sizeof(uint64_t));
+    if (!m->bits) {
+        printf("Memory allocation failed for bit matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void bitmatrix_free(BitMatrix *m) {
+    free(m->bits);
+    m->bits = NULL;
+    m->rows = m->words = 0;
+}
@@ -0,0 +1,254 @@
+#include "call_graph.h"
+#include "cfg.h"
+#include "intern.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int *call_graph_alloc_ints(size_t count, int fill) {
+    int *items = malloc((count ? count : 1) * sizeof(int));
+    if (!items) {
+        printf("Memory allocation failed for call graph.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < count; i++) items[i] = fill;
+    return items;
+}
+
+static unsigned char *call_graph_alloc_flags(size_t count) {
+    unsigned char *flags = calloc(count ? count : 1, 1);
+    if (!flags) {
+        printf("Memory allocation failed for call graph.\n");
+        exit(EXIT_FAILURE);
+    }
+    return flags;
+}
+
+int call_graph_find(const CallGraph *graph, int sym) {
+    return sym >= 0 && (size_t)sym < graph->sym_count ? graph->by_sym[sym] : -1;
+}
+
+const int *call_graph_callees(const CallGraph *graph, int function, size_t *count) {
+    *count = (size_t)(graph->callee_start[function + 1] - graph->callee_start[function]);
+    return graph->callees + graph->callee_start[function];
+}
+
+void call_graph_callees_first(const CallGraph *graph, int *order) {
+    // counting sort by component number
+    size_t *start = calloc(graph->scc_count + 1, sizeof(size_t));
+    if (!start) {
+        printf("Memory allocation failed for call graph.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t f = 0; f < graph->count; f++) start[graph->scc[f] + 1]++;
+    for (size_t c = 0; c < graph->scc_count; c++) start[c + 1] += start[c];
+    for (size_t f = 0; f < graph->count; f++) order[start[graph->scc[f]]++] = (int)f;
+    free(start);
+}
+
+// Edge to the function named by op, once per caller
+static void add_call(CallGraph *graph, CFGEdgeArray *edges, int *last_caller, int caller, TACOperand op) {
+    if (op.type != TAC_OP_VAR) return;
+    int callee = call_graph_find(graph, op.sym);
+    if (callee < 0 || last_caller[callee] == caller) return;
+    last_caller[callee] = caller;
+    push_edge(edges, caller, callee);
+}
+
+// Tarjan's algorithm with an explicit stack of (function, next callee)
+static void find_sccs(CallGraph *graph) {
+    size_t n = graph->count;
+    int *index = call_graph_alloc_ints(n, -1);
+    int *low = call_graph_alloc_ints(n, 0);
+    int *next = call_graph_alloc_ints(n, 0);
+    int *walk = call_graph_alloc_ints(n, 0);       // the DFS path
+    int *stack = call_graph_alloc_ints(n, 0);      // visited, component not yet closed
+    unsigned char *on_stack = call_graph_alloc_flags(n);
+    int counter = 0;
+    size_t depth, top = 0;
+
+    for (size_t root = 0; root < n; root++) {
+        if (index[root] >= 0) continue;
+        depth = 0;
+        walk[depth++] = (int)root;
+        index[root] = low[root] = counter++;
+        next[root] = graph->callee_start[root];
+        stack[top++] = (int)root;
+        on_stack[root] = 1;
+
+        while (depth > 0) {
+            int f = walk[depth - 1];
+            if (next[f] < graph->callee_start[f + 1]) {
+                int g = graph->callees[next[f]++];
+                if (g == f) graph->recursive[f] = 1;
+                if (index[g] < 0) {
+                    index[g] = low[g] = counter++;
+                    next[g] = graph->callee_start[g];
+                    stack[top++] = g;
+                    on_stack[g] = 1;
+                    walk[depth++] = g;
+                } else if (on_stack[g] && index[g] < low[f]) {
+                    low[f] = index[g];
+                }
+                continue;
+            }
+
+            // f is done: it closes a component if nothing above it is reachable
+            depth--;
+            if (depth > 0 && low[f] < low[walk[depth - 1]]) low[walk[depth - 1]] = low[f];
+            if (low[f] != index[f]) continue;
+            int id = (int)graph->scc_count++;
+            size_t first = top;
+            do {
+                first--;
+                on_stack[stack[first]] = 0;
+                graph->scc[stack[first]] = id;
+            } while (stack[first] != f);
+            if (top - first > 1) {
+                for (size_t k = first; k < top; k++) graph->recursive[stack[k]] = 1;
+            }
+            top = first;
+        }
+    }
+
+    free(index);
+    free(low);
+    free(next);
+    free(walk);
+    free(stack);
+    free(on_stack);
+}
+
+CallGraph *call_graph_build(const TACProgram *program) {
+    CallGraph *graph = calloc(1, sizeof(CallGraph));
+    if (!graph) {
+        printf("Memory allocation failed for call graph.\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t n = program->count;
+    graph->count = n;
+    graph->sym_count = intern_count();
+    graph->name = call_graph_alloc_ints(n, -1);
+    graph->by_sym = call_graph_alloc_ints(graph->sym_count, -1);
+    graph->scc = call_graph_alloc_ints(n, -1);
+    graph->recursive = call_graph_alloc_flags(n);
+    graph->reachable = call_graph_alloc_flags(n);
+
+    // 1) Name every function
+    for (size_t f = 0; f < n; f++) {
+        const TACFunction *fn = &program->functions[f];
+        if (fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION || fn->instrs[0].dst.type != TAC_OP_VAR) continue;
+        graph->name[f] = fn->instrs[0].dst.sym;
+        graph->by_sym[graph->name[f]] = (int)f;
+    }
+
+    // 2) One edge per distinct callee, from calls and from names used as values
+    CFGEdgeArray edges = {0};
+    int *last_caller = call_graph_alloc_ints(n, -1);
+    for (size_t f = 0; f < n; f++) {
+        const TACFunction *fn = &program->functions[f];
+        for (size_t i = 0; i < fn->count; i++) {
+            const TACInstr *instr = &fn->instrs[i];
+            if (instr->kind == TAC_CALL) {
+                graph->call_count++;
+                add_call(graph, &edges, last_caller, (int)f, instr->arg1);
+            }
+            unsigned uses = tac_use_mask(instr);
+            if (uses & TAC_USE_ARG1) add_call(graph, &edges, last_caller, (int)f, instr->arg1);
+            if (uses & TAC_USE_ARG2) add_call(graph, &edges, last_caller, (int)f, instr->arg2);
+            if (uses & TAC_USE_ARG3) add_call(graph, &edges, last_caller, (int)f, instr->arg3);
+            if (instr->kind == TAC_PHI) {
+                const TACOperand *args = tac_phi_args(instr);
+                for (size_t k = 0; k < tac_phi_arg_count(instr); k++) {
+                    add_call(graph, &edges, last_caller, (int)f, args[k]);
+                }
+            }
+        }
+    }
+    free(last_caller);
+    cfg_pairs_to_csr(n, edges.items, edges.count, 0, &graph->callee_start, &graph->callees);
+    free(edges.items);
+
+    // 3) Recursion
+    find_sccs(graph);
+    return graph;
+}
+
+void call_graph_free(CallGraph *graph) {
+    if (!graph) return;
+    free(graph->name);
+    free(graph->by_sym);
+    free(graph->callee_start);
+    free(graph->callees);
+    free(graph->scc);
+    free(graph->recursive);
+    free(graph->reachable);
+    free(graph);
+}
+
+size_t call_graph_mark_reachable(CallGraph *graph, const char *const *roots, size_t root_count) {
+    int *work = call_graph_alloc_ints(graph->count, 0);
+    size_t work_count = 0, reached = 0;
+    for (size_t f = 0; f < graph->count; f++) graph->reachable[f] = 0;
+
+    // 1) Code outside functions and the named roots
+    for (size_t f = 0; f < graph->count; f++) {
+        if (graph->name[f] >= 0) continue;
+        graph->reachable[f] = 1;
+        work[work_count++] = (int)f;
+    }
+    for (size_t r = 0; r < root_count; r++) {
+        int f = call_graph_find(graph, intern(roots[r]));
+        if (f < 0 || graph->reachable[f]) continue;
+        graph->reachable[f] = 1;
+        work[work_count++] = f;
+    }
+
+    // 2) Everything they call
+    while (work_count > 0) {
+        int f = work[--work_count];
+        reached++;
+        size_t count;
+        const int *callees = call_graph_callees(graph, f, &count);
+        for (size_t k = 0; k < count; k++) {
+            if (graph->reachable[callees[k]]) continue;
+            graph->reachable[callees[k]] = 1;
+            work[work_count++] = callees[k];
+        }
+    }
+    free(work);
+    return reached;
+}
+
+size_t call_graph_remove_dead(TACProgram *program, const char *const *roots, size_t root_count) {
+    static const char *const default_roots[] = { "main" };
+    if (root_count == 0) {
+        roots = default_roots;
+        root_count = 1;
+    }
+
+    CallGraph *graph = call_graph_build(program);
+    int known_root = 0;
+    for (size_t r = 0; r < root_count; r++) {
+        if (call_graph_find(graph, intern(roots[r])) >= 0) known_root = 1;
+    }
+    if (!known_root) {
+        call_graph_free(graph);
+        return 0;
+    }
+
+    call_graph_mark_reachable(graph, roots, root_count);
+    size_t kept = 0;
+    for (size_t f = 0; f < program->count; f++) {
+        if (!graph->reachable[f]) {
+            tac_function_free(&program->functions[f]);
+            continue;
+        }
+        program->functions[kept++] = program->functions[f];
+    }
+    size_t removed = program->count - kept;
+    program->count = kept;
+    call_graph_free(graph);
+    return removed;
+}
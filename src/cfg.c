@@ -4,37 +4,6 @@
 #include <string.h>
 #include "tac_print.h"
 
-void add_successor(CFGBlock *from, CFGBlock *to) {
-    if (from == NULL || to == NULL) {
-        printf("Error: Attempted to add a successor or predecessor to a NULL block.\n");
-        exit(EXIT_FAILURE);
-    }
-    push_block(&from->successors, to);
-}
-
-void add_predecessor(CFGBlock *to, CFGBlock *from) {
-    if (to == NULL || from == NULL) {
-        printf("Error: Attempted to add a successor or predecessor to a NULL block.\n");
-        exit(EXIT_FAILURE);
-    }
-    push_block(&to->predecessors, from);
-}
-
-
-void push_block(CFGBlockList *list, CFGBlock *block) {
-    if (list->count >= list->capacity) {
-        size_t new_capacity = list->capacity ? list->capacity * 2 : 4;
-        CFGBlock **new_items = realloc(list->items, new_capacity * sizeof(CFGBlock *));
-        if (!new_items) {
-            printf("Memory allocation failed while resizing CFGBlockList.\n");
-            exit(EXIT_FAILURE);
-        }
-        list->items = new_items;
-        list->capacity = new_capacity;
-    }
-    list->items[list->count++] = block;
-}
-
 CFGBlock *create_block(int id, int is_entry, int is_exit) {
     CFGBlock *block = calloc(1, sizeof(CFGBlock));
     if (block == NULL) {
@@ -42,6 +11,8 @@ CFGBlock *create_block(int id, int is_entry, int is_exit) {
         exit(EXIT_FAILURE);
     }
     block->id = id;
+    block->is_entry = is_entry;
+    block->is_exit = is_exit;
     return block;
 }
 
@@ -59,10 +30,22 @@ void push_block_array(CFGBlockArray *array,  CFGBlock *block) {
     array->items[array->count++] = block;
 }
 
+void push_edge(CFGEdgeArray *array, int from, int to) {
+    if (array->count >= array->capacity) {
+        size_t new_capacity = array->capacity ? array->capacity * 2 : 8;
+        CFGEdge *new_items = realloc(array->items, new_capacity * sizeof(CFGEdge));
+        if (!new_items) {
+            printf("Memory allocation failed while resizing CFGEdgeArray.\n");
+            exit(EXIT_FAILURE);
+        }
+        array->items = new_items;
+        array->capacity = new_capacity;
+    }
+    array->items[array->count++] = (CFGEdge){ from, to };
+}
+
 void init_cfg(CFG *cfg) {
-    cfg->blocks.items = NULL;
-    cfg->blocks.count = 0;
-    cfg->blocks.capacity = 0;
+    memset(cfg, 0, sizeof(*cfg));
 }
 
 void free_cfg(CFG *cfg) {
@@ -70,31 +53,20 @@ void free_cfg(CFG *cfg) {
         return; 
     }
     free_cfg_block_array(&cfg->blocks);
+    free(cfg->succ_start);
+    free(cfg->succ);
+    free(cfg->pred_start);
+    free(cfg->pred);
+    free(cfg->label_block);
+    cfg->succ_start = cfg->succ = cfg->pred_start = cfg->pred = cfg->label_block = NULL;
+    cfg->edge_count = 0;
+    cfg->label_count = 0;
 }
 
 void free_cfg_block(CFGBlock *block) {
-    if (block == NULL) {
-        return; 
-    }
-    free(block->instructions);
-    free_cfg_block_list(&block->successors);
-    free_cfg_block_list(&block->predecessors);
     free(block);
 }
 
-void free_cfg_block_list(CFGBlockList *list) {
-    if (list == NULL) {
-        return; 
-    }
-    for (size_t i = 0; i < list->count; i++) {
-        free_cfg_block(list->items[i]);
-    }
-    free(list->items);
-    list->items = NULL;
-    list->count = 0;
-    list->capacity = 0;
-}
-
 void free_cfg_block_array(CFGBlockArray *array) {
     if (array == NULL) {
         return; 
@@ -108,6 +80,76 @@ void free_cfg_block_array(CFGBlockArray *array) {
     array->capacity = 0;
 }
 
+static int *cfg_alloc_ints(size_t count) {
+    int *items = malloc((count ? count : 1) * sizeof(int));
+    if (!items) {
+        printf("Memory allocation failed for CFG adjacency.\n");
+        exit(EXIT_FAILURE);
+    }
+    return items;
+}
+
+void cfg_pairs_to_csr(size_t blocks, const CFGEdge *edges, size_t count, int by_target,
+                      int **out_start, int **out_items) {
+    int *start = calloc(blocks + 1, sizeof(int));
+    int *items = cfg_alloc_ints(count);
+    if (!start) {
+        printf("Memory allocation failed for CFG adjacency.\n");
+        exit(EXIT_FAILURE);
+    }
+    // 1) degree of every block, shifted by one
+    for (size_t i = 0; i < count; i++) {
+        start[(by_target ? edges[i].to : edges[i].from) + 1]++;
+    }
+    // 2) prefix sums give each block's first slot
+    for (size_t b = 0; b < blocks; b++) {
+        start[b + 1] += start[b];
+    }
+    // 3) place the edges, keeping their order within a block
+    int *fill = cfg_alloc_ints(blocks);
+    memcpy(fill, start, blocks * sizeof(int));
+    for (size_t i = 0; i < count; i++) {
+        int key = by_target ? edges[i].to : edges[i].from;
+        items[fill[key]++] = by_target ? edges[i].from : edges[i].to;
+    }
+    free(fill);
+    *out_start = start;
+    *out_items = items;
+}
+
+void cfg_freeze_edges(CFG *cfg, const CFGEdge *edges, size_t count) {
+    free(cfg->succ_start);
+    free(cfg->succ);
+    free(cfg->pred_start);
+    free(cfg->pred);
+    cfg_pairs_to_csr(cfg->blocks.count, edges, count, 0, &cfg->succ_start, &cfg->succ);
+    cfg_pairs_to_csr(cfg->blocks.count, edges, count, 1, &cfg->pred_start, &cfg->pred);
+    cfg->edge_count = count;
+}
+
+const int *cfg_successors(const CFG *cfg, int id, size_t *count) {
+    if (!cfg->succ_start) {
+        *count = 0;
+        return NULL;
+    }
+    *count = (size_t)(cfg->succ_start[id + 1] - cfg->succ_start[id]);
+    return &cfg->succ[cfg->succ_start[id]];
+}
+
+const int *cfg_predecessors(const CFG *cfg, int id, size_t *count) {
+    if (!cfg->pred_start) {
+        *count = 0;
+        return NULL;
+    }
+    *count = (size_t)(cfg->pred_start[id + 1] - cfg->pred_start[id]);
+    return &cfg->pred[cfg->pred_start[id]];
+}
+
+int cfg_label_block(const CFG *cfg, int label) {
+    if (label < 0 || (size_t)label >= cfg->label_count) return -1;
+    return cfg->label_block[label];
+}
+
 CFG *create_cfg(void) {
     CFG *cfg = malloc(sizeof(CFG));
     if (cfg == NULL) {
@@ -126,8 +168,15 @@ void print_cfg(CFG *cfg) {
     printf("CFG with %zu blocks:\n", cfg->blocks.count);
     for (size_t i = 0; i < cfg->blocks.count; i++) {
         CFGBlock *block = cfg->blocks.items[i];
-        printf("Block ID: %d, Entry: %d, Exit: %d\n", block->id, block->is_entry, block->is_exit);
-        tac_print_list(block->instructions);
+        printf("Block ID: %d, Entry: %d, Exit: %d", block->id, block->is_entry, block->is_exit);
+        size_t count;
+        const int *succ = cfg_successors(cfg, block->id, &count);
+        if (count) {
+            printf(", Successors:");
+            for (size_t j = 0; j < count; j++) printf(" %d", succ[j]);
+        }
+        printf("\n");
+        tac_print_list(block->instructions, block->count);
         printf("\n");
     }
 }
\ No newline at end of file
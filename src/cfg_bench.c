@@ -0,0 +1,169 @@
+#include "cfg_bench.h"
+#include "cfg_builder.h"
+#include "dominance.h"
+#include "liveness.h"
+#include "loops.h"
+#include "tac_emit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_DEPTH 32
+
+static unsigned bench_random(unsigned *state) {
+    *state = *state * 1664525u + 1013904223u;    // LCG, fixed seed
+    return *state >> 16;
+}
+
+static void bench_push(TACFunction *fn, TACOpKind kind, TACOperand dst, TACOperand arg1, TACOperand arg2) {
+    TACInstr instr = {0};
+    instr.kind = kind;
+    instr.dst = dst;
+    instr.arg1 = arg1;
+    instr.arg2 = arg2;
+    tac_function_push(fn, instr);
+}
+
+static void bench_binary(TACFunction *fn, TACBinOp op, TACOperand dst, TACOperand arg1, TACOperand arg2) {
+    TACInstr instr = {0};
+    instr.kind = TAC_BINARY_OP;
+    instr.op.binop = op;
+    instr.dst = dst;
+    instr.arg1 = arg1;
+    instr.arg2 = arg2;
+    tac_function_push(fn, instr);
+}
+
+void cfg_bench_generate(TACFunction *fn, size_t blocks) {
+    TACOperand x = tac_var("x"), i = tac_var("i"), n = tac_var("n");
+    TACOperand bound[BENCH_MAX_DEPTH];
+    int head[BENCH_MAX_DEPTH], exit_label[BENCH_MAX_DEPTH];
+    size_t depth = 0, emitted = 1;
+    unsigned seed = 12345;
+
+    bench_push(fn, TAC_FUNCTION, tac_var("bench"), TAC_NONE, TAC_NONE);
+    tac_function_sync_header(fn);
+
+    while (emitted < blocks) {
+        unsigned r = bench_random(&seed) % 8;
+        if (r < 2 && depth < BENCH_MAX_DEPTH) {
+            // t = i + n; while (i < n) {   (t stays live through the loop)
+            bound[depth] = tac_temp(tac_function_new_temp(fn));
+            bench_binary(fn, TAC_ADD, bound[depth], i, n);
+            head[depth] = tac_function_new_label(fn);
+            exit_label[depth] = tac_function_new_label(fn);
+            bench_push(fn, TAC_LABEL, tac_label(head[depth]), TAC_NONE, TAC_NONE);
+            TACInstr test = {0};
+            test.kind = TAC_IF_CMP;
+            test.op.binop = TAC_GTE;
+            test.dst = tac_label(exit_label[depth]);
+            test.arg1 = i;
+            test.arg2 = n;
+            tac_function_push(fn, test);
+            bench_binary(fn, TAC_ADD, i, i, tac_literal(1));
+            depth++;
+            emitted += 2;
+        } else if (r < 4 && depth > 0) {
+            // x = x + t; }
+            depth--;
+            bench_binary(fn, TAC_ADD, x, x, bound[depth]);
+            bench_push(fn, TAC_GOTO, TAC_NONE, tac_label(head[depth]), TAC_NONE);
+            bench_push(fn, TAC_LABEL, tac_label(exit_label[depth]), TAC_NONE, TAC_NONE);
+            emitted += 1;
+        } else if (r == 4 && depth > 0) {
+            // break out of some enclosing loop
+            size_t level = bench_random(&seed) % depth;
+            bench_push(fn, TAC_IFZ, TAC_NONE, x, tac_label(exit_label[level]));
+            emitted += 1;
+        } else {
+            // t = x * 2; if (x) x = x + t; else x = x - t;
+            TACOperand t = tac_temp(tac_function_new_temp(fn));
+            int else_label = tac_function_new_label(fn);
+            int join_label = tac_function_new_label(fn);
+            bench_binary(fn, TAC_MUL, t, x, tac_literal(2));
+            bench_push(fn, TAC_IFZ, TAC_NONE, x, tac_label(else_label));
+            bench_binary(fn, TAC_ADD, x, x, t);
+            bench_push(fn, TAC_GOTO, TAC_NONE, tac_label(join_label), TAC_NONE);
+            bench_push(fn, TAC_LABEL, tac_label(else_label), TAC_NONE, TAC_NONE);
+            bench_binary(fn, TAC_SUB, x, x, t);
+            bench_push(fn, TAC_LABEL, tac_label(join_label), TAC_NONE, TAC_NONE);
+            emitted += 3;
+        }
+    }
+    while (depth > 0) {
+        depth--;
+        bench_binary(fn, TAC_ADD, x, x, bound[depth]);
+        bench_push(fn, TAC_GOTO, TAC_NONE, tac_label(head[depth]), TAC_NONE);
+        bench_push(fn, TAC_LABEL, tac_label(exit_label[depth]), TAC_NONE, TAC_NONE);
+    }
+    bench_push(fn, TAC_RETURN, TAC_NONE, x, TAC_NONE);
+    bench_push(fn, TAC_END_FUNCTION, TAC_NONE, TAC_NONE, TAC_NONE);
+}
+
+static double bench_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void cfg_benchmark(size_t max_blocks) {
+    printf("%10s %10s %8s %10s %10s %10s %12s\n",
+           "blocks", "edges", "loops", "cfg ms", "dom ms", "loops ms", "ns/block");
+
+    for (size_t size = max_blocks / 8 ? max_blocks / 8 : 1; size <= max_blocks; size *= 2) {
+        TACFunction fn = {0};
+        cfg_bench_generate(&fn, size);
+
+        double t0 = bench_seconds();
+        CFG *cfg = build_from_tac(&fn);
+        double t1 = bench_seconds();
+        DomTree *dom = dom_compute(cfg);
+        double t2 = bench_seconds();
+        LoopForest *forest = loops_compute(cfg, dom);
+        double t3 = bench_seconds();
+
+        size_t blocks = cfg->blocks.count;
+        printf("%10zu %10zu %8zu %10.2f %10.2f %10.2f %12.1f\n",
+               blocks, cfg->edge_count, forest->count,
+               (t1 - t0) * 1e3, (t2 - t1) * 1e3, (t3 - t2) * 1e3,
+               (t3 - t0) * 1e9 / (double)(blocks ? blocks : 1));
+
+        loops_free(forest);
+        dom_free(dom);
+        free_cfg(cfg);
+        free(cfg);
+        tac_function_free(&fn);
+    }
+}
+
+void liveness_benchmark(size_t max_blocks) {
+    printf("%10s %10s %10s %10s %12s %12s\n",
+           "blocks", "facts", "visits", "live ms", "ns/block", "live-in avg");
+
+    for (size_t size = max_blocks / 8 ? max_blocks / 8 : 1; size <= max_blocks; size *= 2) {
+        TACFunction fn = {0};
+        cfg_bench_generate(&fn, size);
+        CFG *cfg = build_from_tac(&fn);
+        DomTree *dom = dom_compute(cfg);
+
+        double t0 = bench_seconds();
+        Liveness *lv = liveness_compute(&fn, cfg, dom);
+        double t1 = bench_seconds();
+
+        size_t blocks = cfg->blocks.count, live = 0;
+        for (size_t b = 0; b < blocks; b++) {
+            live += bitset_count(bitmatrix_row(&lv->live_in, b), lv->live_in.words);
+        }
+        printf("%10zu %10zu %10zu %10.2f %12.1f %12.1f\n",
+               blocks, lv->temp_count + lv->slot_count, lv->visits, (t1 - t0) * 1e3,
+               (t1 - t0) * 1e9 / (double)(blocks ? blocks : 1),
+               (double)live / (double)(blocks ? blocks : 1));
+
+        liveness_free(lv);
+        dom_free(dom);
+        free_cfg(cfg);
+        free(cfg);
+        tac_function_free(&fn);
+    }
+}
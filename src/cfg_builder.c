@@ -1,73 +1,131 @@
 #include "cfg_builder.h"
+#include "tac_util.h"
+#include "intern.h"
 #include <stdlib.h>
 #include <stdio.h>
 
 // Helper: Determine if a TAC instruction ends a basic block
 int is_block_terminator(TACInstr *instr) {
-    return  instr->kind==TAC_GOTO 
+    return  instr->kind==TAC_GOTO
                   || instr->kind==TAC_IFZ
+                  || instr->kind==TAC_IF_CMP
                   || instr->kind==TAC_RETURN
                   || instr->kind==TAC_END_FUNCTION;
 }
 
 
-CFGBlock *create_block_from_range(CFG *cfg, TACInstr *start, TACInstr *end, int id) {
-    CFGBlock *block = create_block(id, 0, 0); 
+// Creates a block viewing instrs[start..end] (inclusive)
+CFGBlock *create_block_from_range(CFG *cfg, TACInstr *instrs, size_t start, size_t end, int id) {
+    CFGBlock *block = create_block(id, 0, 0);
     if (!block) return NULL;
 
-    block->instructions = start;
-
-    // Null-terminate the block's instruction list
-    if (end && end->next) {
-        end->next = NULL;
-    }
+    block->instructions = &instrs[start];
+    block->count = end - start + 1;
 
     // Add the block to the CFG
     push_block_array(&cfg->blocks, block);
     return block;
 }
 
-// Main function
-CFG *build_from_tac(TACInstr *tac) {
+static const char *function_name(const TACFunction *fn) {
+    if (fn->count > 0 && fn->instrs[0].kind == TAC_FUNCTION && fn->instrs[0].dst.type == TAC_OP_VAR)
+        return interned_name(fn->instrs[0].dst.sym);
+    return "the global segment";
+}
+
+// Builds the blocks of fn, the label index and all edges in one pass.
+// Jumps may go forward, so they are recorded against their label and
+// resolved once every block exists; the result is frozen into CSR form.
+CFG *build_from_tac(TACFunction *fn) {
     CFG *cfg = create_cfg();  // Allocates and initializes CFG
     if (!cfg) return NULL;
 
+    cfg->label_count = fn->label_count > 0 ? (size_t)fn->label_count : 0;
+    cfg->label_block = malloc((cfg->label_count ? cfg->label_count : 1) * sizeof(int));
+    if (!cfg->label_block) {
+        printf("Memory allocation failed for CFG label index.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t l = 0; l < cfg->label_count; l++) cfg->label_block[l] = -1;
+
+    CFGEdgeArray edges = {0};   // block -> block (fall-through)
+    CFGEdgeArray jumps = {0};   // block -> label
     int block_id = 0;
-    TACInstr *cursor = tac;
-    TACInstr *block_start = tac;
+    size_t block_start = 0;
 
-    while (cursor) {
-        TACInstr *next = cursor->next;
+    for (size_t i = 0; i < fn->count; i++) {
+        TACInstr *cursor = &fn->instrs[i];
+        TACInstr *next = i + 1 < fn->count ? &fn->instrs[i + 1] : NULL;
 
-        // If the next instruction is a label, we must start a new block
-        if (next && next->kind == TAC_LABEL) {
-            CFGBlock *block = create_block_from_range(cfg, block_start, cursor, block_id++);
+        // A block ends before a label, after a terminator, or at the end
+        if (!next || next->kind == TAC_LABEL || is_block_terminator(cursor)) {
+            int id = block_id++;
+            CFGBlock *block = create_block_from_range(cfg, fn->instrs, block_start, i, id);
             if (!block) {
                 free_cfg(cfg);
+                free(cfg);
+                free(edges.items);
+                free(jumps.items);
                 return NULL;
             }
-            block->is_exit = (cursor->kind == TAC_RETURN || cursor->kind == TAC_END_FUNCTION);
-            block_start = next;
-        }
+            block->is_entry = (id == 0);
 
-        // If current instruction is a block terminator
-        else if  (is_block_terminator(cursor)) {
-            CFGBlock *block = create_block_from_range(cfg, block_start, cursor, block_id++);
-            if (!block) {
-                free_cfg(cfg);
-                return NULL;
+            // 1) Labels only ever start a block
+            TACInstr *first = &fn->instrs[block_start];
+            if (first->kind == TAC_LABEL && first->dst.literal >= 0 &&
+                (size_t)first->dst.literal < cfg->label_count) {
+                cfg->label_block[first->dst.literal] = id;
+            }
+
+            // 2) Outgoing edges
+            switch (cursor->kind) {
+                case TAC_GOTO:
+                    push_edge(&jumps, id, tac_jump_target(cursor));
+                    break;
+                case TAC_IFZ:
+                case TAC_IF_CMP:
+                    if (next) push_edge(&edges, id, id + 1);
+                    push_edge(&jumps, id, tac_jump_target(cursor));
+                    break;
+                case TAC_RETURN:
+                case TAC_END_FUNCTION:
+                    block->is_exit = 1;
+                    break;
+                default:
+                    if (next) push_edge(&edges, id, id + 1);
+                    else block->is_exit = 1;   // code running off the end of a segment
+                    break;
             }
-            block->is_exit = (cursor->kind == TAC_RETURN || cursor->kind == TAC_END_FUNCTION);
-            block_start = next;
+            block_start = i + 1;
         }
+    }
 
-        cursor = next;
+    // 3) Resolve jumps through the label index and freeze the adjacency;
+    //    a jump to a label the function does not define has no edge to
+    //    stand for it, so there is no CFG
+    for (size_t j = 0; j < jumps.count; j++) {
+        int target = cfg_label_block(cfg, jumps.items[j].to);
+        if (target < 0) {
+            fprintf(stderr, "CFG construction failed: jump to undefined label L%d in %s.\n",
+                    jumps.items[j].to, function_name(fn));
+            free_cfg(cfg);
+            free(cfg);
+            free(edges.items);
+            free(jumps.items);
+            return NULL;
+        }
+        push_edge(&edges, jumps.items[j].from, target);
     }
+    cfg_freeze_edges(cfg, edges.items, edges.count);
 
+    free(edges.items);
+    free(jumps.items);
     return cfg;
 }
 
-CFG *extract_functions(TACInstr *tac) {
+// Each function already owns its instruction array (nested definitions are
+// hoisted by lambda_lift), so every function maps to exactly one segment.
+CFG *extract_functions(TACProgram *program) {
     CFG *cfg = create_cfg();
     if (!cfg) {
         fprintf(stderr, "Failed to create CFG.\n");
@@ -75,54 +133,14 @@ CFG *extract_functions(TACInstr *tac) {
     }
 
     int id = 0;
-    TACInstr *cursor = tac;
-    TACInstr *seg_start = tac;
-    TACInstr *prev = NULL;
-    int depth = 0;
-
-
-    while (cursor) {
-        switch (cursor->kind) {
-            case TAC_FUNCTION:
-                // Close previous segment (global code or enclosing function body)
-                if (seg_start && seg_start != cursor && depth == 0) {
-                    if (!create_block_from_range(cfg, seg_start, prev, id++)) {
-                        free_cfg(cfg);
-                        return NULL;
-                    }
-                }
-                depth++;
-                // Start new segment
-                seg_start = cursor;
-                break;
-
-            case TAC_END_FUNCTION:
-                depth--;
-                if (depth < 0) {
-                    fprintf(stderr, "END_FUNCTION without matching FUNCTION.\n");
-                    free_cfg(cfg);
-                    return NULL;
-                }
-                // Close the function or nested function body
-                if (seg_start && seg_start != cursor && depth == 0) {
-                    if (!create_block_from_range(cfg, seg_start, cursor, id++)) {
-                        free_cfg(cfg);
-                        return NULL;
-                    }
-                    // Next segment starts after
-                    seg_start = cursor->next;
-                }
-   
-                break;
-
-            default:
-                // Regular instruction, continue
-                break;
+    for (size_t i = 0; i < program->count; i++) {
+        TACFunction *fn = &program->functions[i];
+        if (fn->count == 0) continue;
+        if (!create_block_from_range(cfg, fn->instrs, 0, fn->count - 1, id++)) {
+            free_cfg(cfg);
+            return NULL;
         }
-        prev = cursor;
-        cursor = cursor->next;
     }
 
-
     return cfg;
 }
@@ -0,0 +1,106 @@
+#include "dataflow.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void dataflow_init(DataflowProblem *problem, const CFG *cfg,
+                   DataflowDirection direction, DataflowMeet meet, size_t bits) {
+    size_t n = cfg->blocks.count;
+    problem->direction = direction;
+    problem->meet = meet;
+    problem->bits = bits;
+    problem->boundary = NULL;
+    problem->visits = 0;
+    bitmatrix_init(&problem->gen, n, bits);
+    bitmatrix_init(&problem->kill, n, bits);
+    bitmatrix_init(&problem->in, n, bits);
+    bitmatrix_init(&problem->out, n, bits);
+}
+
+void dataflow_free(DataflowProblem *problem) {
+    bitmatrix_free(&problem->gen);
+    bitmatrix_free(&problem->kill);
+    bitmatrix_free(&problem->in);
+    bitmatrix_free(&problem->out);
+}
+
+void dataflow_solve(DataflowProblem *problem, const CFG *cfg, const DomTree *dom) {
+    size_t count = dom->rpo_count;
+    size_t words = problem->in.words;
+    int forward = problem->direction == DATAFLOW_FORWARD;
+    // meet side: where neighbours' values are combined; result side: f(meet side)
+    BitMatrix *meet_side = forward ? &problem->in : &problem->out;
+    BitMatrix *result_side = forward ? &problem->out : &problem->in;
+
+    // 1) Position of each block in visit order
+    int *order = malloc((count ? count : 1) * sizeof(int));
+    int *position = malloc((dom->block_count ? dom->block_count : 1) * sizeof(int));
+    uint64_t *pending = malloc((bitset_words(count) ? bitset_words(count) : 1) * sizeof(uint64_t));
+    if (!order || !position || !pending) {
+        printf("Memory allocation failed for dataflow solver.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t b = 0; b < dom->block_count; b++) position[b] = -1;
+    for (size_t i = 0; i < count; i++) {
+        order[i] = dom->rpo[forward ? i : count - 1 - i];
+        position[order[i]] = (int)i;
+    }
+
+    // 2) Optimistic start: the top of the lattice is all facts for an
+    //    intersection, none for a union
+    for (size_t b = 0; b < result_side->rows; b++) {
+        uint64_t *row = bitmatrix_row(result_side, b);
+        if (problem->meet == DATAFLOW_INTERSECT) bitset_fill(row, problem->bits, words);
+        else bitset_clear(row, words);
+    }
+    bitset_fill(pending, count, bitset_words(count));
+    size_t pending_count = count;
+
+    // 3) Sweep the pending positions in order until none are left; a change
+    //    requeues the neighbours on the far side, earlier ones for the next sweep
+    problem->visits = 0;
+    while (pending_count > 0) {
+        for (size_t w = 0; w < bitset_words(count); w++) {
+            while (pending[w]) {
+                size_t pos = w * BITSET_WORD_BITS + (size_t)__builtin_ctzll(pending[w]);
+                pending[w] &= pending[w] - 1;
+                pending_count--;
+                problem->visits++;
+
+                int b = order[pos];
+                size_t nb_count, far_count;
+                const int *nb = forward ? cfg_predecessors(cfg, b, &nb_count)
+                                        : cfg_successors(cfg, b, &nb_count);
+                const int *far = forward ? cfg_successors(cfg, b, &far_count)
+                                         : cfg_predecessors(cfg, b, &far_count);
+
+                uint64_t *meet = bitmatrix_row(meet_side, (size_t)b);
+                if (nb_count == 0) {
+                    if (problem->boundary) bitset_copy(meet, problem->boundary, words);
+                    else bitset_clear(meet, words);
+                } else {
+                    bitset_copy(meet, bitmatrix_row(result_side, (size_t)nb[0]), words);
+                    for (size_t k = 1; k < nb_count; k++) {
+                        const uint64_t *value = bitmatrix_row(result_side, (size_t)nb[k]);
+                        if (problem->meet == DATAFLOW_UNION) bitset_union_into(meet, value, words);
+                        else bitset_intersect_into(meet, value, words);
+                    }
+                }
+
+                int changed = bitset_transfer(bitmatrix_row(result_side, (size_t)b),
+                                              bitmatrix_row(&problem->gen, (size_t)b), meet,
+                                              bitmatrix_row(&problem->kill, (size_t)b), words);
+                if (!changed) continue;
+                for (size_t k = 0; k < far_count; k++) {
+                    int p = position[far[k]];
+                    if (p < 0 || bitset_test(pending, (size_t)p)) continue;
+                    bitset_set(pending, (size_t)p);
+                    pending_count++;
+                }
+            }
+        }
+    }
+
+    free(order);
+    free(position);
+    free(pending);
+}
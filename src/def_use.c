@@ -0,0 +1,286 @@
+#include "def_use.h"
+#include "intern.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *def_use_grow(void *items, size_t count, size_t size) {
+    void *grown = realloc(items, (count ? count : 1) * size);
+    if (!grown) {
+        printf("Memory allocation failed for def-use chains.\n");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+// Chain of a temp or variable; with `create`, grows the tables to hold
+// names that appeared after the index was built
+static DefUseChain *chain_of(DefUse *du, TACOperand op, int create) {
+    DefUseChain **table;
+    size_t *count, id;
+    if (op.type == TAC_OP_TEMP && op.literal >= 0) {
+        table = &du->temps, count = &du->temp_count, id = (size_t)op.literal;
+    } else if (op.type == TAC_OP_VAR && op.sym >= 0) {
+        table = &du->vars, count = &du->var_count, id = (size_t)op.sym;
+    } else {
+        return NULL;
+    }
+    if (id >= *count) {
+        if (!create) return NULL;
+        size_t grown = *count ? *count : 8;
+        while (grown <= id) grown *= 2;
+        *table = def_use_grow(*table, grown, sizeof(DefUseChain));
+        memset(*table + *count, 0, (grown - *count) * sizeof(DefUseChain));
+        *count = grown;
+    }
+    return &(*table)[id];
+}
+
+static const DefUseChain *chain_find(const DefUse *du, TACOperand op) {
+    return chain_of((DefUse *)du, op, 0);
+}
+
+
+/* ---------- Site lists ---------- */
+
+static void list_push(DefUse *du, DefUseList *list, DefUseSite site) {
+    if (list->count == list->capacity) {
+        unsigned capacity = list->capacity ? list->capacity * 2 : 4;
+        int at_end = list->start + list->capacity == du->pool_count;
+        size_t start = at_end ? list->start : du->pool_count;
+        size_t needed = start + capacity;
+        if (needed > du->pool_capacity) {
+            size_t grown = du->pool_capacity ? du->pool_capacity : 64;
+            while (grown < needed) grown *= 2;
+            du->pool = def_use_grow(du->pool, grown, sizeof(DefUseSite));
+            du->pool_capacity = grown;
+        }
+        if (!at_end) {
+            memcpy(du->pool + start, du->pool + list->start, list->count * sizeof(DefUseSite));
+        }
+        list->start = start;
+        list->capacity = capacity;
+        du->pool_count = needed;
+    }
+    du->pool[list->start + list->count++] = site;
+}
+
+static void list_remove(DefUse *du, DefUseList *list, DefUseSite site) {
+    DefUseSite *items = du->pool + list->start;
+    for (unsigned i = 0; i < list->count; i++) {
+        if (items[i].instr == site.instr && items[i].operand == site.operand) {
+            items[i] = items[--list->count];
+            return;
+        }
+    }
+}
+
+
+/* ---------- Visiting the sites of an instruction ---------- */
+
+typedef enum { SITES_COUNT, SITES_ADD, SITES_REMOVE } SiteAction;
+
+static void apply_site(DefUse *du, SiteAction action, TACOperand op, DefUseSite site) {
+    DefUseChain *chain = chain_of(du, op, action != SITES_REMOVE);
+    if (!chain) return;
+    DefUseList *list = site.operand == DEF_USE_DST ? &chain->defs : &chain->uses;
+    if (action == SITES_COUNT) list->count++;
+    else if (action == SITES_ADD) list_push(du, list, site);
+    else list_remove(du, list, site);
+}
+
+static void visit_sites(DefUse *du, SiteAction action, const TACInstr *instr, size_t index) {
+    DefUseSite site = { (int)index, DEF_USE_DST };
+    const TACOperand *def = tac_def_operand(instr);
+    if (def) apply_site(du, action, *def, site);
+
+    unsigned uses = tac_use_mask(instr);
+    const TACOperand *args[3] = { &instr->arg1, &instr->arg2, &instr->arg3 };
+    for (int k = 0; k < 3; k++) {
+        if (!(uses & (TAC_USE_ARG1 << k))) continue;
+        site.operand = DEF_USE_ARG1 + k;
+        apply_site(du, action, *args[k], site);
+    }
+    if (instr->kind == TAC_PHI) {
+        const TACOperand *phi_args = tac_phi_args(instr);
+        for (size_t k = 0; k < tac_phi_arg_count(instr); k++) {
+            site.operand = DEF_USE_PHI_ARG(k);
+            apply_site(du, action, phi_args[k], site);
+        }
+    }
+}
+
+static void ensure_instr(DefUse *du, size_t index) {
+    if (index < du->instr_count) return;
+    size_t grown = du->instr_count ? du->instr_count : 16;
+    while (grown <= index) grown *= 2;
+    du->dead = def_use_grow(du->dead, grown, 1);
+    memset(du->dead + du->instr_count, 0, grown - du->instr_count);
+    du->instr_count = grown;
+}
+
+
+/* ---------- Building ---------- */
+
+// Hands each list its window of the pool, back to back
+static size_t layout_lists(DefUseChain *chains, size_t count, size_t start) {
+    for (size_t i = 0; i < count; i++) {
+        DefUseList *lists[2] = { &chains[i].defs, &chains[i].uses };
+        for (int k = 0; k < 2; k++) {
+            lists[k]->start = start;
+            lists[k]->capacity = lists[k]->count;
+            start += lists[k]->count;
+            lists[k]->count = 0;
+        }
+    }
+    return start;
+}
+
+DefUse *def_use_build(const TACFunction *fn) {
+    DefUse *du = calloc(1, sizeof(DefUse));
+    if (!du) {
+        printf("Memory allocation failed for def-use chains.\n");
+        exit(EXIT_FAILURE);
+    }
+    du->temp_count = fn->temp_count > 0 ? (size_t)fn->temp_count : 0;
+    du->var_count = intern_count();
+    du->temps = calloc(du->temp_count ? du->temp_count : 1, sizeof(DefUseChain));
+    du->vars = calloc(du->var_count ? du->var_count : 1, sizeof(DefUseChain));
+    du->dead = calloc(fn->count ? fn->count : 1, 1);
+    if (!du->temps || !du->vars || !du->dead) {
+        printf("Memory allocation failed for def-use chains.\n");
+        exit(EXIT_FAILURE);
+    }
+    du->instr_count = fn->count;
+
+    // 1) count the sites of every name
+    for (size_t i = 0; i < fn->count; i++) visit_sites(du, SITES_COUNT, &fn->instrs[i], i);
+
+    // 2) give each list exactly its room, then fill them in order
+    size_t total = layout_lists(du->temps, du->temp_count, 0);
+    total = layout_lists(du->vars, du->var_count, total);
+    du->pool = def_use_grow(NULL, total, sizeof(DefUseSite));
+    du->pool_capacity = total ? total : 1;
+    du->pool_count = total;
+    for (size_t i = 0; i < fn->count; i++) visit_sites(du, SITES_ADD, &fn->instrs[i], i);
+    return du;
+}
+
+void def_use_free(DefUse *du) {
+    if (!du) return;
+    free(du->temps);
+    free(du->vars);
+    free(du->pool);
+    free(du->dead);
+    free(du);
+}
+
+
+/* ---------- Queries ---------- */
+
+const DefUseSite *def_use_defs(const DefUse *du, TACOperand op, size_t *count) {
+    const DefUseChain *chain = chain_find(du, op);
+    *count = chain ? chain->defs.count : 0;
+    return *count ? du->pool + chain->defs.start : NULL;
+}
+
+const DefUseSite *def_use_uses(const DefUse *du, TACOperand op, size_t *count) {
+    const DefUseChain *chain = chain_find(du, op);
+    *count = chain ? chain->uses.count : 0;
+    return *count ? du->pool + chain->uses.start : NULL;
+}
+
+int def_use_single_def(const DefUse *du, TACOperand op) {
+    size_t count;
+    const DefUseSite *defs = def_use_defs(du, op, &count);
+    return count == 1 ? defs[0].instr : -1;
+}
+
+TACOperand *def_use_operand(const TACFunction *fn, DefUseSite site) {
+    TACInstr *instr = &fn->instrs[site.instr];
+    switch (site.operand) {
+        case DEF_USE_DST:  return &instr->dst;
+        case DEF_USE_ARG1: return &instr->arg1;
+        case DEF_USE_ARG2: return &instr->arg2;
+        case DEF_USE_ARG3: return &instr->arg3;
+        default:           return &tac_phi_args(instr)[site.operand - DEF_USE_PHI_ARG(0)];
+    }
+}
+
+int def_use_is_dead(const DefUse *du, size_t index) {
+    return index < du->instr_count && du->dead[index];
+}
+
+
+/* ---------- Updates ---------- */
+
+void def_use_unlink(DefUse *du, const TACFunction *fn, size_t index) {
+    visit_sites(du, SITES_REMOVE, &fn->instrs[index], index);
+}
+
+void def_use_link(DefUse *du, const TACFunction *fn, size_t index) {
+    ensure_instr(du, index);
+    visit_sites(du, SITES_ADD, &fn->instrs[index], index);
+}
+
+void def_use_replace_uses(DefUse *du, TACFunction *fn, TACOperand from, TACOperand to) {
+    DefUseChain *source = chain_of(du, from, 0);
+    if (!source || tac_operand_equal(from, to)) return;
+    // creating the target's chain may move the table holding the source
+    chain_of(du, to, 1);
+    source = chain_of(du, from, 0);
+    unsigned count = source->uses.count;
+    size_t start = source->uses.start;
+    source->uses.count = 0;
+    for (unsigned i = 0; i < count; i++) {
+        DefUseSite site = du->pool[start + i];
+        *def_use_operand(fn, site) = to;
+        DefUseChain *target = chain_of(du, to, 0);
+        if (target) list_push(du, &target->uses, site);
+    }
+}
+
+void def_use_delete(DefUse *du, const TACFunction *fn, size_t index) {
+    if (def_use_is_dead(du, index)) return;
+    def_use_unlink(du, fn, index);
+    ensure_instr(du, index);
+    du->dead[index] = 1;
+    du->dead_count++;
+}
+
+static void renumber_lists(DefUse *du, DefUseChain *chains, size_t count, const int *new_index) {
+    for (size_t i = 0; i < count; i++) {
+        DefUseList *lists[2] = { &chains[i].defs, &chains[i].uses };
+        for (int k = 0; k < 2; k++) {
+            DefUseSite *items = du->pool + lists[k]->start;
+            for (unsigned s = 0; s < lists[k]->count; s++) items[s].instr = new_index[items[s].instr];
+        }
+    }
+}
+
+void def_use_compact(DefUse *du, TACFunction *fn) {
+    if (du->dead_count == 0) return;
+
+    int *new_index = def_use_grow(NULL, fn->count, sizeof(int));
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    for (size_t i = 0; i < fn->count; i++) {
+        if (def_use_is_dead(du, i)) {
+            new_index[i] = -1;
+            continue;
+        }
+        new_index[i] = (int)out.count;
+        tac_function_push(&out, fn->instrs[i]);
+    }
+    tac_function_free(fn);
+    *fn = out;
+
+    renumber_lists(du, du->temps, du->temp_count, new_index);
+    renumber_lists(du, du->vars, du->var_count, new_index);
+    free(new_index);
+    memset(du->dead, 0, du->instr_count);
+    du->dead_count = 0;
+}
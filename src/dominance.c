@@ -0,0 +1,219 @@
+#include "dominance.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int *dom_alloc_ints(size_t count) {
+    int *items = malloc((count ? count : 1) * sizeof(int));
+    if (!items) {
+        printf("Memory allocation failed for dominator tree.\n");
+        exit(EXIT_FAILURE);
+    }
+    return items;
+}
+
+// Depth-first search from block 0 with an explicit stack of
+// (block, next successor to visit); fills rpo and rpo_index
+static void dom_reverse_postorder(const CFG *cfg, DomTree *dom) {
+    size_t n = dom->block_count;
+    int *stack = dom_alloc_ints(n);
+    int *next_edge = dom_alloc_ints(n);
+    int *order = dom_alloc_ints(n);
+    size_t depth = 0, visited = 0;
+
+    for (size_t b = 0; b < n; b++) dom->rpo_index[b] = -1;
+
+    if (n > 0) {
+        stack[depth++] = 0;
+        next_edge[0] = 0;
+        dom->rpo_index[0] = 0;            // marks "seen"; renumbered below
+    }
+    while (depth > 0) {
+        int b = stack[depth - 1];
+        size_t count;
+        const int *succ = cfg_successors(cfg, b, &count);
+        if ((size_t)next_edge[b] < count) {
+            int s = succ[next_edge[b]++];
+            if (dom->rpo_index[s] < 0) {
+                dom->rpo_index[s] = 0;
+                next_edge[s] = 0;
+                stack[depth++] = s;
+            }
+        } else {
+            order[visited++] = b;         // postorder
+            depth--;
+        }
+    }
+
+    dom->rpo_count = visited;
+    for (size_t i = 0; i < visited; i++) {
+        int b = order[visited - 1 - i];
+        dom->rpo[i] = b;
+        dom->rpo_index[b] = (int)i;
+    }
+    free(stack);
+    free(next_edge);
+    free(order);
+}
+
+// Walks both fingers up the tree until they meet; a block earlier in
+// reverse postorder is never dominated by a later one
+static int dom_intersect(const DomTree *dom, int a, int b) {
+    while (a != b) {
+        while (dom->rpo_index[a] > dom->rpo_index[b]) a = dom->idom[a];
+        while (dom->rpo_index[b] > dom->rpo_index[a]) b = dom->idom[b];
+    }
+    return a;
+}
+
+static void dom_iterate(const CFG *cfg, DomTree *dom) {
+    for (size_t b = 0; b < dom->block_count; b++) dom->idom[b] = -1;
+    if (dom->rpo_count == 0) return;
+    dom->idom[dom->rpo[0]] = dom->rpo[0];
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (size_t i = 1; i < dom->rpo_count; i++) {
+            int b = dom->rpo[i];
+            size_t count;
+            const int *pred = cfg_predecessors(cfg, b, &count);
+            int new_idom = -1;
+            for (size_t k = 0; k < count; k++) {
+                int p = pred[k];
+                if (dom->idom[p] < 0) continue;   // unreachable or not processed yet
+                new_idom = new_idom < 0 ? p : dom_intersect(dom, p, new_idom);
+            }
+            if (new_idom != dom->idom[b]) {
+                dom->idom[b] = new_idom;
+                changed = 1;
+            }
+        }
+    }
+}
+
+// Children lists plus pre/post numbers from an iterative walk of the tree
+static void dom_build_tree(DomTree *dom) {
+    size_t n = dom->block_count;
+    CFGEdge *pairs = malloc((dom->rpo_count ? dom->rpo_count : 1) * sizeof(CFGEdge));
+    if (!pairs) {
+        printf("Memory allocation failed for dominator tree.\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t count = 0;
+    // rpo order keeps children sorted by reverse postorder
+    for (size_t i = 1; i < dom->rpo_count; i++) {
+        int b = dom->rpo[i];
+        pairs[count++] = (CFGEdge){ dom->idom[b], b };
+    }
+    cfg_pairs_to_csr(n, pairs, count, 0, &dom->child_start, &dom->children);
+    free(pairs);
+
+    for (size_t b = 0; b < n; b++) dom->pre[b] = dom->post[b] = -1;
+    if (dom->rpo_count == 0) return;
+
+    int *stack = dom_alloc_ints(n);
+    int *next_child = dom_alloc_ints(n);
+    size_t depth = 0;
+    int clock_pre = 0, clock_post = 0;
+    int root = dom->rpo[0];
+    stack[depth++] = root;
+    next_child[root] = dom->child_start[root];
+    dom->pre[root] = clock_pre++;
+    while (depth > 0) {
+        int b = stack[depth - 1];
+        if (next_child[b] < dom->child_start[b + 1]) {
+            int c = dom->children[next_child[b]++];
+            dom->pre[c] = clock_pre++;
+            next_child[c] = dom->child_start[c];
+            stack[depth++] = c;
+        } else {
+            dom->post[b] = clock_post++;
+            depth--;
+        }
+    }
+    free(stack);
+    free(next_child);
+}
+
+// Cooper-Harvey-Kennedy frontiers: from each predecessor of a join point,
+// walk up to the join's idom adding the join to every frontier passed
+static void dom_build_frontiers(const CFG *cfg, DomTree *dom) {
+    size_t n = dom->block_count;
+    int *last_join = dom_alloc_ints(n);   // dedups a join within one runner's frontier
+    for (size_t b = 0; b < n; b++) last_join[b] = -1;
+
+    CFGEdgeArray pairs = {0};
+    for (size_t i = 0; i < dom->rpo_count; i++) {
+        int b = dom->rpo[i];
+        size_t count;
+        const int *pred = cfg_predecessors(cfg, b, &count);
+        if (count < 2) continue;
+        for (size_t k = 0; k < count; k++) {
+            int runner = pred[k];
+            if (dom->idom[runner] < 0) continue;
+            while (runner != dom->idom[b] && last_join[runner] != b) {
+                push_edge(&pairs, runner, b);
+                last_join[runner] = b;
+                runner = dom->idom[runner];
+            }
+        }
+    }
+    cfg_pairs_to_csr(n, pairs.items, pairs.count, 0, &dom->df_start, &dom->df);
+    free(pairs.items);
+    free(last_join);
+}
+
+DomTree *dom_compute(const CFG *cfg) {
+    DomTree *dom = calloc(1, sizeof(DomTree));
+    if (!dom) {
+        printf("Memory allocation failed for dominator tree.\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t n = cfg->blocks.count;
+    dom->block_count = n;
+    dom->rpo = dom_alloc_ints(n);
+    dom->rpo_index = dom_alloc_ints(n);
+    dom->idom = dom_alloc_ints(n);
+    dom->pre = dom_alloc_ints(n);
+    dom->post = dom_alloc_ints(n);
+
+    // 1) Reverse postorder from the entry
+    dom_reverse_postorder(cfg, dom);
+    // 2) Immediate dominators
+    dom_iterate(cfg, dom);
+    // 3) Tree shape and numbering
+    dom_build_tree(dom);
+    // 4) Frontiers
+    dom_build_frontiers(cfg, dom);
+    return dom;
+}
+
+void dom_free(DomTree *dom) {
+    if (!dom) return;
+    free(dom->rpo);
+    free(dom->rpo_index);
+    free(dom->idom);
+    free(dom->child_start);
+    free(dom->children);
+    free(dom->pre);
+    free(dom->post);
+    free(dom->df_start);
+    free(dom->df);
+    free(dom);
+}
+
+int dom_dominates(const DomTree *dom, int a, int b) {
+    if (dom->pre[a] < 0 || dom->pre[b] < 0) return 0;
+    return dom->pre[a] <= dom->pre[b] && dom->post[b] <= dom->post[a];
+}
+
+const int *dom_children(const DomTree *dom, int block, size_t *count) {
+    *count = (size_t)(dom->child_start[block + 1] - dom->child_start[block]);
+    return &dom->children[dom->child_start[block]];
+}
+
+const int *dom_frontier(const DomTree *dom, int block, size_t *count) {
+    *count = (size_t)(dom->df_start[block + 1] - dom->df_start[block]);
+    return &dom->df[dom->df_start[block]];
+}
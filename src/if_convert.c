@@ -0,0 +1,260 @@
+#include "if_convert.h"
+#include "cfg_builder.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// One arm of an if: straight-line code without its label or closing goto
+typedef struct {
+    const TACInstr *instrs;
+    size_t count;
+} Arm;
+
+typedef struct {
+    const TACInstr *branch;   // the ifz / if_<rel> ending the head block
+    int  diamond;             // else arm present
+    Arm  then_arm;
+    Arm  else_arm;
+    int  join_label;          // label starting the block after the arms
+} IfShape;
+
+// Only pure computations may run on the path that would have skipped them;
+// division is excluded because it can trap
+static int is_speculatable(const TACInstr *instr) {
+    switch (instr->kind) {
+        case TAC_COPY:
+        case TAC_UNARY_OP:
+        case TAC_SELECT:
+            return 1;
+        case TAC_BINARY_OP:
+            return instr->op.binop != TAC_DIV && instr->op.binop != TAC_MOD;
+        default:
+            return 0;
+    }
+}
+
+// Every instruction but the last may only define temps;
+// the last one defines the variable the select will write
+static int arm_is_convertible(Arm arm) {
+    if (arm.count == 0) return 0;
+    for (size_t i = 0; i < arm.count; i++) {
+        if (!is_speculatable(&arm.instrs[i])) return 0;
+        if (i + 1 < arm.count && arm.instrs[i].dst.type != TAC_OP_TEMP) return 0;
+    }
+    return 1;
+}
+
+static const TACInstr *arm_last(Arm arm) {
+    return &arm.instrs[arm.count - 1];
+}
+
+// True if one of the arm's leading instructions (everything that stays a
+// write after conversion) defines op
+static int arm_defines(Arm arm, TACOperand op) {
+    for (size_t i = 0; i + 1 < arm.count; i++) {
+        if (tac_operand_equal(arm.instrs[i].dst, op)) return 1;
+    }
+    return 0;
+}
+
+// Instructions executed speculatively; a trailing copy folds into the select
+static size_t arm_cost(Arm arm) {
+    if (arm.count == 0) return 0;
+    return arm_last(arm)->kind == TAC_COPY ? arm.count - 1 : arm.count;
+}
+
+static int starts_with_label(const CFGBlock *block, int label) {
+    return block->count > 0
+        && block->instructions[0].kind == TAC_LABEL
+        && block->instructions[0].dst.type == TAC_OP_LABEL
+        && block->instructions[0].dst.literal == label;
+}
+
+// Recognizes a diamond or triangle whose head is blocks[i]
+static int match_if(CFGBlock **blocks, size_t n, size_t i, const size_t *refs,
+                    size_t max_speculated, IfShape *s) {
+    const CFGBlock *head = blocks[i];
+    if (head->count == 0 || i + 2 >= n) return 0;
+    s->branch = &head->instructions[head->count - 1];
+    if (s->branch->kind != TAC_IFZ && s->branch->kind != TAC_IF_CMP) return 0;
+    int skip = tac_jump_target(s->branch);
+    if (skip < 0) return 0;
+
+    // 1) The then arm falls out of the head; a label means it is entered elsewhere too
+    const CFGBlock *then_block = blocks[i + 1];
+    if (then_block->instructions[0].kind == TAC_LABEL) return 0;
+    const TACInstr *then_end = &then_block->instructions[then_block->count - 1];
+
+    // 2) Diamond: then arm jumps over an else arm that only the branch enters
+    if (then_end->kind == TAC_GOTO) {
+        int join = tac_jump_target(then_end);
+        if (join < 0 || i + 3 >= n || refs[skip] != 1) return 0;
+        const CFGBlock *else_block = blocks[i + 2];
+        if (!starts_with_label(else_block, skip) || !starts_with_label(blocks[i + 3], join)) return 0;
+        s->diamond = 1;
+        s->then_arm = (Arm){ then_block->instructions, then_block->count - 1 };
+        s->else_arm = (Arm){ else_block->instructions + 1, else_block->count - 1 };
+        s->join_label = join;
+    } else {
+        // 3) Triangle: then arm falls through into the branch target
+        if (!starts_with_label(blocks[i + 2], skip)) return 0;
+        s->diamond = 0;
+        s->then_arm = (Arm){ then_block->instructions, then_block->count };
+        s->else_arm = (Arm){ NULL, 0 };
+        s->join_label = skip;
+    }
+
+    // 4) Both arms must be pure and end by writing the same destination
+    if (!arm_is_convertible(s->then_arm)) return 0;
+    TACOperand x = arm_last(s->then_arm)->dst;
+    if (s->diamond) {
+        if (!arm_is_convertible(s->else_arm)) return 0;
+        if (!tac_operand_equal(arm_last(s->else_arm)->dst, x)) return 0;
+    } else if (arm_defines(s->then_arm, x)) {
+        return 0;   // the select reads the old x
+    }
+
+    // 5) ifz's condition is read again by the select, after the arms ran
+    if (s->branch->kind == TAC_IFZ &&
+        (arm_defines(s->then_arm, s->branch->arg1) || arm_defines(s->else_arm, s->branch->arg1)))
+        return 0;
+
+    // 6) Profitability
+    return arm_cost(s->then_arm) + arm_cost(s->else_arm) <= max_speculated;
+}
+
+// Copies the arm into out and returns the operand holding its value
+static TACOperand emit_arm(TACFunction *out, Arm arm, int fold_copy) {
+    for (size_t i = 0; i + 1 < arm.count; i++) {
+        tac_function_push(out, arm.instrs[i]);
+    }
+    TACInstr last = *arm_last(arm);
+    if (fold_copy && last.kind == TAC_COPY) return last.arg1;
+    last.dst = tac_temp(tac_function_new_temp(out));
+    tac_function_push(out, last);
+    return last.dst;
+}
+
+static void emit_select(TACFunction *out, const IfShape *s) {
+    TACOperand x = arm_last(s->then_arm)->dst;
+
+    // 1) The select tests against zero. ifz skips the then arm when its
+    //    operand is zero; if_<rel> skips it when the relation holds
+    TACOperand cond = s->branch->arg1;
+    int relation = s->branch->kind == TAC_IF_CMP;
+    if (relation) {
+        TACInstr rel = {0};
+        rel.kind = TAC_BINARY_OP;
+        rel.op.binop = s->branch->op.binop;
+        rel.dst = tac_temp(tac_function_new_temp(out));
+        rel.arg1 = s->branch->arg1;
+        rel.arg2 = s->branch->arg2;
+        tac_function_push(out, rel);
+        cond = rel.dst;
+    }
+
+    // 2) Both arms, each leaving its value in a fresh temp (or a folded copy source);
+    //    the then value cannot be folded if the else arm overwrites it
+    TACOperand then_source = arm_last(s->then_arm)->arg1;
+    int fold_then = !s->diamond || !arm_defines(s->else_arm, then_source);
+    TACOperand then_value = emit_arm(out, s->then_arm, fold_then);
+    TACOperand else_value = s->diamond ? emit_arm(out, s->else_arm, 1) : x;
+
+    // 3) x ← select cond then else
+    TACInstr select = {0};
+    select.kind = TAC_SELECT;
+    select.dst = x;
+    select.arg1 = cond;
+    select.arg2 = relation ? else_value : then_value;
+    select.arg3 = relation ? then_value : else_value;
+    tac_function_push(out, select);
+}
+
+// Copies block[0..count) into out, leaving out a label nothing jumps to anymore
+static void copy_block(TACFunction *out, const CFGBlock *block, size_t count, int drop_label) {
+    size_t start = drop_label >= 0 && starts_with_label(block, drop_label) ? 1 : 0;
+    for (size_t i = start; i < count; i++) {
+        tac_function_push(out, block->instructions[i]);
+    }
+}
+
+// Converts every non-overlapping shape once; nested ones need another round
+static size_t if_convert_round(TACFunction *fn, size_t max_speculated) {
+    // 1) How many jumps reach each label
+    size_t *refs = calloc(fn->label_count ? (size_t)fn->label_count : 1, sizeof(size_t));
+    if (!refs) {
+        printf("Memory allocation failed for label references.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < fn->count; i++) {
+        int target = tac_jump_target(&fn->instrs[i]);
+        if (target >= 0) refs[target]++;
+    }
+
+    // 2) Rebuild the function block by block
+    CFG *cfg = build_from_tac(fn);
+    if (!cfg) {
+        free(refs);
+        return 0;
+    }
+    CFGBlock **blocks = cfg->blocks.items;
+    size_t n = cfg->blocks.count;
+
+    // The header is copied over with the first block; new temps keep it current
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    size_t converted = 0;
+    int drop_label = -1;
+    for (size_t i = 0; i < n; i++) {
+        IfShape shape;
+        if (!match_if(blocks, n, i, refs, max_speculated, &shape)) {
+            copy_block(&out, blocks[i], blocks[i]->count, drop_label);
+            drop_label = -1;
+            continue;
+        }
+        copy_block(&out, blocks[i], blocks[i]->count - 1, drop_label);
+        emit_select(&out, &shape);
+        converted++;
+
+        // The join keeps its label only if something else still jumps there
+        refs[shape.join_label]--;
+        drop_label = refs[shape.join_label] == 0 ? shape.join_label : -1;
+        i += shape.diamond ? 2 : 1;
+    }
+
+    free_cfg(cfg);
+    free(cfg);
+    free(refs);
+
+    // 3) Swap in the rebuilt instructions
+    if (converted) {
+        tac_function_free(fn);
+        *fn = out;
+    } else {
+        tac_function_free(&out);
+    }
+    return converted;
+}
+
+size_t if_convert_function(TACFunction *fn, size_t max_speculated) {
+    size_t total = 0;
+    size_t converted;
+    // Removing edges would leave phi arguments without their predecessor
+    for (size_t i = 0; i < fn->count; i++) {
+        if (fn->instrs[i].kind == TAC_PHI) return 0;
+    }
+    while ((converted = if_convert_round(fn, max_speculated)) > 0) {
+        total += converted;
+    }
+    return total;
+}
+
+size_t if_convert_program(TACProgram *program, size_t max_speculated) {
+    size_t total = 0;
+    for (size_t i = 0; i < program->count; i++) {
+        total += if_convert_function(&program->functions[i], max_speculated);
+    }
+    return total;
+}
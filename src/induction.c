@@ -0,0 +1,591 @@
+#include "induction.h"
+#include "cfg_builder.h"
+#include "dominance.h"
+#include "intern.h"
+#include "licm.h"
+#include "loops.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define IV_NO_DEF ((size_t)-1)
+
+typedef struct {
+    size_t     phi;           // instruction index of the header phi
+    TACOperand value;         // its result, the value at the top of an iteration
+    TACOperand init;          // value on entering the loop
+    TACOperand next;          // value around the back edge
+    size_t     step_def;      // instruction computing next = value + step
+    long long  step;
+    int        bounded;       // every value it takes is within [lo, hi]
+    long long  lo, hi;
+    long long  bound;         // literal the exit test compares it with,
+    int        literal_bound; // when there is one
+} BasicIV;
+
+// A multiplication of a basic variable by an invariant factor
+typedef struct {
+    int        iv;
+    TACOperand factor;
+    TACOperand value;         // the new variable: phi in the header
+    TACOperand base;          // its value on entering
+    TACOperand step;
+    TACOperand next;
+} Reduced;
+
+typedef struct {
+    TACFunction *fn;
+    CFG         *cfg;
+    DomTree     *dom;
+    LoopForest  *forest;
+    size_t       temp_count;
+    size_t      *def_of;      // per name: defining instruction, or IV_NO_DEF
+    int         *block_of;    // per instruction
+
+    // The loop being looked at
+    int          loop;
+    int          header;
+    int          latch;
+    int          entering;
+    size_t       entering_slot;
+    BasicIV     *ivs;
+    size_t       iv_count;
+} Induction;
+
+static size_t *def_slot(Induction *in, TACOperand op) {
+    if (op.type == TAC_OP_TEMP && op.literal >= 0 && (size_t)op.literal < in->temp_count) return &in->def_of[op.literal];
+    if (op.type == TAC_OP_VAR) return &in->def_of[in->temp_count + (size_t)op.sym];
+    return NULL;
+}
+
+// 0 if fn has no CFG, with nothing to release
+static int analyse(Induction *in, TACFunction *fn) {
+    *in = (Induction){0};
+    in->fn = fn;
+    in->cfg = build_from_tac(fn);
+    if (!in->cfg) return 0;
+    in->dom = dom_compute(in->cfg);
+    in->forest = loops_compute(in->cfg, in->dom);
+    in->temp_count = fn->temp_count > 0 ? (size_t)fn->temp_count : 0;
+    size_t names = in->temp_count + intern_count();
+    in->def_of = xcalloc(names, sizeof(size_t));
+    in->block_of = xcalloc(fn->count, sizeof(int));
+    for (size_t k = 0; k < names; k++) in->def_of[k] = IV_NO_DEF;
+    for (size_t b = 0; b < in->cfg->blocks.count; b++) {
+        const CFGBlock *block = in->cfg->blocks.items[b];
+        size_t base = (size_t)(block->instructions - fn->instrs);
+        for (size_t i = 0; i < block->count; i++) {
+            in->block_of[base + i] = (int)b;
+            const TACOperand *def = tac_def_operand(&block->instructions[i]);
+            size_t *slot = def ? def_slot(in, *def) : NULL;
+            if (slot) *slot = base + i;
+        }
+    }
+    return 1;
+}
+
+static void release(Induction *in) {
+    free(in->ivs);
+    free(in->def_of);
+    free(in->block_of);
+    loops_free(in->forest);
+    dom_free(in->dom);
+    free_cfg(in->cfg);
+    free(in->cfg);
+}
+
+// Defined outside the current loop (or a literal); variables without a
+// definition may be changed by calls
+static int is_invariant(Induction *in, TACOperand op) {
+    if (op.type == TAC_OP_LITERAL) return 1;
+    size_t *slot = def_slot(in, op);
+    if (!slot || *slot == IV_NO_DEF) return op.type == TAC_OP_TEMP;
+    return !loop_contains(in->forest, in->loop, in->block_of[*slot]);
+}
+
+static int fits_int(long long v) {
+    return v >= INT_MIN && v <= INT_MAX;
+}
+
+// Loops with one entering edge and one latch that jumps back
+static int loop_shape(Induction *in, int loop) {
+    in->loop = loop;
+    in->header = in->forest->loops[loop].header;
+    const CFGBlock *header = in->cfg->blocks.items[in->header];
+    if (header->instructions[0].kind != TAC_LABEL) return 0;
+
+    size_t pred_count;
+    const int *pred = cfg_predecessors(in->cfg, in->header, &pred_count);
+    if (pred_count != 2) return 0;
+    int inside0 = loop_contains(in->forest, loop, pred[0]);
+    int inside1 = loop_contains(in->forest, loop, pred[1]);
+    if (inside0 == inside1) return 0;
+    in->entering_slot = inside0 ? 1 : 0;
+    in->entering = pred[in->entering_slot];
+    in->latch = pred[1 - in->entering_slot];
+
+    const CFGBlock *latch = in->cfg->blocks.items[in->latch];
+    return tac_jump_target(&latch->instructions[latch->count - 1]) == header->instructions[0].dst.literal;
+}
+
+// The range of iv from the header's exit test, when it compares iv with
+// an invariant bound and iv starts at a literal
+static void iv_range(Induction *in, BasicIV *iv) {
+    const CFGBlock *header = in->cfg->blocks.items[in->header];
+    const TACInstr *test = &header->instructions[header->count - 1];
+    if (test->kind != TAC_IF_CMP || iv->init.type != TAC_OP_LITERAL) return;
+
+    TACBinOp rel = test->op.binop;
+    TACOperand bound;
+    if (tac_operand_equal(test->arg1, iv->value)) {
+        bound = test->arg2;
+    } else if (tac_operand_equal(test->arg2, iv->value)) {
+        // b < iv is iv > b
+        bound = test->arg1;
+        if (rel == TAC_LT) rel = TAC_GT;
+        else if (rel == TAC_GT) rel = TAC_LT;
+        else if (rel == TAC_LTE) rel = TAC_GTE;
+        else if (rel == TAC_GTE) rel = TAC_LTE;
+    } else {
+        return;
+    }
+    if (!is_invariant(in, bound)) return;
+
+    // The relation under which the loop goes on
+    int target = cfg_label_block(in->cfg, tac_jump_target(test));
+    int jump_stays = target >= 0 && loop_contains(in->forest, in->loop, target);
+    int fall_stays = loop_contains(in->forest, in->loop, in->header + 1);
+    if (jump_stays == fall_stays) return;
+    TACBinOp stay = jump_stays ? rel : tac_negate_relation(rel);
+
+    // Each value after the first is one that passed the test plus the step
+    long long init = iv->init.literal, step = iv->step;
+    long long lo, hi;
+    if (bound.type == TAC_OP_LITERAL) {
+        long long b = bound.literal;
+        if (step > 0 && (stay == TAC_LT || stay == TAC_LTE)) {
+            long long last = stay == TAC_LT ? b - 1 : b;
+            lo = init;
+            hi = init > last + step ? init : last + step;
+        } else if (step < 0 && (stay == TAC_GT || stay == TAC_GTE)) {
+            long long last = stay == TAC_GT ? b + 1 : b;
+            hi = init;
+            lo = init < last + step ? init : last + step;
+        } else {
+            return;
+        }
+        iv->bound = b;
+        iv->literal_bound = 1;
+    } else if (step == 1 && stay == TAC_LT) {
+        // below some int, plus one
+        lo = init;
+        hi = INT_MAX;
+    } else if (step == -1 && stay == TAC_GT) {
+        lo = INT_MIN;
+        hi = init;
+    } else {
+        return;
+    }
+    if (!fits_int(lo) || !fits_int(hi)) return;
+    iv->bounded = 1;
+    iv->lo = lo;
+    iv->hi = hi;
+}
+
+// Header phis stepped by a literal around the back edge
+static void find_ivs(Induction *in) {
+    const CFGBlock *header = in->cfg->blocks.items[in->header];
+    size_t base = (size_t)(header->instructions - in->fn->instrs);
+    free(in->ivs);
+    in->ivs = xcalloc(header->count, sizeof(BasicIV));
+    in->iv_count = 0;
+
+    for (size_t i = 1; i < header->count && header->instructions[i].kind == TAC_PHI; i++) {
+        const TACInstr *phi = &header->instructions[i];
+        const TACOperand *args = tac_phi_args(phi);
+        BasicIV iv = {0};
+        iv.phi = base + i;
+        iv.value = phi->dst;
+        iv.init = args[in->entering_slot];
+        iv.next = args[1 - in->entering_slot];
+
+        size_t *slot = def_slot(in, iv.next);
+        if (!slot || *slot == IV_NO_DEF || !loop_contains(in->forest, in->loop, in->block_of[*slot])) continue;
+        const TACInstr *def = &in->fn->instrs[*slot];
+        if (def->kind != TAC_BINARY_OP) continue;
+        if (def->op.binop == TAC_ADD && tac_operand_equal(def->arg1, iv.value) && def->arg2.type == TAC_OP_LITERAL) {
+            iv.step = def->arg2.literal;
+        } else if (def->op.binop == TAC_ADD && tac_operand_equal(def->arg2, iv.value) && def->arg1.type == TAC_OP_LITERAL) {
+            iv.step = def->arg1.literal;
+        } else if (def->op.binop == TAC_SUB && tac_operand_equal(def->arg1, iv.value) && def->arg2.type == TAC_OP_LITERAL) {
+            iv.step = -(long long)def->arg2.literal;
+        } else {
+            continue;
+        }
+        if (iv.step == 0) continue;
+        iv.step_def = *slot;
+        iv_range(in, &iv);
+        in->ivs[in->iv_count++] = iv;
+    }
+}
+
+static int iv_of(const Induction *in, TACOperand op) {
+    for (size_t k = 0; k < in->iv_count; k++) {
+        if (tac_operand_equal(in->ivs[k].value, op)) return (int)k;
+    }
+    return -1;
+}
+
+typedef struct {
+    TACInstr *items;
+    size_t    count;
+    size_t    capacity;
+} InstrList;
+
+static void push_instr(InstrList *list, TACInstr instr) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 8;
+        TACInstr *grown = realloc(list->items, capacity * sizeof(TACInstr));
+        if (!grown) {
+            printf("Memory allocation failed for induction variables.\n");
+            exit(EXIT_FAILURE);
+        }
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = instr;
+}
+
+static TACInstr binary(TACBinOp op, TACOperand dst, TACOperand a, TACOperand b) {
+    TACInstr instr = {0};
+    instr.kind = TAC_BINARY_OP;
+    instr.op.binop = op;
+    instr.dst = dst;
+    instr.arg1 = a;
+    instr.arg2 = b;
+    return instr;
+}
+
+// Pushes the instructions of a block, with `tail` in front of a closing jump
+static void push_block(TACFunction *out, const TACInstr *instrs, size_t count, const InstrList *tail) {
+    const TACInstr *last = &instrs[count - 1];
+    int closes = last->kind == TAC_GOTO || last->kind == TAC_IFZ || last->kind == TAC_IF_CMP;
+    for (size_t i = 0; i + (closes ? 1 : 0) < count; i++) tac_function_push(out, instrs[i]);
+    for (size_t k = 0; k < tail->count; k++) tac_function_push(out, tail->items[k]);
+    if (closes) tac_function_push(out, *last);
+}
+
+// Strength-reduces the current loop; returns whether the function changed
+static int reduce_loop(Induction *in, InductionStats *counts) {
+    TACFunction *fn = in->fn;
+
+    // 1) Products of a basic variable and an invariant, one new
+    //    variable per distinct pair
+    Reduced *reduced = NULL;
+    size_t reduced_count = 0, reduced_capacity = 0;
+    size_t *product = NULL;           // instruction -> index into reduced + 1
+    for (size_t b = 0; b < in->cfg->blocks.count; b++) {
+        if (!loop_contains(in->forest, in->loop, (int)b)) continue;
+        const CFGBlock *block = in->cfg->blocks.items[b];
+        size_t base = (size_t)(block->instructions - fn->instrs);
+        for (size_t i = 0; i < block->count; i++) {
+            const TACInstr *instr = &block->instructions[i];
+            if (instr->kind != TAC_BINARY_OP || instr->op.binop != TAC_MUL) continue;
+            int iv = iv_of(in, instr->arg1);
+            TACOperand factor = instr->arg2;
+            if (iv < 0) {
+                iv = iv_of(in, instr->arg2);
+                factor = instr->arg1;
+            }
+            if (iv < 0 || !is_invariant(in, factor)) continue;
+            if (factor.type == TAC_OP_LITERAL && (factor.literal == 0 || factor.literal == 1)) continue;
+
+            size_t r = 0;
+            while (r < reduced_count && !(reduced[r].iv == iv && tac_operand_equal(reduced[r].factor, factor))) r++;
+            if (r == reduced_count) {
+                if (reduced_count == reduced_capacity) {
+                    reduced_capacity = reduced_capacity ? reduced_capacity * 2 : 4;
+                    reduced = realloc(reduced, reduced_capacity * sizeof(Reduced));
+                    if (!reduced) {
+                        printf("Memory allocation failed for induction variables.\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                reduced[reduced_count++] = (Reduced){ .iv = iv, .factor = factor };
+            }
+            if (!product) product = xcalloc(fn->count, sizeof(size_t));
+            product[base + i] = r + 1;
+        }
+    }
+    if (reduced_count == 0) return 0;
+
+    // 2) Start and step of each new variable, in the preheader when they
+    //    are not literals
+    InstrList pre = {0}, latch = {0};
+    for (size_t r = 0; r < reduced_count; r++) {
+        Reduced *red = &reduced[r];
+        const BasicIV *iv = &in->ivs[red->iv];
+        if (iv->init.type == TAC_OP_LITERAL && red->factor.type == TAC_OP_LITERAL) {
+            red->base = tac_literal((int)((unsigned)iv->init.literal * (unsigned)red->factor.literal));
+        } else if (iv->init.type == TAC_OP_LITERAL && (iv->init.literal == 0 || iv->init.literal == 1)) {
+            red->base = iv->init.literal == 0 ? tac_literal(0) : red->factor;
+        } else {
+            red->base = tac_temp(tac_function_new_temp(fn));
+            push_instr(&pre, binary(TAC_MUL, red->base, iv->init, red->factor));
+        }
+        if (red->factor.type == TAC_OP_LITERAL) {
+            red->step = tac_literal((int)((unsigned)iv->step * (unsigned)red->factor.literal));
+        } else if (iv->step == 1) {
+            red->step = red->factor;
+        } else if (iv->step == -1) {
+            red->step = tac_temp(tac_function_new_temp(fn));
+            push_instr(&pre, (TACInstr){ .kind = TAC_UNARY_OP, .op.unop = TAC_NEG, .dst = red->step, .arg1 = red->factor });
+        } else {
+            red->step = tac_temp(tac_function_new_temp(fn));
+            push_instr(&pre, binary(TAC_MUL, red->step, red->factor, tac_literal((int)iv->step)));
+        }
+        red->value = tac_temp(tac_function_new_temp(fn));
+        red->next = tac_temp(tac_function_new_temp(fn));
+        push_instr(&latch, binary(TAC_ADD, red->next, red->value, red->step));
+    }
+    counts->reduced += reduced_count;
+
+    // 3) The exit test moves to a reduced variable with a positive
+    //    literal factor when no scaled value overflows
+    const CFGBlock *header = in->cfg->blocks.items[in->header];
+    size_t test_index = (size_t)(header->instructions - fn->instrs) + header->count - 1;
+    TACInstr test = fn->instrs[test_index];
+    int replaced_test = 0;
+    for (size_t r = 0; r < reduced_count && !replaced_test; r++) {
+        const Reduced *red = &reduced[r];
+        const BasicIV *iv = &in->ivs[red->iv];
+        if (!iv->bounded || !iv->literal_bound || red->factor.type != TAC_OP_LITERAL || red->factor.literal <= 0) continue;
+        long long c = red->factor.literal;
+        if (!fits_int(iv->lo * c) || !fits_int(iv->hi * c) || !fits_int(iv->bound * c)) continue;
+        TACOperand scaled = tac_literal((int)(iv->bound * c));
+        if (tac_operand_equal(test.arg1, iv->value)) {
+            test.arg1 = red->value;
+            test.arg2 = scaled;
+        } else {
+            test.arg1 = scaled;
+            test.arg2 = red->value;
+        }
+        replaced_test = 1;
+        counts->replaced_tests++;
+    }
+
+    // 4) Rebuild: preheader code, new phis after the header's own,
+    //    products read the new variables, steps go before the back edge
+    size_t phis_end = 1;
+    while (phis_end < header->count && header->instructions[phis_end].kind == TAC_PHI) phis_end++;
+
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    InstrList none = {0};
+    for (size_t b = 0; b < in->cfg->blocks.count; b++) {
+        const CFGBlock *block = in->cfg->blocks.items[b];
+        size_t base = (size_t)(block->instructions - fn->instrs);
+        TACInstr *instrs = xcalloc(block->count + reduced_count, sizeof(TACInstr));
+        size_t count = 0;
+        for (size_t i = 0; i < block->count; i++) {
+            TACInstr instr = block->instructions[i];
+            if (product && product[base + i]) {
+                const Reduced *red = &reduced[product[base + i] - 1];
+                instr = (TACInstr){ .kind = TAC_COPY, .dst = instr.dst, .arg1 = red->value };
+            }
+            if (replaced_test && base + i == test_index) instr = test;
+            instrs[count++] = instr;
+
+            if ((int)b == in->header && i + 1 == phis_end) {
+                for (size_t r = 0; r < reduced_count; r++) {
+                    TACOperand args[2];
+                    args[in->entering_slot] = reduced[r].base;
+                    args[1 - in->entering_slot] = reduced[r].next;
+                    TACInstr phi = {0};
+                    phi.kind = TAC_PHI;
+                    phi.dst = reduced[r].value;
+                    phi.arg1 = tac_literal(tac_phi_alloc(2));
+                    phi.arg2 = tac_literal(2);
+                    tac_phi_args(&phi)[0] = args[0];
+                    tac_phi_args(&phi)[1] = args[1];
+                    instrs[count++] = phi;
+                }
+            }
+        }
+        const InstrList *tail = (int)b == in->entering ? &pre : (int)b == in->latch ? &latch : &none;
+        push_block(&out, instrs, count, tail);
+        free(instrs);
+    }
+    tac_function_sync_header(&out);
+
+    free(pre.items);
+    free(latch.items);
+    free(product);
+    free(reduced);
+    tac_function_free(fn);
+    *fn = out;
+    return 1;
+}
+
+// Uses of op as a value, phi arguments included
+static size_t count_uses(const TACFunction *fn, TACOperand op) {
+    size_t uses = 0;
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACInstr *instr = &fn->instrs[i];
+        if (instr->kind == TAC_PHI) {
+            const TACOperand *args = tac_phi_args(instr);
+            for (size_t k = 0; k < tac_phi_arg_count(instr); k++) uses += tac_operand_equal(args[k], op);
+            continue;
+        }
+        unsigned mask = tac_use_mask(instr);
+        if ((mask & TAC_USE_ARG1) && tac_operand_equal(instr->arg1, op)) uses++;
+        if ((mask & TAC_USE_ARG2) && tac_operand_equal(instr->arg2, op)) uses++;
+        if ((mask & TAC_USE_ARG3) && tac_operand_equal(instr->arg3, op)) uses++;
+    }
+    return uses;
+}
+
+// A basic variable only read by its own step, and a step only read by
+// the phi, keep each other alive; drops both
+static void drop_dead_iv(TACFunction *fn, TACOperand value, TACOperand next) {
+    if (count_uses(fn, value) != 1 || count_uses(fn, next) != 1) return;
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACOperand *def = tac_def_operand(&fn->instrs[i]);
+        if (def && (tac_operand_equal(*def, value) || tac_operand_equal(*def, next))) continue;
+        tac_function_push(&out, fn->instrs[i]);
+    }
+    tac_function_sync_header(&out);
+    tac_function_free(fn);
+    *fn = out;
+}
+
+// k if v is 2^k for 1 <= k <= 30, else -1
+static int exact_log2(int v) {
+    if (v < 2 || (v & (v - 1)) != 0) return -1;
+    int k = 0;
+    while ((1 << k) != v) k++;
+    return k;
+}
+
+// Divisions by a power of two of induction variables known to stay
+// non-negative become shifts. Done before test replacement, which may
+// take away the test their range comes from
+static size_t shift_divisions(TACFunction *fn) {
+    Induction in;
+    if (!analyse(&in, fn)) return 0;
+    unsigned char *non_negative = xcalloc(fn->count, 1);   // per defining phi
+    for (size_t k = 0; k < in.forest->count; k++) {
+        if (!loop_shape(&in, (int)k)) continue;
+        find_ivs(&in);
+        for (size_t v = 0; v < in.iv_count; v++) {
+            if (in.ivs[v].bounded && in.ivs[v].lo >= 0) non_negative[in.ivs[v].phi] = 1;
+        }
+    }
+
+    size_t shifts = 0;
+    for (size_t i = 0; i < fn->count; i++) {
+        TACInstr *instr = &fn->instrs[i];
+        if (instr->kind != TAC_BINARY_OP || instr->op.binop != TAC_DIV || instr->arg2.type != TAC_OP_LITERAL) continue;
+        int k = exact_log2(instr->arg2.literal);
+        size_t *slot = def_slot(&in, instr->arg1);
+        if (k > 0 && slot && *slot != IV_NO_DEF && non_negative[*slot]) {
+            // rounding toward zero and toward minus infinity agree
+            instr->op.binop = TAC_SHR;
+            instr->arg2 = tac_literal(k);
+            shifts++;
+        }
+    }
+    free(non_negative);
+    release(&in);
+    return shifts;
+}
+
+// Multiplications by a power of two left after strength reduction
+// become shifts
+static size_t shift_multiplications(TACFunction *fn) {
+    size_t shifts = 0;
+    for (size_t i = 0; i < fn->count; i++) {
+        TACInstr *instr = &fn->instrs[i];
+        if (instr->kind != TAC_BINARY_OP || instr->op.binop != TAC_MUL) continue;
+        int k;
+        if (instr->arg2.type == TAC_OP_LITERAL && instr->arg1.type != TAC_OP_LITERAL &&
+            (k = exact_log2(instr->arg2.literal)) > 0) {
+            instr->op.binop = TAC_SHL;
+            instr->arg2 = tac_literal(k);
+            shifts++;
+        } else if (instr->arg1.type == TAC_OP_LITERAL && instr->arg2.type != TAC_OP_LITERAL &&
+                   (k = exact_log2(instr->arg1.literal)) > 0) {
+            instr->op.binop = TAC_SHL;
+            instr->arg1 = instr->arg2;
+            instr->arg2 = tac_literal(k);
+            shifts++;
+        }
+    }
+    return shifts;
+}
+
+void induction(TACFunction *fn, InductionStats *stats) {
+    if (fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION) return;
+    InductionStats counts = {0};
+    counts.shifts += shift_divisions(fn);
+
+    // Headers (by label) already done; each loop is reduced once
+    size_t label_capacity = fn->label_count > 0 ? (size_t)fn->label_count : 0;
+    unsigned char *done = xcalloc(label_capacity, 1);
+
+    for (int changed = 1; changed;) {
+        changed = 0;
+        Induction in;
+        if (!analyse(&in, fn)) break;
+        for (size_t k = 0; k < in.forest->count && !changed; k++) {
+            if (!loop_shape(&in, (int)k)) continue;
+            const CFGBlock *header = in.cfg->blocks.items[in.header];
+            int label = header->instructions[0].dst.literal;
+            if ((size_t)label >= label_capacity || done[label]) continue;
+            find_ivs(&in);
+            if (in.iv_count == 0) {
+                done[label] = 1;
+                continue;
+            }
+
+            // 1) Code goes at the end of the entering block, which must
+            //    lead nowhere else
+            size_t succ_count;
+            cfg_successors(in.cfg, in.entering, &succ_count);
+            if (succ_count != 1) {
+                if (licm_make_preheader(fn, label) == 2) changed = 1;
+                else done[label] = 1;
+                continue;
+            }
+
+            // 2) Reduce, then drop variables the exit test no longer needs
+            done[label] = 1;
+            counts.ivs += in.iv_count;
+            if (reduce_loop(&in, &counts)) {
+                changed = 1;
+                for (size_t v = 0; v < in.iv_count; v++) drop_dead_iv(fn, in.ivs[v].value, in.ivs[v].next);
+            }
+        }
+        release(&in);
+    }
+    free(done);
+
+    counts.shifts += shift_multiplications(fn);
+    if (stats) {
+        stats->ivs += counts.ivs;
+        stats->reduced += counts.reduced;
+        stats->replaced_tests += counts.replaced_tests;
+        stats->shifts += counts.shifts;
+    }
+}
+
+void induction_program(TACProgram *program, InductionStats *stats) {
+    for (size_t i = 0; i < program->count; i++) induction(&program->functions[i], stats);
+}
@@ -0,0 +1,356 @@
+#include "inliner.h"
+#include "call_graph.h"
+#include "cfg_builder.h"
+#include "dominance.h"
+#include "intern.h"
+#include "loops.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    TACProgram  *program;
+    CallGraph   *graph;
+    int          recursive;
+    long long    budget;
+    size_t      *calls;       // per function: calls of it left in the program
+    size_t      *pops;        // per function: pops opening it, or 0 if it has others
+    size_t      *size;        // per function: instructions inlining copies
+    int          instances;   // for fresh names
+} Inliner;
+
+// A call to inline: instruction indices in the caller
+typedef struct {
+    size_t call;
+    int    callee;
+    int    depth;
+    size_t push[64];          // argument pushes, in order
+    int    args;
+} Site;
+
+static int is_function(const TACFunction *fn) {
+    return fn->count > 0 && fn->instrs[0].kind == TAC_FUNCTION;
+}
+
+// Parameters are the pops right after `fun`; a function popping anywhere
+// else is not inlined (pops[] is -1)
+static void measure(Inliner *in, int f) {
+    const TACFunction *fn = &in->program->functions[f];
+    size_t pops = 0;
+    while (1 + pops < fn->count && fn->instrs[1 + pops].kind == TAC_POP) pops++;
+    int other_pops = 0;
+    for (size_t i = 1 + pops; i < fn->count; i++) other_pops |= fn->instrs[i].kind == TAC_POP || fn->instrs[i].kind == TAC_PHI;
+    in->pops[f] = other_pops ? (size_t)-1 : pops;
+    in->size[f] = fn->count - 2 - pops;
+}
+
+static int deeper_first(const void *a, const void *b) {
+    const Site *x = a, *y = b;
+    if (x->depth != y->depth) return y->depth - x->depth;
+    return x->call < y->call ? -1 : x->call > y->call;
+}
+
+static int writes_var(const TACFunction *fn, int sym) {
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACOperand *def = tac_def_operand(&fn->instrs[i]);
+        if (def && def->type == TAC_OP_VAR && def->sym == sym) return 1;
+    }
+    return 0;
+}
+
+// True if callee reads a variable it never writes, so a global, that the
+// caller has one of its own by the same name: inlined, the read would see
+// the caller's
+static int captures_global(const TACFunction *callee, const unsigned char *written, size_t name_count) {
+    for (size_t i = 0; i < callee->count; i++) {
+        const TACInstr *instr = &callee->instrs[i];
+        unsigned uses = tac_use_mask(instr);
+        const TACOperand *args[3] = { &instr->arg1, &instr->arg2, &instr->arg3 };
+        for (int k = 0; k < 3; k++) {
+            if (!(uses & (TAC_USE_ARG1 << k)) || args[k]->type != TAC_OP_VAR) continue;
+            int sym = args[k]->sym;
+            if ((size_t)sym < name_count && written[sym] && !writes_var(callee, sym)) return 1;
+        }
+    }
+    return 0;
+}
+
+// Calls of f worth inlining, deepest first
+static size_t choose_sites(Inliner *in, int f, Site **out) {
+    const TACFunction *fn = &in->program->functions[f];
+    CFG *cfg = build_from_tac((TACFunction *)fn);
+    if (!cfg) {
+        *out = NULL;
+        return 0;
+    }
+    DomTree *dom = dom_compute(cfg);
+    LoopForest *forest = loops_compute(cfg, dom);
+    int *depth = xcalloc(fn->count, sizeof(int));
+    for (size_t b = 0; b < cfg->blocks.count; b++) {
+        const CFGBlock *block = cfg->blocks.items[b];
+        size_t base = (size_t)(block->instructions - fn->instrs);
+        for (size_t i = 0; i < block->count; i++) depth[base + i] = forest->block_depth[b];
+    }
+
+    // Variables f writes are its own; in the global segment they are the
+    // globals themselves
+    size_t name_count = intern_count();
+    unsigned char *written = xcalloc(name_count, 1);
+    for (size_t i = 0; is_function(fn) && i < fn->count; i++) {
+        const TACOperand *def = tac_def_operand(&fn->instrs[i]);
+        if (def && def->type == TAC_OP_VAR && (size_t)def->sym < name_count) written[def->sym] = 1;
+    }
+
+    Site *sites = NULL;
+    size_t count = 0, capacity = 0;
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACInstr *instr = &fn->instrs[i];
+        if (instr->kind != TAC_CALL || instr->arg1.type != TAC_OP_VAR) continue;
+        int g = call_graph_find(in->graph, instr->arg1.sym);
+        if (g < 0 || !is_function(&in->program->functions[g])) continue;
+        if (in->graph->recursive[g] && !in->recursive) continue;
+        Site site = { .call = i, .callee = g, .depth = depth[i] };
+        site.args = tac_call_pushes(fn, i, site.push, sizeof site.push / sizeof site.push[0]);
+        if (site.args < 0 || in->pops[g] != (size_t)site.args) continue;
+
+        // a result needs every path to end in a return, so none to fall
+        // into endfun
+        const TACFunction *callee = &in->program->functions[g];
+        TACOpKind last = callee->instrs[callee->count - 2].kind;
+        if (instr->dst.type != TAC_OP_NONE && last != TAC_RETURN && last != TAC_GOTO) continue;
+        if (captures_global(callee, written, name_count)) continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 8;
+            sites = realloc(sites, capacity * sizeof(Site));
+            if (!sites) {
+                printf("Memory allocation failed for inlining.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        sites[count++] = site;
+    }
+    free(written);
+    free(depth);
+    loops_free(forest);
+    dom_free(dom);
+    free_cfg(cfg);
+    free(cfg);
+
+    if (count > 1) qsort(sites, count, sizeof(Site), deeper_first);
+    size_t kept = 0;
+    for (size_t k = 0; k < count; k++) {
+        int g = sites[k].callee;
+        int levels = sites[k].depth < INLINE_MAX_DEPTH ? sites[k].depth : INLINE_MAX_DEPTH;
+        size_t allowance = INLINE_MAX_SIZE + (size_t)INLINE_LOOP_BONUS * (size_t)levels;
+        if (in->calls[g] == 1 && !in->graph->recursive[g] && allowance < INLINE_ONCE_MAX_SIZE) allowance = INLINE_ONCE_MAX_SIZE;
+        if (in->size[g] > allowance || (long long)in->size[g] > in->budget) continue;
+        in->budget -= (long long)in->size[g];
+        sites[kept++] = sites[k];
+    }
+    *out = sites;
+    return kept;
+}
+
+// A name for a variable of an inlined body no function uses yet
+static int fresh_var(Inliner *in, int sym, const unsigned char *used, size_t used_count) {
+    const char *base = interned_name(sym);
+    size_t len = strlen(base) + 24;
+    char *buf = xcalloc(len, 1);
+    int fresh;
+    do {
+        snprintf(buf, len, "%s.i%d", base, ++in->instances);
+        fresh = intern(buf);
+    } while ((size_t)fresh < used_count && used[fresh]);
+    free(buf);
+    return fresh;
+}
+
+typedef struct {
+    int  temps;               // added to the callee's temp numbers
+    int  labels;              // added to its label numbers
+    int *vars;                // callee name -> fresh name, or -1 to keep
+    size_t var_count;
+} Renaming;
+
+static TACOperand rename_operand(const Renaming *r, TACOperand op) {
+    switch (op.type) {
+      case TAC_OP_TEMP:  return tac_temp(op.literal + r->temps);
+      case TAC_OP_LABEL: return tac_label(op.literal + r->labels);
+      case TAC_OP_VAR:
+        if ((size_t)op.sym < r->var_count && r->vars[op.sym] >= 0) op.sym = r->vars[op.sym];
+        return op;
+      default:           return op;
+    }
+}
+
+// Pushes the body of callee g in place of the call `call`
+static void push_inlined(Inliner *in, TACFunction *out, const TACInstr *call, int g, const Renaming *r) {
+    const TACFunction *callee = &in->program->functions[g];
+    size_t first = 1 + in->pops[g], last = callee->count - 1;    // before endfun
+    int end = tac_function_new_label(out);
+    int jumped = 0;
+    for (size_t i = first; i < last; i++) {
+        TACInstr instr = callee->instrs[i];
+        if (instr.kind == TAC_RETURN) {
+            if (call->dst.type != TAC_OP_NONE && instr.arg1.type != TAC_OP_NONE) {
+                tac_function_push(out, (TACInstr){ .kind = TAC_COPY, .dst = call->dst, .arg1 = rename_operand(r, instr.arg1) });
+            }
+            if (i + 1 < last) {
+                tac_function_push(out, (TACInstr){ .kind = TAC_GOTO, .arg1 = tac_label(end) });
+                jumped = 1;
+            }
+            continue;
+        }
+        instr.dst = rename_operand(r, instr.dst);
+        instr.arg1 = rename_operand(r, instr.arg1);
+        instr.arg2 = rename_operand(r, instr.arg2);
+        instr.arg3 = rename_operand(r, instr.arg3);
+        if (instr.kind == TAC_CALL) instr.op.tail = 0;      // no longer followed by the return
+        tac_function_push(out, instr);
+
+        // calls the body makes are now made here as well
+        if (instr.kind == TAC_CALL && instr.arg1.type == TAC_OP_VAR) {
+            int h = call_graph_find(in->graph, instr.arg1.sym);
+            if (h >= 0) in->calls[h]++;
+        }
+    }
+    if (jumped) tac_function_push(out, (TACInstr){ .kind = TAC_LABEL, .dst = tac_label(end) });
+    in->calls[g]--;
+}
+
+static void inline_into(Inliner *in, int f, InlineStats *counts) {
+    TACFunction *fn = &in->program->functions[f];
+    for (size_t i = 0; i < fn->count; i++) {
+        if (fn->instrs[i].kind == TAC_PHI) return;
+    }
+    Site *sites;
+    size_t site_count = choose_sites(in, f, &sites);
+    if (site_count == 0) {
+        free(sites);
+        return;
+    }
+
+    // 1) Per instruction, the site it belongs to (+1) and, for pushes, the
+    //    argument; names in use, so fresh ones stay apart
+    size_t *site_of = xcalloc(fn->count, sizeof(size_t));
+    int *arg_of = xcalloc(fn->count, sizeof(int));
+    for (size_t k = 0; k < site_count; k++) {
+        site_of[sites[k].call] = k + 1;
+        for (int a = 0; a < sites[k].args; a++) {
+            site_of[sites[k].push[a]] = k + 1;
+            arg_of[sites[k].push[a]] = a;
+        }
+    }
+    size_t used_count = intern_count();
+    unsigned char *used = xcalloc(used_count, 1);
+    for (size_t p = 0; p < in->program->count; p++) {
+        const TACFunction *other = &in->program->functions[p];
+        for (size_t i = 0; i < other->count; i++) {
+            const TACInstr *instr = &other->instrs[i];
+            const TACOperand *ops[4] = { &instr->dst, &instr->arg1, &instr->arg2, &instr->arg3 };
+            for (int o = 0; o < 4; o++) {
+                if (ops[o]->type == TAC_OP_VAR && (size_t)ops[o]->sym < used_count) used[ops[o]->sym] = 1;
+            }
+        }
+    }
+
+    // 2) Renamings, made when the first push or the call is reached
+    Renaming *renaming = xcalloc(site_count, sizeof(Renaming));
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    for (size_t k = 0; k < site_count; k++) {
+        int g = sites[k].callee;
+        const TACFunction *callee = &in->program->functions[g];
+        Renaming *r = &renaming[k];
+        r->temps = out.temp_count;
+        r->labels = out.label_count;
+        out.temp_count += callee->temp_count;
+        out.label_count += callee->label_count;
+        r->var_count = intern_count();
+        r->vars = xcalloc(r->var_count, sizeof(int));
+        for (size_t v = 0; v < r->var_count; v++) r->vars[v] = -1;
+        for (size_t i = 1; i + 1 < callee->count; i++) {
+            const TACOperand *def = tac_def_operand(&callee->instrs[i]);
+            if (def && def->type == TAC_OP_VAR && r->vars[def->sym] < 0) {
+                r->vars[def->sym] = fresh_var(in, def->sym, used, used_count);
+            }
+        }
+    }
+
+    // 3) Rebuild
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACInstr *instr = &fn->instrs[i];
+        if (!site_of[i]) {
+            tac_function_push(&out, *instr);
+            continue;
+        }
+        size_t k = site_of[i] - 1;
+        int g = sites[k].callee;
+        if (instr->kind == TAC_PUSH) {
+            // the parameter takes the value here, where it was pushed
+            const TACInstr *pop = &in->program->functions[g].instrs[1 + arg_of[i]];
+            tac_function_push(&out, (TACInstr){ .kind = TAC_COPY, .dst = rename_operand(&renaming[k], pop->arg1),
+                                                .arg1 = instr->arg1 });
+        } else {
+            push_inlined(in, &out, instr, g, &renaming[k]);
+        }
+    }
+    tac_function_sync_header(&out);
+
+    counts->inlined += site_count;
+    if (out.count > fn->count) counts->added += out.count - fn->count;
+    for (size_t k = 0; k < site_count; k++) free(renaming[k].vars);
+    free(renaming);
+    free(used);
+    free(arg_of);
+    free(site_of);
+    free(sites);
+    tac_function_free(fn);
+    *fn = out;
+    measure(in, f);
+}
+
+void inline_program(TACProgram *program, int recursive, InlineStats *stats) {
+    Inliner in = {0};
+    in.program = program;
+    in.graph = call_graph_build(program);
+    in.recursive = recursive;
+    in.calls = xcalloc(program->count, sizeof(size_t));
+    in.pops = xcalloc(program->count, sizeof(size_t));
+    in.size = xcalloc(program->count, sizeof(size_t));
+
+    size_t total = 0;
+    for (size_t f = 0; f < program->count; f++) {
+        const TACFunction *fn = &program->functions[f];
+        total += fn->count;
+        if (is_function(fn)) measure(&in, (int)f);
+        for (size_t i = 0; i < fn->count; i++) {
+            const TACInstr *instr = &fn->instrs[i];
+            if (instr->kind != TAC_CALL || instr->arg1.type != TAC_OP_VAR) continue;
+            int g = call_graph_find(in.graph, instr->arg1.sym);
+            if (g >= 0) in.calls[g]++;
+        }
+    }
+    in.budget = (long long)(total * INLINE_GROWTH_PERCENT / 100);
+    if (in.budget < INLINE_MIN_BUDGET) in.budget = INLINE_MIN_BUDGET;
+
+    // Callees first, so bodies are copied with their own calls inlined
+    InlineStats counts = {0};
+    int *order = xcalloc(in.graph->count, sizeof(int));
+    call_graph_callees_first(in.graph, order);
+    for (size_t k = 0; k < in.graph->count; k++) inline_into(&in, order[k], &counts);
+    free(order);
+
+    free(in.size);
+    free(in.pops);
+    free(in.calls);
+    call_graph_free(in.graph);
+    if (stats) {
+        stats->inlined += counts.inlined;
+        stats->added += counts.added;
+    }
+}
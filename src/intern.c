@@ -0,0 +1,96 @@
+#include "intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Open-addressing hash table of ids, keyed by the strings in `names`
+static char   **names = NULL;
+static size_t   name_count = 0;
+static size_t   name_capacity = 0;
+static int     *slots = NULL;      // -1 marks an empty slot
+static size_t   slot_capacity = 0; // always a power of two
+
+static uint32_t hash_name(const char *s, size_t len) {
+    uint32_t h = 2166136261u;      // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void intern_rehash(size_t new_capacity) {
+    int *new_slots = malloc(new_capacity * sizeof(int));
+    if (!new_slots) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < new_capacity; i++) new_slots[i] = -1;
+
+    for (size_t id = 0; id < name_count; id++) {
+        size_t mask = new_capacity - 1;
+        size_t i = hash_name(names[id], strlen(names[id])) & mask;
+        while (new_slots[i] != -1) i = (i + 1) & mask;
+        new_slots[i] = (int)id;
+    }
+    free(slots);
+    slots = new_slots;
+    slot_capacity = new_capacity;
+}
+
+int intern_n(const char *name, size_t len) {
+    if (name_count * 2 >= slot_capacity) {
+        intern_rehash(slot_capacity ? slot_capacity * 2 : 64);
+    }
+
+    size_t mask = slot_capacity - 1;
+    size_t i = hash_name(name, len) & mask;
+    while (slots[i] != -1) {
+        const char *existing = names[slots[i]];
+        if (strncmp(existing, name, len) == 0 && existing[len] == '\0') {
+            return slots[i];
+        }
+        i = (i + 1) & mask;
+    }
+
+    if (name_count >= name_capacity) {
+        size_t new_capacity = name_capacity ? name_capacity * 2 : 64;
+        char **new_names = realloc(names, new_capacity * sizeof(char *));
+        if (!new_names) {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+        names = new_names;
+        name_capacity = new_capacity;
+    }
+    names[name_count] = strndup(name, len);
+    if (!names[name_count]) {
+        perror("strndup");
+        exit(EXIT_FAILURE);
+    }
+    slots[i] = (int)name_count;
+    return (int)name_count++;
+}
+
+int intern(const char *name) {
+    return intern_n(name, strlen(name));
+}
+
+const char *interned_name(int id) {
+    if (id < 0 || (size_t)id >= name_count) return NULL;
+    return names[id];
+}
+
+size_t intern_count(void) {
+    return name_count;
+}
+
+void intern_free(void) {
+    for (size_t i = 0; i < name_count; i++) free(names[i]);
+    free(names);
+    free(slots);
+    names = NULL;
+    slots = NULL;
+    name_count = name_capacity = slot_capacity = 0;
+}
@@ -0,0 +1,498 @@
+#include "lambda_lift.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* A growable set of names. The strings are borrowed from the AST. */
+typedef struct {
+    const char **items;
+    size_t count;
+    size_t capacity;
+} NameSet;
+
+typedef struct LiftFunction LiftFunction;
+
+/* A variable of an enclosing function, passed in as a parameter */
+typedef struct {
+    const char   *name;       // as declared in owner
+    LiftFunction *owner;      // the function declaring it
+    char         *param;      // the parameter standing for it
+} LiftCapture;
+
+/* A call site together with the function it resolved to */
+typedef struct {
+    AstNode      *call;
+    LiftFunction *target;
+} LiftCall;
+
+struct LiftFunction {
+    AstNode      *node;       // AST_FUNCTION
+    LiftFunction *parent;     // enclosing function, NULL at top level
+    AstNode      *block;      // block holding the definition (nested only)
+
+    NameSet locals;           // parameters and declarations
+    NameSet refs;             // every variable read or written
+    NameSet assigned;         // variables written by assignment
+    LiftCapture *captures;    // enclosing variables passed in as parameters
+    size_t capture_count;
+    size_t capture_capacity;
+
+    LiftFunction **children;  // directly nested definitions
+    size_t child_count;
+    size_t child_capacity;
+
+    LiftCall *calls;
+    size_t call_count;
+    size_t call_capacity;
+};
+
+typedef struct {
+    LiftFunction **items;
+    size_t count;
+    size_t capacity;
+} LiftFunctionArray;
+
+
+static void *lift_grow(void *items, size_t *capacity, size_t elem_size) {
+    size_t new_capacity = *capacity ? *capacity * 2 : 4;
+    void *new_items = realloc(items, new_capacity * elem_size);
+    if (!new_items) {
+        perror("realloc");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = new_capacity;
+    return new_items;
+}
+
+static int name_set_contains(const NameSet *set, const char *name) {
+    for (size_t i = 0; i < set->count; i++) {
+        if (strcmp(set->items[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+// returns 1 if the name was not in the set yet
+static int name_set_add(NameSet *set, const char *name) {
+    if (name_set_contains(set, name)) return 0;
+    if (set->count >= set->capacity) {
+        set->items = lift_grow(set->items, &set->capacity, sizeof(*set->items));
+    }
+    set->items[set->count++] = name;
+    return 1;
+}
+
+static void name_set_free(NameSet *set) {
+    free(set->items);
+    set->items = NULL;
+    set->count = set->capacity = 0;
+}
+
+static const char *function_name(const LiftFunction *fn) {
+    return fn->node->data.function.name->data.variable.identifier;
+}
+
+
+/* ---------- 1) collect scopes, references and call sites ---------- */
+
+static LiftFunction *collect_function(AstNode *node, LiftFunction *parent,
+                                      AstNode *block, LiftFunctionArray *all);
+
+static void collect_node(LiftFunction *fn, AstNode *node, LiftFunctionArray *all) {
+    if (!node) return;
+
+    switch (node->type) {
+        case AST_VARIABLE:
+            name_set_add(&fn->refs, node->data.variable.identifier);
+            break;
+
+        case AST_UNARY_OP:
+            collect_node(fn, node->data.unary.operand, all);
+            break;
+
+        case AST_BINARY_OP:
+            collect_node(fn, node->data.binary.left, all);
+            collect_node(fn, node->data.binary.right, all);
+            break;
+
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->data.block.count; i++) {
+                AstNode *stmt = node->data.block.statements[i];
+                if (stmt && stmt->type == AST_FUNCTION) {
+                    collect_function(stmt, fn, node, all);
+                } else {
+                    collect_node(fn, stmt, all);
+                }
+            }
+            break;
+
+        case AST_IF:
+            collect_node(fn, node->data.if_stmt.condition, all);
+            collect_node(fn, (AstNode *)node->data.if_stmt.then_block, all);
+            collect_node(fn, (AstNode *)node->data.if_stmt.else_block, all);
+            break;
+
+        case AST_WHILE:
+            collect_node(fn, node->data.while_loop.condition, all);
+            collect_node(fn, (AstNode *)node->data.while_loop.body, all);
+            break;
+
+        case AST_DECLARATION:
+            name_set_add(&fn->locals,
+                         node->data.declaration.variable->data.variable.identifier);
+            collect_node(fn, node->data.declaration.value, all);
+            break;
+
+        case AST_ASSIGNMENT: {
+            const char *name = node->data.assignment.variable->data.variable.identifier;
+            name_set_add(&fn->refs, name);
+            name_set_add(&fn->assigned, name);
+            collect_node(fn, node->data.assignment.value, all);
+            break;
+        }
+
+        case AST_RETURN:
+            collect_node(fn, node->data.return_stmt.expression, all);
+            break;
+
+        case AST_CALL: {
+            if (fn->call_count >= fn->call_capacity) {
+                fn->calls = lift_grow(fn->calls, &fn->call_capacity, sizeof(*fn->calls));
+            }
+            fn->calls[fn->call_count++] = (LiftCall){ node, NULL };
+
+            AstNode *args = node->data.call.args;
+            for (size_t i = 0; args && i < args->data.args.count; i++) {
+                collect_node(fn, args->data.args.arguments[i], all);
+            }
+            break;
+        }
+
+        case AST_FUNCTION:
+            // definitions outside a block (should not happen) are still scoped
+            collect_function(node, fn, NULL, all);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static LiftFunction *collect_function(AstNode *node, LiftFunction *parent,
+                                      AstNode *block, LiftFunctionArray *all) {
+    LiftFunction *fn = calloc(1, sizeof(LiftFunction));
+    if (!fn) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    fn->node = node;
+    fn->parent = parent;
+    fn->block = block;
+
+    if (parent) {
+        if (parent->child_count >= parent->child_capacity) {
+            parent->children = lift_grow(parent->children, &parent->child_capacity,
+                                         sizeof(*parent->children));
+        }
+        parent->children[parent->child_count++] = fn;
+    }
+
+    if (all->count >= all->capacity) {
+        all->items = lift_grow(all->items, &all->capacity, sizeof(*all->items));
+    }
+    all->items[all->count++] = fn;
+
+    AstNode *params = node->data.function.params;
+    for (size_t i = 0; params && i < params->data.params.count; i++) {
+        name_set_add(&fn->locals, params->data.params.params[i]->data.variable.identifier);
+    }
+
+    collect_node(fn, (AstNode *)node->data.function.body, all);
+    return fn;
+}
+
+
+/* ---------- 2) resolve calls and compute captured variables ---------- */
+
+// Finds the nested function a call inside `fn` refers to, following the
+// lexical scope chain. Top-level functions need no lifting and yield NULL.
+static LiftFunction *resolve_callee(LiftFunction *fn, const char *name) {
+    for (LiftFunction *scope = fn; scope; scope = scope->parent) {
+        for (size_t i = 0; i < scope->child_count; i++) {
+            if (strcmp(function_name(scope->children[i]), name) == 0) {
+                return scope->children[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+static char *lifted_name(const LiftFunction *fn);
+
+// The function `name` refers to inside fn: fn itself or the nearest
+// enclosing one declaring it; NULL for a global
+static LiftFunction *binding_scope(LiftFunction *fn, const char *name) {
+    for (LiftFunction *scope = fn; scope; scope = scope->parent) {
+        if (name_set_contains(&scope->locals, name)) return scope;
+    }
+    return NULL;
+}
+
+static LiftCapture *find_capture(LiftFunction *fn, const char *name, const LiftFunction *owner) {
+    for (size_t k = 0; k < fn->capture_count; k++) {
+        if (fn->captures[k].owner == owner && strcmp(fn->captures[k].name, name) == 0) {
+            return &fn->captures[k];
+        }
+    }
+    return NULL;
+}
+
+// returns 1 if fn did not capture the variable yet
+static int add_capture(LiftFunction *fn, const char *name, LiftFunction *owner) {
+    if (find_capture(fn, name, owner)) return 0;
+    if (fn->capture_count >= fn->capture_capacity) {
+        fn->captures = lift_grow(fn->captures, &fn->capture_capacity, sizeof(*fn->captures));
+    }
+    fn->captures[fn->capture_count++] = (LiftCapture){ name, owner, NULL };
+    return 1;
+}
+
+// Iterates to a fixed point: a function also captures whatever the nested
+// functions it calls capture, unless it declares those variables itself.
+// Captures are variables, not names: a function declaring x may still
+// have to pass on the x of an enclosing function to a callee reading it.
+static void compute_captures(LiftFunctionArray *all) {
+    for (size_t i = 0; i < all->count; i++) {
+        LiftFunction *fn = all->items[i];
+        if (!fn->parent) continue;
+        for (size_t r = 0; r < fn->refs.count; r++) {
+            LiftFunction *owner = binding_scope(fn, fn->refs.items[r]);
+            if (owner && owner != fn) add_capture(fn, fn->refs.items[r], owner);
+        }
+    }
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (size_t i = 0; i < all->count; i++) {
+            LiftFunction *fn = all->items[i];
+            for (size_t c = 0; c < fn->call_count; c++) {
+                LiftFunction *callee = fn->calls[c].target;
+                if (!callee) continue;
+                // the owner encloses the callee, so it is fn or encloses fn
+                for (size_t k = 0; k < callee->capture_count; k++) {
+                    LiftCapture *capture = &callee->captures[k];
+                    if (capture->owner == fn) continue;
+                    changed |= add_capture(fn, capture->name, capture->owner);
+                }
+            }
+        }
+    }
+
+    // A capture keeps its name unless the name means another variable in
+    // fn; the other gets one no identifier can take
+    for (size_t i = 0; i < all->count; i++) {
+        LiftFunction *fn = all->items[i];
+        for (size_t k = 0; k < fn->capture_count; k++) {
+            LiftCapture *capture = &fn->captures[k];
+            if (binding_scope(fn, capture->name) == capture->owner) {
+                capture->param = strdup(capture->name);
+            } else {
+                char *owner = lifted_name(capture->owner);
+                size_t len = strlen(capture->name) + 1 + strlen(owner) + 1;
+                capture->param = malloc(len);
+                if (capture->param) snprintf(capture->param, len, "%s.%s", capture->name, owner);
+                free(owner);
+            }
+            if (!capture->param) {
+                perror("malloc");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+}
+
+
+/* ---------- 3) rewrite definitions and call sites ---------- */
+
+static AstNode *make_variable(const char *name) {
+    AstNode *var = ast_create_node(AST_VARIABLE);
+    var->data.variable.identifier = strdup(name);
+    return var;
+}
+
+static char *lifted_name(const LiftFunction *fn) {
+    if (!fn->parent) return strdup(function_name(fn));
+
+    char *prefix = lifted_name(fn->parent);
+    const char *name = function_name(fn);
+    size_t len = strlen(prefix) + 1 + strlen(name) + 1;
+    char *full = malloc(len);
+    if (!full) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(full, len, "%s.%s", prefix, name);
+    free(prefix);
+    return full;
+}
+
+// What `caller` passes for a variable its callee captures
+static const char *capture_argument(LiftFunction *caller, const LiftCapture *capture) {
+    if (capture->owner == caller) return capture->name;
+    return find_capture(caller, capture->name, capture->owner)->param;
+}
+
+static void rewrite_call(LiftFunction *caller, LiftCall *site, const char *new_name) {
+    AstNode *call = site->call;
+    AstNode *callee = call->data.call.callee;
+    free(callee->data.variable.identifier);
+    callee->data.variable.identifier = strdup(new_name);
+
+    if (!call->data.call.args) {
+        call->data.call.args = ast_param_list_create();
+    }
+    for (size_t i = 0; i < site->target->capture_count; i++) {
+        ast_param_list_push(call->data.call.args,
+                            make_variable(capture_argument(caller, &site->target->captures[i])));
+    }
+}
+
+static void remove_from_block(AstNode *block, AstNode *stmt) {
+    size_t out = 0;
+    for (size_t i = 0; i < block->data.block.count; i++) {
+        if (block->data.block.statements[i] != stmt) {
+            block->data.block.statements[out++] = block->data.block.statements[i];
+        }
+    }
+    block->data.block.count = out;
+}
+
+// Appends `fn` and its lifted descendants to `block`, innermost first
+static void hoist_descendants(LiftFunction *fn, AstBlock *block) {
+    for (size_t i = 0; i < fn->child_count; i++) {
+        hoist_descendants(fn->children[i], block);
+        ast_block_push(block, fn->children[i]->node);
+    }
+}
+
+static void free_lift_function(LiftFunction *fn) {
+    name_set_free(&fn->locals);
+    name_set_free(&fn->refs);
+    name_set_free(&fn->assigned);
+    for (size_t k = 0; k < fn->capture_count; k++) free(fn->captures[k].param);
+    free(fn->captures);
+    free(fn->children);
+    free(fn->calls);
+    free(fn);
+}
+
+
+void lambda_lift(AstNode *program) {
+    if (!program || program->type != AST_BLOCK) return;
+
+    // 1) Build the scope tree for every top-level function
+    LiftFunctionArray all = {0};
+    for (size_t i = 0; i < program->data.block.count; i++) {
+        AstNode *stmt = program->data.block.statements[i];
+        if (stmt && stmt->type == AST_FUNCTION) {
+            collect_function(stmt, NULL, NULL, &all);
+        }
+    }
+
+    int nested = 0;
+    for (size_t i = 0; i < all.count; i++) {
+        nested |= all.items[i]->parent != NULL;
+    }
+    if (!nested) {
+        for (size_t i = 0; i < all.count; i++) free_lift_function(all.items[i]);
+        free(all.items);
+        return;
+    }
+
+    // 2) Resolve call sites before anything is renamed
+    for (size_t i = 0; i < all.count; i++) {
+        LiftFunction *fn = all.items[i];
+        for (size_t c = 0; c < fn->call_count; c++) {
+            const char *name = fn->calls[c].call->data.call.callee->data.variable.identifier;
+            fn->calls[c].target = resolve_callee(fn, name);
+        }
+    }
+
+    compute_captures(&all);
+
+    // 3) Captures are passed by value, so writes cannot reach the enclosing frame
+    for (size_t i = 0; i < all.count; i++) {
+        LiftFunction *fn = all.items[i];
+        for (size_t k = 0; k < fn->capture_count; k++) {
+            const LiftCapture *capture = &fn->captures[k];
+            if (binding_scope(fn, capture->name) == capture->owner &&
+                name_set_contains(&fn->assigned, capture->name)) {
+                fprintf(stderr,
+                        "warning: nested function '%s' assigns captured variable '%s'; "
+                        "the update is not visible to the enclosing function\n",
+                        function_name(fn), capture->name);
+            }
+        }
+    }
+
+    // 4) Rewrite call sites to use the lifted name and pass captures
+    for (size_t i = 0; i < all.count; i++) {
+        LiftFunction *fn = all.items[i];
+        for (size_t c = 0; c < fn->call_count; c++) {
+            if (!fn->calls[c].target) continue;
+            char *name = lifted_name(fn->calls[c].target);
+            rewrite_call(fn, &fn->calls[c], name);
+            free(name);
+        }
+    }
+
+    // 5) Rename nested definitions and append captures as parameters.
+    //    Names are computed first since they depend on the parent's old name.
+    char **names = calloc(all.count, sizeof(char *));
+    if (!names) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < all.count; i++) {
+        if (all.items[i]->parent) names[i] = lifted_name(all.items[i]);
+    }
+    for (size_t i = 0; i < all.count; i++) {
+        LiftFunction *fn = all.items[i];
+        if (!fn->parent) continue;
+
+        AstNode *name_node = fn->node->data.function.name;
+        free(name_node->data.variable.identifier);
+        name_node->data.variable.identifier = names[i];
+
+        if (!fn->node->data.function.params) {
+            fn->node->data.function.params = ast_param_list_create();
+        }
+        for (size_t k = 0; k < fn->capture_count; k++) {
+            ast_param_list_push(fn->node->data.function.params,
+                                make_variable(fn->captures[k].param));
+        }
+
+        if (fn->block) remove_from_block(fn->block, fn->node);
+    }
+    free(names);
+
+    // 6) Rebuild the top level with lifted functions ahead of their enclosing one
+    AstBlock hoisted = {0};
+    for (size_t i = 0; i < program->data.block.count; i++) {
+        AstNode *stmt = program->data.block.statements[i];
+        if (stmt && stmt->type == AST_FUNCTION) {
+            for (size_t f = 0; f < all.count; f++) {
+                if (all.items[f]->node == stmt) {
+                    hoist_descendants(all.items[f], &hoisted);
+                    break;
+                }
+            }
+        }
+        ast_block_push(&hoisted, stmt);
+    }
+    free(program->data.block.statements);
+    program->data.block = hoisted;
+
+    for (size_t i = 0; i < all.count; i++) free_lift_function(all.items[i]);
+    free(all.items);
+}
@@ -65,6 +65,7 @@ void lexer_init_patterns(void) {
         regcomp(&re_logical,     "^" REGEX_LOGICAL, REG_EXTENDED) != 0 ||
         regcomp(&re_endln,       "^" REGEX_END_OF_LINE, REG_EXTENDED) != 0 ||
         regcomp(&re_number,      "^" REGEX_NUMBER,     REG_EXTENDED) != 0 ||
+        regcomp(&re_string,      "^" REGEX_STRING,      REG_EXTENDED) != 0 ||
         regcomp(&re_comma,       "^" REGEX_COMMA,       REG_EXTENDED) != 0 ||
         regcomp(&re_operator,   "^" REGEX_OPERATOR,   REG_EXTENDED) != 0) {
         fprintf(stderr, "Failed to compile regex patterns\n");
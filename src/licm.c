@@ -0,0 +1,446 @@
+#include "licm.h"
+#include "call_graph.h"
+#include "cfg_builder.h"
+#include "dominance.h"
+#include "intern.h"
+#include "loops.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <stdlib.h>
+
+#define LICM_NO_DEF ((size_t)-1)
+
+typedef struct {
+    TACFunction   *fn;
+    const unsigned char *pure;
+    CFG           *cfg;
+    DomTree       *dom;
+    LoopForest    *forest;
+
+    size_t         temp_count;
+    size_t        *def_of;        // per name: defining instruction, or LICM_NO_DEF
+    int           *block_of;      // per instruction
+    unsigned char *hoisted;       // per instruction
+} LICM;
+
+static size_t *def_slot(LICM *l, TACOperand op) {
+    if (op.type == TAC_OP_TEMP && op.literal >= 0 && (size_t)op.literal < l->temp_count) return &l->def_of[op.literal];
+    if (op.type == TAC_OP_VAR) return &l->def_of[l->temp_count + (size_t)op.sym];
+    return NULL;
+}
+
+static int is_pure_call(const LICM *l, const TACInstr *instr) {
+    return instr->kind == TAC_CALL && l->pure && instr->arg1.type == TAC_OP_VAR && l->pure[instr->arg1.sym];
+}
+
+// Whether op has the same value on every iteration of `loop`
+static int operand_invariant(LICM *l, int loop, TACOperand op, int varying_globals) {
+    size_t *slot = def_slot(l, op);
+    if (!slot) return 1;
+    if (*slot == LICM_NO_DEF) return op.type == TAC_OP_TEMP || !varying_globals;
+    if (l->hoisted[*slot]) return 1;
+    return !loop_contains(l->forest, loop, l->block_of[*slot]);
+}
+
+// Instructions that may run on paths that did not run them before
+static int is_speculable(const TACInstr *instr) {
+    switch (instr->kind) {
+        case TAC_BINARY_OP:
+            if (instr->op.binop == TAC_DIV || instr->op.binop == TAC_MOD)
+                return instr->arg2.type == TAC_OP_LITERAL && instr->arg2.literal != 0 && instr->arg2.literal != -1;
+            return 1;
+        case TAC_UNARY_OP:
+        case TAC_COPY:
+        case TAC_SELECT:
+            return 1;
+        case TAC_DEFINE:
+            return instr->arg1.type != TAC_OP_NONE;
+        default:
+            return 0;
+    }
+}
+
+// Marks the call at `index` and the pushes of its arguments when they all
+// can move: between them there may only be code already hoisted
+static int mark_call(LICM *l, int loop, const CFGBlock *block, size_t base, size_t i, int varying_globals) {
+    const TACInstr *call = &block->instructions[i];
+    int args = call->arg2.type == TAC_OP_LITERAL ? call->arg2.literal : 0;
+    size_t push[64];
+    if (args < 0 || args > 64) return 0;
+    int found = 0;
+    for (size_t k = i; k-- > 0 && found < args;) {
+        const TACInstr *instr = &block->instructions[k];
+        if (l->hoisted[base + k]) continue;
+        if (instr->kind != TAC_PUSH || !operand_invariant(l, loop, instr->arg1, varying_globals)) return 0;
+        push[found++] = base + k;
+    }
+    if (found < args) return 0;
+    for (int k = 0; k < found; k++) l->hoisted[push[k]] = 1;
+    l->hoisted[base + i] = 1;
+    return 1 + found;
+}
+
+// Marks what can leave `loop`; returns how many instructions
+static size_t mark_invariants(LICM *l, int loop, LICMStats *counts) {
+    const CFG *cfg = l->cfg;
+    const DomTree *dom = l->dom;
+
+    int varying_globals = 0;
+    for (size_t r = 0; r < dom->rpo_count && !varying_globals; r++) {
+        int b = dom->rpo[r];
+        if (!loop_contains(l->forest, loop, b)) continue;
+        const CFGBlock *block = cfg->blocks.items[b];
+        for (size_t i = 0; i < block->count; i++) {
+            if (block->instructions[i].kind == TAC_CALL && !is_pure_call(l, &block->instructions[i])) varying_globals = 1;
+        }
+    }
+
+    size_t marked = 0;
+    for (size_t r = 0; r < dom->rpo_count; r++) {
+        int b = dom->rpo[r];
+        if (!loop_contains(l->forest, loop, b)) continue;
+        const CFGBlock *block = cfg->blocks.items[b];
+        size_t base = (size_t)(block->instructions - l->fn->instrs);
+        for (size_t i = 0; i < block->count; i++) {
+            const TACInstr *instr = &block->instructions[i];
+            if (is_pure_call(l, instr)) {
+                int moved = mark_call(l, loop, block, base, i, varying_globals);
+                if (moved > 0) {
+                    marked += (size_t)moved;
+                    counts->calls++;
+                }
+                continue;
+            }
+            if (!is_speculable(instr)) continue;
+            unsigned mask = tac_use_mask(instr);
+            int invariant = 1;
+            if (mask & TAC_USE_ARG1) invariant &= operand_invariant(l, loop, instr->arg1, varying_globals);
+            if (mask & TAC_USE_ARG2) invariant &= operand_invariant(l, loop, instr->arg2, varying_globals);
+            if (mask & TAC_USE_ARG3) invariant &= operand_invariant(l, loop, instr->arg3, varying_globals);
+            if (!invariant) continue;
+            l->hoisted[base + i] = 1;
+            marked++;
+        }
+    }
+    return marked;
+}
+
+static void push_phi(TACFunction *out, TACOperand dst, const TACOperand *args, size_t count) {
+    TACInstr phi = {0};
+    phi.kind = TAC_PHI;
+    phi.dst = dst;
+    phi.arg1 = tac_literal(tac_phi_alloc(count));
+    phi.arg2 = tac_literal((int)count);
+    TACOperand *pooled = tac_phi_args(&phi);
+    for (size_t k = 0; k < count; k++) pooled[k] = args[k];
+    tac_function_push(out, phi);
+}
+
+// Rebuilds the function with the marked instructions of `loop` in a
+// preheader in front of its header; own_block makes it a block of its
+// own even when nothing jumps into the loop
+static void hoist(LICM *l, int loop, int own_block, LICMStats *counts) {
+    TACFunction *fn = l->fn;
+    const CFG *cfg = l->cfg;
+    const DomTree *dom = l->dom;
+    int h = l->forest->loops[loop].header;
+    const CFGBlock *header = cfg->blocks.items[h];
+    int header_label = header->instructions[0].dst.literal;
+
+    // 1) Edges entering the loop, in predecessor order; the preheader
+    //    needs a label when any of them is a jump
+    size_t pred_count;
+    const int *pred = cfg_predecessors(cfg, h, &pred_count);
+    unsigned char *entering = xcalloc(pred_count, 1);
+    size_t enter_count = 0;
+    for (size_t j = 0; j < pred_count; j++) {
+        entering[j] = !loop_contains(l->forest, loop, pred[j]);
+        enter_count += entering[j];
+    }
+    int jumps_in = 0;
+    for (size_t b = 0; b < cfg->blocks.count; b++) {
+        if (loop_contains(l->forest, loop, (int)b)) continue;
+        const CFGBlock *block = cfg->blocks.items[b];
+        if (tac_jump_target(&block->instructions[block->count - 1]) == header_label) jumps_in = 1;
+    }
+    int pre_label = jumps_in || own_block ? tac_function_new_label(fn) : -1;
+    if (pre_label >= 0) counts->preheaders++;
+
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    for (size_t b = 0; b < cfg->blocks.count; b++) {
+        const CFGBlock *block = cfg->blocks.items[b];
+        size_t base = (size_t)(block->instructions - fn->instrs);
+        int inside = loop_contains(l->forest, loop, (int)b);
+
+        if ((int)b == h) {
+            // 2) The preheader: its label, phis merging the entering
+            //    values, then the hoisted code in its original order
+            if (pre_label >= 0) {
+                TACInstr label = {0};
+                label.kind = TAC_LABEL;
+                label.dst = tac_label(pre_label);
+                tac_function_push(&out, label);
+            }
+            size_t first_phi = out.count;
+            for (size_t i = 1; i < header->count && header->instructions[i].kind == TAC_PHI; i++) {
+                if (enter_count < 2) break;
+                const TACInstr *phi = &header->instructions[i];
+                TACOperand *merged = xcalloc(enter_count, sizeof(TACOperand));
+                const TACOperand *args = tac_phi_args(phi);
+                size_t k = 0;
+                for (size_t j = 0; j < pred_count; j++) if (entering[j]) merged[k++] = args[j];
+                push_phi(&out, tac_temp(tac_function_new_temp(&out)), merged, enter_count);
+                free(merged);
+            }
+            for (size_t r = 0; r < dom->rpo_count; r++) {
+                int in = dom->rpo[r];
+                if (!loop_contains(l->forest, loop, in)) continue;
+                const CFGBlock *from = cfg->blocks.items[in];
+                size_t from_base = (size_t)(from->instructions - fn->instrs);
+                for (size_t i = 0; i < from->count; i++) {
+                    if (l->hoisted[from_base + i]) tac_function_push(&out, from->instructions[i]);
+                }
+            }
+
+            // 3) The header's phis take the preheader's value first, then
+            //    the latches' in their old order
+            tac_function_push(&out, header->instructions[0]);
+            size_t merged_phi = first_phi;
+            for (size_t i = 1; i < header->count; i++) {
+                TACInstr instr = header->instructions[i];
+                if (instr.kind != TAC_PHI) break;
+                size_t count = pred_count - enter_count + 1;
+                TACOperand *args = xcalloc(count, sizeof(TACOperand));
+                const TACOperand *old = tac_phi_args(&instr);
+                size_t k = 1;
+                for (size_t j = 0; j < pred_count; j++) {
+                    if (entering[j]) args[0] = enter_count < 2 ? old[j] : out.instrs[merged_phi].dst;
+                    else args[k++] = old[j];
+                }
+                if (enter_count >= 2) merged_phi++;
+                push_phi(&out, instr.dst, args, count);
+                free(args);
+            }
+        }
+
+        // 4) A block without a label sits between a conditional jump and
+        //    its fall-through target; emptied, the jump would reach that
+        //    block twice, so it keeps a label of its own
+        if (block->instructions[0].kind != TAC_LABEL) {
+            size_t left = 0;
+            for (size_t i = 0; i < block->count; i++) left += !l->hoisted[base + i];
+            if (left == 0) {
+                TACInstr label = {0};
+                label.kind = TAC_LABEL;
+                label.dst = tac_label(tac_function_new_label(&out));
+                tac_function_push(&out, label);
+            }
+        }
+
+        for (size_t i = 0; i < block->count; i++) {
+            if ((int)b == h && (i == 0 || block->instructions[i].kind == TAC_PHI)) continue;
+            if (l->hoisted[base + i]) continue;
+            TACInstr instr = block->instructions[i];
+            if (!inside && pre_label >= 0 && tac_jump_target(&instr) == header_label) tac_set_jump_target(&instr, pre_label);
+            tac_function_push(&out, instr);
+        }
+    }
+    tac_function_sync_header(&out);
+    free(entering);
+
+    tac_function_free(fn);
+    *fn = out;
+}
+
+// 0 if fn has no CFG, with nothing to release
+static int licm_analyse(LICM *l, TACFunction *fn, const unsigned char *pure) {
+    *l = (LICM){0};
+    l->fn = fn;
+    l->pure = pure;
+    l->cfg = build_from_tac(fn);
+    if (!l->cfg) return 0;
+    l->dom = dom_compute(l->cfg);
+    l->forest = loops_compute(l->cfg, l->dom);
+    l->temp_count = fn->temp_count > 0 ? (size_t)fn->temp_count : 0;
+    size_t names = l->temp_count + intern_count();
+    l->def_of = xcalloc(names, sizeof(size_t));
+    l->block_of = xcalloc(fn->count, sizeof(int));
+    l->hoisted = xcalloc(fn->count, 1);
+    for (size_t k = 0; k < names; k++) l->def_of[k] = LICM_NO_DEF;
+    for (size_t b = 0; b < l->cfg->blocks.count; b++) {
+        const CFGBlock *block = l->cfg->blocks.items[b];
+        size_t base = (size_t)(block->instructions - fn->instrs);
+        for (size_t i = 0; i < block->count; i++) {
+            l->block_of[base + i] = (int)b;
+            const TACOperand *def = tac_def_operand(&block->instructions[i]);
+            size_t *slot = def ? def_slot(l, *def) : NULL;
+            if (slot) *slot = base + i;
+        }
+    }
+    return 1;
+}
+
+static void licm_release(LICM *l) {
+    free(l->def_of);
+    free(l->block_of);
+    free(l->hoisted);
+    loops_free(l->forest);
+    dom_free(l->dom);
+    free_cfg(l->cfg);
+    free(l->cfg);
+}
+
+// A header right behind a block of its loop that does not end in a jump
+// is entered by falling through from a latch; nothing can go in between
+static int latch_falls_in(const LICM *l, int loop) {
+    int h = l->forest->loops[loop].header;
+    if (h == 0 || !loop_contains(l->forest, loop, h - 1)) return 0;
+    const CFGBlock *before = l->cfg->blocks.items[h - 1];
+    TACOpKind last = before->instructions[before->count - 1].kind;
+    return last != TAC_GOTO && last != TAC_RETURN;
+}
+
+void licm(TACFunction *fn, const unsigned char *pure, LICMStats *stats) {
+    if (fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION) return;
+    LICMStats counts = {0};
+
+    // Headers (by label) already done; a loop is tried once
+    size_t label_capacity = fn->label_count > 0 ? (size_t)fn->label_count : 0;
+    unsigned char *done = xcalloc(label_capacity, 1);
+
+    for (;;) {
+        LICM l;
+        if (!licm_analyse(&l, fn, pure)) break;
+
+        // 1) The innermost loop not tried yet. A header without a label
+        //    is entered by falling through from a latch
+        int chosen = -1;
+        for (size_t k = 0; k < l.forest->count && chosen < 0; k++) {
+            int h = l.forest->loops[k].header;
+            const CFGBlock *header = l.cfg->blocks.items[h];
+            if (header->instructions[0].kind != TAC_LABEL) continue;
+            int label = header->instructions[0].dst.literal;
+            if ((size_t)label >= label_capacity || done[label]) continue;
+            done[label] = 1;
+            if (latch_falls_in(&l, (int)k)) continue;
+            if (mark_invariants(&l, (int)k, &counts) == 0) continue;
+            chosen = (int)k;
+        }
+
+        // 2) Move its code out, then look at the changed function again
+        if (chosen >= 0) {
+            size_t moved = 0;
+            for (size_t i = 0; i < fn->count; i++) moved += l.hoisted[i];
+            counts.loops++;
+            counts.hoisted += moved;
+            hoist(&l, chosen, 0, &counts);
+        }
+        licm_release(&l);
+        if (chosen < 0) break;
+    }
+    free(done);
+
+    if (stats) {
+        stats->loops += counts.loops;
+        stats->hoisted += counts.hoisted;
+        stats->calls += counts.calls;
+        stats->preheaders += counts.preheaders;
+    }
+}
+
+int licm_make_preheader(TACFunction *fn, int header_label) {
+    LICM l;
+    if (!licm_analyse(&l, fn, NULL)) return 0;
+    int made = 0;
+    for (size_t k = 0; k < l.forest->count; k++) {
+        const CFGBlock *header = l.cfg->blocks.items[l.forest->loops[k].header];
+        if (header->instructions[0].kind != TAC_LABEL || header->instructions[0].dst.literal != header_label) continue;
+        if (latch_falls_in(&l, (int)k)) break;
+        int entering = -1, count = 0;
+        size_t pred_count;
+        const int *pred = cfg_predecessors(l.cfg, l.forest->loops[k].header, &pred_count);
+        for (size_t j = 0; j < pred_count; j++) {
+            if (loop_contains(l.forest, (int)k, pred[j])) continue;
+            entering = pred[j];
+            count++;
+        }
+        size_t succ_count = 0;
+        if (count == 1) cfg_successors(l.cfg, entering, &succ_count);
+        made = count == 1 && succ_count == 1 ? 1 : 2;
+        if (made == 2) {
+            LICMStats ignored = {0};
+            hoist(&l, (int)k, 1, &ignored);
+        }
+        break;
+    }
+    licm_release(&l);
+    return made;
+}
+
+// True if fn cannot trap, loop or touch anything but its own variables,
+// calls aside
+static int is_pure_body(const TACFunction *fn) {
+    size_t syms = intern_count();
+    unsigned char *written = xcalloc(syms, 1);
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACOperand *def = tac_def_operand(&fn->instrs[i]);
+        if (def && def->type == TAC_OP_VAR) written[def->sym] = 1;
+    }
+    int pure = 1;
+    for (size_t i = 1; i < fn->count && pure; i++) {
+        const TACInstr *instr = &fn->instrs[i];
+        unsigned mask = tac_use_mask(instr);
+        if ((mask & TAC_USE_ARG1) && instr->arg1.type == TAC_OP_VAR && !written[instr->arg1.sym]) pure = 0;
+        if ((mask & TAC_USE_ARG2) && instr->arg2.type == TAC_OP_VAR && !written[instr->arg2.sym]) pure = 0;
+        if ((mask & TAC_USE_ARG3) && instr->arg3.type == TAC_OP_VAR && !written[instr->arg3.sym]) pure = 0;
+        if (instr->kind == TAC_PHI) {
+            const TACOperand *args = tac_phi_args(instr);
+            for (size_t k = 0; k < tac_phi_arg_count(instr); k++) {
+                if (args[k].type == TAC_OP_VAR && !written[args[k].sym]) pure = 0;
+            }
+        }
+        if (instr->kind == TAC_BINARY_OP && (instr->op.binop == TAC_DIV || instr->op.binop == TAC_MOD) &&
+            (instr->arg2.type != TAC_OP_LITERAL || instr->arg2.literal == 0 || instr->arg2.literal == -1)) pure = 0;
+        // Jumps only go forward, so there is no cycle
+        int target = tac_jump_target(instr);
+        if (target >= 0) {
+            size_t at = tac_function_label_index(fn, target);
+            if (at == TAC_NO_LABEL || at < i) pure = 0;
+        }
+    }
+    free(written);
+    return pure;
+}
+
+void licm_program(TACProgram *program, LICMStats *stats) {
+    // Pure functions, callees first: a component is only pure if it is
+    // not recursive and everything it calls is
+    CallGraph *graph = call_graph_build(program);
+    size_t syms = intern_count() > graph->sym_count ? intern_count() : graph->sym_count;
+    unsigned char *pure = xcalloc(syms, 1);
+    int *order = xcalloc(graph->count, sizeof(int));
+    call_graph_callees_first(graph, order);
+
+    for (size_t k = 0; k < graph->count; k++) {
+        int f = order[k];
+        if (graph->name[f] < 0 || graph->recursive[f]) continue;
+        const TACFunction *fn = &program->functions[f];
+        if (!is_pure_body(fn)) continue;
+        int callees_pure = 1;
+        for (size_t i = 0; i < fn->count && callees_pure; i++) {
+            const TACInstr *instr = &fn->instrs[i];
+            if (instr->kind != TAC_CALL) continue;
+            callees_pure = instr->arg1.type == TAC_OP_VAR && (size_t)instr->arg1.sym < graph->sym_count &&
+                           pure[instr->arg1.sym];
+        }
+        if (callees_pure) pure[graph->name[f]] = 1;
+    }
+    free(order);
+    call_graph_free(graph);
+
+    for (size_t i = 0; i < program->count; i++) licm(&program->functions[i], pure, stats);
+    free(pure);
+}
@@ -0,0 +1,188 @@
+#include "liveness.h"
+#include "dataflow.h"
+#include "intern.h"
+#include "tac_print.h"
+#include "tac_util.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int liveness_index(const Liveness *lv, TACOperand op) {
+    if (op.type == TAC_OP_TEMP) {
+        return (size_t)op.literal < lv->temp_count ? op.literal : -1;
+    }
+    if (op.type == TAC_OP_VAR && (size_t)op.sym < lv->sym_count && lv->sym_slot[op.sym] >= 0) {
+        return (int)lv->temp_count + lv->sym_slot[op.sym];
+    }
+    return -1;
+}
+
+int liveness_live_in(const Liveness *lv, int block, TACOperand op) {
+    int index = liveness_index(lv, op);
+    return index >= 0 && bitset_test(bitmatrix_row(&lv->live_in, (size_t)block), (size_t)index);
+}
+
+int liveness_live_out(const Liveness *lv, int block, TACOperand op) {
+    int index = liveness_index(lv, op);
+    return index >= 0 && bitset_test(bitmatrix_row(&lv->live_out, (size_t)block), (size_t)index);
+}
+
+static const TACOperand *use_operand(const TACInstr *instr, unsigned use) {
+    return use == TAC_USE_ARG1 ? &instr->arg1 : use == TAC_USE_ARG2 ? &instr->arg2 : &instr->arg3;
+}
+
+// 1) Give every named variable of the function a slot, and note which
+//    ones the function defines itself
+static uint64_t *liveness_number_slots(Liveness *lv, const TACFunction *fn) {
+    lv->sym_count = intern_count();
+    lv->sym_slot = xcalloc(lv->sym_count, sizeof(int));
+    lv->slot_sym = xcalloc(lv->sym_count, sizeof(int));
+    for (size_t s = 0; s < lv->sym_count; s++) lv->sym_slot[s] = -1;
+
+    unsigned char *defined = xcalloc(lv->sym_count, 1);
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACInstr *instr = &fn->instrs[i];
+        unsigned uses = tac_use_mask(instr);
+        const TACOperand *def = tac_def_operand(instr);
+        for (unsigned use = TAC_USE_ARG1; use <= TAC_USE_ARG3; use <<= 1) {
+            const TACOperand *op = use_operand(instr, use);
+            if ((uses & use) && op->type == TAC_OP_VAR && lv->sym_slot[op->sym] < 0) {
+                lv->slot_sym[lv->slot_count] = op->sym;
+                lv->sym_slot[op->sym] = (int)lv->slot_count++;
+            }
+        }
+        if (def && def->type == TAC_OP_VAR) {
+            if (lv->sym_slot[def->sym] < 0) {
+                lv->slot_sym[lv->slot_count] = def->sym;
+                lv->sym_slot[def->sym] = (int)lv->slot_count++;
+            }
+            defined[def->sym] = 1;
+        }
+    }
+
+    // Everything the function does not define can be seen by other functions
+    size_t bits = lv->temp_count + lv->slot_count;
+    uint64_t *shared = xcalloc(bitset_words(bits), sizeof(uint64_t));
+    for (size_t slot = 0; slot < lv->slot_count; slot++) {
+        if (!defined[lv->slot_sym[slot]]) bitset_set(shared, lv->temp_count + slot);
+    }
+    free(defined);
+    return shared;
+}
+
+unsigned liveness_step(const Liveness *lv, const TACInstr *instr, uint64_t *live) {
+    const TACOperand *def = tac_def_operand(instr);
+    if (def) {
+        int index = liveness_index(lv, *def);
+        if (index >= 0) bitset_reset(live, (size_t)index);
+    }
+
+    unsigned uses = tac_use_mask(instr), dying = 0;
+    for (unsigned use = TAC_USE_ARG1; use <= TAC_USE_ARG3; use <<= 1) {
+        if (!(uses & use)) continue;
+        int index = liveness_index(lv, *use_operand(instr, use));
+        if (index >= 0 && !bitset_test(live, (size_t)index)) dying |= use;
+    }
+    for (unsigned use = TAC_USE_ARG1; use <= TAC_USE_ARG3; use <<= 1) {
+        if (!(dying & use)) continue;
+        bitset_set(live, (size_t)liveness_index(lv, *use_operand(instr, use)));
+    }
+    if (instr->kind == TAC_CALL) bitset_union_into(live, lv->shared, lv->live_in.words);
+    return dying;
+}
+
+Liveness *liveness_compute(const TACFunction *fn, const CFG *cfg, const DomTree *dom) {
+    Liveness *lv = xcalloc(1, sizeof(Liveness));
+    lv->temp_count = fn->temp_count > 0 ? (size_t)fn->temp_count : 0;
+    uint64_t *shared = liveness_number_slots(lv, fn);
+    lv->shared = shared;
+    size_t bits = lv->temp_count + lv->slot_count;
+    size_t n = cfg->blocks.count;
+
+    DataflowProblem problem;
+    dataflow_init(&problem, cfg, DATAFLOW_BACKWARD, DATAFLOW_UNION, bits);
+    problem.boundary = shared;
+    size_t words = problem.gen.words;
+
+    // 2) gen = upward-exposed uses, kill = defs; walking each block
+    //    backwards, a def hides the uses below it
+    for (size_t b = 0; b < n; b++) {
+        const CFGBlock *block = cfg->blocks.items[b];
+        uint64_t *gen = bitmatrix_row(&problem.gen, b);
+        uint64_t *kill = bitmatrix_row(&problem.kill, b);
+        for (size_t i = block->count; i-- > 0; ) {
+            const TACInstr *instr = &block->instructions[i];
+            const TACOperand *def = tac_def_operand(instr);
+            int index = def ? liveness_index(lv, *def) : -1;
+            if (index >= 0) {
+                bitset_reset(gen, (size_t)index);
+                bitset_set(kill, (size_t)index);
+            }
+            unsigned uses = tac_use_mask(instr);
+            for (unsigned use = TAC_USE_ARG1; use <= TAC_USE_ARG3; use <<= 1) {
+                if (!(uses & use)) continue;
+                index = liveness_index(lv, *use_operand(instr, use));
+                if (index >= 0) bitset_set(gen, (size_t)index);
+            }
+            if (instr->kind == TAC_CALL) bitset_union_into(gen, shared, words);
+        }
+    }
+
+    // 3) Solve, keeping the in/out sets
+    dataflow_solve(&problem, cfg, dom);
+    lv->visits = problem.visits;
+    lv->live_in = problem.in;
+    lv->live_out = problem.out;
+    bitmatrix_free(&problem.gen);
+    bitmatrix_free(&problem.kill);
+
+    // 4) Last uses: replay each block backwards from its live-out set
+    lv->instr_count = fn->count;
+    lv->last_use = xcalloc(fn->count, 1);
+    uint64_t *live = xcalloc(words, sizeof(uint64_t));
+    for (size_t b = 0; b < n; b++) {
+        const CFGBlock *block = cfg->blocks.items[b];
+        if (dom->rpo_index[b] < 0 || block->count == 0) continue;
+        size_t base = (size_t)(block->instructions - fn->instrs);
+        bitset_copy(live, bitmatrix_row(&lv->live_out, b), words);
+        for (size_t i = block->count; i-- > 0; ) {
+            lv->last_use[base + i] = (unsigned char)liveness_step(lv, &block->instructions[i], live);
+        }
+    }
+    free(live);
+    return lv;
+}
+
+void liveness_free(Liveness *lv) {
+    if (!lv) return;
+    free(lv->slot_sym);
+    free(lv->sym_slot);
+    bitmatrix_free(&lv->live_in);
+    bitmatrix_free(&lv->live_out);
+    free(lv->shared);
+    free(lv->last_use);
+    free(lv);
+}
+
+static void liveness_print_set(const Liveness *lv, const uint64_t *set) {
+    size_t bits = lv->temp_count + lv->slot_count;
+    for (size_t w = 0; w < bitset_words(bits); w++) {
+        for (uint64_t word = set[w]; word; word &= word - 1) {
+            size_t index = w * BITSET_WORD_BITS + (size_t)__builtin_ctzll(word);
+            if (index < lv->temp_count) printf(" t%zu", index);
+            else printf(" %s", interned_name(lv->slot_sym[index - lv->temp_count]));
+        }
+    }
+}
+
+void liveness_print(const Liveness *lv, const CFG *cfg) {
+    printf("Liveness (%zu temps, %zu slots):\n", lv->temp_count, lv->slot_count);
+    for (size_t b = 0; b < cfg->blocks.count; b++) {
+        printf("Block %zu in:", b);
+        liveness_print_set(lv, bitmatrix_row(&lv->live_in, b));
+        printf(", out:");
+        liveness_print_set(lv, bitmatrix_row(&lv->live_out, b));
+        printf("\n");
+    }
+}
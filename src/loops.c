@@ -0,0 +1,244 @@
+#include "loops.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static void push_loop(LoopForest *forest, size_t *capacity, int header) {
+    if (forest->count >= *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 8;
+        Loop *new_items = realloc(forest->loops, new_capacity * sizeof(Loop));
+        if (!new_items) {
+            printf("Memory allocation failed while resizing loop forest.\n");
+            exit(EXIT_FAILURE);
+        }
+        forest->loops = new_items;
+        *capacity = new_capacity;
+    }
+    forest->loops[forest->count++] = (Loop){ .header = header, .parent = -1 };
+}
+
+// Outermost loop enclosing `loop` found so far, compressing the path so
+// repeated lookups stay near constant time
+static int outermost(int *top, int loop) {
+    int root = loop;
+    while (top[root] != root) root = top[root];
+    while (top[loop] != root) {
+        int next = top[loop];
+        top[loop] = root;
+        loop = next;
+    }
+    return root;
+}
+
+// 1) Headers are visited in dominator tree postorder, so inner loops are
+//    built before the loops around them. Walking backwards from the latches,
+//    a block that already belongs to a loop stands for that whole loop:
+//    the walk continues from its outermost header, which becomes a child.
+static void loops_discover(const CFG *cfg, const DomTree *dom, LoopForest *forest,
+                           CFGEdgeArray *latch_pairs) {
+    size_t n = forest->block_count;
+    size_t capacity = 0;
+    int *top = NULL;               // union-find parent per loop
+    size_t top_capacity = 0;
+    // A block can be queued once per incoming edge before it is claimed
+    int *worklist = xcalloc(n + cfg->edge_count, sizeof(int));
+
+    // Postorder of the dominator tree is the order of increasing post number
+    int *by_post = xcalloc(n, sizeof(int));
+    for (size_t i = 0; i < dom->rpo_count; i++) {
+        int b = dom->rpo[i];
+        by_post[dom->post[b]] = b;
+    }
+
+    for (size_t i = 0; i < dom->rpo_count; i++) {
+        int h = by_post[i];
+        size_t pred_count;
+        const int *pred = cfg_predecessors(cfg, h, &pred_count);
+
+        size_t pending = 0;
+        for (size_t k = 0; k < pred_count; k++) {
+            if (dom_dominates(dom, h, pred[k])) worklist[pending++] = pred[k];
+        }
+        if (pending == 0) continue;
+
+        int loop = (int)forest->count;
+        push_loop(forest, &capacity, h);
+        if ((size_t)loop >= top_capacity) {
+            top_capacity = top_capacity ? top_capacity * 2 : 8;
+            top = realloc(top, top_capacity * sizeof(int));
+            if (!top) {
+                printf("Memory allocation failed for loop forest.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        top[loop] = loop;
+        for (size_t k = 0; k < pending; k++) push_edge(latch_pairs, loop, worklist[k]);
+        forest->block_loop[h] = loop;
+
+        while (pending > 0) {
+            int b = worklist[--pending];
+            if (dom->rpo_index[b] < 0) continue;
+
+            int start;
+            if (forest->block_loop[b] < 0) {
+                forest->block_loop[b] = loop;
+                start = b;
+            } else {
+                int inner = outermost(top, forest->block_loop[b]);
+                if (inner == loop) continue;
+                forest->loops[inner].parent = loop;
+                top[inner] = loop;
+                start = forest->loops[inner].header;
+            }
+            const int *preds = cfg_predecessors(cfg, start, &pred_count);
+            for (size_t k = 0; k < pred_count; k++) {
+                int p = preds[k];
+                // Blocks of this loop are done; anything else is still open
+                if (forest->block_loop[p] >= 0 && outermost(top, forest->block_loop[p]) == loop) continue;
+                worklist[pending++] = p;
+            }
+        }
+    }
+
+    free(top);
+    free(worklist);
+    free(by_post);
+}
+
+// 2) Depth and preorder intervals; parents always come after their children
+static void loops_number(LoopForest *forest) {
+    size_t m = forest->count;
+    CFGEdge *pairs = xcalloc(m, sizeof(CFGEdge));
+    size_t count = 0;
+    for (size_t l = 0; l < m; l++) {
+        int parent = forest->loops[l].parent;
+        forest->loops[l].depth = parent < 0 ? 1 : 0;
+        if (parent >= 0) pairs[count++] = (CFGEdge){ parent, (int)l };
+    }
+    for (size_t l = m; l-- > 0; ) {
+        int parent = forest->loops[l].parent;
+        if (parent >= 0) forest->loops[l].depth = forest->loops[parent].depth + 1;
+    }
+
+    int *child_start, *children;
+    cfg_pairs_to_csr(m, pairs, count, 0, &child_start, &children);
+    free(pairs);
+
+    int *stack = xcalloc(m, sizeof(int));
+    int *next_child = xcalloc(m, sizeof(int));
+    int clock = 0;
+    for (size_t root = 0; root < m; root++) {
+        if (forest->loops[root].parent >= 0) continue;
+        size_t depth = 0;
+        stack[depth++] = (int)root;
+        next_child[root] = child_start[root];
+        forest->loops[root].pre = clock++;
+        while (depth > 0) {
+            int l = stack[depth - 1];
+            if (next_child[l] < child_start[l + 1]) {
+                int c = children[next_child[l]++];
+                forest->loops[c].pre = clock++;
+                next_child[c] = child_start[c];
+                stack[depth++] = c;
+            } else {
+                forest->loops[l].last = clock - 1;
+                depth--;
+            }
+        }
+    }
+    free(stack);
+    free(next_child);
+    free(child_start);
+    free(children);
+}
+
+static int loop_nests_in(const LoopForest *forest, int outer, int inner) {
+    const Loop *o = &forest->loops[outer];
+    int pre = forest->loops[inner].pre;
+    return pre >= o->pre && pre <= o->last;
+}
+
+int loop_contains(const LoopForest *forest, int loop, int block) {
+    int inner = forest->block_loop[block];
+    return inner >= 0 && loop_nests_in(forest, loop, inner);
+}
+
+LoopForest *loops_compute(const CFG *cfg, const DomTree *dom) {
+    LoopForest *forest = calloc(1, sizeof(LoopForest));
+    if (!forest) {
+        printf("Memory allocation failed for loop forest.\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t n = cfg->blocks.count;
+    forest->block_count = n;
+    forest->block_loop = xcalloc(n, sizeof(int));
+    forest->block_depth = xcalloc(n, sizeof(int));
+    for (size_t b = 0; b < n; b++) forest->block_loop[b] = -1;
+
+    CFGEdgeArray latch_pairs = {0};
+    loops_discover(cfg, dom, forest, &latch_pairs);
+    loops_number(forest);
+
+    // 3) Per block depth, and exits: an edge leaving a block's loop leaves
+    //    every enclosing loop that does not contain the target either
+    CFGEdgeArray exit_pairs = {0};
+    for (size_t b = 0; b < n; b++) {
+        int l = forest->block_loop[b];
+        forest->block_depth[b] = l < 0 ? 0 : forest->loops[l].depth;
+        if (l < 0) continue;
+        size_t count;
+        const int *succ = cfg_successors(cfg, (int)b, &count);
+        for (size_t k = 0; k < count; k++) {
+            for (int a = l; a >= 0 && !loop_contains(forest, a, succ[k]); a = forest->loops[a].parent) {
+                push_edge(&exit_pairs, a, succ[k]);
+            }
+        }
+    }
+
+    cfg_pairs_to_csr(forest->count, latch_pairs.items, latch_pairs.count, 0,
+                     &forest->latch_start, &forest->latches);
+    cfg_pairs_to_csr(forest->count, exit_pairs.items, exit_pairs.count, 0,
+                     &forest->exit_start, &forest->exits);
+    free(latch_pairs.items);
+    free(exit_pairs.items);
+
+    // 4) Several edges can reach the same exit block; keep it once per loop
+    int *seen = xcalloc(n, sizeof(int));
+    for (size_t b = 0; b < n; b++) seen[b] = -1;
+    int kept = 0;
+    for (size_t l = 0; l < forest->count; l++) {
+        int begin = forest->exit_start[l], end = forest->exit_start[l + 1];
+        forest->exit_start[l] = kept;
+        for (int k = begin; k < end; k++) {
+            int target = forest->exits[k];
+            if (seen[target] == (int)l) continue;
+            seen[target] = (int)l;
+            forest->exits[kept++] = target;
+        }
+    }
+    forest->exit_start[forest->count] = kept;
+    free(seen);
+    return forest;
+}
+
+void loops_free(LoopForest *forest) {
+    if (!forest) return;
+    free(forest->loops);
+    free(forest->block_loop);
+    free(forest->block_depth);
+    free(forest->latch_start);
+    free(forest->latches);
+    free(forest->exit_start);
+    free(forest->exits);
+    free(forest);
+}
+
+const int *loop_latches(const LoopForest *forest, int loop, size_t *count) {
+    *count = (size_t)(forest->latch_start[loop + 1] - forest->latch_start[loop]);
+    return &forest->latches[forest->latch_start[loop]];
+}
+
+const int *loop_exits(const LoopForest *forest, int loop, size_t *count) {
+    *count = (size_t)(forest->exit_start[loop + 1] - forest->exit_start[loop]);
+    return &forest->exits[forest->exit_start[loop]];
+}
@@ -0,0 +1,249 @@
+#include "lvn.h"
+#include "cfg_builder.h"
+#include "intern.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LVN_LITERAL -1        // key kind of a literal's own number
+
+// An operator and the value numbers of its operands (-1 where unused)
+typedef struct {
+    int kind;
+    int op;
+    int a, b, c;
+} LVNKey;
+
+typedef struct {
+    LVNKey   key;
+    int      vn;
+    unsigned stamp;           // block that filled the entry; others are empty
+} LVNEntry;
+
+// Value number a name holds in the current block
+typedef struct {
+    int      vn;
+    unsigned stamp;
+    unsigned epoch;           // calls seen when it was set
+} LVNName;
+
+typedef struct {
+    TACFunction   *fn;
+
+    LVNEntry      *table;     // open addressing, size a power of two
+    size_t         table_mask;
+
+    LVNName       *temps;
+    size_t         temp_count;
+    LVNName       *vars;
+    size_t         var_count;
+    unsigned char *written;   // per interned name: assigned by the function
+
+    TACOperand    *holder;    // per value number: a name holding it, or NONE
+    size_t         holder_capacity;
+    int            next_vn;
+    unsigned       stamp;
+    unsigned       epoch;
+} LVN;
+
+static size_t hash_key(const LVNKey *key) {
+    size_t h = (size_t)(unsigned)key->kind * 0x9E3779B1u;
+    h = (h ^ (unsigned)key->op) * 0x85EBCA77u;
+    h = (h ^ (unsigned)key->a) * 0xC2B2AE3Du;
+    h = (h ^ (unsigned)key->b) * 0x27D4EB2Fu;
+    h = (h ^ (unsigned)key->c) * 0x165667B1u;
+    return h ^ (h >> 15);
+}
+
+static int fresh_vn(LVN *l) {
+    if ((size_t)l->next_vn >= l->holder_capacity) {
+        size_t capacity = l->holder_capacity ? l->holder_capacity * 2 : 64;
+        TACOperand *grown = realloc(l->holder, capacity * sizeof(TACOperand));
+        if (!grown) {
+            printf("Memory allocation failed for value numbering.\n");
+            exit(EXIT_FAILURE);
+        }
+        l->holder = grown;
+        l->holder_capacity = capacity;
+    }
+    l->holder[l->next_vn] = TAC_NONE;
+    return l->next_vn++;
+}
+
+// Number of the value `key` computes; *found tells whether it was known
+static int lookup(LVN *l, LVNKey key, int *found) {
+    size_t slot = hash_key(&key) & l->table_mask;
+    while (l->table[slot].stamp == l->stamp) {
+        const LVNKey *k = &l->table[slot].key;
+        if (k->kind == key.kind && k->op == key.op && k->a == key.a && k->b == key.b && k->c == key.c) {
+            *found = 1;
+            return l->table[slot].vn;
+        }
+        slot = (slot + 1) & l->table_mask;
+    }
+    *found = 0;
+    l->table[slot].key = key;
+    l->table[slot].vn = fresh_vn(l);
+    l->table[slot].stamp = l->stamp;
+    return l->table[slot].vn;
+}
+
+static LVNName *name_slot(LVN *l, TACOperand op) {
+    if (op.type == TAC_OP_TEMP && op.literal >= 0 && (size_t)op.literal < l->temp_count) return &l->temps[op.literal];
+    if (op.type == TAC_OP_VAR && op.sym >= 0 && (size_t)op.sym < l->var_count) return &l->vars[op.sym];
+    return NULL;
+}
+
+// Whether the number a name holds is still current: set in this block
+// and, for a variable only others write, not since the last call
+static int name_current(const LVN *l, TACOperand op, const LVNName *name) {
+    if (name->stamp != l->stamp) return 0;
+    return op.type != TAC_OP_VAR || l->written[op.sym] || name->epoch == l->epoch;
+}
+
+static int value_of(LVN *l, TACOperand op) {
+    int found;
+    if (op.type == TAC_OP_LITERAL) {
+        LVNKey key = { LVN_LITERAL, 0, op.literal, -1, -1 };
+        int vn = lookup(l, key, &found);
+        if (!found) l->holder[vn] = op;
+        return vn;
+    }
+    LVNName *name = name_slot(l, op);
+    if (!name) return fresh_vn(l);
+    if (!name_current(l, op, name)) {
+        // first read in the block: whatever it holds on entry
+        name->vn = fresh_vn(l);
+        name->stamp = l->stamp;
+        name->epoch = l->epoch;
+        l->holder[name->vn] = op;
+    }
+    return name->vn;
+}
+
+// dst now holds vn; the number it held loses it as a holder
+static void assign(LVN *l, TACOperand dst, int vn) {
+    LVNName *name = name_slot(l, dst);
+    if (!name) return;
+    if (name_current(l, dst, name) && tac_operand_equal(l->holder[name->vn], dst)) {
+        l->holder[name->vn] = TAC_NONE;
+    }
+    name->vn = vn;
+    name->stamp = l->stamp;
+    name->epoch = l->epoch;
+    if (l->holder[vn].type == TAC_OP_NONE) l->holder[vn] = dst;
+}
+
+static int is_commutative(TACBinOp op) {
+    return op == TAC_ADD || op == TAC_MUL || op == TAC_EQ || op == TAC_NEQ || op == TAC_AND || op == TAC_OR;
+}
+
+// The key of a computation, or kind -1 for instructions that compute
+// nothing reusable
+static LVNKey computation_key(LVN *l, const TACInstr *instr) {
+    LVNKey key = { -1, 0, -1, -1, -1 };
+    switch (instr->kind) {
+        case TAC_BINARY_OP: {
+            TACBinOp op = instr->op.binop;
+            int a = value_of(l, instr->arg1), b = value_of(l, instr->arg2);
+            if (op == TAC_GT || op == TAC_GTE) {
+                // a > b is b < a
+                op = op == TAC_GT ? TAC_LT : TAC_LTE;
+                int swap = a; a = b; b = swap;
+            } else if (is_commutative(op) && a > b) {
+                int swap = a; a = b; b = swap;
+            }
+            key = (LVNKey){ TAC_BINARY_OP, op, a, b, -1 };
+            break;
+        }
+        case TAC_UNARY_OP:
+            key = (LVNKey){ TAC_UNARY_OP, instr->op.unop, value_of(l, instr->arg1), -1, -1 };
+            break;
+        case TAC_SELECT:
+            key = (LVNKey){ TAC_SELECT, 0, value_of(l, instr->arg1), value_of(l, instr->arg2), value_of(l, instr->arg3) };
+            break;
+        default:
+            break;
+    }
+    return key;
+}
+
+static void number_block(LVN *l, const CFGBlock *block, LVNStats *stats) {
+    l->stamp++;
+    l->epoch = 0;
+    l->next_vn = 0;
+    for (size_t i = 0; i < block->count; i++) {
+        TACInstr *instr = &block->instructions[i];
+        stats->instructions++;
+
+        LVNKey key = computation_key(l, instr);
+        if (key.kind >= 0) {
+            int found;
+            int vn = lookup(l, key, &found);
+            TACOperand held = l->holder[vn];
+            if (found && held.type != TAC_OP_NONE && !tac_operand_equal(held, instr->dst)) {
+                TACInstr copy = { .kind = TAC_COPY, .dst = instr->dst, .arg1 = held };
+                *instr = copy;
+                stats->redundant++;
+            }
+            assign(l, instr->dst, vn);
+            continue;
+        }
+
+        if ((instr->kind == TAC_COPY || instr->kind == TAC_DEFINE) && instr->arg1.type != TAC_OP_NONE) {
+            assign(l, instr->dst, value_of(l, instr->arg1));
+            continue;
+        }
+        if (instr->kind == TAC_CALL) l->epoch++;
+        const TACOperand *def = tac_def_operand(instr);
+        if (def) assign(l, *def, fresh_vn(l));
+    }
+}
+
+void lvn(TACFunction *fn, LVNStats *stats) {
+    LVNStats counts = {0};
+    CFG *cfg = build_from_tac(fn);
+    if (!cfg) return;
+
+    LVN l = {0};
+    l.fn = fn;
+    l.temp_count = fn->temp_count > 0 ? (size_t)fn->temp_count : 0;
+    l.var_count = intern_count();
+    l.temps = xcalloc(l.temp_count, sizeof(LVNName));
+    l.vars = xcalloc(l.var_count, sizeof(LVNName));
+    l.written = xcalloc(l.var_count, 1);
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACOperand *def = tac_def_operand(&fn->instrs[i]);
+        if (def && def->type == TAC_OP_VAR && (size_t)def->sym < l.var_count) l.written[def->sym] = 1;
+    }
+
+    // Every instruction adds at most four entries (three literals and its own)
+    size_t longest = 0;
+    for (size_t b = 0; b < cfg->blocks.count; b++) {
+        if (cfg->blocks.items[b]->count > longest) longest = cfg->blocks.items[b]->count;
+    }
+    size_t size = 16;
+    while (size < 8 * longest) size *= 2;
+    l.table = xcalloc(size, sizeof(LVNEntry));
+    l.table_mask = size - 1;
+
+    for (size_t b = 0; b < cfg->blocks.count; b++) number_block(&l, cfg->blocks.items[b], &counts);
+
+    if (stats) {
+        stats->instructions += counts.instructions;
+        stats->redundant += counts.redundant;
+    }
+    free(l.table);
+    free(l.temps);
+    free(l.vars);
+    free(l.written);
+    free(l.holder);
+    free_cfg(cfg);
+    free(cfg);
+}
+
+void lvn_program(TACProgram *program, LVNStats *stats) {
+    for (size_t i = 0; i < program->count; i++) lvn(&program->functions[i], stats);
+}
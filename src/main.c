@@ -6,9 +6,8 @@
 #include "token_util.h"
 
 
-int main(void) {
-    const char *code = read_file("./input/test.txt");
-
+/* Lex, parse and lower `code` into TAC */
+static TACProgram *run_front_end(const char *code, const char *filename) {
     /* 1) init lexer and token array */
     Lexer *lx = lexer_create(code);
     TokenArray tokens;
@@ -31,28 +30,232 @@ int main(void) {
     //printf("\n\n");
 
     dump_tokens_json_file("./compiler-steps/tokens.json", tokens.data, tokens.size);
-    
-    // 3.5) parse the tokens 
-    Parser *parser = parser_create(tokens, "./input/test.txt");
-    AstNode *ast = parse(parser);   
+
+    // 4) parse the tokens
+    Parser *parser = parser_create(tokens, filename);
+    AstNode *ast = parse(parser);
     //print_ast(ast, 0);
 
     printf("\n\n");
     dump_ast_json_file("./compiler-steps/ast.json", ast);
-    FILE *out = stdout;
 
-    int temp_counter = 0;
-    TACInstr *instr = tac_parse(ast, &temp_counter);
-    //tac_print_list(instr);
-    CFG *cfg2 = extract_functions(instr);
-    print_cfg(cfg2);
-    //CFG *cfg = build_from_tac(instr);
-    //print_cfg(cfg);
+    // 5) hoist nested functions so every function has a flat frame
+    lambda_lift(ast);
 
+    TACProgram *program = tac_parse(ast);
 
-    /* 4) cleanup */
     parser_free(parser);
     free_ast_node(ast);
+    return program;
+}
+
+
+#define MAX_ROOTS 64
+
+typedef struct {
+    const char *roots[MAX_ROOTS];   // entry points (default: main)
+    size_t      root_count;
+    int         stats;              // report what the passes did on stderr
+    int         unroll_factor;      // bodies per test in unrolled loops
+    int         inline_recursive;   // inline calls into recursive cycles once
+} MiddleEndOptions;
+
+static size_t program_size(const TACProgram *program) {
+    size_t count = 0;
+    for (size_t i = 0; i < program->count; i++) count += program->functions[i].count;
+    return count;
+}
+
+/* Runs the CFG construction (and later passes) on program, then frees it */
+static int run_middle_end(TACProgram *program, const MiddleEndOptions *options) {
+    size_t size_before = program_size(program);
+
+    // 1) peephole: local waste the front end leaves, before anything counts on it
+    PeepholeStats peephole_stats = {0};
+    peephole_program(program, PEEPHOLE_EARLY, &peephole_stats);
+
+    // 2) drop the functions the entry points never reach
+    size_t dead_functions = call_graph_remove_dead(program, options->roots, options->root_count);
+
+    // 3) self tail calls become loops, before inlining sees them as recursive
+    TailCallStats tail_call_stats = {0};
+    tail_call_eliminate_program(program, &tail_call_stats);
+
+    // 4) inline small callees, then drop those left without calls
+    InlineStats inline_stats = {0};
+    inline_program(program, options->inline_recursive, &inline_stats);
+    dead_functions += call_graph_remove_dead(program, options->roots, options->root_count);
+
+    // 5) if-conversion: small branchy assignments become selects
+    if_convert_program(program, IF_CONVERT_MAX_SPECULATED);
+
+    // 6) SSA form for the scalar passes, then back to plain copies
+    ssa_construct_program(program);
+    if (ssa_verify_program(program) > 0) {
+        fprintf(stderr, "SSA verification failed.\n");
+        tac_program_free(program);
+        tac_phi_free();
+        intern_free();
+        return 1;
+    }
+    SCCPStats sccp_stats = {0};
+    LVNStats lvn_stats = {0};
+    LICMStats licm_stats = {0};
+    InductionStats induction_stats = {0};
+    SSASimplifyStats simplify_stats = {0};
+    sccp_program(program, &sccp_stats);
+    lvn_program(program, &lvn_stats);
+    licm_program(program, &licm_stats);
+    induction_program(program, &induction_stats);
+    ssa_simplify_program(program, &simplify_stats);
+    ssa_destruct_program(program);
+
+    // 7) partial redundancy elimination needs lexical names, so after SSA
+    PREStats pre_stats = {0};
+    pre_program(program, &pre_stats);
+
+    // 8) unrolling: copies of loop bodies need no renaming without SSA either
+    UnrollStats unroll_stats = {0};
+    unroll_program(program, options->unroll_factor, &unroll_stats);
+
+    // 9) rotation last, as the loop passes above look for the test at the top
+    RotateStats rotate_stats = {0};
+    rotate_program(program, &rotate_stats);
+
+    // 10) peephole again, for what the passes above leave
+    peephole_program(program, PEEPHOLE_LATE, &peephole_stats);
+
+    // 11) mark the tail calls left, once nothing moves code around them
+    tail_call_mark_program(program, &tail_call_stats);
+
+    if (options->stats) {
+        size_t size_after = program_size(program);
+        fprintf(stderr, "instructions: %zu -> %zu (%+.1f%%)\n", size_before, size_after,
+                size_before ? 100.0 * ((double)size_after - (double)size_before) / (double)size_before : 0.0);
+        fprintf(stderr, "dead functions: %zu\n", dead_functions);
+        fprintf(stderr, "tail calls: %zu self calls made jumps, %zu marked\n", tail_call_stats.self, tail_call_stats.marked);
+        fprintf(stderr, "inline: %zu calls inlined, %zu instructions added\n", inline_stats.inlined, inline_stats.added);
+        fprintf(stderr, "sccp: %zu constants, %zu branches decided, %zu blocks removed\n",
+                sccp_stats.constants, sccp_stats.branches, sccp_stats.blocks);
+        fprintf(stderr, "lvn: %zu of %zu instructions redundant\n", lvn_stats.redundant, lvn_stats.instructions);
+        fprintf(stderr, "licm: %zu instructions (%zu pure calls) out of %zu loops, %zu preheaders\n",
+                licm_stats.hoisted, licm_stats.calls, licm_stats.loops, licm_stats.preheaders);
+        fprintf(stderr, "induction: %zu variables, %zu multiplications reduced, %zu tests replaced, %zu shifts\n",
+                induction_stats.ivs, induction_stats.reduced, induction_stats.replaced_tests, induction_stats.shifts);
+        fprintf(stderr, "simplify: %zu copies, %zu phis, %zu dead\n",
+                simplify_stats.copies, simplify_stats.phis, simplify_stats.dead);
+        fprintf(stderr, "pre: %zu expressions, %zu inserted, %zu deleted, %zu edges split\n",
+                pre_stats.expressions, pre_stats.inserted, pre_stats.deleted, pre_stats.split_edges);
+        fprintf(stderr, "unroll: %zu loops fully, %zu partially (%zu with a remainder), %zu bodies copied\n",
+                unroll_stats.full, unroll_stats.partial, unroll_stats.remainders, unroll_stats.copies);
+        fprintf(stderr, "rotate: %zu loops, %zu test instructions copied\n", rotate_stats.loops, rotate_stats.copied);
+        fprintf(stderr, "peephole: %zu rewrites in %zu rounds", peephole_stats.rewrites, peephole_stats.rounds);
+        for (size_t r = 0; r < peephole_rule_count; r++) {
+            if (peephole_stats.hits[r]) fprintf(stderr, ", %s %zu", peephole_rules[r].name, peephole_stats.hits[r]);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    //tac_print_program(program);
+    //CFG *cfg2 = extract_functions(program);
+    //print_cfg(cfg2);
+
+    // 12) one CFG per function, with its edges and live variables
+    for (size_t i = 0; i < program->count; i++) {
+        CFG *cfg = build_from_tac(&program->functions[i]);
+        if (!cfg) {
+            tac_program_free(program);
+            tac_phi_free();
+            intern_free();
+            return 1;
+        }
+        print_cfg(cfg);
+        DomTree *dom = dom_compute(cfg);
+        Liveness *lv = liveness_compute(&program->functions[i], cfg, dom);
+        liveness_print(lv, cfg);
+        printf("\n");
+        liveness_free(lv);
+        dom_free(dom);
+        free_cfg(cfg);
+        free(cfg);
+    }
+
+    /* 13) cleanup */
+    tac_program_free(program);
+    tac_phi_free();
+    intern_free();
 
     return 0;
 }
+
+
+/* True if path names a textual TAC file rather than a source program */
+static int is_tac_file(const char *path) {
+    size_t len = strlen(path);
+    return len >= 4 && strcmp(path + len - 4, ".tac") == 0;
+}
+
+
+int main(int argc, char **argv) {
+    const char *filename = "./input/test.txt";
+    int use_cache = 0;
+    size_t bench_blocks = 0, bench_live_blocks = 0;
+    MiddleEndOptions options = {0};
+    options.unroll_factor = UNROLL_DEFAULT_FACTOR;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cache") == 0) {
+            use_cache = 1;
+        } else if (strncmp(argv[i], "--bench-cfg", 11) == 0) {
+            // --bench-cfg[=max blocks]
+            bench_blocks = argv[i][11] == '=' ? strtoul(argv[i] + 12, NULL, 10) : 200000;
+        } else if (strncmp(argv[i], "--bench-live", 12) == 0) {
+            // --bench-live[=max blocks]
+            bench_live_blocks = argv[i][12] == '=' ? strtoul(argv[i] + 13, NULL, 10) : 16000;
+        } else if (strncmp(argv[i], "--root=", 7) == 0) {
+            // --root=name keeps name and what it calls (default: main)
+            if (options.root_count < MAX_ROOTS) options.roots[options.root_count++] = argv[i] + 7;
+        } else if (strncmp(argv[i], "--unroll=", 9) == 0) {
+            // --unroll=N runs N bodies per test; 1 only unrolls fully, 0 not at all
+            options.unroll_factor = atoi(argv[i] + 9);
+        } else if (strcmp(argv[i], "--inline-recursive") == 0) {
+            options.inline_recursive = 1;
+        } else if (strcmp(argv[i], "--opt-stats") == 0) {
+            options.stats = 1;
+        } else {
+            filename = argv[i];
+        }
+    }
+
+    if (bench_blocks || bench_live_blocks) {
+        if (bench_blocks) cfg_benchmark(bench_blocks);
+        if (bench_live_blocks) liveness_benchmark(bench_live_blocks);
+        intern_free();
+        return 0;
+    }
+
+    char *code = read_file(filename);
+    if (!code) return 1;
+
+    /* 1) .tac input skips the front end entirely */
+    if (is_tac_file(filename)) {
+        TACProgram *program = tac_read(code, strlen(code), filename);
+        free_file_content(code);
+        if (!program) return 1;
+        return run_middle_end(program, &options);
+    }
+
+    /* 2) reuse the TAC cached next to the source if it is still current */
+    uint64_t source_hash = tac_hash_source(code, strlen(code));
+    char cache_path[4096];
+    snprintf(cache_path, sizeof(cache_path), "%s.tacb", filename);
+
+    TACProgram *program = use_cache ? tac_load_cache(cache_path, source_hash) : NULL;
+    if (!program) {
+        program = run_front_end(code, filename);
+        if (use_cache) tac_write_cache(cache_path, program, source_hash);
+    }
+    free_file_content(code);
+
+    return run_middle_end(program, &options);
+}
@@ -0,0 +1,118 @@
+#include "peephole.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <stdlib.h>
+
+// Rule numbers by the kind of their first instruction, CSR
+typedef struct {
+    size_t start[TAC_KIND_COUNT + 1];
+    size_t rules[TAC_KIND_COUNT * PEEPHOLE_MAX_RULES];
+} RuleIndex;
+
+static int any_matches(TACOpKind kind) {
+    return kind != TAC_LABEL && kind != TAC_FUNCTION && kind != TAC_END_FUNCTION && kind != TAC_PHI;
+}
+
+static int kind_matches(TACOpKind pattern, TACOpKind kind) {
+    return pattern == PEEPHOLE_ANY ? any_matches(kind) : pattern == kind;
+}
+
+static void index_rules(RuleIndex *index, unsigned run) {
+    size_t count = peephole_rule_count < PEEPHOLE_MAX_RULES ? peephole_rule_count : PEEPHOLE_MAX_RULES;
+    size_t n = 0;
+    for (int kind = 0; kind < TAC_KIND_COUNT; kind++) {
+        index->start[kind] = n;
+        for (size_t r = 0; r < count; r++) {
+            const PeepholeRule *rule = &peephole_rules[r];
+            if ((rule->runs & run) && kind_matches(rule->kinds[0], (TACOpKind)kind)) index->rules[n++] = r;
+        }
+    }
+    index->start[TAC_KIND_COUNT] = n;
+}
+
+// Adds sign times the temp reads of instr to uses
+static void count_uses(const TACInstr *instr, int *uses, int sign) {
+    if (instr->kind == TAC_PHI) {
+        const TACOperand *args = tac_phi_args(instr);
+        for (size_t k = 0; k < tac_phi_arg_count(instr); k++) {
+            if (args[k].type == TAC_OP_TEMP) uses[args[k].literal] += sign;
+        }
+        return;
+    }
+    unsigned mask = tac_use_mask(instr);
+    if ((mask & TAC_USE_ARG1) && instr->arg1.type == TAC_OP_TEMP) uses[instr->arg1.literal] += sign;
+    if ((mask & TAC_USE_ARG2) && instr->arg2.type == TAC_OP_TEMP) uses[instr->arg2.literal] += sign;
+    if ((mask & TAC_USE_ARG3) && instr->arg3.type == TAC_OP_TEMP) uses[instr->arg3.literal] += sign;
+}
+
+// The first rule applying to the window at i, or -1; w->out is filled
+static int match(const TACFunction *fn, size_t i, const RuleIndex *index, PeepholeWindow *w) {
+    const TACOpKind kind = fn->instrs[i].kind;
+    for (size_t k = index->start[kind]; k < index->start[kind + 1]; k++) {
+        const PeepholeRule *rule = &peephole_rules[index->rules[k]];
+        if (i + rule->length > fn->count) continue;
+        size_t p = 1;
+        while (p < rule->length && kind_matches(rule->kinds[p], fn->instrs[i + p].kind)) p++;
+        if (p < rule->length) continue;
+        w->in = &fn->instrs[i];
+        w->out_count = 0;
+        if (rule->rewrite(w)) return (int)index->rules[k];
+    }
+    return -1;
+}
+
+void peephole(TACFunction *fn, unsigned run, PeepholeStats *stats) {
+    if (fn->count == 0) return;
+    RuleIndex index;
+    index_rules(&index, run);
+    PeepholeStats counts = {0};
+
+    // Reads per temp, kept current as windows are replaced
+    int *uses = xcalloc((size_t)fn->temp_count, sizeof(int));
+    for (size_t i = 0; i < fn->count; i++) count_uses(&fn->instrs[i], uses, 1);
+
+    for (int changed = 1; changed;) {
+        changed = 0;
+        counts.rounds++;
+        TACFunction out = {0};
+        out.temp_count = fn->temp_count;
+        out.label_count = fn->label_count;
+        PeepholeWindow w = { .temp_uses = uses };
+        for (size_t i = 0; i < fn->count;) {
+            int r = match(fn, i, &index, &w);
+            if (r < 0) {
+                tac_function_push(&out, fn->instrs[i++]);
+                continue;
+            }
+            size_t length = peephole_rules[r].length;
+            for (size_t k = 0; k < length; k++) count_uses(&fn->instrs[i + k], uses, -1);
+            for (size_t k = 0; k < w.out_count; k++) {
+                count_uses(&w.out[k], uses, 1);
+                tac_function_push(&out, w.out[k]);
+            }
+            i += length;
+            counts.hits[r]++;
+            counts.rewrites++;
+            changed = 1;
+        }
+        if (!changed) {
+            tac_function_free(&out);
+            break;
+        }
+        tac_function_sync_header(&out);
+        tac_function_free(fn);
+        *fn = out;
+    }
+    free(uses);
+
+    if (stats) {
+        for (size_t r = 0; r < PEEPHOLE_MAX_RULES; r++) stats->hits[r] += counts.hits[r];
+        stats->rewrites += counts.rewrites;
+        stats->rounds += counts.rounds;
+    }
+}
+
+void peephole_program(TACProgram *program, unsigned run, PeepholeStats *stats) {
+    for (size_t i = 0; i < program->count; i++) peephole(&program->functions[i], run, stats);
+}
@@ -0,0 +1,184 @@
+#include "peephole.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+
+// The rules of peephole.h. A rewrite sees w->in[0 .. length) of the kinds
+// its rule names and returns 0 unless it fills w->out; a rule may only
+// make the code shorter or simpler. Add rules to the table at the end.
+
+static int is_literal(TACOperand op, int value) {
+    return op.type == TAC_OP_LITERAL && op.literal == value;
+}
+
+static int read_once(const PeepholeWindow *w, TACOperand op) {
+    return op.type == TAC_OP_TEMP && w->temp_uses[op.literal] == 1;
+}
+
+static TACInstr copy_of(TACOperand dst, TACOperand value) {
+    return (TACInstr){ .kind = TAC_COPY, .dst = dst, .arg1 = value };
+}
+
+static int emit(PeepholeWindow *w, TACInstr instr) {
+    w->out[w->out_count++] = instr;
+    return 1;
+}
+
+// The other operand of a binary op whose arg1 or arg2 is `value`, given
+// that the op is commutative; NONE if neither is
+static TACOperand other_than(const TACInstr *instr, int value, int commutative) {
+    if (is_literal(instr->arg2, value)) return instr->arg1;
+    if (commutative && is_literal(instr->arg1, value)) return instr->arg2;
+    return (TACOperand){ .type = TAC_OP_NONE };
+}
+
+// x ← a + 0, x ← 0 + a, x ← a - 0  =>  x ← a
+static int add_zero(PeepholeWindow *w) {
+    const TACInstr *in = &w->in[0];
+    if (in->op.binop != TAC_ADD && in->op.binop != TAC_SUB) return 0;
+    TACOperand a = other_than(in, 0, in->op.binop == TAC_ADD);
+    return a.type != TAC_OP_NONE && emit(w, copy_of(in->dst, a));
+}
+
+// x ← a * 1, x ← 1 * a, x ← a / 1  =>  x ← a
+static int mul_one(PeepholeWindow *w) {
+    const TACInstr *in = &w->in[0];
+    if (in->op.binop != TAC_MUL && in->op.binop != TAC_DIV) return 0;
+    TACOperand a = other_than(in, 1, in->op.binop == TAC_MUL);
+    return a.type != TAC_OP_NONE && emit(w, copy_of(in->dst, a));
+}
+
+// x ← a * 0, x ← 0 * a  =>  x ← 0
+static int mul_zero(PeepholeWindow *w) {
+    const TACInstr *in = &w->in[0];
+    if (in->op.binop != TAC_MUL || other_than(in, 0, 1).type == TAC_OP_NONE) return 0;
+    return emit(w, copy_of(in->dst, tac_literal(0)));
+}
+
+// x ← a * 2  =>  x ← a + a
+static int mul_two(PeepholeWindow *w) {
+    const TACInstr *in = &w->in[0];
+    if (in->op.binop != TAC_MUL) return 0;
+    TACOperand a = other_than(in, 2, 1);
+    if (a.type == TAC_OP_NONE || a.type == TAC_OP_LITERAL) return 0;
+    return emit(w, (TACInstr){ .kind = TAC_BINARY_OP, .op.binop = TAC_ADD, .dst = in->dst, .arg1 = a, .arg2 = a });
+}
+
+// x ← a * 2^k  =>  x ← a << k, for k > 1 (a product wraps as the shift does)
+static int mul_power_of_two(PeepholeWindow *w) {
+    const TACInstr *in = &w->in[0];
+    if (in->op.binop != TAC_MUL) return 0;
+    int swapped = in->arg1.type == TAC_OP_LITERAL && in->arg2.type != TAC_OP_LITERAL;
+    TACOperand a = swapped ? in->arg2 : in->arg1, factor = swapped ? in->arg1 : in->arg2;
+    if (a.type == TAC_OP_LITERAL || factor.type != TAC_OP_LITERAL || factor.literal <= 2) return 0;
+    unsigned f = (unsigned)factor.literal;
+    if (f & (f - 1)) return 0;
+    int k = 0;
+    while ((1u << k) != f) k++;
+    return emit(w, (TACInstr){ .kind = TAC_BINARY_OP, .op.binop = TAC_SHL, .dst = in->dst, .arg1 = a, .arg2 = tac_literal(k) });
+}
+
+// x ← a - a  =>  x ← 0
+static int sub_self(PeepholeWindow *w) {
+    const TACInstr *in = &w->in[0];
+    if (in->op.binop != TAC_SUB || in->arg1.type == TAC_OP_LITERAL || !tac_operand_equal(in->arg1, in->arg2)) return 0;
+    return emit(w, copy_of(in->dst, tac_literal(0)));
+}
+
+// t ← -a; x ← -t  =>  t ← -a; x ← a, and t ← !a; x ← !t  =>  t ← !a; x ← a != 0
+static int double_negation(PeepholeWindow *w) {
+    const TACInstr *first = &w->in[0], *second = &w->in[1];
+    if (first->op.unop != second->op.unop || first->dst.type != TAC_OP_TEMP) return 0;
+    if (!tac_operand_equal(second->arg1, first->dst) || tac_operand_equal(first->arg1, first->dst)) return 0;
+    emit(w, *first);
+    if (first->op.unop == TAC_NEG) return emit(w, copy_of(second->dst, first->arg1));
+    return emit(w, (TACInstr){ .kind = TAC_BINARY_OP, .op.binop = TAC_NEQ, .dst = second->dst,
+                               .arg1 = first->arg1, .arg2 = tac_literal(0) });
+}
+
+// t ← a < b; x ← !t  =>  t ← a < b; x ← a >= b
+static int not_relation(PeepholeWindow *w) {
+    const TACInstr *first = &w->in[0], *second = &w->in[1];
+    if (second->op.unop != TAC_NOT || !tac_is_relational(first->op.binop) || first->dst.type != TAC_OP_TEMP) return 0;
+    if (!tac_operand_equal(second->arg1, first->dst)) return 0;
+    if (tac_operand_equal(first->arg1, first->dst) || tac_operand_equal(first->arg2, first->dst)) return 0;
+    emit(w, *first);
+    return emit(w, (TACInstr){ .kind = TAC_BINARY_OP, .op.binop = tac_negate_relation(first->op.binop),
+                               .dst = second->dst, .arg1 = first->arg1, .arg2 = first->arg2 });
+}
+
+// t ← <value>; x ← t  =>  x ← <value>, t read nowhere else
+static int forward_temp(PeepholeWindow *w) {
+    const TACInstr *first = &w->in[0], *second = &w->in[1];
+    switch (first->kind) {
+      case TAC_BINARY_OP: case TAC_UNARY_OP: case TAC_COPY: case TAC_SELECT: case TAC_CALL: break;
+      default: return 0;
+    }
+    if (!read_once(w, first->dst) || !tac_operand_equal(second->arg1, first->dst)) return 0;
+    if (tac_operand_equal(second->dst, first->dst)) return 0;
+    TACInstr merged = *first;
+    merged.dst = second->dst;
+    return emit(w, merged);
+}
+
+// t ← a; <use of t>  =>  <use of a>, t read nowhere else
+static int forward_copy(PeepholeWindow *w) {
+    const TACInstr *copy = &w->in[0];
+    TACInstr use = w->in[1];
+    if (!read_once(w, copy->dst) || tac_operand_equal(copy->arg1, copy->dst)) return 0;
+    unsigned mask = tac_use_mask(&use);
+    int found = 0;
+    if ((mask & TAC_USE_ARG1) && tac_operand_equal(use.arg1, copy->dst)) use.arg1 = copy->arg1, found = 1;
+    if ((mask & TAC_USE_ARG2) && tac_operand_equal(use.arg2, copy->dst)) use.arg2 = copy->arg1, found = 1;
+    if ((mask & TAC_USE_ARG3) && tac_operand_equal(use.arg3, copy->dst)) use.arg3 = copy->arg1, found = 1;
+    return found && emit(w, use);
+}
+
+// x ← x  =>  nothing
+static int self_copy(PeepholeWindow *w) {
+    return tac_operand_equal(w->in[0].dst, w->in[0].arg1);
+}
+
+// A temp nobody reads, from an instruction without effects  =>  nothing
+static int dead_temp(PeepholeWindow *w) {
+    const TACInstr *in = &w->in[0];
+    switch (in->kind) {
+      case TAC_BINARY_OP:
+        // a division by zero traps, so only literal divisors other than 0
+        if ((in->op.binop == TAC_DIV || in->op.binop == TAC_MOD)
+            && (in->arg2.type != TAC_OP_LITERAL || in->arg2.literal == 0 || in->arg2.literal == -1)) return 0;
+        break;
+      case TAC_UNARY_OP: case TAC_COPY: case TAC_SELECT: break;
+      default: return 0;
+    }
+    return in->dst.type == TAC_OP_TEMP && w->temp_uses[in->dst.literal] == 0;
+}
+
+// goto L; L:  =>  L:   (also ifz and if_<rel>, whose tests have no effects)
+static int jump_to_next(PeepholeWindow *w) {
+    int target = tac_jump_target(&w->in[0]);
+    if (target < 0 || w->in[1].dst.literal != target) return 0;
+    return emit(w, w->in[1]);
+}
+
+#define BOTH (PEEPHOLE_EARLY | PEEPHOLE_LATE)
+
+const PeepholeRule peephole_rules[] = {
+    { "add-zero",        1, { TAC_BINARY_OP },               BOTH,          add_zero },
+    { "mul-one",         1, { TAC_BINARY_OP },               BOTH,          mul_one },
+    { "mul-zero",        1, { TAC_BINARY_OP },               BOTH,          mul_zero },
+    { "mul-two",         1, { TAC_BINARY_OP },               PEEPHOLE_LATE, mul_two },
+    { "mul-pow2",        1, { TAC_BINARY_OP },               PEEPHOLE_LATE, mul_power_of_two },
+    { "sub-self",        1, { TAC_BINARY_OP },               BOTH,          sub_self },
+    { "double-negation", 2, { TAC_UNARY_OP, TAC_UNARY_OP },  BOTH,          double_negation },
+    { "not-relation",    2, { TAC_BINARY_OP, TAC_UNARY_OP }, BOTH,          not_relation },
+    { "forward-temp",    2, { PEEPHOLE_ANY, TAC_COPY },      BOTH,          forward_temp },
+    { "forward-copy",    2, { TAC_COPY, PEEPHOLE_ANY },      BOTH,          forward_copy },
+    { "self-copy",       1, { TAC_COPY },                    BOTH,          self_copy },
+    { "dead-temp",       1, { PEEPHOLE_ANY },                BOTH,          dead_temp },
+    { "jump-to-next",    2, { PEEPHOLE_ANY, TAC_LABEL },     BOTH,          jump_to_next },
+};
+
+const size_t peephole_rule_count = sizeof(peephole_rules) / sizeof(peephole_rules[0]);
+
+_Static_assert(sizeof(peephole_rules) / sizeof(peephole_rules[0]) <= PEEPHOLE_MAX_RULES,
+               "raise PEEPHOLE_MAX_RULES");
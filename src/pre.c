@@ -0,0 +1,612 @@
+#include "pre.h"
+#include "bitset.h"
+#include "cfg_builder.h"
+#include "dataflow.h"
+#include "dominance.h"
+#include "intern.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// An operator and its operand names; b is TAC_NONE for unary operators
+typedef struct {
+    int        kind;
+    int        op;
+    TACOperand a, b;
+} PREExpr;
+
+typedef struct {
+    TACInstr *items;
+    size_t    count;
+    size_t    capacity;
+} PREList;
+
+static void push_instr(PREList *list, TACInstr instr) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 8;
+        TACInstr *grown = realloc(list->items, capacity * sizeof(TACInstr));
+        if (!grown) {
+            printf("Memory allocation failed for partial redundancy elimination.\n");
+            exit(EXIT_FAILURE);
+        }
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = instr;
+}
+
+typedef struct {
+    TACFunction *fn;
+    CFG         *cfg;
+    DomTree     *dom;
+    size_t       n;
+
+    PREExpr     *exprs;
+    size_t       expr_count;
+    int         *expr_of;         // per instruction: expression id, or -1
+    int         *table;           // open addressing over expression ids
+    size_t       table_mask;
+
+    size_t       temp_count;
+    int         *user_start;      // per name: expressions reading it, CSR
+    int         *users;
+    unsigned char *written;       // per interned name: assigned by the function
+
+    size_t       words;
+    BitMatrix    antloc;          // computed before any operand is assigned
+    BitMatrix    comp;            // computed after the last assignment
+    BitMatrix    kill;            // some operand assigned
+} PRE;
+
+static int is_commutative(TACBinOp op) {
+    return op == TAC_ADD || op == TAC_MUL || op == TAC_EQ || op == TAC_NEQ || op == TAC_AND || op == TAC_OR;
+}
+
+// Total order on operands, for putting commutative ones in a fixed order
+static int operand_before(TACOperand a, TACOperand b) {
+    if (a.type != b.type) return a.type < b.type;
+    int ka = a.type == TAC_OP_VAR ? a.sym : a.literal;
+    int kb = b.type == TAC_OP_VAR ? b.sym : b.literal;
+    return ka < kb;
+}
+
+static int is_name(TACOperand op) {
+    return op.type == TAC_OP_TEMP || op.type == TAC_OP_VAR;
+}
+
+// Dense id of a temp or variable, or -1
+static int name_id(const PRE *p, TACOperand op) {
+    if (op.type == TAC_OP_TEMP && op.literal >= 0 && (size_t)op.literal < p->temp_count) return op.literal;
+    if (op.type == TAC_OP_VAR) return (int)p->temp_count + op.sym;
+    return -1;
+}
+
+// The expression instr computes, or kind -1 if it is not one PRE moves
+static PREExpr expression_of(const TACInstr *instr) {
+    PREExpr e = { -1, 0, TAC_NONE, TAC_NONE };
+    if (instr->kind == TAC_UNARY_OP) {
+        if (!is_name(instr->arg1)) return e;
+        e = (PREExpr){ TAC_UNARY_OP, instr->op.unop, instr->arg1, TAC_NONE };
+    } else if (instr->kind == TAC_BINARY_OP) {
+        TACBinOp op = instr->op.binop;
+        TACOperand a = instr->arg1, b = instr->arg2;
+        if (!is_name(a) && !is_name(b)) return e;
+        if (op == TAC_DIV || op == TAC_MOD) {
+            // moved onto paths that did not divide, it must not trap
+            if (b.type != TAC_OP_LITERAL || b.literal == 0 || b.literal == -1) return e;
+        }
+        if (op == TAC_GT || op == TAC_GTE) {
+            op = op == TAC_GT ? TAC_LT : TAC_LTE;
+            TACOperand swap = a; a = b; b = swap;
+        } else if (is_commutative(op) && operand_before(b, a)) {
+            TACOperand swap = a; a = b; b = swap;
+        }
+        e = (PREExpr){ TAC_BINARY_OP, op, a, b };
+    }
+    return e;
+}
+
+static size_t hash_expr(const PREExpr *e) {
+    size_t h = (size_t)(unsigned)e->kind * 0x9E3779B1u;
+    h = (h ^ (unsigned)e->op) * 0x85EBCA77u;
+    h = (h ^ (unsigned)e->a.type ^ ((unsigned)(e->a.type == TAC_OP_VAR ? e->a.sym : e->a.literal) << 2)) * 0xC2B2AE3Du;
+    h = (h ^ (unsigned)e->b.type ^ ((unsigned)(e->b.type == TAC_OP_VAR ? e->b.sym : e->b.literal) << 2)) * 0x27D4EB2Fu;
+    return h ^ (h >> 15);
+}
+
+static int expr_equal(const PREExpr *x, const PREExpr *y) {
+    return x->kind == y->kind && x->op == y->op && tac_operand_equal(x->a, y->a) && tac_operand_equal(x->b, y->b);
+}
+
+static int intern_expr(PRE *p, PREExpr e) {
+    size_t slot = hash_expr(&e) & p->table_mask;
+    while (p->table[slot] >= 0) {
+        if (expr_equal(&p->exprs[p->table[slot]], &e)) return p->table[slot];
+        slot = (slot + 1) & p->table_mask;
+    }
+    p->exprs[p->expr_count] = e;
+    p->table[slot] = (int)p->expr_count;
+    return (int)p->expr_count++;
+}
+
+static TACInstr expr_instr(const PREExpr *e, TACOperand dst) {
+    TACInstr instr = {0};
+    instr.kind = e->kind;
+    instr.dst = dst;
+    instr.arg1 = e->a;
+    if (e->kind == TAC_BINARY_OP) {
+        instr.op.binop = e->op;
+        instr.arg2 = e->b;
+    } else {
+        instr.op.unop = e->op;
+    }
+    return instr;
+}
+
+static void collect_expressions(PRE *p) {
+    TACFunction *fn = p->fn;
+    p->expr_of = xcalloc(fn->count, sizeof(int));
+    p->exprs = xcalloc(fn->count, sizeof(PREExpr));
+    size_t size = 16;
+    while (size < 2 * fn->count) size *= 2;
+    p->table = xcalloc(size, sizeof(int));
+    p->table_mask = size - 1;
+    for (size_t s = 0; s < size; s++) p->table[s] = -1;
+
+    for (size_t i = 0; i < fn->count; i++) {
+        PREExpr e = expression_of(&fn->instrs[i]);
+        p->expr_of[i] = e.kind < 0 ? -1 : intern_expr(p, e);
+    }
+
+    // Which expressions read each name, for kills
+    size_t names = p->temp_count + intern_count();
+    p->user_start = xcalloc(names + 1, sizeof(int));
+    for (size_t x = 0; x < p->expr_count; x++) {
+        int a = name_id(p, p->exprs[x].a), b = name_id(p, p->exprs[x].b);
+        if (a >= 0) p->user_start[a + 1]++;
+        if (b >= 0 && b != a) p->user_start[b + 1]++;
+    }
+    for (size_t k = 0; k < names; k++) p->user_start[k + 1] += p->user_start[k];
+    p->users = xcalloc((size_t)p->user_start[names], sizeof(int));
+    int *fill = xcalloc(names, sizeof(int));
+    for (size_t x = 0; x < p->expr_count; x++) {
+        int a = name_id(p, p->exprs[x].a), b = name_id(p, p->exprs[x].b);
+        if (a >= 0) p->users[p->user_start[a] + fill[a]++] = (int)x;
+        if (b >= 0 && b != a) p->users[p->user_start[b] + fill[b]++] = (int)x;
+    }
+    free(fill);
+
+    p->written = xcalloc(intern_count(), 1);
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACOperand *def = tac_def_operand(&fn->instrs[i]);
+        if (def && def->type == TAC_OP_VAR) p->written[def->sym] = 1;
+    }
+}
+
+static void kill_expr(PRE *p, size_t b, int x) {
+    bitset_set(bitmatrix_row(&p->kill, b), (size_t)x);
+    bitset_reset(bitmatrix_row(&p->comp, b), (size_t)x);
+}
+
+// ANTLOC, COMP and KILL of every block in one scan
+static void local_sets(PRE *p) {
+    bitmatrix_init(&p->antloc, p->n, p->expr_count);
+    bitmatrix_init(&p->comp, p->n, p->expr_count);
+    bitmatrix_init(&p->kill, p->n, p->expr_count);
+
+    // Expressions reading a variable only others write end at each call
+    uint64_t *shared = xcalloc(p->words, sizeof(uint64_t));
+    for (size_t x = 0; x < p->expr_count; x++) {
+        const PREExpr *e = &p->exprs[x];
+        if ((e->a.type == TAC_OP_VAR && !p->written[e->a.sym]) || (e->b.type == TAC_OP_VAR && !p->written[e->b.sym]))
+            bitset_set(shared, x);
+    }
+
+    for (size_t b = 0; b < p->n; b++) {
+        const CFGBlock *block = p->cfg->blocks.items[b];
+        size_t base = (size_t)(block->instructions - p->fn->instrs);
+        for (size_t i = 0; i < block->count; i++) {
+            const TACInstr *instr = &block->instructions[i];
+            int x = p->expr_of[base + i];
+            if (x >= 0) {
+                if (!bitset_test(bitmatrix_row(&p->kill, b), (size_t)x)) bitset_set(bitmatrix_row(&p->antloc, b), (size_t)x);
+                bitset_set(bitmatrix_row(&p->comp, b), (size_t)x);
+            }
+            if (instr->kind == TAC_CALL) {
+                bitset_union_into(bitmatrix_row(&p->kill, b), shared, p->words);
+                bitset_difference(bitmatrix_row(&p->comp, b), bitmatrix_row(&p->comp, b), shared, p->words);
+            }
+            const TACOperand *def = tac_def_operand(instr);
+            int name = def ? name_id(p, *def) : -1;
+            if (name < 0) continue;
+            for (int k = p->user_start[name]; k < p->user_start[name + 1]; k++) kill_expr(p, b, p->users[k]);
+        }
+    }
+    free(shared);
+}
+
+// Predecessor slot of the edge p -> s (the first, if there are two)
+static size_t edge_slot(const CFG *cfg, int p, int s) {
+    size_t count;
+    const int *pred = cfg_predecessors(cfg, s, &count);
+    size_t j = 0;
+    while (j + 1 < count && pred[j] != p) j++;
+    return (size_t)(pred - cfg->pred) + j;
+}
+
+// EARLIEST(p,s) = ANTIN(s) ∩ ¬AVOUT(p) ∩ (KILL(p) ∪ ¬ANTOUT(p))
+static void earliest(const PRE *pr, const DataflowProblem *ant, const DataflowProblem *avail,
+                     int p, int s, uint64_t *out) {
+    const uint64_t *antin = bitmatrix_row(&ant->in, (size_t)s);
+    const uint64_t *antout = bitmatrix_row(&ant->out, (size_t)p);
+    const uint64_t *avout = bitmatrix_row(&avail->out, (size_t)p);
+    const uint64_t *kill = bitmatrix_row(&pr->kill, (size_t)p);
+    for (size_t w = 0; w < pr->words; w++) out[w] = antin[w] & ~avout[w] & (kill[w] | ~antout[w]);
+}
+
+void pre(TACFunction *fn, PREStats *stats) {
+    if (fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION) return;
+
+    PRE p = {0};
+    p.fn = fn;
+    p.temp_count = fn->temp_count > 0 ? (size_t)fn->temp_count : 0;
+    collect_expressions(&p);
+    p.cfg = p.expr_count ? build_from_tac(fn) : NULL;
+    if (!p.cfg) {
+        free(p.expr_of);
+        free(p.exprs);
+        free(p.table);
+        free(p.user_start);
+        free(p.users);
+        free(p.written);
+        return;
+    }
+    p.dom = dom_compute(p.cfg);
+    p.n = p.cfg->blocks.count;
+    p.words = bitset_words(p.expr_count);
+    const CFG *cfg = p.cfg;
+    const DomTree *dom = p.dom;
+    size_t n = p.n, words = p.words;
+    local_sets(&p);
+
+    // 1) Availability (forward) and anticipability (backward)
+    DataflowProblem avail, ant;
+    dataflow_init(&avail, cfg, DATAFLOW_FORWARD, DATAFLOW_INTERSECT, p.expr_count);
+    dataflow_init(&ant, cfg, DATAFLOW_BACKWARD, DATAFLOW_INTERSECT, p.expr_count);
+    bitset_copy(avail.gen.bits, p.comp.bits, n * words);
+    bitset_copy(avail.kill.bits, p.kill.bits, n * words);
+    bitset_copy(ant.gen.bits, p.antloc.bits, n * words);
+    bitset_copy(ant.kill.bits, p.kill.bits, n * words);
+    dataflow_solve(&avail, cfg, dom);
+    dataflow_solve(&ant, cfg, dom);
+
+    // 2) LATERIN(s) = ∩ over reachable preds of
+    //    LATER(p,s) = EARLIEST(p,s) ∪ (LATERIN(p) ∩ ¬ANTLOC(p)),
+    //    from all ones; the entry starts with what is anticipated there
+    BitMatrix laterin;
+    bitmatrix_init(&laterin, n, p.expr_count);
+    for (size_t b = 0; b < n; b++) bitset_fill(bitmatrix_row(&laterin, b), p.expr_count, words);
+    bitset_copy(bitmatrix_row(&laterin, 0), bitmatrix_row(&ant.in, 0), words);
+    uint64_t *later = xcalloc(words, sizeof(uint64_t));
+    uint64_t *meet = xcalloc(words, sizeof(uint64_t));
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (size_t r = 1; r < dom->rpo_count; r++) {
+            int s = dom->rpo[r];
+            size_t pred_count;
+            const int *pred = cfg_predecessors(cfg, s, &pred_count);
+            bitset_fill(meet, p.expr_count, words);
+            for (size_t j = 0; j < pred_count; j++) {
+                int q = pred[j];
+                if (dom->rpo_index[q] < 0) continue;
+                earliest(&p, &ant, &avail, q, s, later);
+                const uint64_t *in = bitmatrix_row(&laterin, (size_t)q);
+                const uint64_t *antloc = bitmatrix_row(&p.antloc, (size_t)q);
+                for (size_t w = 0; w < words; w++) meet[w] &= later[w] | (in[w] & ~antloc[w]);
+            }
+            uint64_t *row = bitmatrix_row(&laterin, (size_t)s);
+            for (size_t w = 0; w < words; w++) {
+                if (row[w] != meet[w]) changed = 1;
+                row[w] = meet[w];
+            }
+        }
+    }
+
+    // 3) INSERT(p,s) = LATER(p,s) ∩ ¬LATERIN(s) per predecessor slot,
+    //    DELETE(b) = ANTLOC(b) ∩ ¬LATERIN(b)
+    BitMatrix insert, delete;
+    bitmatrix_init(&insert, cfg->edge_count, p.expr_count);
+    bitmatrix_init(&delete, n, p.expr_count);
+    for (size_t r = 0; r < dom->rpo_count; r++) {
+        int s = dom->rpo[r];
+        const uint64_t *in_s = bitmatrix_row(&laterin, (size_t)s);
+        bitset_difference(bitmatrix_row(&delete, (size_t)s), bitmatrix_row(&p.antloc, (size_t)s), in_s, words);
+        size_t pred_count;
+        const int *pred = cfg_predecessors(cfg, s, &pred_count);
+        for (size_t j = 0; j < pred_count; j++) {
+            int q = pred[j];
+            if (dom->rpo_index[q] < 0) continue;
+            earliest(&p, &ant, &avail, q, s, later);
+            const uint64_t *in = bitmatrix_row(&laterin, (size_t)q);
+            const uint64_t *antloc = bitmatrix_row(&p.antloc, (size_t)q);
+            uint64_t *row = bitmatrix_row(&insert, (size_t)(pred - cfg->pred) + j);
+            for (size_t w = 0; w < words; w++) row[w] = (later[w] | (in[w] & ~antloc[w])) & ~in_s[w];
+        }
+    }
+
+    // 4) Only expressions with a deletion are worth a temp, and not when
+    //    every deleted computation just moves onto all the edges into its
+    //    block
+    uint64_t *chosen = xcalloc(words, sizeof(uint64_t));
+    uint64_t *isolated = xcalloc(words, sizeof(uint64_t));
+    for (size_t b = 0; b < n; b++) bitset_union_into(chosen, bitmatrix_row(&delete, b), words);
+    bitset_copy(isolated, chosen, words);
+    for (size_t b = 0; b < n; b++) {
+        const uint64_t *del = bitmatrix_row(&delete, b);
+        size_t pred_count;
+        const int *pred = cfg_predecessors(cfg, (int)b, &pred_count);
+        for (size_t j = 0; j < pred_count; j++) {
+            if (dom->rpo_index[pred[j]] < 0) continue;
+            const uint64_t *ins = bitmatrix_row(&insert, (size_t)(pred - cfg->pred) + j);
+            for (size_t w = 0; w < words; w++) isolated[w] &= ~(del[w] & ~ins[w]);
+        }
+    }
+    bitset_difference(chosen, chosen, isolated, words);
+
+    // 5) Where the temp must hold the value on leaving a block: a path
+    //    from there reaches a deletion before new code or a kill
+    //    OUT(b) = ∪ (IN(s) ∩ ¬INSERT(b,s)),  IN(b) = DELETE(b) ∪ (OUT(b) ∩ ¬(COMP(b) ∪ KILL(b)))
+    BitMatrix used_in, used_out;
+    bitmatrix_init(&used_in, n, p.expr_count);
+    bitmatrix_init(&used_out, n, p.expr_count);
+    changed = 1;
+    while (changed) {
+        changed = 0;
+        for (size_t r = dom->rpo_count; r-- > 0;) {
+            int b = dom->rpo[r];
+            uint64_t *out = bitmatrix_row(&used_out, (size_t)b);
+            size_t succ_count;
+            const int *succ = cfg_successors(cfg, b, &succ_count);
+            bitset_clear(out, words);
+            for (size_t k = 0; k < succ_count; k++) {
+                const uint64_t *in = bitmatrix_row(&used_in, (size_t)succ[k]);
+                const uint64_t *ins = bitmatrix_row(&insert, edge_slot(cfg, b, succ[k]));
+                for (size_t w = 0; w < words; w++) out[w] |= in[w] & ~ins[w];
+            }
+            uint64_t *in = bitmatrix_row(&used_in, (size_t)b);
+            const uint64_t *del = bitmatrix_row(&delete, (size_t)b);
+            const uint64_t *comp = bitmatrix_row(&p.comp, (size_t)b);
+            const uint64_t *kill = bitmatrix_row(&p.kill, (size_t)b);
+            for (size_t w = 0; w < words; w++) {
+                uint64_t value = del[w] | (out[w] & ~(comp[w] | kill[w]));
+                if (value != in[w]) changed = 1;
+                in[w] = value;
+            }
+        }
+    }
+
+    // 6) A temp per chosen expression
+    PREStats counts = {0};
+    int *temp_of = xcalloc(p.expr_count, sizeof(int));
+    for (size_t x = 0; x < p.expr_count; x++) {
+        temp_of[x] = -1;
+        if (!bitset_test(chosen, x)) continue;
+        temp_of[x] = tac_function_new_temp(fn);
+        counts.expressions++;
+    }
+
+    // 7) What happens to each computation: the upward exposed one of a
+    //    deletion block reads the temp, the last one of a block the temp
+    //    is needed after sets it first
+    enum { PRE_KEEP, PRE_DELETE, PRE_SAVE };
+    unsigned char *action = xcalloc(fn->count, 1);
+    uint64_t *seen = xcalloc(words, sizeof(uint64_t));
+    for (size_t r = 0; r < dom->rpo_count; r++) {
+        int b = dom->rpo[r];
+        const CFGBlock *block = cfg->blocks.items[b];
+        size_t base = (size_t)(block->instructions - fn->instrs);
+        const uint64_t *del = bitmatrix_row(&delete, (size_t)b);
+        const uint64_t *out = bitmatrix_row(&used_out, (size_t)b);
+        const uint64_t *comp = bitmatrix_row(&p.comp, (size_t)b);
+        bitset_clear(seen, words);
+        for (size_t i = 0; i < block->count; i++) {
+            int x = p.expr_of[base + i];
+            if (x < 0 || temp_of[x] < 0 || bitset_test(seen, (size_t)x)) continue;
+            bitset_set(seen, (size_t)x);
+            if (bitset_test(del, (size_t)x)) action[base + i] = PRE_DELETE;
+        }
+        for (size_t i = block->count; i-- > 0;) {
+            int x = p.expr_of[base + i];
+            if (x < 0 || temp_of[x] < 0 || !bitset_test(seen, (size_t)x)) continue;
+            bitset_reset(seen, (size_t)x);
+            if (bitset_test(comp, (size_t)x) && bitset_test(out, (size_t)x) && action[base + i] != PRE_DELETE)
+                action[base + i] = PRE_SAVE;
+        }
+    }
+
+    // 8) Where each edge's code goes: at the start of a target with no
+    //    other predecessor, the end of a source with no other successor,
+    //    after a conditional jump whose fall-through it is, or into a new
+    //    block the jump is retargeted to
+    PREList *head = xcalloc(n, sizeof(PREList));
+    PREList *tail = xcalloc(n, sizeof(PREList));
+    PREList *fall = xcalloc(n, sizeof(PREList));
+    PREList *jump = xcalloc(n, sizeof(PREList));
+    int *retarget = xcalloc(n, sizeof(int));
+    for (size_t b = 0; b < n; b++) retarget[b] = -1;
+
+    for (size_t r = 0; r < dom->rpo_count; r++) {
+        int s = dom->rpo[r];
+        size_t pred_count;
+        const int *pred = cfg_predecessors(cfg, s, &pred_count);
+        for (size_t j = 0; j < pred_count; j++) {
+            int q = pred[j];
+            if (dom->rpo_index[q] < 0) continue;
+            int seen_before = 0;
+            for (size_t k = 0; k < j && !seen_before; k++) seen_before = pred[k] == q;
+            if (seen_before) continue;
+
+            const uint64_t *row = bitmatrix_row(&insert, (size_t)(pred - cfg->pred) + j);
+            size_t succ_count;
+            const int *succ = cfg_successors(cfg, q, &succ_count);
+            int only_successor = 1;
+            for (size_t k = 0; k < succ_count; k++) only_successor &= succ[k] == s;
+            const CFGBlock *from = cfg->blocks.items[q];
+            const TACInstr *last = &from->instructions[from->count - 1];
+
+            for (size_t x = 0; x < p.expr_count; x++) {
+                if (temp_of[x] < 0 || !bitset_test(row, x)) continue;
+                TACInstr instr = expr_instr(&p.exprs[x], tac_temp(temp_of[x]));
+                counts.inserted++;
+                if (pred_count == 1) {
+                    push_instr(&head[s], instr);
+                } else if (only_successor) {
+                    push_instr(&tail[q], instr);
+                } else if ((size_t)q + 1 == (size_t)s && !(tac_jump_target(last) >= 0 &&
+                           cfg_label_block(cfg, tac_jump_target(last)) == s)) {
+                    if (fall[q].count == 0) counts.split_edges++;
+                    push_instr(&fall[q], instr);
+                } else {
+                    if (retarget[q] < 0) {
+                        retarget[q] = tac_function_new_label(fn);
+                        counts.split_edges++;
+                    }
+                    push_instr(&jump[q], instr);
+                }
+            }
+        }
+    }
+
+    // 9) Rebuild; split blocks go in front of the block holding endfun,
+    //    which the code before them then has to jump to
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    for (size_t b = 0; b < n; b++) {
+        const CFGBlock *block = cfg->blocks.items[b];
+        size_t base = (size_t)(block->instructions - fn->instrs);
+        const TACInstr *last = &block->instructions[block->count - 1];
+        int exit_label = -1;
+
+        if (b + 1 == n) {
+            int any_split = 0;
+            for (size_t q = 0; q < n && !any_split; q++) any_split = retarget[q] >= 0;
+            const TACInstr *prev = out.count > 0 ? &out.instrs[out.count - 1] : NULL;
+            if (any_split && prev && prev->kind != TAC_GOTO && prev->kind != TAC_RETURN) {
+                exit_label = block->instructions[0].kind == TAC_LABEL
+                           ? block->instructions[0].dst.literal : tac_function_new_label(&out);
+                TACInstr jump_exit = {0};
+                jump_exit.kind = TAC_GOTO;
+                jump_exit.arg1 = tac_label(exit_label);
+                tac_function_push(&out, jump_exit);
+            }
+            for (size_t q = 0; q < n; q++) {
+                if (retarget[q] < 0) continue;
+                const CFGBlock *from = cfg->blocks.items[q];
+                TACInstr label = {0};
+                label.kind = TAC_LABEL;
+                label.dst = tac_label(retarget[q]);
+                tac_function_push(&out, label);
+                for (size_t k = 0; k < jump[q].count; k++) tac_function_push(&out, jump[q].items[k]);
+                TACInstr back = {0};
+                back.kind = TAC_GOTO;
+                back.arg1 = tac_label(tac_jump_target(&from->instructions[from->count - 1]));
+                tac_function_push(&out, back);
+            }
+            if (exit_label >= 0 && block->instructions[0].kind != TAC_LABEL) {
+                TACInstr label = {0};
+                label.kind = TAC_LABEL;
+                label.dst = tac_label(exit_label);
+                tac_function_push(&out, label);
+            }
+        }
+
+        size_t first = 0;
+        if (block->count > 0 && block->instructions[0].kind == TAC_LABEL) tac_function_push(&out, block->instructions[first++]);
+        for (size_t k = 0; k < head[b].count; k++) tac_function_push(&out, head[b].items[k]);
+
+        int ends_in_jump = last->kind == TAC_GOTO || last->kind == TAC_IFZ || last->kind == TAC_IF_CMP;
+        for (size_t i = first; i < block->count; i++) {
+            TACInstr instr = block->instructions[i];
+            int x = p.expr_of[base + i];
+            if (&block->instructions[i] == last && ends_in_jump) {
+                for (size_t k = 0; k < tail[b].count; k++) tac_function_push(&out, tail[b].items[k]);
+                if (retarget[b] >= 0) tac_set_jump_target(&instr, retarget[b]);
+                tac_function_push(&out, instr);
+                for (size_t k = 0; k < fall[b].count; k++) tac_function_push(&out, fall[b].items[k]);
+                continue;
+            }
+            if (action[base + i] == PRE_DELETE) {
+                TACInstr copy = { .kind = TAC_COPY, .dst = instr.dst, .arg1 = tac_temp(temp_of[x]) };
+                tac_function_push(&out, copy);
+                counts.deleted++;
+            } else if (action[base + i] == PRE_SAVE) {
+                tac_function_push(&out, expr_instr(&p.exprs[x], tac_temp(temp_of[x])));
+                TACInstr copy = { .kind = TAC_COPY, .dst = instr.dst, .arg1 = tac_temp(temp_of[x]) };
+                tac_function_push(&out, copy);
+            } else {
+                tac_function_push(&out, instr);
+            }
+        }
+        if (!ends_in_jump) {
+            for (size_t k = 0; k < tail[b].count; k++) tac_function_push(&out, tail[b].items[k]);
+        }
+    }
+    tac_function_sync_header(&out);
+
+    if (stats) {
+        stats->expressions += counts.expressions;
+        stats->inserted += counts.inserted;
+        stats->deleted += counts.deleted;
+        stats->split_edges += counts.split_edges;
+    }
+
+    for (size_t b = 0; b < n; b++) {
+        free(head[b].items);
+        free(tail[b].items);
+        free(fall[b].items);
+        free(jump[b].items);
+    }
+    free(head);
+    free(tail);
+    free(fall);
+    free(jump);
+    free(retarget);
+    free(action);
+    free(seen);
+    free(temp_of);
+    free(chosen);
+    free(isolated);
+    free(later);
+    free(meet);
+    bitmatrix_free(&used_in);
+    bitmatrix_free(&used_out);
+    bitmatrix_free(&insert);
+    bitmatrix_free(&delete);
+    bitmatrix_free(&laterin);
+    dataflow_free(&avail);
+    dataflow_free(&ant);
+    bitmatrix_free(&p.antloc);
+    bitmatrix_free(&p.comp);
+    bitmatrix_free(&p.kill);
+    free(p.expr_of);
+    free(p.exprs);
+    free(p.table);
+    free(p.user_start);
+    free(p.users);
+    free(p.written);
+    dom_free(p.dom);
+    free_cfg(p.cfg);
+    free(p.cfg);
+
+    tac_function_free(fn);
+    *fn = out;
+}
+
+void pre_program(TACProgram *program, PREStats *stats) {
+    for (size_t i = 0; i < program->count; i++) pre(&program->functions[i], stats);
+}
@@ -0,0 +1,155 @@
+#include "rotate.h"
+#include "cfg_builder.h"
+#include "dominance.h"
+#include "loops.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A while loop as rotate.h describes it, by instruction index
+typedef struct {
+    size_t test_start;        // the header's label
+    size_t test_end;          // one past its jump out
+    size_t back_edge;         // the latch's goto
+    int    exit_label;
+} Rotation;
+
+static int loop_to_rotate(const CFG *cfg, const LoopForest *forest, int loop, const TACFunction *fn, Rotation *r) {
+    int h = forest->loops[loop].header;
+    const CFGBlock *header = cfg->blocks.items[h];
+    if (header->instructions[0].kind != TAC_LABEL || header->count < 2 || header->count - 1 > ROTATE_MAX_TEST) return 0;
+    int label = header->instructions[0].dst.literal;
+
+    // 1) The header ends in a jump out of the loop and falls into it
+    const TACInstr *exit = &header->instructions[header->count - 1];
+    if (exit->kind != TAC_IFZ && exit->kind != TAC_IF_CMP) return 0;
+    int exit_block = cfg_label_block(cfg, tac_jump_target(exit));
+    if (exit_block < 0 || loop_contains(forest, loop, exit_block)) return 0;
+    if ((size_t)h + 1 >= cfg->blocks.count || !loop_contains(forest, loop, h + 1)) return 0;
+
+    // 2) Its one latch jumps back unconditionally
+    size_t latch_count;
+    const int *latches = loop_latches(forest, loop, &latch_count);
+    if (latch_count != 1 || latches[0] == h) return 0;
+    const CFGBlock *latch = cfg->blocks.items[latches[0]];
+    const TACInstr *back = &latch->instructions[latch->count - 1];
+    if (back->kind != TAC_GOTO || tac_jump_target(back) != label) return 0;
+
+    r->test_start = (size_t)(header->instructions - fn->instrs);
+    r->test_end = r->test_start + header->count;
+    r->back_edge = (size_t)(back - fn->instrs);
+    r->exit_label = tac_jump_target(exit);
+    return 1;
+}
+
+// Rotates the loop; returns the label of the body, its new header
+static int rotate_loop(TACFunction *fn, const Rotation *r, RotateStats *counts) {
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+
+    // The body's first block gets a label unless it has one
+    const TACInstr *top = &fn->instrs[r->test_end];
+    int body_label = top->kind == TAC_LABEL ? top->dst.literal : tac_function_new_label(&out);
+
+    for (size_t i = 0; i < fn->count; i++) {
+        if (i == r->test_end && top->kind != TAC_LABEL) {
+            tac_function_push(&out, (TACInstr){ .kind = TAC_LABEL, .dst = tac_label(body_label) });
+        }
+        if (i != r->back_edge) {
+            tac_function_push(&out, fn->instrs[i]);
+            continue;
+        }
+
+        // 1) The test again, jumping back to the body unless it exits
+        for (size_t k = r->test_start + 1; k + 1 < r->test_end; k++) tac_function_push(&out, fn->instrs[k]);
+        const TACInstr *exit = &fn->instrs[r->test_end - 1];
+        TACInstr again = { .kind = TAC_IF_CMP, .dst = tac_label(body_label) };
+        if (exit->kind == TAC_IFZ) {
+            again.op.binop = TAC_NEQ;
+            again.arg1 = exit->arg1;
+            again.arg2 = tac_literal(0);
+        } else {
+            again.op.binop = tac_negate_relation(exit->op.binop);
+            again.arg1 = exit->arg1;
+            again.arg2 = exit->arg2;
+        }
+        tac_function_push(&out, again);
+        counts->copied += r->test_end - r->test_start - 1;
+
+        // 2) Leaving, on to the exit unless it comes next
+        const TACInstr *next = i + 1 < fn->count ? &fn->instrs[i + 1] : NULL;
+        if (!next || next->kind != TAC_LABEL || next->dst.literal != r->exit_label) {
+            tac_function_push(&out, (TACInstr){ .kind = TAC_GOTO, .arg1 = tac_label(r->exit_label) });
+        }
+    }
+    tac_function_sync_header(&out);
+    tac_function_free(fn);
+    *fn = out;
+    counts->loops++;
+    return body_label;
+}
+
+// Room in done for every label of fn
+static unsigned char *cover_labels(unsigned char *done, size_t *capacity, const TACFunction *fn) {
+    size_t needed = fn->label_count > 0 ? (size_t)fn->label_count : 0;
+    if (needed <= *capacity && done) return done;
+    size_t grown_capacity = needed * 2 + 8;
+    unsigned char *grown = xcalloc(grown_capacity, 1);
+    if (done) memcpy(grown, done, *capacity);
+    free(done);
+    *capacity = grown_capacity;
+    return grown;
+}
+
+void rotate(TACFunction *fn, RotateStats *stats) {
+    if (fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION) return;
+    for (size_t i = 0; i < fn->count; i++) {
+        if (fn->instrs[i].kind == TAC_PHI) return;
+    }
+    RotateStats counts = {0};
+
+    // Headers (by label) already done; each loop is rotated once
+    size_t label_capacity = 0;
+    unsigned char *done = NULL;
+
+    for (int changed = 1; changed;) {
+        changed = 0;
+        done = cover_labels(done, &label_capacity, fn);
+
+        CFG *cfg = build_from_tac(fn);
+        if (!cfg) break;
+        DomTree *dom = dom_compute(cfg);
+        LoopForest *forest = loops_compute(cfg, dom);
+        for (size_t k = 0; k < forest->count && !changed; k++) {
+            const CFGBlock *header = cfg->blocks.items[forest->loops[k].header];
+            if (header->instructions[0].kind != TAC_LABEL) continue;
+            int label = header->instructions[0].dst.literal;
+            if (done[label]) continue;
+            done[label] = 1;
+
+            Rotation r;
+            if (!loop_to_rotate(cfg, forest, (int)k, fn, &r)) continue;
+            int body_label = rotate_loop(fn, &r, &counts);
+            done = cover_labels(done, &label_capacity, fn);
+            done[body_label] = 1;
+            changed = 1;
+        }
+        loops_free(forest);
+        dom_free(dom);
+        free_cfg(cfg);
+        free(cfg);
+    }
+    free(done);
+
+    if (stats) {
+        stats->loops += counts.loops;
+        stats->copied += counts.copied;
+    }
+}
+
+void rotate_program(TACProgram *program, RotateStats *stats) {
+    for (size_t i = 0; i < program->count; i++) rotate(&program->functions[i], stats);
+}
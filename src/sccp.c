@@ -0,0 +1,432 @@
+#include "sccp.h"
+#include "cfg_builder.h"
+#include "def_use.h"
+#include "intern.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <limits.h>
+#include <stdlib.h>
+
+typedef enum { SCCP_TOP, SCCP_CONST, SCCP_BOTTOM } SCCPState;
+
+typedef struct {
+    unsigned char state;      // SCCPState
+    int           value;      // for SCCP_CONST
+} SCCPValue;
+
+static const SCCPValue sccp_top = { SCCP_TOP, 0 };
+static const SCCPValue sccp_bottom = { SCCP_BOTTOM, 0 };
+
+static SCCPValue sccp_const(int value) {
+    return (SCCPValue){ SCCP_CONST, value };
+}
+
+static SCCPValue meet(SCCPValue a, SCCPValue b) {
+    if (a.state == SCCP_TOP) return b;
+    if (b.state == SCCP_TOP) return a;
+    if (a.state == SCCP_CONST && b.state == SCCP_CONST && a.value == b.value) return a;
+    return sccp_bottom;
+}
+
+typedef struct {
+    TACFunction   *fn;
+    CFG           *cfg;
+    DefUse        *du;
+    size_t         n;
+
+    SCCPValue     *temps;
+    size_t         temp_count;
+    SCCPValue     *vars;
+    size_t         var_count;
+
+    int           *block_of;      // per instruction
+    int           *edge_target;   // per predecessor slot (cfg->pred positions)
+    unsigned char *edge_run;      // the edge is known to execute
+    unsigned char *visited;       // per block: evaluated at least once
+
+    int           *edges;         // flow worklist of predecessor slots
+    size_t         edge_count;
+    TACOperand    *names;         // SSA worklist of lowered values
+    size_t         name_count;
+} SCCP;
+
+static SCCPValue *value_slot(SCCP *s, TACOperand op) {
+    if (op.type == TAC_OP_TEMP && op.literal >= 0 && (size_t)op.literal < s->temp_count) return &s->temps[op.literal];
+    if (op.type == TAC_OP_VAR && op.sym >= 0 && (size_t)op.sym < s->var_count) return &s->vars[op.sym];
+    return NULL;
+}
+
+// Value of an operand; names the function never defines are varying
+static SCCPValue read(SCCP *s, TACOperand op) {
+    if (op.type == TAC_OP_LITERAL) return sccp_const(op.literal);
+    SCCPValue *slot = value_slot(s, op);
+    size_t defs;
+    if (!slot || (def_use_defs(s->du, op, &defs), defs == 0)) return sccp_bottom;
+    return *slot;
+}
+
+static void lower(SCCP *s, TACOperand op, SCCPValue value) {
+    SCCPValue *slot = value_slot(s, op);
+    if (!slot) return;
+    SCCPValue lowered = meet(*slot, value);
+    if (lowered.state == slot->state && lowered.value == slot->value) return;
+    *slot = lowered;
+    s->names[s->name_count++] = op;
+}
+
+
+/* ---------- Folding ---------- */
+
+// a op b on 32-bit ints; 0 if it must be left to run time
+static int fold_binary(TACBinOp op, int a, int b, int *result) {
+    unsigned ua = (unsigned)a, ub = (unsigned)b;
+    switch (op) {
+        case TAC_ADD: *result = (int)(ua + ub); return 1;
+        case TAC_SUB: *result = (int)(ua - ub); return 1;
+        case TAC_MUL: *result = (int)(ua * ub); return 1;
+        case TAC_DIV:
+        case TAC_MOD:
+            if (b == 0 || (a == INT_MIN && b == -1)) return 0;
+            *result = op == TAC_DIV ? a / b : a % b;
+            return 1;
+        case TAC_EQ:  *result = a == b; return 1;
+        case TAC_NEQ: *result = a != b; return 1;
+        case TAC_LT:  *result = a < b;  return 1;
+        case TAC_LTE: *result = a <= b; return 1;
+        case TAC_GT:  *result = a > b;  return 1;
+        case TAC_GTE: *result = a >= b; return 1;
+        case TAC_AND: *result = a && b; return 1;
+        case TAC_OR:  *result = a || b; return 1;
+        case TAC_SHL: *result = (int)(ua << (ub & 31)); return 1;
+        case TAC_SHR: *result = a >> (ub & 31); return 1;
+    }
+    return 0;
+}
+
+// Whether a constant operand decides op by itself (x * 0, x && 0, x || 1)
+static int absorbs(TACBinOp op, SCCPValue v, int *result) {
+    if (v.state != SCCP_CONST) return 0;
+    if ((op == TAC_MUL || op == TAC_AND) && v.value == 0) { *result = 0; return 1; }
+    if (op == TAC_OR && v.value != 0) { *result = 1; return 1; }
+    return 0;
+}
+
+static SCCPValue eval_binary(TACBinOp op, SCCPValue a, SCCPValue b) {
+    int result;
+    if (absorbs(op, a, &result) || absorbs(op, b, &result)) return sccp_const(result);
+    if (a.state == SCCP_TOP || b.state == SCCP_TOP) return sccp_top;
+    if (a.state == SCCP_BOTTOM || b.state == SCCP_BOTTOM) return sccp_bottom;
+    return fold_binary(op, a.value, b.value, &result) ? sccp_const(result) : sccp_bottom;
+}
+
+static SCCPValue eval_unary(TACUnaryOp op, SCCPValue a) {
+    if (a.state != SCCP_CONST) return a;
+    return sccp_const(op == TAC_NEG ? (int)(0u - (unsigned)a.value) : !a.value);
+}
+
+
+/* ---------- Propagation ---------- */
+
+// Predecessor slot of the edge from -> to: a fall-through edge comes
+// before any jump, so it is the first slot of `from`, a jump the last
+static int edge_slot(const SCCP *s, int from, int to, int fall) {
+    int found = -1;
+    for (int k = s->cfg->pred_start[to]; k < s->cfg->pred_start[to + 1]; k++) {
+        if (s->cfg->pred[k] != from) continue;
+        found = k;
+        if (fall) break;
+    }
+    return found;
+}
+
+static void mark_edge(SCCP *s, int from, int to, int fall) {
+    if (to < 0 || (size_t)to >= s->n) return;
+    int slot = edge_slot(s, from, to, fall);
+    if (slot < 0 || s->edge_run[slot]) return;
+    s->edge_run[slot] = 1;
+    s->edges[s->edge_count++] = slot;
+}
+
+static void mark_jump(SCCP *s, int block, const TACInstr *jump) {
+    mark_edge(s, block, cfg_label_block(s->cfg, tac_jump_target(jump)), 0);
+}
+
+static void mark_branch(SCCP *s, int block, const TACInstr *jump, SCCPValue taken) {
+    if (taken.state == SCCP_TOP) return;
+    if (taken.state == SCCP_BOTTOM || taken.value != 0) mark_jump(s, block, jump);
+    if (taken.state == SCCP_BOTTOM || taken.value == 0) mark_edge(s, block, block + 1, 1);
+}
+
+static SCCPValue eval_phi(SCCP *s, const TACInstr *phi, int block) {
+    const TACOperand *args = tac_phi_args(phi);
+    size_t count = tac_phi_arg_count(phi);
+    int first = s->cfg->pred_start[block];
+    SCCPValue value = sccp_top;
+    for (size_t k = 0; k < count && first + (int)k < s->cfg->pred_start[block + 1]; k++) {
+        if (s->edge_run[first + k]) value = meet(value, read(s, args[k]));
+    }
+    return value;
+}
+
+static void evaluate(SCCP *s, size_t index) {
+    const TACInstr *instr = &s->fn->instrs[index];
+    int block = s->block_of[index];
+    switch (instr->kind) {
+        case TAC_GOTO:
+            mark_jump(s, block, instr);
+            return;
+        case TAC_IFZ: {
+            SCCPValue cond = read(s, instr->arg1);
+            if (cond.state == SCCP_CONST) cond.value = cond.value == 0;
+            mark_branch(s, block, instr, cond);
+            return;
+        }
+        case TAC_IF_CMP:
+            mark_branch(s, block, instr, eval_binary(instr->op.binop, read(s, instr->arg1), read(s, instr->arg2)));
+            return;
+        case TAC_PHI:
+            lower(s, instr->dst, eval_phi(s, instr, block));
+            return;
+        case TAC_BINARY_OP:
+            lower(s, instr->dst, eval_binary(instr->op.binop, read(s, instr->arg1), read(s, instr->arg2)));
+            return;
+        case TAC_UNARY_OP:
+            lower(s, instr->dst, eval_unary(instr->op.unop, read(s, instr->arg1)));
+            return;
+        case TAC_COPY:
+        case TAC_DEFINE:
+            lower(s, instr->dst, read(s, instr->arg1));
+            return;
+        case TAC_SELECT: {
+            SCCPValue cond = read(s, instr->arg1);
+            if (cond.state == SCCP_TOP) return;
+            if (cond.state == SCCP_CONST) {
+                lower(s, instr->dst, read(s, cond.value ? instr->arg2 : instr->arg3));
+            } else {
+                lower(s, instr->dst, meet(read(s, instr->arg2), read(s, instr->arg3)));
+            }
+            return;
+        }
+        default: {
+            const TACOperand *def = tac_def_operand(instr);
+            if (def) lower(s, *def, sccp_bottom);   // calls, pops
+            return;
+        }
+    }
+}
+
+static void visit_block(SCCP *s, int b) {
+    const CFGBlock *block = s->cfg->blocks.items[b];
+    size_t first = (size_t)(block->instructions - s->fn->instrs);
+    if (s->visited[b]) {
+        // only the phis see the new edge
+        for (size_t i = 0; i < block->count; i++) {
+            if (block->instructions[i].kind == TAC_PHI) evaluate(s, first + i);
+        }
+        return;
+    }
+    s->visited[b] = 1;
+    for (size_t i = 0; i < block->count; i++) evaluate(s, first + i);
+    TACOpKind last = block->count ? block->instructions[block->count - 1].kind : TAC_LABEL;
+    if (last != TAC_GOTO && last != TAC_IFZ && last != TAC_IF_CMP &&
+        last != TAC_RETURN && last != TAC_END_FUNCTION) {
+        mark_edge(s, b, b + 1, 1);
+    }
+}
+
+static void propagate(SCCP *s) {
+    visit_block(s, 0);
+    while (s->edge_count > 0 || s->name_count > 0) {
+        if (s->edge_count > 0) {
+            visit_block(s, s->edge_target[s->edges[--s->edge_count]]);
+            continue;
+        }
+        TACOperand name = s->names[--s->name_count];
+        size_t count;
+        const DefUseSite *uses = def_use_uses(s->du, name, &count);
+        for (size_t u = 0; u < count; u++) {
+            if (s->visited[s->block_of[uses[u].instr]]) evaluate(s, (size_t)uses[u].instr);
+        }
+    }
+}
+
+
+/* ---------- Rewriting ---------- */
+
+static void replace_constants(SCCP *s, SCCPStats *stats) {
+    for (size_t t = 0; t < s->temp_count; t++) {
+        if (s->temps[t].state != SCCP_CONST) continue;
+        def_use_replace_uses(s->du, s->fn, tac_temp((int)t), tac_literal(s->temps[t].value));
+        stats->constants++;
+    }
+    for (size_t v = 0; v < s->var_count; v++) {
+        if (s->vars[v].state != SCCP_CONST) continue;
+        TACOperand var = { .type = TAC_OP_VAR, .sym = (int)v };
+        def_use_replace_uses(s->du, s->fn, var, tac_literal(s->vars[v].value));
+        stats->constants++;
+    }
+}
+
+// A conditional jump that runs one way only becomes a goto, or goes away.
+// When it is all there is between another conditional jump and a label,
+// its block would vanish and leave two edges between the same blocks;
+// it becomes a dead copy instead, which ssa_simplify keeps for the same reason.
+static void decide_branch(SCCP *s, int b, size_t index, SCCPStats *stats) {
+    TACFunction *fn = s->fn;
+    TACInstr *jump = &fn->instrs[index];
+    int target = cfg_label_block(s->cfg, tac_jump_target(jump));
+    int jump_slot = target >= 0 ? edge_slot(s, b, target, 0) : -1;
+    int fall_slot = (size_t)b + 1 < s->n ? edge_slot(s, b, b + 1, 1) : -1;
+    int jumps = jump_slot >= 0 && s->edge_run[jump_slot];
+    int falls = fall_slot >= 0 && s->edge_run[fall_slot];
+    if (jumps == falls) return;
+
+    stats->branches++;
+    if (jumps) {
+        int label = tac_jump_target(jump);
+        def_use_unlink(s->du, fn, index);
+        TACInstr jump_instr = { .kind = TAC_GOTO, .arg1 = tac_label(label) };
+        *jump = jump_instr;
+        def_use_link(s->du, fn, index);
+        return;
+    }
+    TACOpKind before = index > 0 ? fn->instrs[index - 1].kind : TAC_LABEL;
+    int alone = (before == TAC_IFZ || before == TAC_IF_CMP) &&
+                index + 1 < fn->count && fn->instrs[index + 1].kind == TAC_LABEL;
+    if (!alone) {
+        def_use_delete(s->du, fn, index);
+        return;
+    }
+    def_use_unlink(s->du, fn, index);
+    TACInstr placeholder = { .kind = TAC_COPY, .dst = tac_temp(tac_function_new_temp(fn)), .arg1 = tac_literal(0) };
+    fn->instrs[index] = placeholder;
+    def_use_link(s->du, fn, index);
+}
+
+// A select on a constant is a copy of the arm it picks
+static void decide_select(SCCP *s, size_t index) {
+    TACInstr *select = &s->fn->instrs[index];
+    if (select->arg1.type != TAC_OP_LITERAL) return;
+    def_use_unlink(s->du, s->fn, index);
+    TACInstr copy = { .kind = TAC_COPY, .dst = select->dst };
+    copy.arg1 = select->arg1.literal ? select->arg2 : select->arg3;
+    *select = copy;
+    def_use_link(s->du, s->fn, index);
+}
+
+// Drops the arguments of edges that never run; one left makes a copy
+static void prune_phi(SCCP *s, int b, size_t index) {
+    TACFunction *fn = s->fn;
+    TACInstr *phi = &fn->instrs[index];
+    size_t count = tac_phi_arg_count(phi), kept = 0;
+    int first = s->cfg->pred_start[b];
+    TACOperand *args = xcalloc(count, sizeof(TACOperand));
+    for (size_t k = 0; k < count; k++) {
+        if (s->edge_run[first + k]) args[kept++] = tac_phi_args(phi)[k];
+    }
+    if (kept == count || kept == 0) {
+        free(args);
+        return;
+    }
+
+    def_use_unlink(s->du, fn, index);
+    if (kept == 1) {
+        phi->kind = TAC_COPY;
+        phi->arg1 = args[0];
+        phi->arg2 = TAC_NONE;
+    } else {
+        int start = tac_phi_alloc(kept);
+        phi->arg1 = tac_literal(start);
+        phi->arg2 = tac_literal((int)kept);
+        TACOperand *pooled = tac_phi_args(phi);
+        for (size_t k = 0; k < kept; k++) pooled[k] = args[k];
+    }
+    def_use_link(s->du, fn, index);
+    free(args);
+}
+
+static void rewrite(SCCP *s, SCCPStats *stats) {
+    replace_constants(s, stats);
+    for (size_t b = 0; b < s->n; b++) {
+        const CFGBlock *block = s->cfg->blocks.items[b];
+        size_t first = (size_t)(block->instructions - s->fn->instrs);
+        if (!s->visited[b]) {
+            size_t deleted = 0;
+            for (size_t i = 0; i < block->count; i++) {
+                if (block->instructions[i].kind == TAC_END_FUNCTION) continue;
+                def_use_delete(s->du, s->fn, first + i);
+                deleted++;
+            }
+            if (deleted > 0) stats->blocks++;
+            continue;
+        }
+        for (size_t i = 0; i < block->count; i++) {
+            TACOpKind kind = s->fn->instrs[first + i].kind;
+            if (kind == TAC_PHI) prune_phi(s, (int)b, first + i);
+            else if (kind == TAC_SELECT) decide_select(s, first + i);
+            else if (kind == TAC_IFZ || kind == TAC_IF_CMP) decide_branch(s, (int)b, first + i, stats);
+        }
+    }
+}
+
+
+void sccp(TACFunction *fn, SCCPStats *stats) {
+    if (fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION) return;
+
+    SCCP s = {0};
+    s.fn = fn;
+    s.cfg = build_from_tac(fn);
+    if (!s.cfg) return;
+    s.du = def_use_build(fn);
+    s.n = s.cfg->blocks.count;
+    s.temp_count = fn->temp_count > 0 ? (size_t)fn->temp_count : 0;
+    s.var_count = intern_count();
+    s.temps = xcalloc(s.temp_count, sizeof(SCCPValue));
+    s.vars = xcalloc(s.var_count, sizeof(SCCPValue));
+
+    s.block_of = xcalloc(fn->count, sizeof(int));
+    for (size_t b = 0; b < s.n; b++) {
+        const CFGBlock *block = s.cfg->blocks.items[b];
+        size_t first = (size_t)(block->instructions - fn->instrs);
+        for (size_t i = 0; i < block->count; i++) s.block_of[first + i] = (int)b;
+    }
+    s.edge_target = xcalloc(s.cfg->edge_count, sizeof(int));
+    for (size_t b = 0; b < s.n; b++) {
+        for (int k = s.cfg->pred_start[b]; k < s.cfg->pred_start[b + 1]; k++) s.edge_target[k] = (int)b;
+    }
+    s.edge_run = xcalloc(s.cfg->edge_count, 1);
+    s.visited = xcalloc(s.n, 1);
+    s.edges = xcalloc(s.cfg->edge_count, sizeof(int));
+    // a value is lowered at most twice (to a constant, then to varying)
+    s.names = xcalloc(2 * (s.temp_count + s.var_count), sizeof(TACOperand));
+
+    // 1) Find the constants and the edges that can run
+    propagate(&s);
+
+    // 2) Use them
+    SCCPStats counts = {0};
+    rewrite(&s, &counts);
+    def_use_compact(s.du, fn);
+
+    if (stats) {
+        stats->constants += counts.constants;
+        stats->branches += counts.branches;
+        stats->blocks += counts.blocks;
+    }
+    def_use_free(s.du);
+    free_cfg(s.cfg);
+    free(s.cfg);
+    free(s.temps);
+    free(s.vars);
+    free(s.block_of);
+    free(s.edge_target);
+    free(s.edge_run);
+    free(s.visited);
+    free(s.edges);
+    free(s.names);
+}
+
+void sccp_program(TACProgram *program, SCCPStats *stats) {
+    for (size_t i = 0; i < program->count; i++) sccp(&program->functions[i], stats);
+}
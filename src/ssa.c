@@ -0,0 +1,880 @@
+#include "ssa.h"
+#include "cfg_builder.h"
+#include "dominance.h"
+#include "intern.h"
+#include "liveness.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int has_header(const TACFunction *fn) {
+    return fn->count > 0 && fn->instrs[0].kind == TAC_FUNCTION;
+}
+
+static int has_phis(const TACFunction *fn) {
+    for (size_t i = 0; i < fn->count; i++) {
+        if (fn->instrs[i].kind == TAC_PHI) return 1;
+    }
+    return 0;
+}
+
+static const TACOperand *use_operand(const TACInstr *instr, unsigned use) {
+    return use == TAC_USE_ARG1 ? &instr->arg1 : use == TAC_USE_ARG2 ? &instr->arg2 : &instr->arg3;
+}
+
+
+/* ---------- Construction ---------- */
+
+// Saved name of a value, restored when the renaming walk leaves the
+// dominator subtree that redefined it
+typedef struct {
+    int        fact;
+    TACOperand previous;
+} RenameUndo;
+
+typedef struct {
+    TACFunction     *fn;
+    const Liveness  *lv;
+    size_t           facts;
+
+    unsigned char   *defined;     // fact has a definition in the function
+    unsigned char   *first_taken; // the original name is already in use
+    int             *version;     // last N handed out as "name.N"
+    TACOperand      *current;     // reaching name per fact, NONE if undefined
+
+    RenameUndo      *undo;
+    size_t           undo_count;
+    size_t           undo_capacity;
+} SSARename;
+
+static TACOperand fact_operand(const Liveness *lv, size_t fact) {
+    if (fact < lv->temp_count) return tac_temp((int)fact);
+    return (TACOperand){ .type = TAC_OP_VAR, .sym = lv->slot_sym[fact - lv->temp_count] };
+}
+
+static TACOperand fresh_name(SSARename *r, size_t fact) {
+    TACOperand original = fact_operand(r->lv, fact);
+    if (!r->first_taken[fact]) {
+        r->first_taken[fact] = 1;
+        return original;
+    }
+    if (original.type == TAC_OP_TEMP) return tac_temp(tac_function_new_temp(r->fn));
+
+    // "name.N", skipping names the function already uses
+    const char *base = interned_name(original.sym);
+    size_t len = strlen(base) + 16;
+    char *buf = xcalloc(len, 1);
+    int sym;
+    do {
+        snprintf(buf, len, "%s.%d", base, ++r->version[fact]);
+        sym = intern(buf);
+    } while ((size_t)sym < r->lv->sym_count && r->lv->sym_slot[sym] >= 0);
+    free(buf);
+    return (TACOperand){ .type = TAC_OP_VAR, .sym = sym };
+}
+
+static void push_name(SSARename *r, size_t fact, TACOperand name) {
+    if (r->undo_count >= r->undo_capacity) {
+        r->undo_capacity = r->undo_capacity ? r->undo_capacity * 2 : 64;
+        r->undo = realloc(r->undo, r->undo_capacity * sizeof(RenameUndo));
+        if (!r->undo) {
+            printf("Memory allocation failed for SSA form.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    r->undo[r->undo_count++] = (RenameUndo){ (int)fact, r->current[fact] };
+    r->current[fact] = name;
+}
+
+static TACOperand reaching_name(const SSARename *r, size_t fact) {
+    return r->current[fact].type != TAC_OP_NONE ? r->current[fact] : tac_literal(0);
+}
+
+void ssa_construct(TACFunction *fn) {
+    if (!has_header(fn) || has_phis(fn)) return;
+
+    CFG *cfg = build_from_tac(fn);
+    if (!cfg) return;
+    DomTree *dom = dom_compute(cfg);
+    Liveness *lv = liveness_compute(fn, cfg, dom);
+    size_t n = cfg->blocks.count;
+    size_t facts = lv->temp_count + lv->slot_count;
+
+    SSARename r = { .fn = fn, .lv = lv, .facts = facts };
+    r.defined = xcalloc(facts, 1);
+    r.first_taken = xcalloc(facts, 1);
+    r.version = xcalloc(facts, sizeof(int));
+    r.current = xcalloc(facts, sizeof(TACOperand));
+
+    // 1) Blocks defining each fact, as (fact, block) pairs in CSR form
+    CFGEdgeArray def_pairs = {0};
+    for (size_t b = 0; b < n; b++) {
+        const CFGBlock *block = cfg->blocks.items[b];
+        if (dom->rpo_index[b] < 0) continue;
+        for (size_t i = 0; i < block->count; i++) {
+            const TACOperand *def = tac_def_operand(&block->instructions[i]);
+            int fact = def ? liveness_index(lv, *def) : -1;
+            if (fact < 0) continue;
+            r.defined[fact] = 1;
+            push_edge(&def_pairs, fact, (int)b);
+        }
+    }
+    int *def_start, *def_blocks;
+    cfg_pairs_to_csr(facts, def_pairs.items, def_pairs.count, 0, &def_start, &def_blocks);
+    free(def_pairs.items);
+
+    // 2) Phis on the iterated dominance frontier, kept only where the
+    //    value is live on entry (the frontier is still followed through
+    //    blocks that get no phi)
+    CFGEdgeArray phi_pairs = {0};          // (block, fact)
+    int *has_phi = xcalloc(n, sizeof(int));
+    int *queued = xcalloc(n, sizeof(int));
+    int *worklist = xcalloc(n, sizeof(int));
+    for (size_t b = 0; b < n; b++) has_phi[b] = queued[b] = -1;
+    for (size_t f = 0; f < facts; f++) {
+        size_t pending = 0;
+        for (int k = def_start[f]; k < def_start[f + 1]; k++) {
+            int b = def_blocks[k];
+            if (queued[b] == (int)f) continue;
+            queued[b] = (int)f;
+            worklist[pending++] = b;
+        }
+        while (pending > 0) {
+            int b = worklist[--pending];
+            size_t count;
+            const int *df = dom_frontier(dom, b, &count);
+            for (size_t k = 0; k < count; k++) {
+                int y = df[k];
+                if (has_phi[y] == (int)f) continue;
+                has_phi[y] = (int)f;
+                if (bitset_test(bitmatrix_row(&lv->live_in, (size_t)y), f)) push_edge(&phi_pairs, y, (int)f);
+                if (queued[y] != (int)f) {
+                    queued[y] = (int)f;
+                    worklist[pending++] = y;
+                }
+            }
+        }
+    }
+    free(has_phi);
+    free(queued);
+    free(def_start);
+    free(def_blocks);
+
+    int *phi_start, *phi_fact;
+    cfg_pairs_to_csr(n, phi_pairs.items, phi_pairs.count, 0, &phi_start, &phi_fact);
+    size_t phi_count = phi_pairs.count;
+    free(phi_pairs.items);
+
+    // 3) Each phi gets one argument per reachable predecessor. pred_slot
+    //    maps a predecessor list position to its argument, or -1
+    int *pred_slot = xcalloc(cfg->edge_count, sizeof(int));
+    int *slot_block = xcalloc(cfg->edge_count, sizeof(int));
+    CFGEdge *slot_pairs = xcalloc(cfg->edge_count, sizeof(CFGEdge));
+    int *arg_count = xcalloc(n, sizeof(int));
+    for (size_t s = 0; s < n; s++) {
+        for (int g = cfg->pred_start[s]; g < cfg->pred_start[s + 1]; g++) {
+            int p = cfg->pred[g];
+            pred_slot[g] = dom->rpo_index[p] >= 0 ? arg_count[s]++ : -1;
+            slot_block[g] = (int)s;
+            slot_pairs[g] = (CFGEdge){ p, g };
+        }
+    }
+    int *out_start, *out_slots;            // the predecessor positions each block fills
+    cfg_pairs_to_csr(n, slot_pairs, cfg->edge_count, 0, &out_start, &out_slots);
+    free(slot_pairs);
+
+    TACInstr *phis = xcalloc(phi_count, sizeof(TACInstr));
+    for (size_t b = 0; b < n; b++) {
+        for (int k = phi_start[b]; k < phi_start[b + 1]; k++) {
+            phis[k].kind = TAC_PHI;
+            phis[k].arg1 = tac_literal(tac_phi_alloc((size_t)arg_count[b]));
+            phis[k].arg2 = tac_literal(arg_count[b]);
+        }
+    }
+    for (size_t k = 0; k < phi_count; k++) {
+        TACOperand *args = tac_phi_args(&phis[k]);
+        for (size_t j = 0; j < tac_phi_arg_count(&phis[k]); j++) args[j] = tac_literal(0);
+    }
+
+    // 4) Rename in dominator tree preorder; ~b on the stack marks leaving b
+    int *stack = xcalloc(2 * n + 1, sizeof(int));
+    size_t *undo_mark = xcalloc(n, sizeof(size_t));
+    size_t depth = 0;
+    if (dom->rpo_count > 0) stack[depth++] = dom->rpo[0];
+    while (depth > 0) {
+        int b = stack[--depth];
+        if (b < 0) {
+            b = ~b;
+            while (r.undo_count > undo_mark[b]) {
+                RenameUndo undo = r.undo[--r.undo_count];
+                r.current[undo.fact] = undo.previous;
+            }
+            continue;
+        }
+        undo_mark[b] = r.undo_count;
+
+        for (int k = phi_start[b]; k < phi_start[b + 1]; k++) {
+            phis[k].dst = fresh_name(&r, (size_t)phi_fact[k]);
+            push_name(&r, (size_t)phi_fact[k], phis[k].dst);
+        }
+        CFGBlock *block = cfg->blocks.items[b];
+        for (size_t i = 0; i < block->count; i++) {
+            TACInstr *instr = &block->instructions[i];
+            unsigned uses = tac_use_mask(instr);
+            for (unsigned use = TAC_USE_ARG1; use <= TAC_USE_ARG3; use <<= 1) {
+                TACOperand *op = (TACOperand *)use_operand(instr, use);
+                int fact = (uses & use) ? liveness_index(lv, *op) : -1;
+                if (fact >= 0 && r.defined[fact]) *op = reaching_name(&r, (size_t)fact);
+            }
+            TACOperand *def = (TACOperand *)tac_def_operand(instr);
+            int fact = def ? liveness_index(lv, *def) : -1;
+            if (fact < 0) continue;
+            *def = fresh_name(&r, (size_t)fact);
+            push_name(&r, (size_t)fact, *def);
+        }
+        for (int k = out_start[b]; k < out_start[b + 1]; k++) {
+            int g = out_slots[k], s = slot_block[g];
+            for (int p = phi_start[s]; p < phi_start[s + 1]; p++) {
+                tac_phi_args(&phis[p])[pred_slot[g]] = reaching_name(&r, (size_t)phi_fact[p]);
+            }
+        }
+
+        stack[depth++] = ~b;
+        size_t child_count;
+        const int *children = dom_children(dom, b, &child_count);
+        for (size_t k = child_count; k-- > 0; ) stack[depth++] = children[k];
+    }
+    free(stack);
+    free(undo_mark);
+
+    // 5) Rebuild: phis go after each block's label; of unreachable blocks
+    //    only the end of the function survives
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    for (size_t b = 0; b < n; b++) {
+        const CFGBlock *block = cfg->blocks.items[b];
+        size_t i = 0;
+        if (dom->rpo_index[b] < 0) {
+            for (; i < block->count; i++) {
+                if (block->instructions[i].kind == TAC_END_FUNCTION) tac_function_push(&out, block->instructions[i]);
+            }
+            continue;
+        }
+        if (block->count > 0 && block->instructions[0].kind == TAC_LABEL) {
+            tac_function_push(&out, block->instructions[i++]);
+        }
+        for (int k = phi_start[b]; k < phi_start[b + 1]; k++) tac_function_push(&out, phis[k]);
+        for (; i < block->count; i++) tac_function_push(&out, block->instructions[i]);
+    }
+    tac_function_sync_header(&out);
+
+    free(phis);
+    free(phi_start);
+    free(phi_fact);
+    free(pred_slot);
+    free(slot_block);
+    free(out_start);
+    free(out_slots);
+    free(arg_count);
+    free(worklist);
+    free(r.defined);
+    free(r.first_taken);
+    free(r.version);
+    free(r.current);
+    free(r.undo);
+    liveness_free(lv);
+    dom_free(dom);
+    free_cfg(cfg);
+    free(cfg);
+
+    tac_function_free(fn);
+    *fn = out;
+}
+
+void ssa_construct_program(TACProgram *program) {
+    for (size_t i = 0; i < program->count; i++) ssa_construct(&program->functions[i]);
+}
+
+
+/* ---------- Destruction ---------- */
+
+typedef struct {
+    TACInstr *items;
+    size_t count;
+    size_t capacity;
+} CopyList;
+
+static void push_instr(CopyList *list, TACInstr instr) {
+    if (list->count >= list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : 4;
+        TACInstr *new_items = realloc(list->items, new_capacity * sizeof(TACInstr));
+        if (!new_items) {
+            printf("Memory allocation failed for SSA copies.\n");
+            exit(EXIT_FAILURE);
+        }
+        list->items = new_items;
+        list->capacity = new_capacity;
+    }
+    list->items[list->count++] = instr;
+}
+
+static void push_copy(CopyList *list, TACOperand dst, TACOperand src) {
+    TACInstr copy = {0};
+    copy.kind = TAC_COPY;
+    copy.dst = dst;
+    copy.arg1 = src;
+    push_instr(list, copy);
+}
+
+// Orders the parallel copy dst[k] ← src[k] (all dst distinct): a copy may
+// run once no other pending copy still reads its destination; when only
+// cycles are left, one destination is saved to a temp first
+static void sequentialize(TACFunction *fn, const TACOperand *dst, TACOperand *src,
+                          size_t count, CopyList *out) {
+    unsigned char *done = xcalloc(count, 1);
+    size_t left = 0;
+    for (size_t k = 0; k < count; k++) {
+        done[k] = src[k].type == TAC_OP_NONE || tac_operand_equal(dst[k], src[k]);
+        if (!done[k]) left++;
+    }
+    while (left > 0) {
+        int progress = 0;
+        for (size_t k = 0; k < count; k++) {
+            if (done[k]) continue;
+            int blocked = 0;
+            for (size_t m = 0; m < count && !blocked; m++) {
+                blocked = m != k && !done[m] && tac_operand_equal(src[m], dst[k]);
+            }
+            if (blocked) continue;
+            push_copy(out, dst[k], src[k]);
+            done[k] = 1;
+            left--;
+            progress = 1;
+        }
+        if (progress || left == 0) continue;
+
+        size_t k = 0;
+        while (done[k]) k++;
+        TACOperand saved = tac_temp(tac_function_new_temp(fn));
+        push_copy(out, saved, dst[k]);
+        for (size_t m = 0; m < count; m++) {
+            if (!done[m] && tac_operand_equal(src[m], dst[k])) src[m] = saved;
+        }
+    }
+    free(done);
+}
+
+// The copies a block's phis need on the edge from predecessor slot j
+static void edge_copies(TACFunction *fn, const CFGBlock *block, size_t j, CopyList *out) {
+    size_t first = block->count > 0 && block->instructions[0].kind == TAC_LABEL ? 1 : 0;
+    size_t count = 0;
+    while (first + count < block->count && block->instructions[first + count].kind == TAC_PHI) count++;
+
+    TACOperand *dst = xcalloc(count, sizeof(TACOperand));
+    TACOperand *src = xcalloc(count, sizeof(TACOperand));
+    for (size_t k = 0; k < count; k++) {
+        const TACInstr *phi = &block->instructions[first + k];
+        dst[k] = phi->dst;
+        src[k] = j < tac_phi_arg_count(phi) ? tac_phi_args(phi)[j] : TAC_NONE;
+    }
+    sequentialize(fn, dst, src, count, out);
+    free(dst);
+    free(src);
+}
+
+static int block_has_phis(const CFGBlock *block) {
+    size_t first = block->count > 0 && block->instructions[0].kind == TAC_LABEL ? 1 : 0;
+    return first < block->count && block->instructions[first].kind == TAC_PHI;
+}
+
+/* ---------- Coalescing ---------- */
+
+#define SSA_FAMILY_MAX 64     // versions of one variable considered together
+
+// Name a variable had before renaming ("x" of "x.2")
+static int base_sym(int sym) {
+    const char *name = interned_name(sym);
+    const char *dot = strchr(name, '.');
+    return dot ? intern_n(name, (size_t)(dot - name)) : sym;
+}
+
+// Versions of one variable, each with the members it overlaps
+typedef struct {
+    int      members[SSA_FAMILY_MAX];    // facts, the original name first
+    uint64_t conflicts[SSA_FAMILY_MAX];
+    int      count;
+} SSAFamily;
+
+// One round: versions of a variable that never hold different live values
+// at the same time share a name again (a greedy colouring of their
+// overlaps, the original name first); copies between temps are merged
+// pairwise. Copies that became x ← x are dropped. Returns the number of
+// names merged; the caller repeats until there are none.
+static size_t coalesce_round(TACFunction *fn) {
+    CFG *cfg = build_from_tac(fn);
+    if (!cfg) return 0;
+    DomTree *dom = dom_compute(cfg);
+    Liveness *lv = liveness_compute(fn, cfg, dom);
+    size_t n = cfg->blocks.count;
+    size_t facts = lv->temp_count + lv->slot_count;
+
+    // 1) Families of the variables the function writes
+    int *family_of = xcalloc(facts, sizeof(int));
+    int *member_of = xcalloc(facts, sizeof(int));
+    for (size_t f = 0; f < facts; f++) family_of[f] = -1;
+    int *by_base = NULL;
+    SSAFamily *families = xcalloc(lv->slot_count, sizeof(SSAFamily));
+    size_t family_count = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        // the original names first, so they lead their family
+        for (size_t slot = 0; slot < lv->slot_count; slot++) {
+            size_t fact = lv->temp_count + slot;
+            int sym = lv->slot_sym[slot];
+            if (bitset_test(lv->shared, fact) || (base_sym(sym) == sym) != (pass == 0)) continue;
+            int base = base_sym(sym);
+            if (!by_base) {
+                by_base = xcalloc(intern_count(), sizeof(int));
+                for (size_t k = 0; k < intern_count(); k++) by_base[k] = -1;
+            }
+            if (by_base[base] < 0) by_base[base] = (int)family_count++;
+            SSAFamily *family = &families[by_base[base]];
+            if (family->count >= SSA_FAMILY_MAX) continue;
+            family_of[fact] = by_base[base];
+            member_of[fact] = family->count;
+            family->members[family->count++] = (int)fact;
+        }
+    }
+    free(by_base);
+
+    // 2) Copies between temps, indexed by both of their facts
+    CFGEdgeArray pairs = {0};
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACInstr *instr = &fn->instrs[i];
+        if (instr->kind != TAC_COPY || instr->dst.type != TAC_OP_TEMP || instr->arg1.type != TAC_OP_TEMP) continue;
+        int a = liveness_index(lv, instr->dst), b = liveness_index(lv, instr->arg1);
+        if (a < 0 || b < 0 || a == b) continue;
+        push_edge(&pairs, a, b);
+    }
+    CFGEdge *by_fact = xcalloc(2 * pairs.count, sizeof(CFGEdge));
+    for (size_t k = 0; k < pairs.count; k++) {
+        by_fact[2 * k] = (CFGEdge){ pairs.items[k].from, (int)k };
+        by_fact[2 * k + 1] = (CFGEdge){ pairs.items[k].to, (int)k };
+    }
+    int *pair_start, *pair_list;
+    cfg_pairs_to_csr(facts, by_fact, 2 * pairs.count, 0, &pair_start, &pair_list);
+    free(by_fact);
+
+    // 3) Two values overlap if one is defined while the other is live,
+    //    unless the definition copies the other
+    unsigned char *interferes = xcalloc(pairs.count, 1);
+    uint64_t *live = xcalloc(lv->live_out.words, sizeof(uint64_t));
+    for (size_t b = 0; b < n; b++) {
+        const CFGBlock *block = cfg->blocks.items[b];
+        if (dom->rpo_index[b] < 0) continue;
+        bitset_copy(live, bitmatrix_row(&lv->live_out, b), lv->live_out.words);
+        for (size_t i = block->count; i-- > 0; ) {
+            const TACInstr *instr = &block->instructions[i];
+            const TACOperand *def = tac_def_operand(instr);
+            int d = def ? liveness_index(lv, *def) : -1;
+            int copied = instr->kind == TAC_COPY ? liveness_index(lv, instr->arg1) : -1;
+            if (d >= 0 && family_of[d] >= 0) {
+                SSAFamily *family = &families[family_of[d]];
+                for (int m = 0; m < family->count; m++) {
+                    int other = family->members[m];
+                    if (other == d || other == copied || !bitset_test(live, (size_t)other)) continue;
+                    family->conflicts[member_of[d]] |= (uint64_t)1 << m;
+                    family->conflicts[m] |= (uint64_t)1 << member_of[d];
+                }
+            }
+            for (int k = d >= 0 ? pair_start[d] : 0; d >= 0 && k < pair_start[d + 1]; k++) {
+                const CFGEdge *pair = &pairs.items[pair_list[k]];
+                int other = pair->from == d ? pair->to : pair->from;
+                if (other != copied && bitset_test(live, (size_t)other)) interferes[pair_list[k]] = 1;
+            }
+            liveness_step(lv, instr, live);
+        }
+    }
+    free(live);
+
+    // 4) Pick the new names
+    TACOperand *rename = xcalloc(facts, sizeof(TACOperand));
+    size_t merged = 0;
+    for (size_t f = 0; f < family_count; f++) {
+        SSAFamily *family = &families[f];
+        uint64_t class_members[SSA_FAMILY_MAX];
+        int class_leader[SSA_FAMILY_MAX];
+        int classes = 0;
+        for (int m = 0; m < family->count; m++) {
+            int c = 0;
+            while (c < classes && (family->conflicts[m] & class_members[c])) c++;
+            if (c == classes) {
+                class_members[classes] = 0;
+                class_leader[classes++] = family->members[m];
+            } else {
+                rename[family->members[m]] = fact_operand(lv, (size_t)class_leader[c]);
+                merged++;
+            }
+            class_members[c] |= (uint64_t)1 << m;
+        }
+
+        // The original name's own definitions were optimised away: the
+        // first class takes the name back
+        int sym = lv->slot_sym[(size_t)family->members[0] - lv->temp_count];
+        int base = base_sym(sym);
+        if (base != sym && ((size_t)base >= lv->sym_count || lv->sym_slot[base] < 0)) {
+            TACOperand name = { .type = TAC_OP_VAR, .sym = base };
+            for (int m = 0; m < family->count; m++) {
+                if (class_members[0] & ((uint64_t)1 << m)) rename[family->members[m]] = name;
+            }
+            merged++;
+        }
+    }
+    unsigned char *touched = xcalloc(facts, 1);
+    for (size_t k = 0; k < pairs.count; k++) {
+        int a = pairs.items[k].from, b = pairs.items[k].to;
+        if (interferes[k] || touched[a] || touched[b]) continue;
+        touched[a] = touched[b] = 1;
+        if (a < b) rename[b] = tac_temp(a);
+        else rename[a] = tac_temp(b);
+        merged++;
+    }
+
+    // 5) Rename and remove self copies
+    TACFunction out = {0};
+    if (merged > 0) {
+        out.temp_count = fn->temp_count;
+        out.label_count = fn->label_count;
+        for (size_t i = 0; i < fn->count; i++) {
+            TACInstr instr = fn->instrs[i];
+            TACOperand *ops[4] = { &instr.dst, &instr.arg1, &instr.arg2, &instr.arg3 };
+            for (int k = 0; k < 4; k++) {
+                if (ops[k]->type != TAC_OP_TEMP && ops[k]->type != TAC_OP_VAR) continue;
+                if (instr.kind == TAC_CALL && k == 1) continue;   // the callee's name
+                int fact = liveness_index(lv, *ops[k]);
+                if (fact >= 0 && rename[fact].type != TAC_OP_NONE) *ops[k] = rename[fact];
+            }
+            if (instr.kind == TAC_COPY && tac_operand_equal(instr.dst, instr.arg1)) continue;
+            tac_function_push(&out, instr);
+        }
+    }
+
+    free(rename);
+    free(touched);
+    free(interferes);
+    free(pairs.items);
+    free(pair_start);
+    free(pair_list);
+    free(families);
+    free(family_of);
+    free(member_of);
+    liveness_free(lv);
+    dom_free(dom);
+    free_cfg(cfg);
+    free(cfg);
+
+    if (merged > 0) {
+        tac_function_free(fn);
+        *fn = out;
+    }
+    return merged;
+}
+
+// Split blocks whose copies were all coalesced away are just "L: goto M";
+// jumps to L go straight to M, and a goto to the very next label goes too
+static void drop_empty_splits(TACFunction *fn, int first_split) {
+    size_t labels = fn->label_count > 0 ? (size_t)fn->label_count : 0;
+    int *forward = xcalloc(labels, sizeof(int));
+    for (size_t l = 0; l < labels; l++) forward[l] = -1;
+    for (size_t i = 0; i + 1 < fn->count; i++) {
+        const TACInstr *instr = &fn->instrs[i];
+        if (instr->kind == TAC_LABEL && instr->dst.literal >= first_split && fn->instrs[i + 1].kind == TAC_GOTO)
+            forward[instr->dst.literal] = tac_jump_target(&fn->instrs[i + 1]);
+    }
+
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    for (size_t i = 0; i < fn->count; i++) {
+        TACInstr instr = fn->instrs[i];
+        if (instr.kind == TAC_LABEL && forward[instr.dst.literal] >= 0) {
+            i++;                                  // and its goto
+            continue;
+        }
+        int target = tac_jump_target(&instr);
+        if (target >= 0 && forward[target] >= 0) tac_set_jump_target(&instr, forward[target]);
+        tac_function_push(&out, instr);
+    }
+    free(forward);
+
+    TACFunction tidy = {0};
+    tidy.temp_count = out.temp_count;
+    tidy.label_count = out.label_count;
+    for (size_t i = 0; i < out.count; i++) {
+        const TACInstr *instr = &out.instrs[i];
+        if (instr->kind == TAC_GOTO && i + 1 < out.count && out.instrs[i + 1].kind == TAC_LABEL &&
+            out.instrs[i + 1].dst.literal == tac_jump_target(instr)) continue;
+        tac_function_push(&tidy, *instr);
+    }
+    tac_function_free(&out);
+    tac_function_free(fn);
+    *fn = tidy;
+}
+
+static void lower_phis(TACFunction *fn) {
+    CFG *cfg = build_from_tac(fn);
+    if (!cfg) return;
+    size_t n = cfg->blocks.count;
+
+    // 1) Where each edge's copies go: before a predecessor's closing goto
+    //    or at its end (inline), after its conditional jump when the phi
+    //    block is next (fall-through), or into a new block the jump is
+    //    retargeted to (split)
+    CopyList *inline_copies = xcalloc(n, sizeof(CopyList));
+    int *retarget = xcalloc(n, sizeof(int));
+    CopyList splits = {0};
+    for (size_t b = 0; b < n; b++) retarget[b] = -1;
+
+    for (size_t s = 0; s < n; s++) {
+        const CFGBlock *block = cfg->blocks.items[s];
+        if (!block_has_phis(block)) continue;
+        int label = block->instructions[0].kind == TAC_LABEL ? block->instructions[0].dst.literal : -1;
+
+        size_t pred_count;
+        const int *pred = cfg_predecessors(cfg, (int)s, &pred_count);
+        for (size_t j = 0; j < pred_count; j++) {
+            int p = pred[j];
+            // A predecessor listed twice (jump and fall-through into the
+            // same block) carries the same values on both edges
+            int seen = 0;
+            for (size_t k = 0; k < j && !seen; k++) seen = pred[k] == p;
+            if (seen) continue;
+
+            const CFGBlock *from = cfg->blocks.items[p];
+            TACInstr *last = &from->instructions[from->count - 1];
+            int conditional = last->kind == TAC_IFZ || last->kind == TAC_IF_CMP;
+            if (!conditional) {
+                edge_copies(fn, block, j, &inline_copies[p]);
+                continue;
+            }
+            if (label >= 0 && tac_jump_target(last) == label) {
+                int split = tac_function_new_label(fn);
+                retarget[p] = split;
+                TACInstr head = {0};
+                head.kind = TAC_LABEL;
+                head.dst = tac_label(split);
+                push_instr(&splits, head);
+                edge_copies(fn, block, j, &splits);
+                TACInstr jump = {0};
+                jump.kind = TAC_GOTO;
+                jump.arg1 = tac_label(label);
+                push_instr(&splits, jump);
+            }
+            if ((size_t)p + 1 == s) edge_copies(fn, block, j, &inline_copies[p]);
+        }
+    }
+
+    // 2) Rebuild without phis; split blocks go in front of the block
+    //    holding endfun, which the code before them then has to jump to
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    for (size_t b = 0; b < n; b++) {
+        const CFGBlock *block = cfg->blocks.items[b];
+        const TACInstr *last = &block->instructions[block->count - 1];
+        int exit_label = -1;
+
+        if (b + 1 == n && splits.count > 0) {
+            const TACInstr *prev = out.count > 0 ? &out.instrs[out.count - 1] : NULL;
+            int falls_through = prev && prev->kind != TAC_GOTO && prev->kind != TAC_RETURN;
+            if (falls_through) {
+                exit_label = block->instructions[0].kind == TAC_LABEL
+                           ? block->instructions[0].dst.literal : tac_function_new_label(&out);
+                TACInstr jump = {0};
+                jump.kind = TAC_GOTO;
+                jump.arg1 = tac_label(exit_label);
+                tac_function_push(&out, jump);
+            }
+            for (size_t k = 0; k < splits.count; k++) tac_function_push(&out, splits.items[k]);
+            if (exit_label >= 0 && block->instructions[0].kind != TAC_LABEL) {
+                TACInstr head = {0};
+                head.kind = TAC_LABEL;
+                head.dst = tac_label(exit_label);
+                tac_function_push(&out, head);
+            }
+        }
+
+        for (size_t i = 0; i < block->count; i++) {
+            TACInstr instr = block->instructions[i];
+            if (instr.kind == TAC_PHI) continue;
+            if (&block->instructions[i] == last) {
+                if (instr.kind == TAC_GOTO) {
+                    for (size_t k = 0; k < inline_copies[b].count; k++) tac_function_push(&out, inline_copies[b].items[k]);
+                    inline_copies[b].count = 0;
+                }
+                if (retarget[b] >= 0) tac_set_jump_target(&instr, retarget[b]);
+            }
+            tac_function_push(&out, instr);
+        }
+        for (size_t k = 0; k < inline_copies[b].count; k++) tac_function_push(&out, inline_copies[b].items[k]);
+        free(inline_copies[b].items);
+    }
+    tac_function_sync_header(&out);
+
+    free(inline_copies);
+    free(retarget);
+    free(splits.items);
+    free_cfg(cfg);
+    free(cfg);
+
+    tac_function_free(fn);
+    *fn = out;
+}
+
+void ssa_destruct(TACFunction *fn) {
+    if (!has_header(fn)) return;
+    int first_split = fn->label_count;
+    if (has_phis(fn)) lower_phis(fn);
+
+    // Give versions back their names where they do not overlap
+    while (coalesce_round(fn) > 0) {}
+    drop_empty_splits(fn, first_split);
+}
+
+void ssa_destruct_program(TACProgram *program) {
+    for (size_t i = 0; i < program->count; i++) ssa_destruct(&program->functions[i]);
+}
+
+
+/* ---------- Verification ---------- */
+
+typedef struct {
+    int block;                // -1 if not defined
+    size_t index;             // position in the block
+} SSADef;
+
+typedef struct {
+    SSADef *temps;
+    size_t  temp_count;
+    SSADef *vars;
+} SSADefs;
+
+// Definition record of a temp or variable; NULL for other operands and
+// for temps beyond the function's count
+static SSADef *def_slot(const SSADefs *defs, TACOperand op) {
+    if (op.type == TAC_OP_TEMP && op.literal >= 0 && (size_t)op.literal < defs->temp_count)
+        return &defs->temps[op.literal];
+    if (op.type == TAC_OP_VAR) return &defs->vars[op.sym];
+    return NULL;
+}
+
+static void ssa_report(const TACFunction *fn, size_t *problems, const char *what, TACOperand op, int block) {
+    const char *name = interned_name(fn->instrs[0].dst.sym);
+    if (op.type == TAC_OP_TEMP) fprintf(stderr, "ssa: %s: block %d: t%d %s\n", name, block, op.literal, what);
+    else if (op.type == TAC_OP_VAR) fprintf(stderr, "ssa: %s: block %d: %s %s\n", name, block, interned_name(op.sym), what);
+    else fprintf(stderr, "ssa: %s: block %d: %s\n", name, block, what);
+    (*problems)++;
+}
+
+// True if the definition `def` is available at position `index` of `block`
+static int def_reaches(const DomTree *dom, const SSADef *def, int block, size_t index) {
+    if (def->block == block) return def->index < index;
+    return dom_dominates(dom, def->block, block);
+}
+
+size_t ssa_verify(const TACFunction *fn) {
+    if (!has_header(fn)) return 0;
+
+    CFG *cfg = build_from_tac((TACFunction *)fn);
+    if (!cfg) return 1;
+    DomTree *dom = dom_compute(cfg);
+    size_t n = cfg->blocks.count;
+    size_t syms = intern_count();
+    SSADefs defs;
+    defs.temp_count = fn->temp_count > 0 ? (size_t)fn->temp_count : 0;
+    defs.temps = xcalloc(defs.temp_count, sizeof(SSADef));
+    defs.vars = xcalloc(syms, sizeof(SSADef));
+    for (size_t t = 0; t < defs.temp_count; t++) defs.temps[t].block = -1;
+    for (size_t s = 0; s < syms; s++) defs.vars[s].block = -1;
+    size_t problems = 0;
+
+    // 1) One definition per name; phis only at the top of a block, with
+    //    one argument per predecessor
+    for (size_t b = 0; b < n; b++) {
+        const CFGBlock *block = cfg->blocks.items[b];
+        if (dom->rpo_index[b] < 0) continue;
+        size_t pred_count;
+        cfg_predecessors(cfg, (int)b, &pred_count);
+        int phis_allowed = 1;
+        for (size_t i = 0; i < block->count; i++) {
+            const TACInstr *instr = &block->instructions[i];
+            if (instr->kind == TAC_PHI) {
+                if (!phis_allowed) ssa_report(fn, &problems, "phi after other instructions", instr->dst, (int)b);
+                if (tac_phi_arg_count(instr) != pred_count)
+                    ssa_report(fn, &problems, "phi argument count differs from predecessor count", instr->dst, (int)b);
+            } else if (instr->kind != TAC_LABEL) {
+                phis_allowed = 0;
+            }
+            const TACOperand *def = tac_def_operand(instr);
+            if (!def || (def->type != TAC_OP_TEMP && def->type != TAC_OP_VAR)) continue;
+            SSADef *slot = def_slot(&defs, *def);
+            if (!slot) {
+                ssa_report(fn, &problems, "is beyond the temp count", *def, (int)b);
+            } else if (slot->block >= 0) {
+                ssa_report(fn, &problems, "is defined more than once", *def, (int)b);
+            } else {
+                slot->block = (int)b;
+                slot->index = i;
+            }
+        }
+    }
+
+    // 2) Uses are dominated by their definitions; a phi argument by the
+    //    end of the matching predecessor. Names without any definition
+    //    (globals, parameters of other functions) are not checked
+    for (size_t b = 0; b < n && problems == 0; b++) {
+        const CFGBlock *block = cfg->blocks.items[b];
+        if (dom->rpo_index[b] < 0) continue;
+        size_t pred_count;
+        const int *pred = cfg_predecessors(cfg, (int)b, &pred_count);
+        for (size_t i = 0; i < block->count; i++) {
+            const TACInstr *instr = &block->instructions[i];
+            if (instr->kind == TAC_PHI) {
+                const TACOperand *args = tac_phi_args(instr);
+                for (size_t j = 0; j < tac_phi_arg_count(instr) && j < pred_count; j++) {
+                    const SSADef *def = def_slot(&defs, args[j]);
+                    int p = pred[j];
+                    if (!def || def->block < 0 || dom->rpo_index[p] < 0) continue;
+                    if (!def_reaches(dom, def, p, cfg->blocks.items[p]->count))
+                        ssa_report(fn, &problems, "reaches a phi without dominating its predecessor", args[j], (int)b);
+                }
+                continue;
+            }
+            unsigned uses = tac_use_mask(instr);
+            for (unsigned use = TAC_USE_ARG1; use <= TAC_USE_ARG3; use <<= 1) {
+                if (!(uses & use)) continue;
+                const TACOperand *op = use_operand(instr, use);
+                const SSADef *def = def_slot(&defs, *op);
+                if (!def || def->block < 0) continue;
+                if (!def_reaches(dom, def, (int)b, i))
+                    ssa_report(fn, &problems, "is used where its definition does not dominate", *op, (int)b);
+            }
+        }
+    }
+
+    free(defs.temps);
+    free(defs.vars);
+    dom_free(dom);
+    free_cfg(cfg);
+    free(cfg);
+    return problems;
+}
+
+size_t ssa_verify_program(const TACProgram *program) {
+    size_t problems = 0;
+    for (size_t i = 0; i < program->count; i++) problems += ssa_verify(&program->functions[i]);
+    return problems;
+}
@@ -0,0 +1,206 @@
+#include "ssa_simplify.h"
+#include "cfg_builder.h"
+#include "def_use.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <stdlib.h>
+
+typedef struct {
+    TACFunction      *fn;
+    DefUse           *du;
+    SSASimplifyStats  stats;
+
+    // Blocks that follow a conditional jump without a label of their own
+    // vanish when emptied; those keep their last instruction
+    int              *guard_block;    // per instruction: first index of such a block, or -1
+    size_t           *remaining;      // per first index: instructions left
+
+    int              *work;
+    size_t            work_count;
+    unsigned char    *queued;
+} Simplify;
+
+static void find_guarded_blocks(Simplify *s) {
+    TACFunction *fn = s->fn;
+    s->guard_block = xcalloc(fn->count, sizeof(int));
+    s->remaining = xcalloc(fn->count, sizeof(size_t));
+    int current = -1;
+    for (size_t i = 0; i < fn->count; i++) {
+        TACInstr *instr = &fn->instrs[i];
+        if (instr->kind == TAC_LABEL) {
+            current = -1;
+        } else if (i > 0 && is_block_terminator(&fn->instrs[i - 1])) {
+            TACOpKind jump = fn->instrs[i - 1].kind;
+            current = jump == TAC_IFZ || jump == TAC_IF_CMP ? (int)i : -1;
+        }
+        s->guard_block[i] = current;
+        if (current >= 0) s->remaining[current]++;
+    }
+}
+
+static int can_delete(Simplify *s, size_t index) {
+    int first = s->guard_block[index];
+    if (first < 0) return 1;
+    if (s->remaining[first] <= 1) return 0;
+    s->remaining[first]--;
+    return 1;
+}
+
+static void queue(Simplify *s, int index) {
+    if (s->queued[index]) return;
+    s->queued[index] = 1;
+    s->work[s->work_count++] = index;
+}
+
+static int pop(Simplify *s) {
+    int index = s->work[--s->work_count];
+    s->queued[index] = 0;
+    return index;
+}
+
+static int is_name(TACOperand op) {
+    return op.type == TAC_OP_TEMP || op.type == TAC_OP_VAR;
+}
+
+// Queues the phis reading `value`, which may become trivial once it is replaced
+static void queue_phi_users(Simplify *s, TACOperand value) {
+    size_t count;
+    const DefUseSite *uses = def_use_uses(s->du, value, &count);
+    for (size_t u = 0; u < count; u++) {
+        if (s->fn->instrs[uses[u].instr].kind == TAC_PHI) queue(s, uses[u].instr);
+    }
+}
+
+
+/* ---------- Copies and trivial phis ---------- */
+
+// x ← y: every reader of x reads y. A variable the function never writes
+// may change behind a call, so it is not propagated.
+static void propagate_copy(Simplify *s, int index) {
+    const TACInstr *instr = &s->fn->instrs[index];
+    TACOperand dst = instr->dst, src = instr->arg1;
+    if (!is_name(dst) || def_use_single_def(s->du, dst) != index) return;
+    if (tac_operand_equal(dst, src)) return;
+    size_t defs;
+    if (src.type == TAC_OP_VAR && (def_use_defs(s->du, src, &defs), defs == 0)) return;
+    if (src.type != TAC_OP_LITERAL && !is_name(src)) return;
+
+    queue_phi_users(s, dst);
+    def_use_replace_uses(s->du, s->fn, dst, src);
+    if (can_delete(s, (size_t)index)) def_use_delete(s->du, s->fn, (size_t)index);
+    s->stats.copies++;
+}
+
+// x ← phi a a x: x is a
+static void fold_phi(Simplify *s, int index) {
+    const TACInstr *phi = &s->fn->instrs[index];
+    const TACOperand *args = tac_phi_args(phi);
+    TACOperand value = TAC_NONE;
+    for (size_t k = 0; k < tac_phi_arg_count(phi); k++) {
+        if (tac_operand_equal(args[k], phi->dst)) continue;
+        if (value.type == TAC_OP_NONE) value = args[k];
+        else if (!tac_operand_equal(value, args[k])) return;
+    }
+    if (value.type == TAC_OP_NONE) return;     // only ever itself: a dead loop
+
+    TACOperand dst = phi->dst;
+    def_use_delete(s->du, s->fn, (size_t)index);
+    queue_phi_users(s, dst);
+    def_use_replace_uses(s->du, s->fn, dst, value);
+    s->stats.phis++;
+}
+
+
+/* ---------- Dead code ---------- */
+
+// Whether deleting the instruction loses nothing but its result. Division
+// stays unless its divisor is a literal that cannot trap.
+static int is_pure(const TACInstr *instr) {
+    switch (instr->kind) {
+        case TAC_BINARY_OP:
+            if (instr->op.binop == TAC_DIV || instr->op.binop == TAC_MOD) {
+                return instr->arg2.type == TAC_OP_LITERAL && instr->arg2.literal != 0 && instr->arg2.literal != -1;
+            }
+            return 1;
+        case TAC_UNARY_OP:
+        case TAC_COPY:
+        case TAC_DEFINE:
+        case TAC_SELECT:
+        case TAC_PHI:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void queue_defs(Simplify *s, TACOperand value) {
+    size_t count;
+    if (!is_name(value) || (def_use_uses(s->du, value, &count), count > 0)) return;
+    const DefUseSite *defs = def_use_defs(s->du, value, &count);
+    for (size_t d = 0; d < count; d++) queue(s, defs[d].instr);
+}
+
+static void delete_if_dead(Simplify *s, int index) {
+    const TACInstr *instr = &s->fn->instrs[index];
+    if (def_use_is_dead(s->du, (size_t)index) || !is_pure(instr) || !is_name(instr->dst)) return;
+    size_t count;
+    def_use_uses(s->du, instr->dst, &count);
+    if (count > 0 || !can_delete(s, (size_t)index)) return;
+
+    def_use_delete(s->du, s->fn, (size_t)index);
+    s->stats.dead++;
+    unsigned uses = tac_use_mask(instr);
+    if (uses & TAC_USE_ARG1) queue_defs(s, instr->arg1);
+    if (uses & TAC_USE_ARG2) queue_defs(s, instr->arg2);
+    if (uses & TAC_USE_ARG3) queue_defs(s, instr->arg3);
+    if (instr->kind == TAC_PHI) {
+        const TACOperand *args = tac_phi_args(instr);
+        for (size_t k = 0; k < tac_phi_arg_count(instr); k++) queue_defs(s, args[k]);
+    }
+}
+
+
+void ssa_simplify(TACFunction *fn, SSASimplifyStats *stats) {
+    if (fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION) return;
+
+    Simplify s = {0};
+    s.fn = fn;
+    s.du = def_use_build(fn);
+    find_guarded_blocks(&s);
+    s.work = xcalloc(fn->count, sizeof(int));
+    s.queued = xcalloc(fn->count, 1);
+
+    // 1) Copies and phis, then the phis their replacements made trivial
+    for (size_t i = fn->count; i-- > 0;) {
+        TACOpKind kind = fn->instrs[i].kind;
+        if (kind == TAC_COPY || kind == TAC_DEFINE || kind == TAC_PHI) queue(&s, (int)i);
+    }
+    while (s.work_count > 0) {
+        int index = pop(&s);
+        if (def_use_is_dead(s.du, (size_t)index)) continue;
+        if (fn->instrs[index].kind == TAC_PHI) fold_phi(&s, index);
+        else propagate_copy(&s, index);
+    }
+
+    // 2) Results nobody reads, then the values only those read
+    for (size_t i = fn->count; i-- > 0;) queue(&s, (int)i);
+    while (s.work_count > 0) delete_if_dead(&s, pop(&s));
+
+    def_use_compact(s.du, fn);
+
+    if (stats) {
+        stats->copies += s.stats.copies;
+        stats->phis += s.stats.phis;
+        stats->dead += s.stats.dead;
+    }
+    def_use_free(s.du);
+    free(s.guard_block);
+    free(s.remaining);
+    free(s.work);
+    free(s.queued);
+}
+
+void ssa_simplify_program(TACProgram *program, SSASimplifyStats *stats) {
+    for (size_t i = 0; i < program->count; i++) ssa_simplify(&program->functions[i], stats);
+}
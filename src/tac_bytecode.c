@@ -0,0 +1,427 @@
+#include "tac_bytecode.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const unsigned char tac_magic[4] = { 'T', 'A', 'C', 'B' };
+
+uint64_t tac_hash_source(const char *source, size_t len) {
+    uint64_t h = 1469598103934665603ull;      // FNV-1a, 64 bit
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)source[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+
+/* ---------- Encoding ---------- */
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+static void buf_reserve(ByteBuffer *buf, size_t extra) {
+    if (buf->size + extra <= buf->capacity) return;
+    size_t new_capacity = buf->capacity ? buf->capacity : 256;
+    while (new_capacity < buf->size + extra) new_capacity *= 2;
+    unsigned char *new_data = realloc(buf->data, new_capacity);
+    if (!new_data) {
+        printf("Memory allocation failed while encoding TAC.\n");
+        exit(EXIT_FAILURE);
+    }
+    buf->data = new_data;
+    buf->capacity = new_capacity;
+}
+
+static void buf_byte(ByteBuffer *buf, unsigned char byte) {
+    buf_reserve(buf, 1);
+    buf->data[buf->size++] = byte;
+}
+
+static void buf_bytes(ByteBuffer *buf, const void *bytes, size_t len) {
+    buf_reserve(buf, len);
+    memcpy(buf->data + buf->size, bytes, len);
+    buf->size += len;
+}
+
+static void buf_varint(ByteBuffer *buf, uint64_t value) {
+    buf_reserve(buf, 10);
+    while (value >= 0x80) {
+        buf->data[buf->size++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    buf->data[buf->size++] = (unsigned char)value;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static int has_subop(TACOpKind kind) {
+    return kind == TAC_BINARY_OP || kind == TAC_UNARY_OP || kind == TAC_IF_CMP;
+}
+
+static void encode_operand(ByteBuffer *buf, TACOperand op, const int *name_index) {
+    switch (op.type) {
+        case TAC_OP_NONE:    break;
+        case TAC_OP_VAR:     buf_varint(buf, (uint64_t)name_index[op.sym]); break;
+        case TAC_OP_LITERAL: buf_varint(buf, zigzag(op.literal)); break;
+        default:             buf_varint(buf, (uint32_t)op.literal); break;
+    }
+}
+
+unsigned char *tac_encode(const TACProgram *program, uint64_t source_hash, size_t *out_len) {
+    ByteBuffer buf = {0};
+
+    // 1) Header
+    buf_bytes(&buf, tac_magic, sizeof(tac_magic));
+    buf_byte(&buf, TAC_BYTECODE_VERSION);
+    for (int i = 0; i < 8; i++) buf_byte(&buf, (unsigned char)(source_hash >> (8 * i)));
+
+    // 2) Name table: only the interned names this program refers to
+    size_t interned = intern_count();
+    int *name_index = malloc((interned ? interned : 1) * sizeof(int));
+    int *names = malloc((interned ? interned : 1) * sizeof(int));
+    if (!name_index || !names) {
+        printf("Memory allocation failed while encoding TAC.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < interned; i++) name_index[i] = -1;
+    size_t name_count = 0;
+    for (size_t f = 0; f < program->count; f++) {
+        const TACFunction *fn = &program->functions[f];
+        for (size_t i = 0; i < fn->count; i++) {
+            const TACOperand *ops[4] = { &fn->instrs[i].dst, &fn->instrs[i].arg1,
+                                         &fn->instrs[i].arg2, &fn->instrs[i].arg3 };
+            for (int k = 0; k < 4; k++) {
+                if (ops[k]->type == TAC_OP_VAR && name_index[ops[k]->sym] < 0) {
+                    name_index[ops[k]->sym] = (int)name_count;
+                    names[name_count++] = ops[k]->sym;
+                }
+            }
+            if (fn->instrs[i].kind != TAC_PHI) continue;
+            const TACOperand *args = tac_phi_args(&fn->instrs[i]);
+            for (size_t k = 0; k < tac_phi_arg_count(&fn->instrs[i]); k++) {
+                if (args[k].type == TAC_OP_VAR && name_index[args[k].sym] < 0) {
+                    name_index[args[k].sym] = (int)name_count;
+                    names[name_count++] = args[k].sym;
+                }
+            }
+        }
+    }
+    buf_varint(&buf, name_count);
+    for (size_t i = 0; i < name_count; i++) {
+        const char *name = interned_name(names[i]);
+        size_t len = strlen(name);
+        buf_varint(&buf, len);
+        buf_bytes(&buf, name, len);
+    }
+
+    // 3) Functions
+    buf_varint(&buf, program->count);
+    for (size_t f = 0; f < program->count; f++) {
+        const TACFunction *fn = &program->functions[f];
+        buf_varint(&buf, fn->count);
+        buf_varint(&buf, (uint64_t)fn->temp_count);
+        buf_varint(&buf, (uint64_t)fn->label_count);
+
+        for (size_t i = 0; i < fn->count; i++) {
+            const TACInstr *instr = &fn->instrs[i];
+            buf_byte(&buf, (unsigned char)instr->kind);
+            if (instr->kind == TAC_PHI) {
+                // Pool positions mean nothing to another run; store the arguments
+                size_t count = tac_phi_arg_count(instr);
+                const TACOperand *args = tac_phi_args(instr);
+                buf_byte(&buf, (unsigned char)instr->dst.type);
+                encode_operand(&buf, instr->dst, name_index);
+                buf_varint(&buf, count);
+                for (size_t k = 0; k < count; k++) {
+                    buf_byte(&buf, (unsigned char)args[k].type);
+                    encode_operand(&buf, args[k], name_index);
+                }
+                continue;
+            }
+            if (instr->kind == TAC_CALL) {
+                buf_byte(&buf, (unsigned char)(instr->op.tail != 0));
+            } else if (has_subop(instr->kind)) {
+                buf_byte(&buf, (unsigned char)(instr->kind == TAC_UNARY_OP
+                                               ? instr->op.unop : instr->op.binop));
+            }
+            buf_byte(&buf, (unsigned char)(instr->dst.type
+                                           + 5 * instr->arg1.type
+                                           + 25 * instr->arg2.type));
+            encode_operand(&buf, instr->dst, name_index);
+            encode_operand(&buf, instr->arg1, name_index);
+            encode_operand(&buf, instr->arg2, name_index);
+            if (instr->kind == TAC_SELECT) {
+                buf_byte(&buf, (unsigned char)instr->arg3.type);
+                encode_operand(&buf, instr->arg3, name_index);
+            }
+        }
+    }
+
+    free(name_index);
+    free(names);
+    *out_len = buf.size;
+    return buf.data;
+}
+
+
+/* ---------- Decoding ---------- */
+
+typedef struct {
+    const unsigned char *data;
+    size_t pos;
+    size_t len;
+    int error;
+} ByteReader;
+
+static unsigned char read_byte(ByteReader *r) {
+    if (r->pos >= r->len) {
+        r->error = 1;
+        return 0;
+    }
+    return r->data[r->pos++];
+}
+
+static uint64_t read_varint(ByteReader *r) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        unsigned char byte = read_byte(r);
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    r->error = 1;
+    return 0;
+}
+
+// Temps and labels must lie below the counts of fn, which the passes size
+// their tables by
+static TACOperand decode_operand(ByteReader *r, int type, const int *name_ids, size_t name_count,
+                                 const TACFunction *fn) {
+    TACOperand op = { .type = (TACOperandType)type };
+    switch (type) {
+        case TAC_OP_NONE:
+            break;
+        case TAC_OP_VAR: {
+            uint64_t index = read_varint(r);
+            if (index >= name_count) {
+                r->error = 1;
+                break;
+            }
+            op.sym = name_ids[index];
+            break;
+        }
+        case TAC_OP_LITERAL:
+            op.literal = (int)unzigzag(read_varint(r));
+            break;
+        case TAC_OP_TEMP:
+        case TAC_OP_LABEL: {
+            uint64_t id = read_varint(r);
+            if (id >= (uint64_t)(type == TAC_OP_TEMP ? fn->temp_count : fn->label_count)) {
+                r->error = 1;
+                break;
+            }
+            op.literal = (int)id;
+            break;
+        }
+        default:
+            r->error = 1;
+            break;
+    }
+    return op;
+}
+
+TACProgram *tac_decode(const unsigned char *data, size_t len, uint64_t *source_hash) {
+    ByteReader r = { data, 0, len, 0 };
+
+    // 1) Header
+    if (len < sizeof(tac_magic) + 9 || memcmp(data, tac_magic, sizeof(tac_magic)) != 0) return NULL;
+    r.pos = sizeof(tac_magic);
+    if (read_byte(&r) != TAC_BYTECODE_VERSION) return NULL;
+    uint64_t hash = 0;
+    for (int i = 0; i < 8; i++) hash |= (uint64_t)read_byte(&r) << (8 * i);
+    if (source_hash) *source_hash = hash;
+
+    // 2) Names are interned directly from the buffer
+    size_t name_count = read_varint(&r);
+    if (r.error || name_count > len) return NULL;
+    int *name_ids = malloc((name_count ? name_count : 1) * sizeof(int));
+    if (!name_ids) {
+        printf("Memory allocation failed while decoding TAC.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < name_count && !r.error; i++) {
+        size_t name_len = read_varint(&r);
+        if (r.error || name_len > len - r.pos) {
+            r.error = 1;
+            break;
+        }
+        name_ids[i] = intern_n((const char *)data + r.pos, name_len);
+        r.pos += name_len;
+    }
+
+    // 3) Functions, each allocated once at its exact size
+    TACProgram *program = tac_program_create();
+    size_t function_count = r.error ? 0 : read_varint(&r);
+    if (function_count > len) r.error = 1;
+    for (size_t f = 0; f < function_count && !r.error; f++) {
+        size_t instr_count = read_varint(&r);
+        size_t temp_count = read_varint(&r);
+        size_t label_count = read_varint(&r);
+        if (r.error || instr_count > len - r.pos || temp_count > INT_MAX || label_count > len) {
+            r.error = 1;
+            break;
+        }
+
+        TACFunction *fn = tac_program_add_function(program);
+        fn->capacity = instr_count;
+        fn->instrs = malloc((instr_count ? instr_count : 1) * sizeof(TACInstr));
+        fn->temp_count = (int)temp_count;
+        fn->label_count = (int)label_count;
+        fn->label_capacity = label_count;
+        fn->label_pos = malloc((label_count ? label_count : 1) * sizeof(size_t));
+        if (!fn->instrs || !fn->label_pos) {
+            printf("Memory allocation failed while decoding TAC.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < label_count; i++) fn->label_pos[i] = TAC_NO_LABEL;
+
+        for (size_t i = 0; i < instr_count && !r.error; i++) {
+            TACInstr instr = {0};
+            instr.kind = (TACOpKind)read_byte(&r);
+            if (instr.kind >= TAC_KIND_COUNT) {
+                r.error = 1;
+                break;
+            }
+            if (instr.kind == TAC_PHI) {
+                // u8 dst kind, dst, varint count, as tac_encode writes them
+                unsigned kind = read_byte(&r);
+                if (kind >= 5) {
+                    r.error = 1;
+                    break;
+                }
+                instr.dst = decode_operand(&r, kind, name_ids, name_count, fn);
+                size_t count = read_varint(&r);
+                if (r.error || count > len - r.pos) {
+                    r.error = 1;
+                    break;
+                }
+                instr.arg1 = tac_literal(tac_phi_alloc(count));
+                instr.arg2 = tac_literal((int)count);
+                for (size_t k = 0; k < count && !r.error; k++) {
+                    unsigned arg_kind = read_byte(&r);
+                    if (arg_kind >= 5) {
+                        r.error = 1;
+                        break;
+                    }
+                    tac_phi_args(&instr)[k] = decode_operand(&r, arg_kind, name_ids, name_count, fn);
+                }
+                tac_function_push(fn, instr);
+                continue;
+            }
+            if (instr.kind == TAC_BINARY_OP || instr.kind == TAC_IF_CMP)
+                instr.op.binop = (TACBinOp)read_byte(&r);
+            if (instr.kind == TAC_UNARY_OP)  instr.op.unop = (TACUnaryOp)read_byte(&r);
+            if (instr.kind == TAC_CALL)      instr.op.tail = read_byte(&r) != 0;
+            int bad_op = (instr.kind == TAC_BINARY_OP && instr.op.binop > TAC_SHR)
+                      || (instr.kind == TAC_IF_CMP && !tac_is_relational(instr.op.binop))
+                      || (instr.kind == TAC_UNARY_OP && instr.op.unop > TAC_NOT);
+            unsigned kinds = read_byte(&r);
+            if (bad_op || kinds >= 125) {
+                r.error = 1;
+                break;
+            }
+            instr.dst  = decode_operand(&r, kinds % 5, name_ids, name_count, fn);
+            instr.arg1 = decode_operand(&r, kinds / 5 % 5, name_ids, name_count, fn);
+            instr.arg2 = decode_operand(&r, kinds / 25, name_ids, name_count, fn);
+            if (instr.kind == TAC_SELECT) {
+                unsigned kind3 = read_byte(&r);
+                if (kind3 >= 5) {
+                    r.error = 1;
+                    break;
+                }
+                instr.arg3 = decode_operand(&r, kind3, name_ids, name_count, fn);
+            }
+            tac_function_push(fn, instr);
+        }
+    }
+
+    free(name_ids);
+    if (r.error || r.pos != len) {
+        tac_program_free(program);
+        return NULL;
+    }
+    return program;
+}
+
+
+/* ---------- Cache files ---------- */
+
+int tac_write_cache(const char *path, const TACProgram *program, uint64_t source_hash) {
+    size_t len;
+    unsigned char *data = tac_encode(program, source_hash, &len);
+
+    // Round trip before trusting the encoding with later runs
+    TACProgram *check = tac_decode(data, len, NULL);
+    int ok = check && tac_program_equal(program, check);
+    tac_program_free(check);
+    if (!ok) {
+        fprintf(stderr, "warning: TAC bytecode round trip failed, not writing %s\n", path);
+        free(data);
+        return -1;
+    }
+
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror("fopen");
+        free(data);
+        return -1;
+    }
+    size_t written = fwrite(data, 1, len, out);
+    fclose(out);
+    free(data);
+    return written == len ? 0 : -1;
+}
+
+TACProgram *tac_load_cache(const char *path, uint64_t source_hash) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    uint64_t hash = 0;
+    TACProgram *program = NULL;
+    // Check the hash in the header before decoding anything else
+    if ((size_t)st.st_size > sizeof(tac_magic) + 9) {
+        const unsigned char *bytes = map;
+        for (int i = 0; i < 8; i++) hash |= (uint64_t)bytes[sizeof(tac_magic) + 1 + i] << (8 * i);
+        if (hash == source_hash) {
+            program = tac_decode(map, (size_t)st.st_size, NULL);
+        }
+    }
+    munmap(map, (size_t)st.st_size);
+    return program;
+}
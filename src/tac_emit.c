@@ -1,176 +1,406 @@
 #include "tac_emit.h"
-#include <stdlib.h> 
+#include "intern.h"
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-TACOperand *tac_create_operand(TACOperandType type, const char *name, int literal) {
-    TACOperand *operand = malloc(sizeof(TACOperand));
-    if (!operand) return NULL; // Handle memory allocation failure
-    operand->type = type;
-    
+TACOperand tac_create_operand(TACOperandType type, const char *name, int literal) {
+    TACOperand operand = { .type = type };
+
     if (type == TAC_OP_VAR) {
-        operand->name = strdup(name); // Duplicate the string for safety
-        if (!operand->name) {
-            free(operand);
-            return NULL; // Handle memory allocation failure
-        }
-    } 
-    
+        operand.sym = intern(name); // Names are interned, not copied per operand
+    }
+
     if( type == TAC_OP_LITERAL || type == TAC_OP_TEMP  || type == TAC_OP_LABEL) {
-        operand->literal = literal; // For LITERAL type
+        operand.literal = literal; // For LITERAL type
     }
     return operand;
 }
 
-TACInstr *tac_emit_binary_op(TACBinOp binop, TACOperand *dst, TACOperand *arg1, TACOperand *arg2) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_BINARY_OP;
-    instr->op.binop = binop;
-    instr->dst = dst;
-    instr->arg1 = arg1;
-    instr->arg2 = arg2;
-    return instr;
-}
-
-TACInstr *tac_emit_unary_op(TACUnaryOp unop, TACOperand *dst, TACOperand *arg1) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_UNARY_OP;
-    instr->op.unop = unop;
-    instr->dst = dst;
-    instr->arg1 = arg1;
-    instr->arg2 = NULL; // Unary operations do not have a second argument
-    return instr;
-}
-
-TACInstr *tac_emit_copy(TACOperand *dst, TACOperand *arg1) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_COPY;
-    instr->dst = dst;
-    instr->arg1 = arg1;
-    instr->arg2 = NULL; // Copy does not have a second argument
-    return instr;
-}
-
-TACInstr *tac_emit_label(TACOperand *dst) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_LABEL;
-    instr->dst = dst;
-    instr->arg1 = NULL; // Labels do not have arguments
-    instr->arg2 = NULL; // Labels do not have arguments
-    return instr;
-}
-
-TACInstr *tac_emit_goto(TACOperand *arg1) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_GOTO;
-    instr->dst = NULL; // Goto does not have a destination
-    instr->arg1 = arg1;
-    instr->arg2 = NULL; // Goto does not have a second argument
-    return instr;
-}
-
-TACInstr *tac_emit_ifz(TACOperand *arg1, TACOperand *arg2) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_IFZ;
-    instr->dst = NULL; // Ifz does not have a destination
-    instr->arg1 = arg1; // The first argument is the operand to check
-    instr->arg2 = arg2; // The second argument is the label to jump to
-    return instr;
-}
-
-TACInstr *tac_emit_param(TACOperand *arg1) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_PUSH;
-    instr->dst = NULL; // Param does not have a destination
-    instr->arg1 = arg1; // The first argument is the parameter to pass
-    instr->arg2 = NULL; // Param does not have a second argument
-    return instr;
-}
-TACInstr *tac_emit_arg(TACOperand *arg1) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_POP;
-    instr->dst = NULL; // Param does not have a destination
-    instr->arg1 = arg1; // The first argument is the parameter to pass
-    instr->arg2 = NULL; // Param does not have a second argument
-    return instr;
-}
-
-TACInstr *tac_emit_call(TACOperand *dst, 
-                        TACOperand *arg1, 
-                        int n_args) 
-{
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-
-    instr->kind = TAC_CALL;
-    instr->dst = dst; // The destination for the result of the call 
-    instr->arg1 = arg1; // The function to call
-    // Create an operand for the number of arguments
-    instr->arg2 = tac_create_operand(TAC_OP_LITERAL, NULL, n_args); 
-    return instr;
-}
-
-TACInstr *tac_emit_return(TACOperand *arg1) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_RETURN;
-    instr->dst = NULL; // Return does not have a destination
-    instr->arg1 = arg1; // The operand to return, can be NULL for void return
-    instr->arg2 = NULL; // Return does not have a second argument
-    return instr;
-}
-
-TACInstr *tac_emit_function(TACOperand *dst) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_FUNCTION;
-    instr->dst = dst; // The function name as a label
-    instr->arg1 = NULL; // Function does not have an argument
-    instr->arg2 = NULL; // Function does not have a second argument
-    return instr;
-}
-
-TACInstr *tac_emit_end_function(void) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_END_FUNCTION;
-    instr->dst = NULL; // End function does not have a destination
-    instr->arg1 = NULL; // End function does not have an argument
-    instr->arg2 = NULL; // End function does not have a second argument
-    return instr;
-}
-
-TACInstr *tac_emit_define(TACOperand *dst, TACOperand *arg1) {
-    TACInstr *instr = malloc(sizeof(TACInstr));
-    if (!instr) return NULL; // Handle memory allocation failure
-    instr->kind = TAC_DEFINE;
-    instr->dst = dst; // The destination for the defined variable
-    instr->arg1 = arg1; // The argument to define, can be NULL
-    instr->arg2 = NULL; // Define does not have a second argument
-    return instr;
-}
-void tac_free_operand(TACOperand *operand) {
-    if (operand) {
-        if (operand->name) {
-            free(operand->name); // Free the name if it was allocated
+TACOperand tac_temp(int id)          { return tac_create_operand(TAC_OP_TEMP, NULL, id); }
+TACOperand tac_label(int id)         { return tac_create_operand(TAC_OP_LABEL, NULL, id); }
+TACOperand tac_literal(int value)    { return tac_create_operand(TAC_OP_LITERAL, NULL, value); }
+TACOperand tac_var(const char *name) { return tac_create_operand(TAC_OP_VAR, name, 0); }
+
+int tac_operand_equal(TACOperand a, TACOperand b) {
+    if (a.type != b.type) return 0;
+    if (a.type == TAC_OP_NONE) return 1;
+    return a.type == TAC_OP_VAR ? a.sym == b.sym : a.literal == b.literal;
+}
+
+
+/* ---------- Phi arguments ---------- */
+
+static struct {
+    TACOperand *items;
+    size_t count;
+    size_t capacity;
+} phi_pool;
+
+int tac_phi_alloc(size_t count) {
+    if (phi_pool.count + count > phi_pool.capacity) {
+        size_t new_capacity = phi_pool.capacity ? phi_pool.capacity * 2 : 64;
+        while (new_capacity < phi_pool.count + count) new_capacity *= 2;
+        TACOperand *new_items = realloc(phi_pool.items, new_capacity * sizeof(TACOperand));
+        if (!new_items) {
+            printf("Memory allocation failed while resizing phi arguments.\n");
+            exit(EXIT_FAILURE);
+        }
+        phi_pool.items = new_items;
+        phi_pool.capacity = new_capacity;
+    }
+    size_t start = phi_pool.count;
+    for (size_t i = 0; i < count; i++) phi_pool.items[start + i] = TAC_NONE;
+    phi_pool.count += count;
+    return (int)start;
+}
+
+TACOperand *tac_phi_args(const TACInstr *phi) {
+    return &phi_pool.items[phi->arg1.literal];
+}
+
+size_t tac_phi_arg_count(const TACInstr *phi) {
+    return (size_t)phi->arg2.literal;
+}
+
+void tac_phi_free(void) {
+    free(phi_pool.items);
+    phi_pool.items = NULL;
+    phi_pool.count = phi_pool.capacity = 0;
+}
+
+
+/* ---------- Program and function storage ---------- */
+
+TACProgram *tac_program_create(void) {
+    TACProgram *program = calloc(1, sizeof(TACProgram));
+    if (!program) {
+        printf("Memory allocation failed for TACProgram.\n");
+        exit(EXIT_FAILURE);
+    }
+    return program;
+}
+
+TACFunction *tac_program_add_function(TACProgram *program) {
+    if (program->count >= program->capacity) {
+        size_t new_capacity = program->capacity ? program->capacity * 2 : 4;
+        TACFunction *new_items = realloc(program->functions, new_capacity * sizeof(TACFunction));
+        if (!new_items) {
+            printf("Memory allocation failed while resizing TACProgram.\n");
+            exit(EXIT_FAILURE);
+        }
+        program->functions = new_items;
+        program->capacity = new_capacity;
+    }
+    TACFunction *fn = &program->functions[program->count++];
+    memset(fn, 0, sizeof(*fn));
+    return fn;
+}
+
+void tac_program_free(TACProgram *program) {
+    if (!program) return;
+    for (size_t i = 0; i < program->count; i++) {
+        tac_function_free(&program->functions[i]);
+    }
+    free(program->functions);
+    free(program);
+}
+
+static void tac_function_record_label(TACFunction *fn, int label, size_t index) {
+    if (label < 0) return;
+    if ((size_t)label >= fn->label_capacity) {
+        size_t new_capacity = fn->label_capacity ? fn->label_capacity : 8;
+        while (new_capacity <= (size_t)label) new_capacity *= 2;
+        size_t *new_pos = realloc(fn->label_pos, new_capacity * sizeof(size_t));
+        if (!new_pos) {
+            printf("Memory allocation failed while resizing label table.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = fn->label_capacity; i < new_capacity; i++) {
+            new_pos[i] = TAC_NO_LABEL;
+        }
+        fn->label_pos = new_pos;
+        fn->label_capacity = new_capacity;
+    }
+    fn->label_pos[label] = index;
+}
+
+TACInstr *tac_function_push(TACFunction *fn, TACInstr instr) {
+    if (fn->count >= fn->capacity) {
+        size_t new_capacity = fn->capacity ? fn->capacity * 2 : 16;
+        TACInstr *new_items = realloc(fn->instrs, new_capacity * sizeof(TACInstr));
+        if (!new_items) {
+            printf("Memory allocation failed while resizing TACFunction.\n");
+            exit(EXIT_FAILURE);
+        }
+        fn->instrs = new_items;
+        fn->capacity = new_capacity;
+    }
+    if (instr.kind == TAC_LABEL && instr.dst.type == TAC_OP_LABEL) {
+        tac_function_record_label(fn, instr.dst.literal, fn->count);
+    }
+    fn->instrs[fn->count] = instr;
+    return &fn->instrs[fn->count++];
+}
+
+size_t tac_function_label_index(const TACFunction *fn, int label) {
+    if (label < 0 || (size_t)label >= fn->label_capacity) return TAC_NO_LABEL;
+    return fn->label_pos[label];
+}
+
+void tac_function_free(TACFunction *fn) {
+    if (!fn) return;
+    free(fn->instrs);
+    free(fn->label_pos);
+    memset(fn, 0, sizeof(*fn));
+}
+
+void tac_function_sync_header(TACFunction *fn) {
+    if (fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION) return;
+    fn->instrs[0].arg1 = tac_literal(fn->temp_count);
+    fn->instrs[0].arg2 = tac_literal(fn->label_count);
+}
+
+int tac_function_new_temp(TACFunction *fn) {
+    int id = fn->temp_count++;
+    tac_function_sync_header(fn);
+    return id;
+}
+
+int tac_function_new_label(TACFunction *fn) {
+    int id = fn->label_count++;
+    tac_function_sync_header(fn);
+    return id;
+}
+
+void tac_function_recount(TACFunction *fn) {
+    fn->temp_count = 0;
+    fn->label_count = 0;
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACInstr *instr = &fn->instrs[i];
+        const TACOperand *ops[4] = { &instr->dst, &instr->arg1, &instr->arg2, &instr->arg3 };
+        for (int k = 0; k < 4; k++) {
+            if (ops[k]->type == TAC_OP_TEMP && ops[k]->literal >= fn->temp_count)
+                fn->temp_count = ops[k]->literal + 1;
+            if (ops[k]->type == TAC_OP_LABEL && ops[k]->literal >= fn->label_count)
+                fn->label_count = ops[k]->literal + 1;
+        }
+        if (instr->kind != TAC_PHI) continue;
+        const TACOperand *args = tac_phi_args(instr);
+        for (size_t k = 0; k < tac_phi_arg_count(instr); k++) {
+            if (args[k].type == TAC_OP_TEMP && args[k].literal >= fn->temp_count)
+                fn->temp_count = args[k].literal + 1;
         }
-        free(operand); // Free the operand structure itself
     }
+    tac_function_sync_header(fn);
 }
 
-void tac_free_instr(TACInstr *instr) {
-    if (instr) {
-        tac_free_operand(instr->dst);
-        tac_free_operand(instr->arg1);
-        tac_free_operand(instr->arg2);
-        free(instr); // Free the instruction structure itself
+
+/* ---------- Builder ---------- */
+
+void tac_builder_init(TACBuilder *b, TACProgram *program) {
+    b->program = program;
+    b->function = TAC_NO_FUNCTION;
+    b->global = TAC_NO_FUNCTION;
+}
+
+// Code emitted outside of a function goes to a single global segment
+TACFunction *tac_builder_function(TACBuilder *b) {
+    if (b->function == TAC_NO_FUNCTION) {
+        if (b->global == TAC_NO_FUNCTION) {
+            tac_program_add_function(b->program);
+            b->global = b->program->count - 1;
+        }
+        return &b->program->functions[b->global];
     }
-}
\ No newline at end of file
+    return &b->program->functions[b->function];
+}
+
+TACInstr *tac_builder_tail(TACBuilder *b) {
+    TACFunction *fn = tac_builder_function(b);
+    return fn->count ? &fn->instrs[fn->count - 1] : NULL;
+}
+
+size_t tac_builder_count(TACBuilder *b) {
+    return tac_builder_function(b)->count;
+}
+
+int tac_builder_new_temp(TACBuilder *b) {
+    return tac_function_new_temp(tac_builder_function(b));
+}
+
+int tac_builder_new_label(TACBuilder *b) {
+    return tac_function_new_label(tac_builder_function(b));
+}
+
+size_t tac_builder_begin_function(TACBuilder *b) {
+    size_t enclosing = b->function;
+    tac_program_add_function(b->program);
+    b->function = b->program->count - 1;
+    return enclosing;
+}
+
+void tac_builder_end_function(TACBuilder *b, size_t enclosing) {
+    b->function = enclosing;
+}
+
+static TACInstr *tac_builder_push(TACBuilder *b, TACInstr instr) {
+    return tac_function_push(tac_builder_function(b), instr);
+}
+
+
+/* ---------- Instruction emitters ---------- */
+
+TACInstr *tac_emit_binary_op(TACBuilder *b, TACBinOp binop, TACOperand dst, TACOperand arg1, TACOperand arg2) {
+    TACInstr instr = {0};
+    instr.kind = TAC_BINARY_OP;
+    instr.op.binop = binop;
+    instr.dst = dst;
+    instr.arg1 = arg1;
+    instr.arg2 = arg2;
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_unary_op(TACBuilder *b, TACUnaryOp unop, TACOperand dst, TACOperand arg1) {
+    TACInstr instr = {0};
+    instr.kind = TAC_UNARY_OP;
+    instr.op.unop = unop;
+    instr.dst = dst;
+    instr.arg1 = arg1;
+    instr.arg2 = TAC_NONE; // Unary operations do not have a second argument
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_copy(TACBuilder *b, TACOperand dst, TACOperand arg1) {
+    TACInstr instr = {0};
+    instr.kind = TAC_COPY;
+    instr.dst = dst;
+    instr.arg1 = arg1;
+    instr.arg2 = TAC_NONE; // Copy does not have a second argument
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_label(TACBuilder *b, TACOperand dst) {
+    TACInstr instr = {0};
+    instr.kind = TAC_LABEL;
+    instr.dst = dst;
+    instr.arg1 = TAC_NONE; // Labels do not have arguments
+    instr.arg2 = TAC_NONE; // Labels do not have arguments
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_goto(TACBuilder *b, TACOperand arg1) {
+    TACInstr instr = {0};
+    instr.kind = TAC_GOTO;
+    instr.dst = TAC_NONE; // Goto does not have a destination
+    instr.arg1 = arg1;
+    instr.arg2 = TAC_NONE; // Goto does not have a second argument
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_ifz(TACBuilder *b, TACOperand arg1, TACOperand arg2) {
+    TACInstr instr = {0};
+    instr.kind = TAC_IFZ;
+    instr.dst = TAC_NONE; // Ifz does not have a destination
+    instr.arg1 = arg1; // The first argument is the operand to check
+    instr.arg2 = arg2; // The second argument is the label to jump to
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_if_cmp(TACBuilder *b, TACBinOp rel, TACOperand arg1, TACOperand arg2, TACOperand label) {
+    TACInstr instr = {0};
+    instr.kind = TAC_IF_CMP;
+    instr.op.binop = rel; // The relation to test
+    instr.dst = label; // The label to jump to when the relation holds
+    instr.arg1 = arg1;
+    instr.arg2 = arg2;
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_select(TACBuilder *b, TACOperand dst, TACOperand cond, TACOperand if_true, TACOperand if_false) {
+    TACInstr instr = {0};
+    instr.kind = TAC_SELECT;
+    instr.dst = dst;
+    instr.arg1 = cond; // Tested against zero, like ifz
+    instr.arg2 = if_true;
+    instr.arg3 = if_false;
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_phi(TACBuilder *b, TACOperand dst, const TACOperand *args, size_t count) {
+    TACInstr instr = {0};
+    instr.kind = TAC_PHI;
+    instr.dst = dst;
+    instr.arg1 = tac_literal(tac_phi_alloc(count)); // First argument in the pool
+    instr.arg2 = tac_literal((int)count);
+    memcpy(tac_phi_args(&instr), args, count * sizeof(TACOperand));
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_param(TACBuilder *b, TACOperand arg1) {
+    TACInstr instr = {0};
+    instr.kind = TAC_PUSH;
+    instr.dst = TAC_NONE; // Param does not have a destination
+    instr.arg1 = arg1; // The first argument is the parameter to pass
+    instr.arg2 = TAC_NONE; // Param does not have a second argument
+    return tac_builder_push(b, instr);
+}
+TACInstr *tac_emit_arg(TACBuilder *b, TACOperand arg1) {
+    TACInstr instr = {0};
+    instr.kind = TAC_POP;
+    instr.dst = TAC_NONE; // Param does not have a destination
+    instr.arg1 = arg1; // The first argument is the parameter to pass
+    instr.arg2 = TAC_NONE; // Param does not have a second argument
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_call(TACBuilder *b,
+                        TACOperand dst,
+                        TACOperand arg1,
+                        int n_args)
+{
+    TACInstr instr = {0};
+    instr.kind = TAC_CALL;
+    instr.dst = dst; // The destination for the result of the call
+    instr.arg1 = arg1; // The function to call
+    // The number of arguments is a literal operand
+    instr.arg2 = tac_literal(n_args);
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_return(TACBuilder *b, TACOperand arg1) {
+    TACInstr instr = {0};
+    instr.kind = TAC_RETURN;
+    instr.dst = TAC_NONE; // Return does not have a destination
+    instr.arg1 = arg1; // The operand to return, TAC_NONE for void return
+    instr.arg2 = TAC_NONE; // Return does not have a second argument
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_function(TACBuilder *b, TACOperand dst) {
+    TACInstr instr = {0};
+    instr.kind = TAC_FUNCTION;
+    instr.dst = dst; // The function name as a label
+    TACInstr *header = tac_builder_push(b, instr);
+    // The temp and label counts, kept up to date as ids are handed out
+    tac_function_sync_header(tac_builder_function(b));
+    return header;
+}
+
+TACInstr *tac_emit_end_function(TACBuilder *b) {
+    TACInstr instr = {0};
+    instr.kind = TAC_END_FUNCTION;
+    instr.dst = TAC_NONE; // End function does not have a destination
+    instr.arg1 = TAC_NONE; // End function does not have an argument
+    instr.arg2 = TAC_NONE; // End function does not have a second argument
+    return tac_builder_push(b, instr);
+}
+
+TACInstr *tac_emit_define(TACBuilder *b, TACOperand dst, TACOperand arg1) {
+    TACInstr instr = {0};
+    instr.kind = TAC_DEFINE;
+    instr.dst = dst; // The destination for the defined variable
+    instr.arg1 = arg1; // The argument to define, can be TAC_NONE
+    instr.arg2 = TAC_NONE; // Define does not have a second argument
+    return tac_builder_push(b, instr);
+}
@@ -4,284 +4,209 @@
 #include "tac.h"
 #include "ast.h"
 #include <stdio.h>
+#include <string.h>
 
-// joins two TAC instruction lists
-// if a is empty, returns b
-// else appends b to the end of a and returns a
-TACInstr *tac_concat(TACInstr *a, TACInstr *b) {
-    if (!a) return b;
-    TACInstr *p = a;
-    while (p->next) p = p->next;
-    p->next = b;
-    return a;
+/* The destination an expression writes: the hint if there is one, else a new temp */
+static TACOperand tac_result(TACBuilder *b, TACOperand dest) {
+    return dest.type != TAC_OP_NONE ? dest : tac_temp(tac_builder_new_temp(b));
 }
 
-/* Returns a new operand and, if needed, a list of instructions that compute it */
-TACInstr *tac_get_operand(AstNode *ast, TACOperand **out, int *temp_counter) {
-    if (ast->type == AST_LITERAL) {
-        *out = tac_create_operand(TAC_OP_LITERAL, NULL, ast->data.literal.value);
-        return NULL;
-    }
-    if (ast->type == AST_VARIABLE) {
-        *out = tac_create_operand(TAC_OP_VAR, ast->data.variable.identifier, 0);
-        return NULL;
-    }
-    /* otherwise it’s a sub-expression; recurse */
-    TACInstr *code = tac_parse(ast, temp_counter);
-    TACInstr *last = code;
-    while (last && last->next) last = last->next;
-    *out = last ? last->dst : NULL;
-    return code;
-}
-
-
 /* Parse a binary expression */
-TACInstr *tac_parse_binary_expression(AstNode *ast, int *temp_counter) {
-    TACOperand *lhs, *rhs;
-    TACInstr *code_l = tac_get_operand(ast->data.binary.left,  &lhs, temp_counter);
-    TACInstr *code_r = tac_get_operand(ast->data.binary.right, &rhs, temp_counter);
-
-    TACOperand *dst = tac_create_operand(TAC_OP_TEMP, NULL, (*temp_counter)++);
-    TACInstr   *op  = tac_emit_binary_op(tac_get_binop(ast), dst, lhs, rhs);
+TACOperand tac_parse_binary_expression(AstNode *ast, TACBuilder *b, TACOperand dest) {
+    TACOperand lhs = tac_parse_expression(ast->data.binary.left,  b, TAC_NONE);
+    TACOperand rhs = tac_parse_expression(ast->data.binary.right, b, TAC_NONE);
 
-    return tac_concat(tac_concat(code_l, code_r), op);
+    TACOperand dst = tac_result(b, dest);
+    tac_emit_binary_op(b, tac_get_binop(ast), dst, lhs, rhs);
+    return dst;
 }
 
 /* Parse a unary expression */
-TACInstr *tac_parse_unary_expression(AstNode *ast, int *temp_counter) {
-    TACOperand *src;
-    TACInstr *code = tac_get_operand(ast->data.unary.operand, &src, temp_counter);
-
-    TACOperand *dst = tac_create_operand(TAC_OP_TEMP, NULL, (*temp_counter)++);
-    TACInstr   *op  = tac_emit_unary_op(tac_get_unop(ast), dst, src);
+TACOperand tac_parse_unary_expression(AstNode *ast, TACBuilder *b, TACOperand dest) {
+    TACOperand src = tac_parse_expression(ast->data.unary.operand, b, TAC_NONE);
 
-    return tac_concat(code, op);
+    TACOperand dst = tac_result(b, dest);
+    tac_emit_unary_op(b, tac_get_unop(ast), dst, src);
+    return dst;
 }
 
-TACInstr *tac_parse_literal(AstNode *ast, int *temp_counter) {
-    TACOperand *dst = tac_create_operand(TAC_OP_TEMP, NULL, (*temp_counter)++);
-    TACOperand *literal = tac_create_operand(TAC_OP_LITERAL, NULL, ast->data.literal.value);
-    TACInstr *instr = tac_emit_copy(dst, literal);
-    return instr;
+/* Literals and variables are used in place; they are only copied
+   when the caller asks for the value in a specific destination */
+TACOperand tac_parse_literal(AstNode *ast, TACBuilder *b, TACOperand dest) {
+    TACOperand literal = tac_literal(ast->data.literal.value);
+    if (dest.type == TAC_OP_NONE) return literal;
+    tac_emit_copy(b, dest, literal);
+    return dest;
 }
 
-TACInstr *tac_parse_variable(AstNode *ast, int *temp_counter) {
-    TACOperand *dst = tac_create_operand(TAC_OP_TEMP, NULL, (*temp_counter)++);
-    TACOperand *var = tac_create_operand(TAC_OP_VAR, ast->data.variable.identifier, 0);
-    TACInstr *instr = tac_emit_copy(dst, var);
-    return instr;
+TACOperand tac_parse_variable(AstNode *ast, TACBuilder *b, TACOperand dest) {
+    TACOperand var = tac_var(ast->data.variable.identifier);
+    if (dest.type == TAC_OP_NONE || tac_operand_equal(dest, var)) return var;
+    tac_emit_copy(b, dest, var);
+    return dest;
 }
 
-TACInstr *tac_parse_block(AstNode *ast, int *temp_counter) {
-    TACInstr *code = NULL;
+void tac_parse_block(AstNode *ast, TACBuilder *b) {
     for (size_t i = 0; i < ast->data.block.count; i++) {
-        TACInstr *stmt_code = tac_parse(ast->data.block.statements[i], temp_counter);
-        code = tac_concat(code, stmt_code);
+        if (ast->data.block.statements[i]) {
+            tac_parse_node(ast->data.block.statements[i], b);
+        }
     }
-    return code;
 }
 
-TACInstr *tac_parse_if_statement(AstNode *ast, int *temp_counter) {
-    // 1) Evaluate condition and emit code
-    TACOperand *cond;
-    TACInstr  *cond_code = tac_get_operand(ast->data.if_stmt.condition, &cond, temp_counter);
-
-    // 2) Create label operators: else always, end only if an else-block exists
-    TACOperand *label_then = tac_create_operand(TAC_OP_LABEL, NULL, (*temp_counter)++);
-    TACOperand *label_end  = ast->data.if_stmt.else_block
-                            ? tac_create_operand(TAC_OP_LABEL, NULL, (*temp_counter)++)
-                            : NULL;
-
-    // 3) Emit branch-on-zero to then label and label for then block
-    TACInstr *branch = tac_emit_ifz(cond, label_then);
-    TACInstr *label_then_code = tac_emit_label(label_then);
-
-    // 4) Parse 'then' block
-    TACInstr *then_code = tac_parse(ast->data.if_stmt.then_block, temp_counter);
-
-    // 5) if else block exists, emit a jump over it
-    //    parse the else block and emit its label
-    TACInstr *jump_over_else = NULL;
-    TACInstr *else_code = NULL;
-    TACInstr *label_end_code = NULL;
-    if (ast->data.if_stmt.else_block) {
-        jump_over_else = tac_emit_goto(label_end);
-        else_code = tac_parse(ast->data.if_stmt.else_block, temp_counter);
-        label_end_code = tac_emit_label(label_end);
+/* Emit a jump to `label` taken when `cond` is false.
+   A comparison becomes a single if_<rel> on the negated relation;
+   any other condition is materialized and tested with ifz */
+static void tac_parse_branch_if_false(AstNode *cond, int label, TACBuilder *b) {
+    if (cond->type == AST_BINARY_OP && tac_is_relational(tac_get_binop(cond))) {
+        TACOperand lhs = tac_parse_expression(cond->data.binary.left,  b, TAC_NONE);
+        TACOperand rhs = tac_parse_expression(cond->data.binary.right, b, TAC_NONE);
+        tac_emit_if_cmp(b, tac_negate_relation(tac_get_binop(cond)), lhs, rhs, tac_label(label));
+        return;
     }
-
- 
-    // 7) Build the instruction sequence
-    TACInstr *seq = NULL;
-    seq = tac_concat(cond_code, branch);
-    seq = tac_concat(seq, then_code);
-    seq = tac_concat(seq, jump_over_else);
-    seq = tac_concat(seq, label_then_code);
-    seq = tac_concat(seq, else_code);
-    seq = tac_concat(seq, label_end_code);
-    
-
-    return seq;
+    TACOperand value = tac_parse_expression(cond, b, TAC_NONE);
+    tac_emit_ifz(b, value, tac_label(label));
 }
 
-TACInstr *tac_parse_assignment(AstNode *ast, int *temp_counter) {
-    // 1) Get the LHS variable operand (no code emitted here)
-    TACOperand *var;
-    TACInstr    *lhs_code = tac_get_operand(ast->data.assignment.variable,
-                                            &var, temp_counter);
-
-    // 2) Compute the RHS expression (may emit code, result in 'value')
-    TACOperand *value = NULL;
-    TACInstr   *rhs_code = tac_get_operand(ast->data.assignment.value,
-                                           &value, temp_counter);
-
-    
-    // 3) If the RHS is a literal, we can emit a copy directly
-    if(!rhs_code){
-        TACInstr   *store = tac_emit_copy(var, value);
-        return store;
-    }
+void tac_parse_if_statement(AstNode *ast, TACBuilder *b) {
+    // 1) Create label ids: else always, end only if an else-block exists
+    int label_then = tac_builder_new_label(b);
+    int label_end  = ast->data.if_stmt.else_block ? tac_builder_new_label(b) : -1;
 
-    TACInstr *tail = rhs_code;
-    while (tail->next) {
-        tail = tail->next;
-    }
-    tail->dst = var;
+    // 2) Evaluate the condition and branch to the else label when it fails
+    tac_parse_branch_if_false(ast->data.if_stmt.condition, label_then, b);
 
-    return rhs_code;
-}
+    // 3) Parse 'then' block
+    tac_parse_node((AstNode *)ast->data.if_stmt.then_block, b);
 
+    // 4) if else block exists, emit a jump over it,
+    //    then the label for the else block and the block itself
+    if (ast->data.if_stmt.else_block) {
+        tac_emit_goto(b, tac_label(label_end));
+        tac_emit_label(b, tac_label(label_then));
+        tac_parse_node((AstNode *)ast->data.if_stmt.else_block, b);
+        tac_emit_label(b, tac_label(label_end));
+    } else {
+        tac_emit_label(b, tac_label(label_then));
+    }
+}
 
-TACInstr *tac_parse_return(AstNode *ast, int *temp_counter) {
+void tac_parse_assignment(AstNode *ast, TACBuilder *b) {
+    // 1) Get the LHS variable operand (no code emitted here)
+    TACOperand var = tac_var(ast->data.assignment.variable->data.variable.identifier);
 
-    // 2) Compute the RHS expression (may emit code, result in 'value')
-    TACOperand *value = NULL;
-    TACInstr   *rhs_code = tac_get_operand(ast->data.return_stmt.expression,
-                                           &value, temp_counter);
+    // 2) Compute the RHS straight into the variable
+    tac_parse_expression(ast->data.assignment.value, b, var);
+}
 
-    
-    // 3) If the RHS is a literal, we can emit a copy directly
-    if(!rhs_code){
-        TACInstr   *store = tac_emit_return(value);
-        return store;
-    }
 
-    TACInstr *tail = rhs_code;
-    while (tail->next) {
-        tail = tail->next;
+void tac_parse_return(AstNode *ast, TACBuilder *b) {
+    if (!ast->data.return_stmt.expression) {
+        tac_emit_return(b, TAC_NONE);
+        return;
     }
-    tail->dst =  tac_create_operand(TAC_OP_TEMP, NULL, (*temp_counter)++);
-
-    return rhs_code;
-    
 
+    // Compute the returned expression (may emit code, result in 'value')
+    TACOperand value = tac_parse_expression(ast->data.return_stmt.expression, b, TAC_NONE);
+    tac_emit_return(b, value);
 }
 
-TACInstr *tac_parse_args(AstNode *ast, int *temp_counter) {
-    TACInstr *code = NULL;
+void tac_parse_args(AstNode *ast, TACBuilder *b) {
     for (size_t i = 0; i < ast->data.params.count; i++) {
         AstNode *param = ast->data.params.params[i];
-        TACOperand *param_op = tac_create_operand(TAC_OP_VAR, param->data.variable.identifier, 0);
-        TACInstr *param_instr = tac_emit_arg(param_op);
-        code = tac_concat(code, param_instr);
+        TACOperand param_op = tac_create_operand(TAC_OP_VAR, param->data.variable.identifier, 0);
+        tac_emit_arg(b, param_op);
     }
-    return code;
 }
 
-TACInstr *tac_parse_function(AstNode *ast, int *temp_counter) {
-    // 1) Create a label for the function
-    TACOperand *label = tac_create_operand(TAC_OP_VAR, ast->data.function.name->data.variable.identifier, 0);
-    TACInstr *function_instr = tac_emit_function(label);
+void tac_parse_function(AstNode *ast, TACBuilder *b) {
+    // 1) Start a new instruction array for the function
+    size_t enclosing = tac_builder_begin_function(b);
+    TACOperand label = tac_create_operand(TAC_OP_VAR, ast->data.function.name->data.variable.identifier, 0);
+    tac_emit_function(b, label);
     // 2) Parse the parameters and emit parameter instructions
-    TACInstr *param_code = tac_parse_args(ast->data.function.params, temp_counter);
+    tac_parse_args(ast->data.function.params, b);
     // 3) Parse the function body
-    TACInstr *body_code = tac_parse(ast->data.function.body, temp_counter);
-    // 4) Concatenate all parts
-    TACInstr *code = tac_concat(function_instr, param_code);
-    code = tac_concat(code, body_code);
-    // 5) Add end function instruction
-    TACInstr *end_function_instr = tac_emit_end_function();
-    code = tac_concat(code, end_function_instr);
-    
-    // 6) Return the complete function code
-    return code;
-
+    tac_parse_node((AstNode *)ast->data.function.body, b);
+    // 4) Add end function instruction
+    tac_emit_end_function(b);
+    // 5) Continue with the enclosing function (or global code)
+    tac_builder_end_function(b, enclosing);
 }
 
-TACInstr *tac_parse_call(AstNode *ast, int *temp_counter) {
-    // 1) Evaluate arguments (which emits PARAM instrs), collecting any code
-    TACInstr *args_code = NULL;
+TACOperand tac_parse_call(AstNode *ast, TACBuilder *b, TACOperand dest) {
+    // 1) Evaluate arguments and emit a PUSH for each
     for (size_t i = 0; ast->data.call.args && i < ast->data.call.args->data.args.count; i++) {
         AstNode *arg = ast->data.call.args->data.args.arguments[i];
-        TACOperand *op;
-        TACInstr   *code = tac_get_operand(arg, &op, temp_counter);
-        args_code = tac_concat(args_code, code);
-        args_code = tac_concat(args_code, tac_emit_param(op));
+        TACOperand op = tac_parse_expression(arg, b, TAC_NONE);
+        tac_emit_param(b, op);
     }
 
-    // 2) Allocate a temp for the call’s result
-    TACOperand *result = tac_create_operand(TAC_OP_TEMP, NULL, (*temp_counter)++);
+    // 2) The call’s result goes to the destination, or a new temp
+    TACOperand result = tac_result(b, dest);
 
     // 3) Emit the call itself (it writes into ‘result’)
-    TACOperand *func = tac_create_operand(
+    TACOperand func = tac_create_operand(
         TAC_OP_VAR,
         ast->data.call.callee->data.variable.identifier,
         0
     );
-    TACInstr *call_instr = tac_emit_call(result, func, 
-                          ast->data.call.args ? ast->data.call.args->data.args.count : 0);
-
-    // 4) Concatenate and return
-    return tac_concat(args_code, call_instr);
+    tac_emit_call(b, result, func,
+                  ast->data.call.args ? ast->data.call.args->data.args.count : 0);
+    return result;
 }
 
-TACInstr *tac_parse_parameters(AstNode *ast, int *temp_counter) {
-    TACInstr *code = NULL;
+void tac_parse_parameters(AstNode *ast, TACBuilder *b) {
     for (size_t i = 0; i < ast->data.params.count; i++) {
         AstNode *param = ast->data.params.params[i];
-        TACInstr *param_code = tac_parse(param, temp_counter);
-        if (param_code) {
-            code = tac_concat(code, param_code);
-        }
-        TACInstr *param_instr = tac_emit_param(param_code ? param_code->dst : NULL);
-        code = tac_concat(code, param_instr);
+        TACOperand op = tac_parse_expression(param, b, TAC_NONE);
+        tac_emit_param(b, op);
     }
-    return code;
 }
 
-TACInstr *tac_parse_while_loop(AstNode *ast, int *temp_counter) {
+void tac_parse_while_loop(AstNode *ast, TACBuilder *b) {
     // 1) Create a label for the start of the loop
-    TACOperand *label_start = tac_create_operand(TAC_OP_LABEL, NULL, (*temp_counter)++);
-    TACInstr *label_start_instr = tac_emit_label(label_start);
+    int label_start = tac_builder_new_label(b);
+    tac_emit_label(b, tac_label(label_start));
 
-    // 2) Evaluate the condition
-    TACOperand *cond;
-    TACInstr *cond_code = tac_get_operand(ast->data.while_loop.condition, &cond, temp_counter);
+    // 2) Create a label for the end of the loop
+    int label_end = tac_builder_new_label(b);
 
-    // 3) Create a label for the end of the loop
-    TACOperand *label_end = tac_create_operand(TAC_OP_LABEL, NULL, (*temp_counter)++);
-    
-    // 4) Emit branch on zero to end label
-    TACInstr *branch = tac_emit_ifz(cond, label_end);
+    // 3) Evaluate the condition, leaving the loop when it fails
+    tac_parse_branch_if_false(ast->data.while_loop.condition, label_end, b);
 
-    // 5) Parse the body of the loop
-    TACInstr *body_code = tac_parse(ast->data.while_loop.body, temp_counter);
+    // 4) Parse the body of the loop
+    tac_parse_node((AstNode *)ast->data.while_loop.body, b);
 
-    // 6) Emit a jump back to the start of the loop
-    TACInstr *jump_back = tac_emit_goto(label_start);
+    // 5) Emit a jump back to the start of the loop
+    tac_emit_goto(b, tac_label(label_start));
 
-    // 7) Emit the end label
-    TACInstr *label_end_instr = tac_emit_label(label_end);
+    // 6) Emit the end label
+    tac_emit_label(b, tac_label(label_end));
+}
 
-    // 8) Concatenate all parts and return
-    return tac_concat(tac_concat(tac_concat(tac_concat(label_start_instr, cond_code), branch),
-                                 body_code), 
-                      tac_concat(jump_back, label_end_instr));
+/* Whether the expression reads the variable `name` */
+static int tac_mentions(const AstNode *ast, const char *name) {
+    switch (ast->type) {
+        case AST_VARIABLE:
+            return strcmp(ast->data.variable.identifier, name) == 0;
+        case AST_BINARY_OP:
+            return tac_mentions(ast->data.binary.left, name) || tac_mentions(ast->data.binary.right, name);
+        case AST_UNARY_OP:
+            return tac_mentions(ast->data.unary.operand, name);
+        case AST_CALL:
+            for (size_t i = 0; ast->data.call.args && i < ast->data.call.args->data.args.count; i++) {
+                if (tac_mentions(ast->data.call.args->data.args.arguments[i], name)) return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
 }
 
-TACInstr *tac_parse_declaration(AstNode *ast, int *temp_counter) {
+void tac_parse_declaration(AstNode *ast, TACBuilder *b) {
     // 1) Create the variable operand for the new symbol:
-    TACOperand *var = tac_create_operand(
+    TACOperand var = tac_create_operand(
         TAC_OP_VAR,
         ast->data.declaration.variable->data.variable.identifier,
         0
@@ -289,65 +214,93 @@ TACInstr *tac_parse_declaration(AstNode *ast, int *temp_counter) {
 
     // 2) If there is no initializer, just emit a DEFINE with no value:
     if (!ast->data.declaration.value) {
-        return tac_emit_define(var, NULL);
+        tac_emit_define(b, var, TAC_NONE);
+        return;
     }
 
-    // 3) Otherwise, compute the initializer into a temp and
-    //    then retarget its final dst to our new var:
-    TACOperand *init_val;
-    TACInstr   *init_code = tac_get_operand(
-        ast->data.declaration.value,
-        &init_val,
-        temp_counter
-    );
-
-    // If the initializer was a bare literal/var, tac_get_operand returns NULL
-    // but does give us init_val, so make sure there's at least one instruction:
-    if (!init_code) {
-        // emit a one-off COPY literal/var→temp
-        return tac_emit_define(var, init_val);
+    // 3) A literal or variable initializer stays in the define, and so does
+    //    one reading the name it declares (def g = g + 1 reads the g
+    //    declared before), computed into a temp first; anything else is
+    //    defined first and then computed into the variable
+    AstNode *value = ast->data.declaration.value;
+    const char *name = ast->data.declaration.variable->data.variable.identifier;
+    if (value->type == AST_LITERAL || value->type == AST_VARIABLE || tac_mentions(value, name)) {
+        tac_emit_define(b, var, tac_parse_expression(value, b, TAC_NONE));
+        return;
     }
-
- 
-    TACInstr *def = tac_emit_define(var, init_val);
-    return tac_concat(init_code, def);
+    tac_emit_define(b, var, TAC_NONE);
+    tac_parse_expression(value, b, var);
 }
 
 
+/* Dispatch an expression node; see tac_parse.h for `dest` */
+TACOperand tac_parse_expression(AstNode *ast, TACBuilder *b, TACOperand dest) {
+    switch (ast->type) {
+        case AST_BINARY_OP:
+            return tac_parse_binary_expression(ast, b, dest);
+        case AST_UNARY_OP:
+            return tac_parse_unary_expression(ast, b, dest);
+        case AST_LITERAL:
+            return tac_parse_literal(ast, b, dest);
+        case AST_VARIABLE:
+            return tac_parse_variable(ast, b, dest);
+        case AST_CALL:
+            return tac_parse_call(ast, b, dest);
+
+        default:
+            fprintf(stderr, "Unsupported expression node type %d\n", ast->type);
+            return TAC_NONE;
+    }
+}
+
 /* Dispatch based on AST node */
-TACInstr *tac_parse(AstNode *ast, int *temp_counter) {
+void tac_parse_node(AstNode *ast, TACBuilder *b) {
     switch (ast->type) {
         case AST_BINARY_OP:
-            return tac_parse_binary_expression(ast, temp_counter);
         case AST_UNARY_OP:
-            return tac_parse_unary_expression(ast, temp_counter);
         case AST_LITERAL:
-            return tac_parse_literal(ast, temp_counter);
         case AST_VARIABLE:
-            return tac_parse_variable(ast, temp_counter);
-        case AST_BLOCK: 
-            return tac_parse_block(ast, temp_counter);
+        case AST_CALL:
+            // An expression statement; its value is unused
+            tac_parse_expression(ast, b, TAC_NONE);
+            break;
+        case AST_BLOCK:
+            tac_parse_block(ast, b);
+            break;
         case AST_IF:
-            return tac_parse_if_statement(ast, temp_counter);
+            tac_parse_if_statement(ast, b);
+            break;
         case AST_ASSIGNMENT:
-            return tac_parse_assignment(ast, temp_counter);
+            tac_parse_assignment(ast, b);
+            break;
         case AST_RETURN:
-            return tac_parse_return(ast, temp_counter);
+            tac_parse_return(ast, b);
+            break;
         case AST_FUNCTION:
-            return tac_parse_function(ast, temp_counter);
-        case AST_CALL:
-            return tac_parse_call(ast, temp_counter);
+            tac_parse_function(ast, b);
+            break;
         case AST_PARAM_LIST:
-            return tac_parse_parameters(ast, temp_counter);
+            tac_parse_parameters(ast, b);
+            break;
         case AST_WHILE:
-            return tac_parse_while_loop(ast, temp_counter);
+            tac_parse_while_loop(ast, b);
+            break;
         case AST_DECLARATION:
-            return tac_parse_declaration(ast, temp_counter);
+            tac_parse_declaration(ast, b);
+            break;
 
-        
-        /* future AST cases: ASSIGN, CALL, IF, WHILE, etc. */
+        /* future AST cases */
         default:
             fprintf(stderr, "Unsupported AST node type %d\n", ast->type);
-            return NULL;
+            break;
     }
-}
\ No newline at end of file
+}
+
+/* Lower a whole program into per-function instruction arrays */
+TACProgram *tac_parse(AstNode *ast) {
+    TACProgram *program = tac_program_create();
+    TACBuilder b;
+    tac_builder_init(&b, program);
+    tac_parse_node(ast, &b);
+    return program;
+}
@@ -1,13 +1,15 @@
 #include "tac_print.h"
+#include "tac_emit.h"
 #include "tac_util.h"
+#include "intern.h"
 #include <stdio.h>
 
 /* Formatting for operands */
 void tac_print_operand(const TACOperand *op) {
-    if (!op) return;
+    if (!op || op->type == TAC_OP_NONE) return;
     switch (op->type) {
       case TAC_OP_TEMP:    printf("t%d",   op->literal); break;
-      case TAC_OP_VAR:     printf("%s",    op->name);    break;
+      case TAC_OP_VAR:     printf("%s",    interned_name(op->sym)); break;
       case TAC_OP_LITERAL: printf("%d",    op->literal); break;
       case TAC_OP_LABEL:   printf("L%d",   op->literal); break;
       default:             printf("<?>");                break;
@@ -20,46 +22,72 @@ void tac_print_instr(const TACInstr *p) {
 
     switch (p->kind) {
       case TAC_BINARY_OP:
-        tac_print_operand(p->dst); printf(" ← ");
-        tac_print_operand(p->arg1); printf(" %s ", tac_binop_str(p->op.binop));
-        tac_print_operand(p->arg2); printf("\n");
+        tac_print_operand(&p->dst); printf(" ← ");
+        tac_print_operand(&p->arg1); printf(" %s ", tac_binop_str(p->op.binop));
+        tac_print_operand(&p->arg2); printf("\n");
         break;
 
       case TAC_UNARY_OP:
-        tac_print_operand(p->dst); printf(" ← %s ", tac_unop_str(p->op.unop));
-        tac_print_operand(p->arg1); printf("\n");
+        tac_print_operand(&p->dst); printf(" ← %s ", tac_unop_str(p->op.unop));
+        tac_print_operand(&p->arg1); printf("\n");
         break;
 
       case TAC_COPY:
-        tac_print_operand(p->dst); printf(" ← ");
-        tac_print_operand(p->arg1); printf("\n");
+        tac_print_operand(&p->dst); printf(" ← ");
+        tac_print_operand(&p->arg1); printf("\n");
         break;
 
       case TAC_LABEL:
-        if (p->dst)
-            printf("L%d:\n", p->dst->literal);
+        if (p->dst.type != TAC_OP_NONE)
+            printf("L%d:\n", p->dst.literal);
         else
             printf("L<?>:\n");
         break;
 
       case TAC_GOTO:
-        if (p->arg1)
-            printf("goto L%d\n", p->arg1->literal);
+        if (p->arg1.type != TAC_OP_NONE)
+            printf("goto L%d\n", p->arg1.literal);
         else
             printf("goto L<?>?\n");
         break;
 
       case TAC_IFZ:
-        if (p->arg1 && p->arg2)
-            printf("ifz t%d goto L%d\n", p->arg1->literal, p->arg2->literal);
+        if (p->arg1.type != TAC_OP_NONE && p->arg2.type != TAC_OP_NONE) {
+            printf("ifz ");
+            tac_print_operand(&p->arg1);
+            printf(" goto L%d\n", p->arg2.literal);
+        }
         else
             printf("ifz ? goto ?\n");
         break;
 
+      case TAC_IF_CMP:
+        printf("if_%s ", tac_relation_mnemonic(p->op.binop));
+        tac_print_operand(&p->arg1); printf(" ");
+        tac_print_operand(&p->arg2);
+        printf(" goto L%d\n", p->dst.literal);
+        break;
+
+      case TAC_SELECT:
+        tac_print_operand(&p->dst); printf(" ← select ");
+        tac_print_operand(&p->arg1); printf(" ");
+        tac_print_operand(&p->arg2); printf(" ");
+        tac_print_operand(&p->arg3); printf("\n");
+        break;
+
+      case TAC_PHI:
+        tac_print_operand(&p->dst); printf(" ← phi");
+        for (size_t k = 0; k < tac_phi_arg_count(p); k++) {
+            printf(" ");
+            tac_print_operand(&tac_phi_args(p)[k]);
+        }
+        printf("\n");
+        break;
+
       case TAC_RETURN:
-        if (p->arg1) {
+        if (p->arg1.type != TAC_OP_NONE) {
             printf("return ");
-            tac_print_operand(p->arg1);
+            tac_print_operand(&p->arg1);
             printf("\n");
         } else {
             printf("return\n");
@@ -67,40 +95,43 @@ void tac_print_instr(const TACInstr *p) {
         break;
 
       case TAC_FUNCTION:
-        if (p->dst)
-            printf("fun %s:\n", p->dst->name);
+        if (p->dst.type != TAC_OP_NONE && p->arg1.type == TAC_OP_LITERAL)
+            printf("fun %s: ; %d temps, %d labels\n", interned_name(p->dst.sym),
+                   p->arg1.literal, p->arg2.literal);
+        else if (p->dst.type != TAC_OP_NONE)
+            printf("fun %s:\n", interned_name(p->dst.sym));
         else
             printf("fun <?>:\n");
         break;
 
       case TAC_PUSH:
         printf("push ");
-        tac_print_operand(p->arg1);
+        tac_print_operand(&p->arg1);
         printf("\n");
         break;
       case TAC_POP:
         printf("pop ");
-        tac_print_operand(p->arg1);
+        tac_print_operand(&p->arg1);
         printf("\n");
         break;
 
       case TAC_CALL:
-        printf("t%d ← call %s %d\n",
-               p->dst ? p->dst->literal : -1,
-               p->arg1 ? p->arg1->name : "<??>",
-               p->arg2 ? p->arg2->literal : 0);
+        tac_print_operand(&p->dst);
+        printf(" ← %scall %s %d\n", p->op.tail ? "tail " : "",
+               p->arg1.type == TAC_OP_VAR ? interned_name(p->arg1.sym) : "<??>",
+               p->arg2.literal);
         break;
 
       case TAC_END_FUNCTION:
         printf("endfun\n\n");
         break;
       case TAC_DEFINE:
-          if (p->dst) {
-              printf("define %s", p->dst->name);
-              if (p->arg1) {
+          if (p->dst.type != TAC_OP_NONE) {
+              printf("define %s", interned_name(p->dst.sym));
+              if (p->arg1.type != TAC_OP_NONE) {
                   // print the initial value
                   printf(" = ");
-                  tac_print_operand(p->arg1);
+                  tac_print_operand(&p->arg1);
               }
               printf("\n");
           } else {
@@ -135,15 +166,16 @@ static void label_stack_pop(LabelStack *s) {
 }
 
 /* Iterate and print a list with line numbers and nested indent for IF/ELSE */
-void tac_print_list(TACInstr *head) {
+void tac_print_list(const TACInstr *instrs, size_t count) {
     int lineno = 1;
     int indent_level = 0;
     LabelStack label_stack = {0};
 
-    for (const TACInstr *p = head; p; p = p->next, ++lineno) {
+    for (size_t i = 0; i < count; i++, ++lineno) {
+        const TACInstr *p = &instrs[i];
         /* Handle label ending an IF block */
         if (p->kind == TAC_LABEL && label_stack.top > 0 &&
-            p->dst && p->dst->literal == label_stack_peek(&label_stack)) {
+            p->dst.literal == label_stack_peek(&label_stack)) {
             label_stack_pop(&label_stack);
             indent_level--;
         }
@@ -160,8 +192,8 @@ void tac_print_list(TACInstr *head) {
         tac_print_instr(p);
 
         /* Increase indent for new blocks */
-        if (p->kind == TAC_IFZ && p->arg2) {
-            label_stack_push(&label_stack, p->arg2->literal);
+        if ((p->kind == TAC_IFZ || p->kind == TAC_IF_CMP) && tac_jump_target(p) >= 0) {
+            label_stack_push(&label_stack, tac_jump_target(p));
             indent_level++;
         } else if (p->kind == TAC_FUNCTION) {
             indent_level++;
@@ -169,4 +201,9 @@ void tac_print_list(TACInstr *head) {
     }
 }
 
-
+/* Print every function of a program */
+void tac_print_program(const TACProgram *program) {
+    for (size_t i = 0; i < program->count; i++) {
+        tac_print_list(program->functions[i].instrs, program->functions[i].count);
+    }
+}
@@ -0,0 +1,452 @@
+#include "tac_read.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+// A jump to label of program->functions[function], checked once all is read
+typedef struct {
+    size_t function;
+    int    label;
+    int    line;            // of the jump
+} LabelRef;
+
+typedef struct {
+    const char *p;          // current position within the line
+    const char *eol;        // end of the current line, before any comment
+    const char *comment;    // text after ';' up to the newline, or NULL
+    const char *comment_end;
+    const char *filename;
+    int         line;
+    int         failed;
+    LabelRef   *refs;
+    size_t      ref_count;
+    size_t      ref_capacity;
+} TACReader;
+
+static const char tac_arrow[] = "\xe2\x86\x90";   // "←" in UTF-8
+
+static void reader_error_at(TACReader *r, int line, const char *what) {
+    if (r->failed) return;
+    fprintf(stderr, "%s:%d: TAC syntax error: %s\n", r->filename, line, what);
+    r->failed = 1;
+}
+
+static void reader_error(TACReader *r, const char *what) {
+    reader_error_at(r, r->line, what);
+}
+
+static int is_ident_start(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static int is_ident_char(char c) {
+    // '.' appears in the names of lifted functions (outer.inner)
+    return is_ident_start(c) || (c >= '0' && c <= '9') || c == '.';
+}
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static void skip_spaces(TACReader *r) {
+    while (r->p < r->eol && (*r->p == ' ' || *r->p == '\t' || *r->p == '\r')) r->p++;
+}
+
+static int at_end(TACReader *r) {
+    skip_spaces(r);
+    return r->p == r->eol;
+}
+
+// Consumes `word` if it is the next token (as a whole word)
+static int accept_word(TACReader *r, const char *word) {
+    skip_spaces(r);
+    size_t len = strlen(word);
+    if ((size_t)(r->eol - r->p) < len || memcmp(r->p, word, len) != 0) return 0;
+    if (r->p + len < r->eol && is_ident_char(r->p[len])) return 0;
+    r->p += len;
+    return 1;
+}
+
+// Consumes the literal text `s` if it comes next
+static int accept(TACReader *r, const char *s) {
+    skip_spaces(r);
+    size_t len = strlen(s);
+    if ((size_t)(r->eol - r->p) < len || memcmp(r->p, s, len) != 0) return 0;
+    r->p += len;
+    return 1;
+}
+
+// The digits from q to end as a value of at most limit; 0 with an error
+// past it, rather than wrapping around
+static int digits_value(TACReader *r, const char *q, const char *end, long limit, long *out) {
+    long value = 0;
+    for (; q < end; q++) {
+        int digit = *q - '0';
+        if (value > (limit - digit) / 10) {
+            reader_error(r, "number out of range");
+            return 0;
+        }
+        value = value * 10 + digit;
+    }
+    *out = value;
+    return 1;
+}
+
+static int read_int(TACReader *r, int *out) {
+    skip_spaces(r);
+    const char *q = r->p;
+    int negative = 0;
+    if (q < r->eol && *q == '-') { negative = 1; q++; }
+    if (q == r->eol || !is_digit(*q)) return 0;
+    const char *digits = q;
+    while (q < r->eol && is_digit(*q)) q++;
+    if (q < r->eol && is_ident_char(*q)) return 0;
+    long value;
+    if (!digits_value(r, digits, q, negative ? -(long)INT_MIN : INT_MAX, &value)) return 0;
+    r->p = q;
+    *out = (int)(negative ? -value : value);
+    return 1;
+}
+
+// <prefix><digits>, e.g. t4 or L2
+static int read_numbered(TACReader *r, char prefix, int *out) {
+    skip_spaces(r);
+    const char *q = r->p;
+    if (q == r->eol || *q != prefix) return 0;
+    q++;
+    if (q == r->eol || !is_digit(*q)) return 0;
+    const char *digits = q;
+    while (q < r->eol && is_digit(*q)) q++;
+    if (q < r->eol && is_ident_char(*q)) return 0;
+    long value;
+    if (!digits_value(r, digits, q, INT_MAX, &value)) return 0;
+    r->p = q;
+    *out = (int)value;
+    return 1;
+}
+
+static int read_name(TACReader *r, TACOperand *out) {
+    skip_spaces(r);
+    const char *start = r->p;
+    if (start == r->eol || !is_ident_start(*start)) return 0;
+    const char *q = start;
+    while (q < r->eol && is_ident_char(*q)) q++;
+    r->p = q;
+    *out = (TACOperand){ .type = TAC_OP_VAR, .sym = intern_n(start, (size_t)(q - start)) };
+    return 1;
+}
+
+static int read_label(TACReader *r, TACOperand *out) {
+    int id;
+    if (!read_numbered(r, 'L', &id)) return 0;
+    *out = tac_label(id);
+    return 1;
+}
+
+// Notes a jump to label from the current line of the function being built
+static void add_label_ref(TACReader *r, TACBuilder *b, TACOperand label) {
+    if (r->ref_count >= r->ref_capacity) {
+        r->ref_capacity = r->ref_capacity ? r->ref_capacity * 2 : 16;
+        r->refs = realloc(r->refs, r->ref_capacity * sizeof(LabelRef));
+        if (!r->refs) {
+            printf("Memory allocation failed while reading TAC.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    size_t function = (size_t)(tac_builder_function(b) - b->program->functions);
+    r->refs[r->ref_count++] = (LabelRef){ function, label.literal, r->line };
+}
+
+// Every jump must go to a label of its own function
+static void check_label_refs(TACReader *r, const TACProgram *program) {
+    for (size_t i = 0; i < r->ref_count && !r->failed; i++) {
+        const LabelRef *ref = &r->refs[i];
+        if (tac_function_label_index(&program->functions[ref->function], ref->label) != TAC_NO_LABEL) continue;
+        char what[64];
+        snprintf(what, sizeof(what), "undefined label L%d", ref->label);
+        reader_error_at(r, ref->line, what);
+    }
+}
+
+// The "; N temps, M labels" tac_print writes after "fun f:"; 0 if the
+// comment is anything else, or with an error if the counts are invalid
+static int read_function_counts(TACReader *r, int *temps, int *labels) {
+    if (!r->comment) return 0;
+    TACReader h = *r;
+    h.p = r->comment;
+    h.eol = r->comment_end;
+    int found = read_int(&h, temps) && accept_word(&h, "temps") && accept(&h, ",")
+             && read_int(&h, labels) && accept_word(&h, "labels") && at_end(&h);
+    r->failed = h.failed;
+    if (found && (*temps < 0 || *labels < 0)) {
+        reader_error(r, "negative count in function header");
+        return 0;
+    }
+    return found;
+}
+
+// A temp, literal or variable
+static int read_operand(TACReader *r, TACOperand *out) {
+    int value;
+    if (read_numbered(r, 't', &value)) { *out = tac_temp(value);    return 1; }
+    if (read_int(r, &value))           { *out = tac_literal(value); return 1; }
+    return read_name(r, out);
+}
+
+static int read_binop(TACReader *r, TACBinOp *out) {
+    // Longest operators first so "<=" is not read as "<"
+    static const TACBinOp ops[] = {
+        TAC_SHL, TAC_SHR, TAC_EQ, TAC_NEQ, TAC_LTE, TAC_GTE, TAC_AND, TAC_OR,
+        TAC_LT, TAC_GT, TAC_ADD, TAC_SUB, TAC_MUL, TAC_DIV, TAC_MOD
+    };
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (accept(r, tac_binop_str(ops[i]))) {
+            *out = ops[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// The <rel> of if_<rel>
+static int read_relation(TACReader *r, TACBinOp *out) {
+    static const TACBinOp rels[] = { TAC_EQ, TAC_NEQ, TAC_LT, TAC_LTE, TAC_GT, TAC_GTE };
+    for (size_t i = 0; i < sizeof(rels) / sizeof(rels[0]); i++) {
+        if (accept_word(r, tac_relation_mnemonic(rels[i]))) {
+            *out = rels[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Unary operators are printed with a space ("- a"); "-5" is a literal
+static int read_unop(TACReader *r, TACUnaryOp *out) {
+    skip_spaces(r);
+    if (r->eol - r->p < 2 || (r->p[1] != ' ' && r->p[1] != '\t')) return 0;
+    if (r->p[0] == '-') *out = TAC_NEG;
+    else if (r->p[0] == '!') *out = TAC_NOT;
+    else return 0;
+    r->p++;
+    return 1;
+}
+
+// Arguments of "dst ← phi a b ...", up to the end of the line
+static void read_phi(TACReader *r, TACBuilder *b, TACOperand dst) {
+    TACOperand *args = NULL;
+    size_t count = 0, capacity = 0;
+    while (!at_end(r)) {
+        if (count >= capacity) {
+            capacity = capacity ? capacity * 2 : 4;
+            args = realloc(args, capacity * sizeof(TACOperand));
+            if (!args) {
+                printf("Memory allocation failed while reading TAC.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (!read_operand(r, &args[count++])) {
+            reader_error(r, "expected phi argument");
+            free(args);
+            return;
+        }
+    }
+    tac_emit_phi(b, dst, args, count);
+    free(args);
+}
+
+// dst ← [tail] call f n | dst ← select c a b | dst ← phi a b ... | dst ← op a | dst ← a op b | dst ← a
+static void read_assignment(TACReader *r, TACBuilder *b, TACOperand dst) {
+    TACOperand arg1, arg2, arg3;
+    TACBinOp binop;
+    TACUnaryOp unop;
+    int n_args;
+
+    const char *start = r->p;
+    int tail = accept_word(r, "tail");
+    if (tail && !accept_word(r, "call")) {
+        r->p = start;               // a variable named tail
+        tail = 0;
+    }
+    if (tail || accept_word(r, "call")) {
+        if (!read_name(r, &arg1) || !read_int(r, &n_args)) {
+            reader_error(r, "expected '[tail] call <function> <argument count>'");
+            return;
+        }
+        tac_emit_call(b, dst, arg1, n_args)->op.tail = tail;
+        return;
+    }
+    if (accept_word(r, "select")) {
+        if (!read_operand(r, &arg1) || !read_operand(r, &arg2) || !read_operand(r, &arg3)) {
+            reader_error(r, "expected 'select <cond> <operand> <operand>'");
+            return;
+        }
+        tac_emit_select(b, dst, arg1, arg2, arg3);
+        return;
+    }
+    if (accept_word(r, "phi")) {
+        read_phi(r, b, dst);
+        return;
+    }
+    if (read_unop(r, &unop)) {
+        if (!read_operand(r, &arg1)) { reader_error(r, "expected operand"); return; }
+        tac_emit_unary_op(b, unop, dst, arg1);
+        return;
+    }
+    if (!read_operand(r, &arg1)) { reader_error(r, "expected operand"); return; }
+    if (at_end(r)) {
+        tac_emit_copy(b, dst, arg1);
+        return;
+    }
+    if (!read_binop(r, &binop) || !read_operand(r, &arg2)) {
+        reader_error(r, "expected binary operator and operand");
+        return;
+    }
+    tac_emit_binary_op(b, binop, dst, arg1, arg2);
+}
+
+static void read_line(TACReader *r, TACBuilder *b, size_t *enclosing) {
+    TACOperand a, c, lhs;
+    TACBinOp rel;
+    int line_number;
+
+    // 1) "N: " prefix written by tac_print_list
+    const char *start = r->p;
+    if (!(read_int(r, &line_number) && accept(r, ":"))) r->p = start;
+
+    if (at_end(r)) return;
+
+    // 2) Keyword instructions
+    start = r->p;
+    if (accept_word(r, "fun")) {
+        if (!read_name(r, &a)) { reader_error(r, "expected function name"); return; }
+        accept(r, ":");
+        if (b->function != TAC_NO_FUNCTION) { reader_error(r, "'fun' inside a function"); return; }
+        *enclosing = tac_builder_begin_function(b);
+        tac_emit_function(b, a);
+        // The counts printed may include temps and labels no longer used
+        int temps, labels;
+        if (read_function_counts(r, &temps, &labels)) {
+            TACFunction *fn = tac_builder_function(b);
+            fn->temp_count = temps;
+            fn->label_count = labels;
+            tac_function_sync_header(fn);
+        }
+    } else if (accept_word(r, "endfun")) {
+        if (b->function == TAC_NO_FUNCTION) { reader_error(r, "'endfun' outside a function"); return; }
+        tac_emit_end_function(b);
+        tac_builder_end_function(b, *enclosing);
+    } else if (accept_word(r, "goto")) {
+        if (!read_label(r, &a)) { reader_error(r, "expected label"); return; }
+        tac_emit_goto(b, a);
+        add_label_ref(r, b, a);
+    } else if (accept_word(r, "ifz")) {
+        if (!read_operand(r, &a) || !accept_word(r, "goto") || !read_label(r, &c)) {
+            reader_error(r, "expected 'ifz <operand> goto <label>'");
+            return;
+        }
+        tac_emit_ifz(b, a, c);
+        add_label_ref(r, b, c);
+    } else if (accept(r, "if_") && read_relation(r, &rel)) {
+        if (!read_operand(r, &lhs) || !read_operand(r, &a)
+            || !accept_word(r, "goto") || !read_label(r, &c)) {
+            reader_error(r, "expected 'if_<rel> <operand> <operand> goto <label>'");
+            return;
+        }
+        tac_emit_if_cmp(b, rel, lhs, a, c);
+        add_label_ref(r, b, c);
+    } else if (accept_word(r, "push")) {
+        if (!read_operand(r, &a)) { reader_error(r, "expected operand"); return; }
+        tac_emit_param(b, a);
+    } else if (accept_word(r, "pop")) {
+        if (!read_operand(r, &a)) { reader_error(r, "expected operand"); return; }
+        tac_emit_arg(b, a);
+    } else if (accept_word(r, "return")) {
+        if (at_end(r)) {
+            tac_emit_return(b, TAC_NONE);
+        } else {
+            if (!read_operand(r, &a)) { reader_error(r, "expected operand"); return; }
+            tac_emit_return(b, a);
+        }
+    } else if (accept_word(r, "define")) {
+        if (!read_name(r, &a)) { reader_error(r, "expected variable name"); return; }
+        c = TAC_NONE;
+        if (accept(r, "=") && !read_operand(r, &c)) { reader_error(r, "expected operand"); return; }
+        tac_emit_define(b, a, c);
+    } else {
+        // 3) "L2:" or an assignment "dst ← ..."
+        r->p = start;
+        if (read_label(r, &a) && accept(r, ":")) {
+            if (tac_function_label_index(tac_builder_function(b), a.literal) != TAC_NO_LABEL) {
+                char what[64];
+                snprintf(what, sizeof(what), "label L%d defined twice", a.literal);
+                reader_error(r, what);
+                return;
+            }
+            tac_emit_label(b, a);
+        } else {
+            r->p = start;
+            if (!read_operand(r, &a) || a.type == TAC_OP_LITERAL) {
+                reader_error(r, "expected instruction");
+                return;
+            }
+            if (!accept(r, tac_arrow) && !accept(r, "=")) {
+                reader_error(r, "expected '←' or '='");
+                return;
+            }
+            read_assignment(r, b, a);
+        }
+    }
+
+    if (!r->failed && !at_end(r)) reader_error(r, "unexpected text at end of line");
+}
+
+TACProgram *tac_read(const char *text, size_t len, const char *filename) {
+    TACProgram *program = tac_program_create();
+    TACBuilder b;
+    tac_builder_init(&b, program);
+
+    TACReader r = { .filename = filename };
+    size_t enclosing = TAC_NO_FUNCTION;
+    const char *end = text + len;
+
+    for (const char *p = text; p < end && !r.failed; ) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        r.line++;
+
+        // Cut the line at a comment
+        const char *comment = memchr(p, ';', (size_t)(eol - p));
+        r.p = p;
+        r.eol = comment ? comment : eol;
+        r.comment = comment ? comment + 1 : NULL;
+        r.comment_end = eol;
+        read_line(&r, &b, &enclosing);
+
+        p = eol + 1;
+    }
+
+    if (!r.failed && b.function != TAC_NO_FUNCTION) {
+        reader_error(&r, "missing 'endfun'");
+    }
+    if (!r.failed) check_label_refs(&r, program);
+    free(r.refs);
+    if (r.failed) {
+        tac_program_free(program);
+        return NULL;
+    }
+    // Counts are those of the header where there is one, raised to cover
+    // the ids used
+    for (size_t i = 0; i < program->count; i++) {
+        TACFunction *fn = &program->functions[i];
+        int temps = fn->temp_count, labels = fn->label_count;
+        tac_function_recount(fn);
+        if (temps > fn->temp_count) fn->temp_count = temps;
+        if (labels > fn->label_count) fn->label_count = labels;
+        tac_function_sync_header(fn);
+    }
+    return program;
+}
@@ -1,4 +1,5 @@
 #include "tac_util.h"
+#include "tac_emit.h"
 
 /* Map AST binary ops to TAC ops */
 TACBinOp tac_get_binop(AstNode *ast) {
@@ -35,10 +36,12 @@ const char *tac_binop_str(TACBinOp o) {
     switch(o) {
       case TAC_ADD:  return "+";  case TAC_SUB:  return "-";
       case TAC_MUL:  return "*";  case TAC_DIV:  return "/";
+      case TAC_MOD:  return "%";
       case TAC_EQ:   return "=="; case TAC_NEQ: return "!=";
       case TAC_LT:   return "<";  case TAC_LTE: return "<=";
       case TAC_GT:   return ">";  case TAC_GTE: return ">=";
       case TAC_AND:  return "&&"; case TAC_OR:  return "||";
+      case TAC_SHL:  return "<<"; case TAC_SHR: return ">>";
       default:       return "?";
     }
 }
@@ -48,4 +51,136 @@ const char *tac_unop_str(TACUnaryOp o) {
       case TAC_NOT: return "!";
       default:      return "?";
     }
-}
\ No newline at end of file
+}
+
+int tac_is_relational(TACBinOp o) {
+    return o == TAC_EQ || o == TAC_NEQ || o == TAC_LT
+        || o == TAC_LTE || o == TAC_GT || o == TAC_GTE;
+}
+
+TACBinOp tac_negate_relation(TACBinOp o) {
+    switch (o) {
+      case TAC_EQ:  return TAC_NEQ; case TAC_NEQ: return TAC_EQ;
+      case TAC_LT:  return TAC_GTE; case TAC_GTE: return TAC_LT;
+      case TAC_GT:  return TAC_LTE; case TAC_LTE: return TAC_GT;
+      default:      return o;
+    }
+}
+
+const char *tac_relation_mnemonic(TACBinOp o) {
+    switch (o) {
+      case TAC_EQ:  return "eq"; case TAC_NEQ: return "ne";
+      case TAC_LT:  return "lt"; case TAC_LTE: return "le";
+      case TAC_GT:  return "gt"; case TAC_GTE: return "ge";
+      default:      return "?";
+    }
+}
+
+int tac_jump_target(const TACInstr *instr) {
+    const TACOperand *target;
+    switch (instr->kind) {
+      case TAC_GOTO:   target = &instr->arg1; break;
+      case TAC_IFZ:    target = &instr->arg2; break;
+      case TAC_IF_CMP: target = &instr->dst;  break;
+      default:         return -1;
+    }
+    return target->type == TAC_OP_LABEL ? target->literal : -1;
+}
+
+void tac_set_jump_target(TACInstr *instr, int label) {
+    switch (instr->kind) {
+      case TAC_GOTO:   instr->arg1 = tac_label(label); break;
+      case TAC_IFZ:    instr->arg2 = tac_label(label); break;
+      case TAC_IF_CMP: instr->dst = tac_label(label);  break;
+      default:         break;
+    }
+}
+
+unsigned tac_use_mask(const TACInstr *instr) {
+    switch (instr->kind) {
+      case TAC_BINARY_OP:
+      case TAC_IF_CMP:
+        return TAC_USE_ARG1 | TAC_USE_ARG2;
+      case TAC_SELECT:
+        return TAC_USE_ARG1 | TAC_USE_ARG2 | TAC_USE_ARG3;
+      case TAC_UNARY_OP:
+      case TAC_COPY:
+      case TAC_IFZ:
+      case TAC_PUSH:
+      case TAC_DEFINE:
+        return TAC_USE_ARG1;
+      case TAC_RETURN:
+        return instr->arg1.type != TAC_OP_NONE ? TAC_USE_ARG1 : 0;
+      default:
+        return 0;   // labels, jumps, calls (arg1 is the callee), pop, fun/endfun,
+                    // phis (arguments are in the phi pool)
+    }
+}
+
+const TACOperand *tac_def_operand(const TACInstr *instr) {
+    switch (instr->kind) {
+      case TAC_BINARY_OP:
+      case TAC_UNARY_OP:
+      case TAC_COPY:
+      case TAC_SELECT:
+      case TAC_CALL:
+      case TAC_DEFINE:
+      case TAC_PHI:
+        return &instr->dst;
+      case TAC_POP:
+        return &instr->arg1;   // pop x binds the next argument to x
+      default:
+        return NULL;
+    }
+}
+
+int tac_call_pushes(const TACFunction *fn, size_t call, size_t *pushes, size_t capacity) {
+    const TACOperand *n = &fn->instrs[call].arg2;
+    if (n->type != TAC_OP_LITERAL || n->literal < 0 || (size_t)n->literal > capacity) return -1;
+    int args = n->literal, found = 0, skip = 0;
+    for (size_t k = call; k-- > 0 && found < args;) {
+        const TACInstr *instr = &fn->instrs[k];
+        if (instr->kind == TAC_LABEL || instr->kind == TAC_FUNCTION || tac_jump_target(instr) >= 0) return -1;
+        if (instr->kind == TAC_CALL) {
+            // a call in between takes the pushes before it
+            skip += instr->arg2.type == TAC_OP_LITERAL ? instr->arg2.literal : 0;
+        } else if (instr->kind == TAC_PUSH) {
+            if (skip > 0) skip--;
+            else pushes[args - 1 - found++] = k;
+        }
+    }
+    return found == args ? args : -1;
+}
+
+static int tac_instr_equal(const TACInstr *a, const TACInstr *b) {
+    if (a->kind != b->kind) return 0;
+    if (a->kind == TAC_PHI) {
+        // Pool positions differ between programs; compare the arguments
+        size_t count = tac_phi_arg_count(a);
+        if (count != tac_phi_arg_count(b) || !tac_operand_equal(a->dst, b->dst)) return 0;
+        for (size_t k = 0; k < count; k++) {
+            if (!tac_operand_equal(tac_phi_args(a)[k], tac_phi_args(b)[k])) return 0;
+        }
+        return 1;
+    }
+    if ((a->kind == TAC_BINARY_OP || a->kind == TAC_IF_CMP) && a->op.binop != b->op.binop) return 0;
+    if (a->kind == TAC_UNARY_OP && a->op.unop != b->op.unop) return 0;
+    if (a->kind == TAC_CALL && a->op.tail != b->op.tail) return 0;
+    return tac_operand_equal(a->dst, b->dst)
+        && tac_operand_equal(a->arg1, b->arg1)
+        && tac_operand_equal(a->arg2, b->arg2)
+        && tac_operand_equal(a->arg3, b->arg3);
+}
+
+int tac_program_equal(const TACProgram *a, const TACProgram *b) {
+    if (a->count != b->count) return 0;
+    for (size_t f = 0; f < a->count; f++) {
+        const TACFunction *fa = &a->functions[f];
+        const TACFunction *fb = &b->functions[f];
+        if (fa->count != fb->count) return 0;
+        for (size_t i = 0; i < fa->count; i++) {
+            if (!tac_instr_equal(&fa->instrs[i], &fb->instrs[i])) return 0;
+        }
+    }
+    return 1;
+}
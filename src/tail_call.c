@@ -0,0 +1,103 @@
+#include "tail_call.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <stdlib.h>
+
+// A call directly returned: `t ← call f n; return t`, or a plain return
+static int is_tail_call(const TACFunction *fn, size_t i) {
+    const TACInstr *call = &fn->instrs[i];
+    if (call->kind != TAC_CALL || i + 1 >= fn->count) return 0;
+    const TACInstr *ret = &fn->instrs[i + 1];
+    if (ret->kind != TAC_RETURN) return 0;
+    return ret->arg1.type == TAC_OP_NONE || tac_operand_equal(ret->arg1, call->dst);
+}
+
+void tail_call_eliminate(TACFunction *fn, TailCallStats *stats) {
+    if (fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION) return;
+
+    // 1) The parameters are the pops right after `fun`, and the only ones
+    size_t params = 0;
+    while (1 + params < fn->count && fn->instrs[1 + params].kind == TAC_POP) params++;
+    for (size_t i = 1 + params; i < fn->count; i++) {
+        if (fn->instrs[i].kind == TAC_POP || fn->instrs[i].kind == TAC_PHI) return;
+    }
+
+    // 2) Self tail calls with one argument per parameter, in their block;
+    //    per instruction, the call (+1) it is or it pushes for
+    size_t *site_of = xcalloc(fn->count, sizeof(size_t));
+    size_t *pushes = xcalloc(params, sizeof(size_t));
+    size_t sites = 0;
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACInstr *instr = &fn->instrs[i];
+        if (!is_tail_call(fn, i) || instr->arg1.type != TAC_OP_VAR || instr->arg1.sym != fn->instrs[0].dst.sym) continue;
+        if (tac_call_pushes(fn, i, pushes, params) != (int)params) continue;
+        site_of[i] = i + 1;
+        for (size_t k = 0; k < params; k++) site_of[pushes[k]] = i + 1;
+        sites++;
+    }
+    if (sites == 0) {
+        free(pushes);
+        free(site_of);
+        return;
+    }
+
+    // 3) Rebuild, with the entry label after the pops
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    int entry = tac_function_new_label(&out);
+    TACOperand *saved = xcalloc(params, sizeof(TACOperand));
+    size_t pushed = 0;
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACInstr *instr = &fn->instrs[i];
+        if (i == 1 + params) tac_function_push(&out, (TACInstr){ .kind = TAC_LABEL, .dst = tac_label(entry) });
+        if (!site_of[i]) {
+            tac_function_push(&out, *instr);
+            continue;
+        }
+        if (instr->kind == TAC_PUSH) {
+            // literals keep; anything else is saved as it is now
+            if (instr->arg1.type == TAC_OP_LITERAL) {
+                saved[pushed++] = instr->arg1;
+            } else {
+                saved[pushed] = tac_temp(tac_function_new_temp(&out));
+                tac_function_push(&out, (TACInstr){ .kind = TAC_COPY, .dst = saved[pushed++], .arg1 = instr->arg1 });
+            }
+            continue;
+        }
+        for (size_t k = 0; k < params; k++) {
+            tac_function_push(&out, (TACInstr){ .kind = TAC_COPY, .dst = fn->instrs[1 + k].arg1, .arg1 = saved[k] });
+        }
+        tac_function_push(&out, (TACInstr){ .kind = TAC_GOTO, .arg1 = tac_label(entry) });
+        pushed = 0;
+        i++;                        // the return
+    }
+    tac_function_sync_header(&out);
+    tac_function_free(fn);
+    *fn = out;
+
+    free(saved);
+    free(pushes);
+    free(site_of);
+    if (stats) stats->self += sites;
+}
+
+void tail_call_eliminate_program(TACProgram *program, TailCallStats *stats) {
+    for (size_t i = 0; i < program->count; i++) tail_call_eliminate(&program->functions[i], stats);
+}
+
+void tail_call_mark(TACFunction *fn, TailCallStats *stats) {
+    size_t marked = 0;
+    for (size_t i = 0; i < fn->count; i++) {
+        TACInstr *instr = &fn->instrs[i];
+        if (instr->kind != TAC_CALL) continue;
+        instr->op.tail = is_tail_call(fn, i);
+        marked += (size_t)instr->op.tail;
+    }
+    if (stats) stats->marked += marked;
+}
+
+void tail_call_mark_program(TACProgram *program, TailCallStats *stats) {
+    for (size_t i = 0; i < program->count; i++) tail_call_mark(&program->functions[i], stats);
+}
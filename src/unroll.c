@@ -0,0 +1,442 @@
+#include "unroll.h"
+#include "cfg_builder.h"
+#include "dominance.h"
+#include "intern.h"
+#include "loops.h"
+#include "tac_emit.h"
+#include "tac_util.h"
+#include "util.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A loop in the shape unroll.h describes
+typedef struct {
+    int        header;        // blocks header..latch, in layout order
+    int        latch;
+    size_t     start, end;    // its instructions
+    size_t     body_size;     // instructions between the test and the back edge
+    TACOperand iv;
+    TACOperand bound;
+    long long  step;
+    TACBinOp   stay;          // iv stay bound keeps the loop going
+    int        exit_label;
+    int        has_init;
+    long long  init;
+    int        entered_by_jump;
+} Counted;
+
+static int same_name(TACOperand a, TACOperand b) {
+    return (a.type == TAC_OP_TEMP || a.type == TAC_OP_VAR) && tac_operand_equal(a, b);
+}
+
+// a rel b is b mirror(rel) a
+static TACBinOp mirror(TACBinOp rel) {
+    switch (rel) {
+      case TAC_LT:  return TAC_GT;  case TAC_GT:  return TAC_LT;
+      case TAC_LTE: return TAC_GTE; case TAC_GTE: return TAC_LTE;
+      default:      return rel;
+    }
+}
+
+static int holds(TACBinOp rel, long long a, long long b) {
+    switch (rel) {
+      case TAC_EQ:  return a == b;  case TAC_NEQ: return a != b;
+      case TAC_LT:  return a < b;   case TAC_LTE: return a <= b;
+      case TAC_GT:  return a > b;   default:      return a >= b;
+    }
+}
+
+static int fits_int(long long v) {
+    return v >= INT_MIN && v <= INT_MAX;
+}
+
+// Stepping towards the bound: each test that passes brings the last closer
+static int is_monotone(const Counted *c) {
+    return c->step > 0 ? c->stay == TAC_LT || c->stay == TAC_LTE
+                       : c->stay == TAC_GT || c->stay == TAC_GTE;
+}
+
+// Times the body runs when the iv starts at init and the bound is a
+// literal, or -1 if unknown (past limit, or the iv would overflow)
+static long long trip_count(const Counted *c, long long limit) {
+    if (!c->has_init || c->bound.type != TAC_OP_LITERAL) return -1;
+    long long bound = c->bound.literal;
+    long long n;
+    if (is_monotone(c)) {
+        // the last value that passes the test
+        long long last = c->stay == TAC_LT ? bound - 1 : c->stay == TAC_GT ? bound + 1 : bound;
+        long long distance = c->step > 0 ? last - c->init : c->init - last;
+        long long step = c->step > 0 ? c->step : -c->step;
+        n = distance < 0 ? 0 : distance / step + 1;
+    } else {
+        long long v = c->init;
+        for (n = 0; holds(c->stay, v, bound); n++) {
+            if (n > limit) return -1;
+            v += c->step;
+            if (!fits_int(v)) return -1;
+        }
+    }
+    return fits_int(c->init + n * c->step) ? n : -1;
+}
+
+typedef struct {
+    TACFunction *fn;
+    CFG         *cfg;
+    DomTree     *dom;
+    LoopForest  *forest;
+    size_t       temp_count;
+    unsigned char *written;   // per name: assigned somewhere in the function
+} Unroll;
+
+static long long name_index(const Unroll *u, TACOperand op) {
+    if (op.type == TAC_OP_TEMP && op.literal >= 0 && (size_t)op.literal < u->temp_count) return op.literal;
+    if (op.type == TAC_OP_VAR) return (long long)(u->temp_count + (size_t)op.sym);
+    return -1;
+}
+
+// Writes of op between start and end; *def is the last one
+static size_t count_defs(const TACFunction *fn, size_t start, size_t end, TACOperand op, size_t *def) {
+    size_t defs = 0;
+    for (size_t i = start; i < end; i++) {
+        const TACOperand *d = tac_def_operand(&fn->instrs[i]);
+        if (d && same_name(*d, op)) {
+            defs++;
+            *def = i;
+        }
+    }
+    return defs;
+}
+
+// Fills c when loop is a counted loop laid out in one piece
+static int counted_loop(const Unroll *u, int loop, Counted *c) {
+    const TACFunction *fn = u->fn;
+    memset(c, 0, sizeof(*c));
+    c->header = u->forest->loops[loop].header;
+    size_t latch_count;
+    const int *latches = loop_latches(u->forest, loop, &latch_count);
+    if (latch_count != 1) return 0;
+    c->latch = latches[0];
+    if (c->latch <= c->header) return 0;
+
+    // 1) Header holds just its label and the exit test; the latch jumps
+    //    back; the loop's blocks are header..latch and nothing else
+    const CFGBlock *header = u->cfg->blocks.items[c->header];
+    const CFGBlock *latch = u->cfg->blocks.items[c->latch];
+    if (header->count != 2 || header->instructions[0].kind != TAC_LABEL || header->instructions[1].kind != TAC_IF_CMP) return 0;
+    int label = header->instructions[0].dst.literal;
+    const TACInstr *back = &latch->instructions[latch->count - 1];
+    if (back->kind != TAC_GOTO || tac_jump_target(back) != label) return 0;
+    for (size_t b = 0; b < u->cfg->blocks.count; b++) {
+        int inside = (int)b >= c->header && (int)b <= c->latch;
+        if (inside != loop_contains(u->forest, loop, (int)b)) return 0;
+    }
+    for (int b = c->header + 1; b <= c->latch; b++) {
+        size_t pred_count;
+        const int *pred = cfg_predecessors(u->cfg, b, &pred_count);
+        for (size_t k = 0; k < pred_count; k++) {
+            if (pred[k] < c->header || pred[k] > c->latch) return 0;
+        }
+    }
+    c->start = (size_t)(header->instructions - fn->instrs);
+    c->end = (size_t)(latch->instructions - fn->instrs) + latch->count;
+    c->body_size = c->end - c->start - 3;
+
+    const TACInstr *test = &header->instructions[1];
+    c->exit_label = tac_jump_target(test);
+    int exit_block = cfg_label_block(u->cfg, c->exit_label);
+    if (exit_block >= c->header && exit_block <= c->latch) return 0;
+
+    // 2) One side of the test is stepped once per iteration, in the
+    //    latch; the other does not change in the loop
+    int has_call = 0;
+    for (size_t i = c->start; i < c->end; i++) has_call |= fn->instrs[i].kind == TAC_CALL;
+    size_t latch_start = (size_t)(latch->instructions - fn->instrs);
+    for (int side = 0; side < 2 && !c->step; side++) {
+        TACOperand iv = side ? test->arg2 : test->arg1;
+        TACOperand bound = side ? test->arg1 : test->arg2;
+        long long index = name_index(u, iv);
+        size_t def = 0;
+        if (index < 0 || count_defs(fn, c->start, c->end, iv, &def) != 1 || def < latch_start) continue;
+        const TACInstr *step = &fn->instrs[def];
+        if (step->kind != TAC_BINARY_OP || step->arg2.type != TAC_OP_LITERAL || !same_name(step->arg1, iv)) continue;
+        if (step->op.binop != TAC_ADD && step->op.binop != TAC_SUB) continue;
+        if (bound.type != TAC_OP_LITERAL) {
+            long long b = name_index(u, bound);
+            size_t unused;
+            if (b < 0 || count_defs(fn, c->start, c->end, bound, &unused) != 0) continue;
+            // as in lvn.h, variables the function never writes may be
+            // changed by the functions it calls
+            if (bound.type == TAC_OP_VAR && has_call && !u->written[b]) continue;
+        }
+        c->step = step->op.binop == TAC_ADD ? step->arg2.literal : -(long long)step->arg2.literal;
+        c->iv = iv;
+        c->bound = bound;
+        c->stay = tac_negate_relation(side ? mirror(test->op.binop) : test->op.binop);
+    }
+    if (c->step == 0) return 0;
+
+    // 3) Where the iv starts: the single block entering the loop, if it
+    //    sets it to a literal
+    size_t pred_count;
+    const int *pred = cfg_predecessors(u->cfg, c->header, &pred_count);
+    int entering = -1;
+    for (size_t k = 0; k < pred_count; k++) {
+        if (pred[k] == c->latch) continue;
+        if (entering >= 0) return 0;
+        entering = pred[k];
+    }
+    if (entering < 0) return 0;
+    const CFGBlock *before = u->cfg->blocks.items[entering];
+    c->entered_by_jump = tac_jump_target(&before->instructions[before->count - 1]) == label;
+    size_t before_start = (size_t)(before->instructions - fn->instrs), def;
+    if (count_defs(fn, before_start, before_start + before->count, c->iv, &def) > 0) {
+        const TACInstr *set = &fn->instrs[def];
+        if ((set->kind == TAC_COPY || set->kind == TAC_DEFINE) && set->arg1.type == TAC_OP_LITERAL) {
+            c->has_init = 1;
+            c->init = set->arg1.literal;
+        }
+    }
+    return 1;
+}
+
+static TACInstr make_label(int label) {
+    return (TACInstr){ .kind = TAC_LABEL, .dst = tac_label(label) };
+}
+
+static TACInstr make_goto(int label) {
+    return (TACInstr){ .kind = TAC_GOTO, .arg1 = tac_label(label) };
+}
+
+static TACInstr make_if(TACBinOp rel, TACOperand a, TACOperand b, int label) {
+    TACInstr instr = { .kind = TAC_IF_CMP, .arg1 = a, .arg2 = b, .dst = tac_label(label) };
+    instr.op.binop = rel;
+    return instr;
+}
+
+// One copy of the body; with `fresh`, labels it defines are renamed
+static void push_body(TACFunction *out, const TACFunction *fn, const Counted *c, int *rename, int fresh) {
+    size_t first = c->start + 2, last = c->end - 1;
+    for (size_t i = first; i < last; i++) {
+        if (fn->instrs[i].kind == TAC_LABEL) {
+            int label = fn->instrs[i].dst.literal;
+            rename[label] = fresh ? tac_function_new_label(out) : label;
+        }
+    }
+    for (size_t i = first; i < last; i++) {
+        TACInstr instr = fn->instrs[i];
+        if (instr.kind == TAC_LABEL) {
+            instr.dst = tac_label(rename[instr.dst.literal]);
+        } else {
+            int target = tac_jump_target(&instr);
+            if (target >= 0 && rename[target] >= 0) tac_set_jump_target(&instr, rename[target]);
+        }
+        tac_function_push(out, instr);
+    }
+    for (size_t i = first; i < last; i++) {
+        if (fn->instrs[i].kind == TAC_LABEL) rename[fn->instrs[i].dst.literal] = -1;
+    }
+}
+
+// Whether the instruction at index is label's
+static int falls_into(const TACFunction *fn, size_t index, int label) {
+    return index < fn->count && fn->instrs[index].kind == TAC_LABEL && fn->instrs[index].dst.literal == label;
+}
+
+typedef enum {
+    UNROLL_NONE,
+    UNROLL_FULL,              // the bodies one after another
+    UNROLL_EXACT,             // factor bodies per test, no remainder
+    UNROLL_REMAINDER          // factor bodies per test, then the original loop
+} UnrollPlan;
+
+// How to unroll a loop running `trips` times (-1: unknown), and how many
+// instructions that adds
+static UnrollPlan choose(const TACFunction *fn, const Counted *c, long long trips, int factor, long long *added) {
+    long long body = (long long)c->body_size, before = body + 3;
+    if (trips >= 0 && trips <= UNROLL_FULL_MAX_TRIPS) {
+        *added = 1 + !falls_into(fn, c->end, c->exit_label) + trips * body - before;
+        if (*added <= UNROLL_MAX_GROWTH) return UNROLL_FULL;
+    }
+    if (factor < 2 || !is_monotone(c)) return UNROLL_NONE;
+    if (trips >= 0 && trips % factor == 0) {
+        *added = 3 + factor * body - before;
+        return UNROLL_EXACT;
+    }
+
+    // the adjusted bound must fit (literal) or be guarded (otherwise)
+    long long k = (long long)(factor - 1) * c->step;
+    if (!fits_int(k) || !fits_int(k > 0 ? INT_MIN + k : INT_MAX + k)) return UNROLL_NONE;
+    if (c->bound.type == TAC_OP_LITERAL && !fits_int(c->bound.literal - k)) return UNROLL_NONE;
+    long long adjust = c->bound.type == TAC_OP_LITERAL ? 0 : 2 + c->entered_by_jump;
+    *added = adjust + 3 + factor * body + 3 + body - before;
+    return UNROLL_REMAINDER;
+}
+
+// Rewrites the loop following plan. Headers of the loops it leaves go to
+// left, so they are not unrolled again
+static void rewrite(TACFunction *fn, const Counted *c, UnrollPlan plan, long long trips, int factor,
+                    int *left, size_t *left_count, UnrollStats *counts) {
+    TACFunction out = {0};
+    out.temp_count = fn->temp_count;
+    out.label_count = fn->label_count;
+    const TACInstr *test = &fn->instrs[c->start + 1];
+    int header_label = fn->instrs[c->start].dst.literal;
+    int *rename = xcalloc((size_t)fn->label_count, sizeof(int));
+    for (int k = 0; k < fn->label_count; k++) rename[k] = -1;
+    *left_count = 0;
+
+    for (size_t i = 0; i < c->start; i++) tac_function_push(&out, fn->instrs[i]);
+
+    if (plan == UNROLL_FULL) {
+        // 1) All of it, then on to the exit
+        tac_function_push(&out, fn->instrs[c->start]);
+        for (long long k = 0; k < trips; k++) push_body(&out, fn, c, rename, 1);
+        if (!falls_into(fn, c->end, c->exit_label)) tac_function_push(&out, make_goto(c->exit_label));
+        counts->full++;
+        counts->copies += (size_t)trips;
+    } else if (plan == UNROLL_EXACT) {
+        // 2) The test only comes round every `factor` iterations
+        tac_function_push(&out, fn->instrs[c->start]);
+        tac_function_push(&out, *test);
+        for (int k = 0; k < factor; k++) push_body(&out, fn, c, rename, 1);
+        tac_function_push(&out, make_goto(header_label));
+        left[(*left_count)++] = header_label;
+        counts->partial++;
+        counts->copies += (size_t)factor;
+    } else {
+        // 3) `factor` iterations while that many remain, the rest in the
+        //    original loop. iv + k stays iff iv stays against bound - k
+        int remainder = tac_function_new_label(&out);
+        long long k = (long long)(factor - 1) * c->step;
+        TACOperand bound;
+        if (c->bound.type == TAC_OP_LITERAL) {
+            bound = tac_literal((int)(c->bound.literal - k));
+        } else {
+            // the adjustment goes in front of the header, which the
+            // entering jump is moved to
+            if (c->entered_by_jump) {
+                int preheader = tac_function_new_label(&out);
+                for (size_t i = 0; i < out.count; i++) {
+                    if (tac_jump_target(&out.instrs[i]) == header_label) tac_set_jump_target(&out.instrs[i], preheader);
+                }
+                for (size_t i = c->end; i < fn->count; i++) {
+                    if (tac_jump_target(&fn->instrs[i]) == header_label) tac_set_jump_target(&fn->instrs[i], preheader);
+                }
+                tac_function_push(&out, make_label(preheader));
+            }
+            // bound - k must not wrap
+            if (k > 0) tac_function_push(&out, make_if(TAC_LT, c->bound, tac_literal((int)(INT_MIN + k)), remainder));
+            else tac_function_push(&out, make_if(TAC_GT, c->bound, tac_literal((int)(INT_MAX + k)), remainder));
+            bound = tac_temp(tac_function_new_temp(&out));
+            TACInstr adjust = { .kind = TAC_BINARY_OP, .dst = bound, .arg1 = c->bound, .arg2 = tac_literal((int)k) };
+            adjust.op.binop = TAC_SUB;
+            tac_function_push(&out, adjust);
+        }
+        tac_function_push(&out, fn->instrs[c->start]);
+        tac_function_push(&out, make_if(tac_negate_relation(c->stay), c->iv, bound, remainder));
+        for (int j = 0; j < factor; j++) push_body(&out, fn, c, rename, 1);
+        tac_function_push(&out, make_goto(header_label));
+
+        tac_function_push(&out, make_label(remainder));
+        tac_function_push(&out, *test);
+        push_body(&out, fn, c, rename, 0);
+        tac_function_push(&out, make_goto(remainder));
+        left[(*left_count)++] = header_label;
+        left[(*left_count)++] = remainder;
+        counts->partial++;
+        counts->remainders++;
+        counts->copies += (size_t)factor;
+    }
+
+    for (size_t i = c->end; i < fn->count; i++) tac_function_push(&out, fn->instrs[i]);
+    tac_function_sync_header(&out);
+    free(rename);
+    tac_function_free(fn);
+    *fn = out;
+}
+
+// Room in done for every label of fn
+static unsigned char *cover_labels(unsigned char *done, size_t *capacity, const TACFunction *fn) {
+    size_t needed = fn->label_count > 0 ? (size_t)fn->label_count : 0;
+    if (needed <= *capacity && done) return done;
+    size_t grown_capacity = needed * 2 + 8;
+    unsigned char *grown = xcalloc(grown_capacity, 1);
+    if (done) memcpy(grown, done, *capacity);
+    free(done);
+    *capacity = grown_capacity;
+    return grown;
+}
+
+void unroll(TACFunction *fn, int factor, UnrollStats *stats) {
+    if (factor <= 0 || fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION) return;
+    for (size_t i = 0; i < fn->count; i++) {
+        if (fn->instrs[i].kind == TAC_PHI) return;
+    }
+    UnrollStats counts = {0};
+    long long budget = fn->count > UNROLL_MAX_GROWTH ? (long long)fn->count : UNROLL_MAX_GROWTH;
+
+    // Headers (by label) already done; unrolled loops are not unrolled again
+    size_t label_capacity = 0;
+    unsigned char *done = NULL;
+
+    for (int changed = 1; changed;) {
+        changed = 0;
+        done = cover_labels(done, &label_capacity, fn);
+
+        Unroll u = {0};
+        u.fn = fn;
+        u.cfg = build_from_tac(fn);
+        if (!u.cfg) break;
+        u.dom = dom_compute(u.cfg);
+        u.forest = loops_compute(u.cfg, u.dom);
+        u.temp_count = fn->temp_count > 0 ? (size_t)fn->temp_count : 0;
+        u.written = xcalloc(u.temp_count + intern_count(), 1);
+        for (size_t i = 0; i < fn->count; i++) {
+            const TACOperand *def = tac_def_operand(&fn->instrs[i]);
+            long long index = def ? name_index(&u, *def) : -1;
+            if (index >= 0) u.written[index] = 1;
+        }
+
+        // Innermost first, one loop per round
+        for (size_t k = 0; k < u.forest->count && !changed; k++) {
+            const CFGBlock *header = u.cfg->blocks.items[u.forest->loops[k].header];
+            if (header->instructions[0].kind != TAC_LABEL) continue;
+            int label = header->instructions[0].dst.literal;
+            if (done[label]) continue;
+            done[label] = 1;
+
+            Counted c;
+            if (!counted_loop(&u, (int)k, &c)) continue;
+            long long trips = trip_count(&c, UNROLL_FULL_MAX_TRIPS), added = 0;
+            UnrollPlan plan = choose(fn, &c, trips, factor, &added);
+            if (plan == UNROLL_NONE || added > UNROLL_MAX_GROWTH || added > budget) continue;
+            budget -= added;
+
+            int left[2];
+            size_t left_count;
+            rewrite(fn, &c, plan, trips, factor, left, &left_count, &counts);
+            done = cover_labels(done, &label_capacity, fn);
+            for (size_t j = 0; j < left_count; j++) done[left[j]] = 1;
+            changed = 1;
+        }
+
+        free(u.written);
+        loops_free(u.forest);
+        dom_free(u.dom);
+        free_cfg(u.cfg);
+        free(u.cfg);
+    }
+    free(done);
+
+    if (stats) {
+        stats->full += counts.full;
+        stats->partial += counts.partial;
+        stats->remainders += counts.remainders;
+        stats->copies += counts.copies;
+    }
+}
+
+void unroll_program(TACProgram *program, int factor, UnrollStats *stats) {
+    for (size_t i = 0; i < program->count; i++) unroll(&program->functions[i], factor, stats);
+}
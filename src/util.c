@@ -0,0 +1,12 @@
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void *xcalloc(size_t count, size_t size) {
+    void *items = calloc(count ? count : 1, size);
+    if (!items) {
+        printf("Memory allocation failed for %zu items of %zu bytes.\n", count, size);
+        exit(EXIT_FAILURE);
+    }
+    return items;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// Shared by the tests: source text to TAC, as the driver's front end does
+// it (lexer, parser, lambda lifting, lowering), without the JSON dumps.
+
+#include "compiler.h"
+
+static TACProgram *front_end(const char *code) {
+    Lexer *lx = lexer_create(code);
+    TokenArray tokens;
+    token_array_init(&tokens);
+    Token *tok;
+    while ((tok = lexer_next(lx))->type != TOKEN_EOF) token_array_push(&tokens, tok);
+    token_array_push(&tokens, tok);
+    free_lexer(lx);
+
+    Parser *parser = parser_create(tokens, "test");
+    AstNode *ast = parse(parser);
+    lambda_lift(ast);
+    TACProgram *program = tac_parse(ast);
+    parser_free(parser);
+    free_ast_node(ast);
+    return program;
+}
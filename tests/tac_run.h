@@ -0,0 +1,287 @@
+#pragma once
+
+// Shared by the tests: an interpreter for TAC, so a pass can be checked
+// by running the program before and after it.
+//
+// Values are 32-bit ints that wrap like the folds of sccp.h. A function's
+// variables are the ones it writes, as the passes take them (see lvn.h);
+// the rest are globals, set by running the global segment first. The k-th
+// pop of a callee takes the k-th argument pushed for its call. Phis pick
+// the argument of the edge taken, in cfg_predecessors order.
+//
+// tac_run returns 0 for what would trap or never end: division by zero,
+// INT_MIN / -1, an unknown callee or temp, too many steps or calls.
+
+#include "compiler.h"
+#include "tac_util.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TAC_RUN_MAX_STEPS 1000000
+#define TAC_RUN_MAX_DEPTH 1000
+
+typedef struct {
+    CFG           *cfg;
+    int           *block_of;      // instruction -> block
+    unsigned char *local;         // name -> written by the function
+} TACRunFunction;
+
+typedef struct {
+    const TACProgram *program;
+    TACRunFunction   *functions;
+    size_t            name_count;
+    int              *globals;
+    long              steps;
+    int               depth;
+} TACRun;
+
+static int tac_run_call(TACRun *run, size_t f, const int *args, size_t arg_count, int *result);
+
+static int tac_run_find(const TACRun *run, int sym, size_t *f) {
+    for (size_t i = 0; i < run->program->count; i++) {
+        const TACFunction *fn = &run->program->functions[i];
+        if (fn->count > 0 && fn->instrs[0].kind == TAC_FUNCTION && fn->instrs[0].dst.sym == sym) {
+            *f = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int tac_run_binary(TACBinOp op, int a, int b, int *result) {
+    unsigned ua = (unsigned)a, ub = (unsigned)b;
+    switch (op) {
+        case TAC_ADD: *result = (int)(ua + ub); return 1;
+        case TAC_SUB: *result = (int)(ua - ub); return 1;
+        case TAC_MUL: *result = (int)(ua * ub); return 1;
+        case TAC_DIV:
+        case TAC_MOD:
+            if (b == 0 || (a == INT_MIN && b == -1)) return 0;
+            *result = op == TAC_DIV ? a / b : a % b;
+            return 1;
+        case TAC_EQ:  *result = a == b; return 1;
+        case TAC_NEQ: *result = a != b; return 1;
+        case TAC_LT:  *result = a < b;  return 1;
+        case TAC_LTE: *result = a <= b; return 1;
+        case TAC_GT:  *result = a > b;  return 1;
+        case TAC_GTE: *result = a >= b; return 1;
+        case TAC_AND: *result = a && b; return 1;
+        case TAC_OR:  *result = a || b; return 1;
+        case TAC_SHL: *result = (int)(ua << (ub & 31)); return 1;
+        case TAC_SHR: *result = a >> (ub & 31); return 1;
+    }
+    return 0;
+}
+
+// A frame: the temps and local variables of one call
+typedef struct {
+    const TACRunFunction *info;
+    int                  *temps;
+    int                   temp_count;
+    int                  *vars;
+} TACRunFrame;
+
+static int tac_run_read(TACRun *run, const TACRunFrame *frame, TACOperand op, int *value) {
+    switch (op.type) {
+        case TAC_OP_LITERAL: *value = op.literal; return 1;
+        case TAC_OP_TEMP:
+            if (op.literal < 0 || op.literal >= frame->temp_count) return 0;
+            *value = frame->temps[op.literal];
+            return 1;
+        case TAC_OP_VAR:
+            if ((size_t)op.sym >= run->name_count) return 0;
+            *value = frame->info->local[op.sym] ? frame->vars[op.sym] : run->globals[op.sym];
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int tac_run_write(TACRun *run, TACRunFrame *frame, TACOperand op, int value) {
+    if (op.type == TAC_OP_TEMP && op.literal >= 0 && op.literal < frame->temp_count) {
+        frame->temps[op.literal] = value;
+        return 1;
+    }
+    if (op.type == TAC_OP_VAR && (size_t)op.sym < run->name_count) {
+        if (frame->info->local[op.sym]) frame->vars[op.sym] = value;
+        else run->globals[op.sym] = value;
+        return 1;
+    }
+    return 0;
+}
+
+// Moves pc to the label; 0 if the function does not define it
+static int tac_run_jump(const TACFunction *fn, int label, size_t *pc) {
+    size_t index = tac_function_label_index(fn, label);
+    if (index == TAC_NO_LABEL) return 0;
+    *pc = index;
+    return 1;
+}
+
+static int tac_run_body(TACRun *run, size_t f, TACRunFrame *frame, const int *args, size_t arg_count, int *result) {
+    const TACFunction *fn = &run->program->functions[f];
+    const TACRunFunction *info = frame->info;
+    int *pushed = NULL;
+    size_t push_count = 0, pops = 0;
+    int ok = 0, from = -1;
+    *result = 0;
+
+    for (size_t pc = 0; pc < fn->count;) {
+        if (++run->steps > TAC_RUN_MAX_STEPS) goto done;
+        const TACInstr *instr = &fn->instrs[pc];
+        int block = info->block_of[pc];
+
+        // The phis opening a block, all reading before any writes
+        if (instr->kind == TAC_PHI) {
+            size_t pred_count, end = pc, which = 0;
+            const int *pred = cfg_predecessors(info->cfg, block, &pred_count);
+            while (which < pred_count && pred[which] != from) which++;
+            if (which == pred_count) goto done;
+            while (end < fn->count && fn->instrs[end].kind == TAC_PHI) end++;
+            int values[64];
+            if (end - pc > 64) goto done;
+            for (size_t i = pc; i < end; i++) {
+                if (tac_phi_arg_count(&fn->instrs[i]) != pred_count) goto done;
+                if (!tac_run_read(run, frame, tac_phi_args(&fn->instrs[i])[which], &values[i - pc])) goto done;
+            }
+            for (size_t i = pc; i < end; i++) {
+                if (!tac_run_write(run, frame, fn->instrs[i].dst, values[i - pc])) goto done;
+            }
+            pc = end;
+            continue;
+        }
+
+        size_t next = pc + 1;
+        int a = 0, b = 0, c = 0, value = 0;
+        switch (instr->kind) {
+            case TAC_BINARY_OP:
+                if (!tac_run_read(run, frame, instr->arg1, &a) || !tac_run_read(run, frame, instr->arg2, &b)) goto done;
+                if (!tac_run_binary(instr->op.binop, a, b, &value)) goto done;
+                if (!tac_run_write(run, frame, instr->dst, value)) goto done;
+                break;
+            case TAC_UNARY_OP:
+                if (!tac_run_read(run, frame, instr->arg1, &a)) goto done;
+                value = instr->op.unop == TAC_NEG ? (int)(0u - (unsigned)a) : !a;
+                if (!tac_run_write(run, frame, instr->dst, value)) goto done;
+                break;
+            case TAC_COPY:
+                if (!tac_run_read(run, frame, instr->arg1, &a) || !tac_run_write(run, frame, instr->dst, a)) goto done;
+                break;
+            case TAC_SELECT:
+                if (!tac_run_read(run, frame, instr->arg1, &a) || !tac_run_read(run, frame, instr->arg2, &b)
+                    || !tac_run_read(run, frame, instr->arg3, &c)) goto done;
+                if (!tac_run_write(run, frame, instr->dst, a ? b : c)) goto done;
+                break;
+            case TAC_DEFINE:
+                if (instr->arg1.type != TAC_OP_NONE && !tac_run_read(run, frame, instr->arg1, &a)) goto done;
+                if (!tac_run_write(run, frame, instr->dst, a)) goto done;
+                break;
+            case TAC_GOTO:
+                if (!tac_run_jump(fn, instr->arg1.literal, &next)) goto done;
+                break;
+            case TAC_IFZ:
+                if (!tac_run_read(run, frame, instr->arg1, &a)) goto done;
+                if (a == 0 && !tac_run_jump(fn, instr->arg2.literal, &next)) goto done;
+                break;
+            case TAC_IF_CMP:
+                if (!tac_run_read(run, frame, instr->arg1, &a) || !tac_run_read(run, frame, instr->arg2, &b)) goto done;
+                tac_run_binary(instr->op.binop, a, b, &value);
+                if (value && !tac_run_jump(fn, instr->dst.literal, &next)) goto done;
+                break;
+            case TAC_PUSH:
+                if (!tac_run_read(run, frame, instr->arg1, &a)) goto done;
+                pushed = realloc(pushed, (push_count + 1) * sizeof(int));
+                if (!pushed) goto done;
+                pushed[push_count++] = a;
+                break;
+            case TAC_POP:
+                if (pops >= arg_count || !tac_run_write(run, frame, instr->arg1, args[pops++])) goto done;
+                break;
+            case TAC_CALL: {
+                size_t callee, n = instr->arg2.type == TAC_OP_LITERAL ? (size_t)instr->arg2.literal : 0;
+                if (instr->arg1.type != TAC_OP_VAR || !tac_run_find(run, instr->arg1.sym, &callee)) goto done;
+                if (n > push_count) goto done;
+                if (!tac_run_call(run, callee, pushed + push_count - n, n, &value)) goto done;
+                push_count -= n;
+                if (instr->dst.type != TAC_OP_NONE && !tac_run_write(run, frame, instr->dst, value)) goto done;
+                break;
+            }
+            case TAC_RETURN:
+                if (instr->arg1.type != TAC_OP_NONE && !tac_run_read(run, frame, instr->arg1, result)) goto done;
+                ok = 1;
+                goto done;
+            case TAC_END_FUNCTION:
+                ok = 1;
+                goto done;
+            default:
+                break;
+        }
+        if (next != pc + 1 || (next < fn->count && info->block_of[next] != block)) from = block;
+        pc = next;
+    }
+    ok = 1;   // the global segment runs off its end
+done:
+    free(pushed);
+    return ok;
+}
+
+static int tac_run_call(TACRun *run, size_t f, const int *args, size_t arg_count, int *result) {
+    const TACFunction *fn = &run->program->functions[f];
+    TACRunFunction *info = &run->functions[f];
+    if (!info->cfg) {
+        info->cfg = build_from_tac((TACFunction *)fn);
+        if (!info->cfg) return 0;
+        info->block_of = calloc(fn->count ? fn->count : 1, sizeof(int));
+        info->local = calloc(run->name_count ? run->name_count : 1, 1);
+        for (size_t b = 0; b < info->cfg->blocks.count; b++) {
+            const CFGBlock *block = info->cfg->blocks.items[b];
+            size_t base = (size_t)(block->instructions - fn->instrs);
+            for (size_t i = 0; i < block->count; i++) info->block_of[base + i] = (int)b;
+        }
+        int is_function = fn->count > 0 && fn->instrs[0].kind == TAC_FUNCTION;
+        for (size_t i = 0; is_function && i < fn->count; i++) {
+            const TACOperand *def = tac_def_operand(&fn->instrs[i]);
+            if (def && def->type == TAC_OP_VAR && (size_t)def->sym < run->name_count) info->local[def->sym] = 1;
+        }
+    }
+    if (run->depth >= TAC_RUN_MAX_DEPTH) return 0;
+
+    TACRunFrame frame = { info, NULL, fn->temp_count, NULL };
+    frame.temps = calloc(fn->temp_count > 0 ? (size_t)fn->temp_count : 1, sizeof(int));
+    frame.vars = calloc(run->name_count ? run->name_count : 1, sizeof(int));
+    run->depth++;
+    int ok = frame.temps && frame.vars && tac_run_body(run, f, &frame, args, arg_count, result);
+    run->depth--;
+    free(frame.temps);
+    free(frame.vars);
+    return ok;
+}
+
+// Runs the global segment, then `name` with args; 1 and *result on a
+// normal return, 0 if the run traps or does not end
+static int tac_run(const TACProgram *program, const char *name, const int *args, size_t arg_count, int *result) {
+    TACRun run = { program, NULL, intern_count(), NULL, 0, 0 };
+    run.functions = calloc(program->count ? program->count : 1, sizeof(TACRunFunction));
+    run.globals = calloc(run.name_count ? run.name_count : 1, sizeof(int));
+    int ok = run.functions && run.globals;
+    int ignored;
+    for (size_t f = 0; ok && f < program->count; f++) {
+        const TACFunction *fn = &program->functions[f];
+        if (fn->count > 0 && fn->instrs[0].kind != TAC_FUNCTION) ok = tac_run_call(&run, f, NULL, 0, &ignored);
+    }
+    size_t entry;
+    ok = ok && tac_run_find(&run, intern(name), &entry) && tac_run_call(&run, entry, args, arg_count, result);
+
+    for (size_t f = 0; run.functions && f < program->count; f++) {
+        if (run.functions[f].cfg) {
+            free_cfg(run.functions[f].cfg);
+            free(run.functions[f].cfg);
+        }
+        free(run.functions[f].block_of);
+        free(run.functions[f].local);
+    }
+    free(run.functions);
+    free(run.globals);
+    return ok;
+}
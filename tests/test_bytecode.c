@@ -0,0 +1,169 @@
+// Round trip of the TAC bytecode: every program is encoded, decoded and
+// compared with tac_program_equal, straight from the front end, in SSA
+// form and after the middle end. Bytecode naming temps or labels beyond
+// the function's counts, or unknown operators, is rejected.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_bytecode.c -o test_bytecode
+//   ./test_bytecode
+#include "compiler.h"
+#include "front_end.h"
+#include "tac_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+static size_t count_kind(const TACProgram *program, TACOpKind kind, int tail) {
+    size_t count = 0;
+    for (size_t f = 0; f < program->count; f++) {
+        const TACFunction *fn = &program->functions[f];
+        for (size_t i = 0; i < fn->count; i++) {
+            const TACInstr *instr = &fn->instrs[i];
+            count += instr->kind == kind && (!tail || instr->op.tail);
+        }
+    }
+    return count;
+}
+
+// Encodes and decodes program; the copy must equal it, hash included
+static void round_trip(const char *what, const TACProgram *program) {
+    size_t len;
+    unsigned char *data = tac_encode(program, 0x1234abcdULL, &len);
+    uint64_t hash = 0;
+    TACProgram *decoded = tac_decode(data, len, &hash);
+    if (!decoded) {
+        printf("FAIL %s: decode returned NULL\n", what);
+        failures++;
+    } else if (!tac_program_equal(program, decoded) || hash != 0x1234abcdULL) {
+        printf("FAIL %s: decoded program differs\n", what);
+        failures++;
+    } else {
+        printf("ok   %s\n", what);
+    }
+    tac_program_free(decoded);
+    free(data);
+}
+
+// The program must contain at least one of kind, or the case tests nothing
+static void expect(const char *what, const TACProgram *program, TACOpKind kind, int tail) {
+    if (count_kind(program, kind, tail) == 0) {
+        printf("FAIL %s: no instruction of the kind under test\n", what);
+        failures++;
+    }
+}
+
+static const char *source =
+    "fn sum(n) {\n"
+    "  def s = 0;\n"
+    "  def i = 0;\n"
+    "  while (i < n) {\n"
+    "    if (i > 2) { s = s + i; } else { s = s - 1; }\n"
+    "    i = i + 1;\n"
+    "  }\n"
+    "  return s;\n"
+    "}\n"
+    "fn pick(a, b) {\n"
+    "  def m = a;\n"
+    "  if (b > a) { m = b; }\n"
+    "  return m;\n"
+    "}\n"
+    "fn even(n) { if (n == 0) { return 1; } return odd(n - 1); }\n"
+    "fn odd(n) { if (n == 0) { return 0; } return even(n - 1); }\n"
+    "fn main() { return sum(10) + pick(3, 4) + even(6); }\n";
+
+static const char *text =
+    "fun f:\n"
+    "pop a\n"
+    "pop b\n"
+    "t0 ← a < b\n"
+    "t1 ← select t0 a b\n"
+    "if_ge t1 10 goto L0\n"
+    "push t1\n"
+    "t2 ← tail call f 1\n"
+    "return t2\n"
+    "L0:\n"
+    "return -7\n"
+    "endfun\n";
+
+// Encodes a copy of text with one instruction damaged by corrupt; the
+// decoder must refuse it
+static void reject(const char *what, void (*corrupt)(TACFunction *fn)) {
+    TACProgram *program = tac_read(text, strlen(text), "test.tac");
+    if (!program) return;
+    corrupt(&program->functions[0]);
+    size_t len;
+    unsigned char *data = tac_encode(program, 0, &len);
+    TACProgram *decoded = tac_decode(data, len, NULL);
+    printf("%s %s\n", decoded ? "FAIL" : "ok  ", what);
+    failures += decoded != NULL;
+    tac_program_free(decoded);
+    tac_program_free(program);
+    free(data);
+}
+
+// Instructions of text: 3 is t0 ← a < b, 5 is if_ge t1 10 goto L0
+static void temp_past_count(TACFunction *fn)  { fn->instrs[3].dst = tac_temp(5000); }
+static void label_past_count(TACFunction *fn) { fn->instrs[5].dst = tac_label(fn->label_count); }
+static void unknown_binop(TACFunction *fn)    { fn->instrs[3].op.binop = (TACBinOp)(TAC_SHR + 1); }
+static void arithmetic_if(TACFunction *fn)    { fn->instrs[5].op.binop = TAC_ADD; }
+static void unknown_unop(TACFunction *fn) {
+    fn->instrs[3].kind = TAC_UNARY_OP;
+    fn->instrs[3].op.unop = (TACUnaryOp)(TAC_NOT + 1);
+    fn->instrs[3].arg2 = (TACOperand){0};
+}
+
+int main(void) {
+    // 1) Lowered source: if_<rel> from the conditions
+    TACProgram *program = front_end(source);
+    expect("front end", program, TAC_IF_CMP, 0);
+    round_trip("front end", program);
+
+    // 2) Selects and phis
+    if_convert_program(program, IF_CONVERT_MAX_SPECULATED);
+    expect("if-converted", program, TAC_SELECT, 0);
+    round_trip("if-converted", program);
+    ssa_construct_program(program);
+    expect("ssa", program, TAC_PHI, 0);
+    round_trip("ssa", program);
+
+    // 3) The rest of the middle end, with tail calls marked
+    sccp_program(program, NULL);
+    lvn_program(program, NULL);
+    licm_program(program, NULL);
+    induction_program(program, NULL);
+    ssa_simplify_program(program, NULL);
+    round_trip("ssa, optimised", program);
+    ssa_destruct_program(program);
+    pre_program(program, NULL);
+    unroll_program(program, UNROLL_DEFAULT_FACTOR, NULL);
+    rotate_program(program, NULL);
+    peephole_program(program, PEEPHOLE_LATE, NULL);
+    tail_call_mark_program(program, NULL);
+    expect("middle end", program, TAC_CALL, 1);
+    round_trip("middle end", program);
+    tac_program_free(program);
+
+    // 4) Read from text, every operand kind in one function
+    program = tac_read(text, strlen(text), "test.tac");
+    if (!program) {
+        printf("FAIL text: tac_read returned NULL\n");
+        failures++;
+    } else {
+        expect("text", program, TAC_CALL, 1);
+        round_trip("text", program);
+        tac_program_free(program);
+    }
+
+    // 5) Damaged bytecode, as a corrupt --cache file would hold
+    reject("temp past the count", temp_past_count);
+    reject("label past the count", label_past_count);
+    reject("unknown binary operator", unknown_binop);
+    reject("arithmetic if", arithmetic_if);
+    reject("unknown unary operator", unknown_unop);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
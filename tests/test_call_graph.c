@@ -0,0 +1,88 @@
+// Call graph: cycles of calls form one component, and dropping dead
+// functions keeps what main reaches, also through a cycle with main, and
+// only that.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_call_graph.c -o test_call_graph
+//   ./test_call_graph
+#include "compiler.h"
+#include "front_end.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+static void check(const char *what, int ok) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    failures += !ok;
+}
+
+static int has_function(const TACProgram *program, const char *name) {
+    int sym = intern(name);
+    for (size_t f = 0; f < program->count; f++) {
+        const TACFunction *fn = &program->functions[f];
+        if (fn->count > 0 && fn->instrs[0].kind == TAC_FUNCTION && fn->instrs[0].dst.sym == sym) return 1;
+    }
+    return 0;
+}
+
+// helper is only called from back, which only main's cycle through it
+// reaches; unused and the cycle it forms with lonely are never called
+static const char *source =
+    "def g = 1;\n"
+    "fn helper(n) { return n + g; }\n"
+    "fn back(n) { if (n > 0) { return main2(n - 1); } return helper(n); }\n"
+    "fn main2(n) { if (n > 5) { return main(); } return back(n); }\n"
+    "fn main() { return main2(3); }\n"
+    "fn unused() { return lonely(); }\n"
+    "fn lonely() { return unused(); }\n";
+
+int main(void) {
+    TACProgram *program = front_end(source);
+
+    // 1) Components and recursion
+    CallGraph *graph = call_graph_build(program);
+    int helper = call_graph_find(graph, intern("helper"));
+    int back = call_graph_find(graph, intern("back"));
+    int main2 = call_graph_find(graph, intern("main2"));
+    int main_fn = call_graph_find(graph, intern("main"));
+    int unused = call_graph_find(graph, intern("unused"));
+    int lonely = call_graph_find(graph, intern("lonely"));
+    check("functions found", helper >= 0 && back >= 0 && main2 >= 0 && main_fn >= 0
+                             && unused >= 0 && lonely >= 0);
+    check("unknown name", call_graph_find(graph, intern("nothing")) == -1);
+    check("cycle", graph->scc[back] == graph->scc[main2] && graph->scc[main2] == graph->scc[main_fn]
+                   && graph->recursive[back] && graph->recursive[main_fn]);
+    check("outside the cycle", graph->scc[helper] != graph->scc[back] && !graph->recursive[helper]);
+    check("callees numbered first", graph->scc[helper] < graph->scc[back]);
+    size_t count;
+    const int *callees = call_graph_callees(graph, back, &count);
+    int calls_helper = 0, calls_main2 = 0;
+    for (size_t i = 0; i < count; i++) {
+        calls_helper += callees[i] == helper;
+        calls_main2 += callees[i] == main2;
+    }
+    check("callees", count == 2 && calls_helper == 1 && calls_main2 == 1);
+    // the code outside functions counts as reached
+    check("reachable", call_graph_mark_reachable(graph, NULL, 0) == 1
+                       && call_graph_mark_reachable(graph, (const char *const[]){ "main" }, 1) == 5
+                       && graph->reachable[helper] && !graph->reachable[unused]);
+    call_graph_free(graph);
+
+    // 2) Without roots main is the entry point; its callees stay
+    check("dead dropped", call_graph_remove_dead(program, NULL, 0) == 2);
+    check("reached through the cycle kept", has_function(program, "helper") && has_function(program, "back")
+                                            && has_function(program, "main2") && has_function(program, "main"));
+    check("unreachable cycle dropped", !has_function(program, "unused") && !has_function(program, "lonely"));
+    check("global code kept", program->count == 5);
+    tac_program_free(program);
+
+    // 3) A root that is no function: nothing is known to be dead
+    program = front_end(source);
+    check("unknown entry", call_graph_remove_dead(program, (const char *const[]){ "start" }, 1) == 0);
+    tac_program_free(program);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
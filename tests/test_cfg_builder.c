@@ -0,0 +1,85 @@
+// A jump to a label the function does not define leaves it without a CFG:
+// build_from_tac fails rather than dropping the edge, and the passes
+// building one leave the function as it is.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_cfg_builder.c -o test_cfg_builder
+//   ./test_cfg_builder
+#include "compiler.h"
+#include "tac_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void check(const char *what, int ok) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    failures += !ok;
+}
+
+static const char *text =
+    "fun f:\n"
+    "pop n\n"
+    "i = 0\n"
+    "L0:\n"
+    "if_ge i n goto L1\n"
+    "t0 ← i + 4\n"
+    "i = i + 1\n"
+    "goto L0\n"
+    "L1:\n"
+    "return i\n"
+    "endfun\n";
+
+// The reader rejects undefined labels, so the jump is retargeted after it
+// to a new label nothing defines, as a pass forgetting to place one would
+static TACProgram *with_undefined_label(void) {
+    TACProgram *program = tac_read(text, strlen(text), "test.tac");
+    if (!program) return NULL;
+    TACFunction *fn = &program->functions[0];
+    int label = tac_function_new_label(fn);
+    for (size_t i = 0; i < fn->count; i++) {
+        if (fn->instrs[i].kind == TAC_GOTO) fn->instrs[i].arg1 = tac_label(label);
+    }
+    return program;
+}
+
+int main(void) {
+    // 1) The reference: every jump resolves
+    TACProgram *program = tac_read(text, strlen(text), "test.tac");
+    CFG *cfg = program ? build_from_tac(&program->functions[0]) : NULL;
+    check("defined labels", cfg != NULL);
+    if (cfg) {
+        free_cfg(cfg);
+        free(cfg);
+    }
+    tac_program_free(program);
+
+    // 2) No CFG for an unresolved jump
+    program = with_undefined_label();
+    check("undefined label read", program != NULL);
+    if (!program) return EXIT_FAILURE;
+    check("undefined label", build_from_tac(&program->functions[0]) == NULL);
+
+    // 3) Passes needing a CFG leave such a function alone
+    TACProgram *before = with_undefined_label();
+    if_convert_program(program, IF_CONVERT_MAX_SPECULATED);
+    ssa_construct_program(program);
+    check("ssa verify fails", ssa_verify_program(program) > 0);
+    sccp_program(program, NULL);
+    lvn_program(program, NULL);
+    licm_program(program, NULL);
+    induction_program(program, NULL);
+    ssa_destruct_program(program);
+    pre_program(program, NULL);
+    unroll_program(program, UNROLL_DEFAULT_FACTOR, NULL);
+    rotate_program(program, NULL);
+    inline_program(program, 0, NULL);
+    check("passes leave it alone", tac_program_equal(program, before));
+    tac_program_free(before);
+    tac_program_free(program);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+// Def-use chains: the sites found for each name, kept current through
+// replacing uses, deleting and compacting; and the SSA cleanups built on
+// them, which must leave main returning the same.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_def_use.c -o test_def_use
+//   ./test_def_use
+#include "compiler.h"
+#include "front_end.h"
+#include "tac_run.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void check(const char *what, int ok) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    failures += !ok;
+}
+
+// Whether the sites hold exactly one of (instr, operand) for each pair given
+static int sites_are(const DefUseSite *sites, size_t count, const int (*expected)[2], size_t expected_count) {
+    if (count != expected_count) return 0;
+    for (size_t e = 0; e < expected_count; e++) {
+        size_t found = 0;
+        for (size_t s = 0; s < count; s++) {
+            found += sites[s].instr == expected[e][0] && sites[s].operand == expected[e][1];
+        }
+        if (found != 1) return 0;
+    }
+    return 1;
+}
+
+static const char *text =
+    "fun f:\n"
+    "pop a\n"            // 1
+    "t0 ← a + 1\n"       // 2
+    "t1 ← t0 * t0\n"     // 3
+    "t2 ← t0\n"          // 4
+    "return t1\n"        // 5
+    "endfun\n";
+
+static size_t count_kind(const TACProgram *program, TACOpKind kind) {
+    size_t count = 0;
+    for (size_t f = 0; f < program->count; f++) {
+        const TACFunction *fn = &program->functions[f];
+        for (size_t i = 0; i < fn->count; i++) count += fn->instrs[i].kind == kind;
+    }
+    return count;
+}
+
+int main(void) {
+    TACProgram *program = tac_read(text, strlen(text), "test.tac");
+    check("read", program != NULL);
+    if (!program) return EXIT_FAILURE;
+    TACFunction *fn = &program->functions[0];
+    TACOperand a = tac_var("a");
+    DefUse *du = def_use_build(fn);
+    size_t count;
+    const DefUseSite *sites;
+
+    // 1) Chains as built
+    sites = def_use_defs(du, tac_temp(0), &count);
+    check("defs of t0", sites_are(sites, count, (const int[][2]){ { 2, DEF_USE_DST } }, 1));
+    sites = def_use_uses(du, tac_temp(0), &count);
+    check("uses of t0", sites_are(sites, count, (const int[][2]){
+              { 3, DEF_USE_ARG1 }, { 3, DEF_USE_ARG2 }, { 4, DEF_USE_ARG1 } }, 3));
+    check("single def", def_use_single_def(du, tac_temp(0)) == 2 && def_use_single_def(du, a) == 1);
+    sites = def_use_uses(du, tac_literal(1), &count);
+    check("no chain for literals", sites == NULL && count == 0);
+
+    // 2) a's list grows past its room and moves
+    def_use_replace_uses(du, fn, tac_temp(0), a);
+    def_use_uses(du, tac_temp(0), &count);
+    check("uses replaced", count == 0 && tac_operand_equal(fn->instrs[3].arg2, a));
+    sites = def_use_uses(du, a, &count);
+    check("uses moved", sites_are(sites, count, (const int[][2]){
+              { 2, DEF_USE_ARG1 }, { 3, DEF_USE_ARG1 }, { 3, DEF_USE_ARG2 }, { 4, DEF_USE_ARG1 } }, 4));
+
+    // 3) Deleted instructions go at compaction, the sites after them renumbered
+    def_use_delete(du, fn, 4);
+    check("deleted", def_use_is_dead(du, 4) && def_use_single_def(du, tac_temp(2)) == -1);
+    def_use_compact(du, fn);
+    sites = def_use_uses(du, tac_temp(1), &count);
+    check("compacted", fn->count == 6 && fn->instrs[4].kind == TAC_RETURN
+                       && sites_are(sites, count, (const int[][2]){ { 4, DEF_USE_ARG1 } }, 1));
+    sites = def_use_uses(du, a, &count);
+    check("compacted uses", sites_are(sites, count, (const int[][2]){
+              { 2, DEF_USE_ARG1 }, { 3, DEF_USE_ARG1 }, { 3, DEF_USE_ARG2 } }, 3));
+    def_use_free(du);
+    tac_program_free(program);
+
+    // 4) The cleanups: copies and the values only they read go
+    program = front_end(
+        "fn f(n) {\n"
+        "  def x = n;\n"
+        "  def unused = n * 3;\n"
+        "  def s = 0;\n"
+        "  def i = 0;\n"
+        "  while (i < x) { s = s + i; i = i + 1; }\n"
+        "  return s;\n"
+        "}\n"
+        "fn main() { return f(5); }\n");
+    int before = 0, after = 0;
+    tac_run(program, "main", NULL, 0, &before);
+    ssa_construct_program(program);
+    size_t copies = count_kind(program, TAC_COPY) + count_kind(program, TAC_DEFINE);
+    SSASimplifyStats stats = {0};
+    ssa_simplify_program(program, &stats);
+    check("simplify verifies", ssa_verify_program(program) == 0);
+    check("simplify runs", tac_run(program, "main", NULL, 0, &after) && before == 10 && after == 10);
+    check("simplify counts", stats.copies > 0 && stats.dead > 0);
+    check("simplify drops copies", count_kind(program, TAC_COPY) + count_kind(program, TAC_DEFINE) < copies);
+    check("simplify drops unused", count_kind(program, TAC_BINARY_OP) == 2);
+    tac_program_free(program);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+// Induction variables: a multiplication by the loop counter becomes an
+// addition, an exit test against a literal moves to the reduced variable,
+// and multiplications and non-negative divisions by powers of two become
+// shifts. f returns the same as before the passes.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_induction.c -o test_induction
+//   ./test_induction
+#include "compiler.h"
+#include "front_end.h"
+#include "tac_run.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+static size_t count_op(const TACFunction *fn, TACBinOp op) {
+    size_t count = 0;
+    for (size_t i = 0; i < fn->count; i++) {
+        count += fn->instrs[i].kind == TAC_BINARY_OP && fn->instrs[i].op.binop == op;
+    }
+    return count;
+}
+
+static size_t count_kind(const TACFunction *fn, TACOpKind kind) {
+    size_t count = 0;
+    for (size_t i = 0; i < fn->count; i++) count += fn->instrs[i].kind == kind;
+    return count;
+}
+
+// f(n, a) after SSA form, SCCP (for the literal start of i) and the pass;
+// expected holds the stats, then how many of each operator and phis are left
+static void check(const char *what, const char *code, InductionStats expected,
+                  size_t muls, size_t divs, size_t shifts, size_t phis) {
+    TACProgram *before = front_end(code);
+    TACProgram *program = front_end(code);
+    ssa_construct_program(program);
+    sccp_program(program, NULL);
+    InductionStats stats = {0};
+    induction_program(program, &stats);
+    const TACFunction *fn = &program->functions[0];
+
+    int ok = ssa_verify_program(program) == 0;
+    for (int n = 0; ok && n < 6; n += 5) {
+        for (int a = -3; ok && a <= 3; a += 3) {
+            int args[2] = { n, a }, result, expected_result;
+            ok = tac_run(before, "f", args, 2, &expected_result) && tac_run(program, "f", args, 2, &result)
+                 && result == expected_result;
+        }
+    }
+    if (!ok) {
+        printf("FAIL %s: f returns something else\n", what);
+        failures++;
+    } else if (stats.reduced != expected.reduced || stats.replaced_tests != expected.replaced_tests
+               || stats.shifts != expected.shifts) {
+        printf("FAIL %s: %zu reduced, %zu tests replaced, %zu shifts\n", what,
+               stats.reduced, stats.replaced_tests, stats.shifts);
+        failures++;
+    } else if (count_op(fn, TAC_MUL) != muls || count_op(fn, TAC_DIV) != divs
+               || count_op(fn, TAC_SHL) + count_op(fn, TAC_SHR) != shifts || count_kind(fn, TAC_PHI) != phis) {
+        printf("FAIL %s: %zu multiplications, %zu divisions, %zu shifts and %zu phis left\n", what,
+               count_op(fn, TAC_MUL), count_op(fn, TAC_DIV), count_op(fn, TAC_SHL) + count_op(fn, TAC_SHR),
+               count_kind(fn, TAC_PHI));
+        failures++;
+    } else {
+        printf("ok   %s\n", what);
+    }
+    tac_program_free(before);
+    tac_program_free(program);
+}
+
+int main(void) {
+    // 1) i * a steps by a; the test on n stays with i
+    check("strength reduction",
+          "fn f(n, a) {\n"
+          "  def s = 0;\n"
+          "  def i = 0;\n"
+          "  while (i < n) { s = s + i * a; i = i + 1; }\n"
+          "  return s;\n"
+          "}\n", (InductionStats){ .reduced = 1 }, 0, 0, 0, 3);
+
+    // 2) i * 3 < 30 replaces i < 10, and i goes
+    check("test replacement",
+          "fn f(n, a) {\n"
+          "  def s = 0;\n"
+          "  def i = 0;\n"
+          "  while (i < 10) { s = s + i * 3; i = i + 1; }\n"
+          "  return s;\n"
+          "}\n", (InductionStats){ .reduced = 1, .replaced_tests = 1 }, 0, 0, 0, 2);
+
+    // 3) i is never negative, a may be
+    check("shifts",
+          "fn f(n, a) {\n"
+          "  def s = 0;\n"
+          "  def i = 0;\n"
+          "  while (i < n) { s = s + i / 4 + a * 8 + a / 4; i = i + 1; }\n"
+          "  return s;\n"
+          "}\n", (InductionStats){ .shifts = 2 }, 0, 1, 2, 2);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+// Inlining must not let a caller's variable take the place of a global
+// the callee reads: such calls stay calls, the others are inlined.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_inliner.c -o test_inliner
+//   ./test_inliner
+#include "compiler.h"
+#include "front_end.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+// Calls main makes after inlining
+static size_t calls_in_main(const TACProgram *program) {
+    int main_sym = intern("main");
+    for (size_t f = 0; f < program->count; f++) {
+        const TACFunction *fn = &program->functions[f];
+        if (fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION || fn->instrs[0].dst.sym != main_sym) continue;
+        size_t calls = 0;
+        for (size_t i = 0; i < fn->count; i++) calls += fn->instrs[i].kind == TAC_CALL;
+        return calls;
+    }
+    return 0;
+}
+
+static void check(const char *what, const char *code, size_t calls) {
+    TACProgram *program = front_end(code);
+    inline_program(program, 0, NULL);
+    size_t left = calls_in_main(program);
+    if (left != calls) {
+        printf("FAIL %s: %zu calls left in main, expected %zu\n", what, left, calls);
+        failures++;
+    } else {
+        printf("ok   %s\n", what);
+    }
+    tac_program_free(program);
+}
+
+int main(void) {
+    // 1) f reads the global g; main's own g would be read instead
+    check("global read, local of the same name",
+          "def g = 5;\n"
+          "fn f() { return g; }\n"
+          "fn main() { def g = 1; return f() + g; }\n", 1);
+
+    // 2) Nothing to capture
+    check("global read",
+          "def g = 5;\n"
+          "fn f() { return g; }\n"
+          "fn main() { return f() + 1; }\n", 0);
+
+    // 3) f's g is its own, renamed apart from main's
+    check("both local",
+          "fn f() { def g = 2; return g; }\n"
+          "fn main() { def g = 1; return f() + g; }\n", 0);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
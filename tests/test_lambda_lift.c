@@ -0,0 +1,92 @@
+// Lambda lifting: captured variables reach the lifted functions, also
+// through several levels and past functions declaring the same name.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_lambda_lift.c -o test_lambda_lift
+//   ./test_lambda_lift
+#include "compiler.h"
+#include "front_end.h"
+#include "tac_run.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+static void check(const char *what, const char *code, int expected) {
+    TACProgram *program = front_end(code);
+    int result;
+    if (!tac_run(program, "main", NULL, 0, &result)) {
+        printf("FAIL %s: the program did not return\n", what);
+        failures++;
+    } else if (result != expected) {
+        printf("FAIL %s: main returned %d, expected %d\n", what, result, expected);
+        failures++;
+    } else {
+        printf("ok   %s\n", what);
+    }
+    tac_program_free(program);
+}
+
+int main(void) {
+    // 1) One level
+    check("capture",
+          "fn outer(a) {\n"
+          "  def x = 10;\n"
+          "  fn inner(b) { return x + a + b; }\n"
+          "  return inner(1);\n"
+          "}\n"
+          "fn main() { return outer(100); }\n", 111);
+
+    // 2) inner is called from middle, which must pass outer's x on
+    check("capture through two levels",
+          "fn outer() {\n"
+          "  def x = 10;\n"
+          "  fn middle() {\n"
+          "    fn inner() { return x; }\n"
+          "    return inner() + 1;\n"
+          "  }\n"
+          "  return middle();\n"
+          "}\n"
+          "fn main() { return outer(); }\n", 11);
+
+    // 3) other's own x must not be passed for outer's
+    check("shadowed in the caller",
+          "fn outer() {\n"
+          "  def x = 10;\n"
+          "  fn inner() { return x; }\n"
+          "  fn other() { def x = 99; return inner() + x; }\n"
+          "  return other();\n"
+          "}\n"
+          "fn main() { return outer(); }\n", 109);
+
+    // 4) Both: the caller two levels down shadows x and also reads it
+    check("shadowed two levels down",
+          "fn outer() {\n"
+          "  def x = 10;\n"
+          "  fn inner() { return x; }\n"
+          "  fn middle() {\n"
+          "    def x = 5;\n"
+          "    fn deep() { return inner() * 100 + x; }\n"
+          "    return deep();\n"
+          "  }\n"
+          "  return middle();\n"
+          "}\n"
+          "fn main() { return outer(); }\n", 1005);
+
+    // 5) A nested x nearer than the captured one
+    check("nearest declaration",
+          "fn outer() {\n"
+          "  def x = 1;\n"
+          "  fn middle() {\n"
+          "    def x = 2;\n"
+          "    fn inner() { return x; }\n"
+          "    return inner();\n"
+          "  }\n"
+          "  return middle() * 10 + x;\n"
+          "}\n"
+          "fn main() { return outer(); }\n", 21);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+// Local value numbering: a computation repeated in a block, operands
+// swapped or not, becomes a copy; one whose operand was reassigned, that
+// reads a global past a call, or that is in another block stays.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_lvn.c -o test_lvn
+//   ./test_lvn
+#include "compiler.h"
+#include "tac_run.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void check(const char *what, int ok) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    failures += !ok;
+}
+
+// Whether instruction i of fn is a copy of temp `from`
+static int copies(const TACFunction *fn, size_t i, int from) {
+    return fn->instrs[i].kind == TAC_COPY && tac_operand_equal(fn->instrs[i].arg1, tac_temp(from));
+}
+
+static const char *text =
+    "define g = 10\n"
+    "fun h:\n"
+    "return 0\n"
+    "endfun\n"
+    "fun f:\n"
+    "pop a\n"               // 1
+    "pop b\n"               // 2
+    "t0 ← a * b\n"          // 3
+    "t1 ← b * a\n"          // 4  t0
+    "t2 ← a > b\n"          // 5
+    "t3 ← b < a\n"          // 6  t2
+    "a ← 1\n"               // 7
+    "t4 ← a * b\n"          // 8  a is another value now
+    "t5 ← g + 1\n"          // 9
+    "t6 ← call h 0\n"       // 10
+    "t7 ← g + 1\n"          // 11 h may have changed g
+    "t8 ← g + 1\n"          // 12 t7
+    "goto L0\n"             // 13
+    "L0:\n"                 // 14
+    "t9 ← g + 1\n"          // 15 another block
+    "t10 ← t1 + t3\n"
+    "t10 ← t10 + t4\n"
+    "t10 ← t10 + t5\n"
+    "t10 ← t10 + t8\n"
+    "t10 ← t10 + t9\n"
+    "return t10\n"
+    "endfun\n"
+    "fun main:\n"
+    "push 3\n"
+    "push 4\n"
+    "t0 ← call f 2\n"
+    "return t0\n"
+    "endfun\n";
+
+int main(void) {
+    TACProgram *program = tac_read(text, strlen(text), "test.tac");
+    check("read", program != NULL);
+    if (!program) return EXIT_FAILURE;
+    int before = 0, after = 0;
+    tac_run(program, "main", NULL, 0, &before);
+    LVNStats stats = {0};
+    lvn_program(program, &stats);
+    const TACFunction *fn = &program->functions[2];
+
+    check("swapped operands", copies(fn, 4, 0));
+    check("flipped relation", copies(fn, 6, 2));
+    check("reassigned operand", fn->instrs[8].kind == TAC_BINARY_OP);
+    check("global past a call", fn->instrs[11].kind == TAC_BINARY_OP && copies(fn, 12, 7));
+    check("other block", fn->instrs[15].kind == TAC_BINARY_OP);
+    check("stats", stats.redundant == 3);
+    check("result", tac_run(program, "main", NULL, 0, &after) && before == 12 + 0 + 4 + 11 + 11 + 11
+                    && after == before);
+    tac_program_free(program);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+// Peephole rules: each rule of the table fires on a window made for it,
+// leaving the function no longer and returning the same; the ones for
+// multiplications wait for the late run, and dead-temp keeps divisions
+// that could trap.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_peephole.c -o test_peephole
+//   ./test_peephole
+#include "compiler.h"
+#include "tac_run.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+static unsigned char fired[PEEPHOLE_MAX_RULES];
+
+static size_t rule_index(const char *name) {
+    for (size_t r = 0; r < peephole_rule_count; r++) {
+        if (strcmp(peephole_rules[r].name, name) == 0) return r;
+    }
+    return peephole_rule_count;
+}
+
+// f(a, b) with the given body, "fun f:", its pops and "endfun" added
+static TACProgram *read_body(const char *body) {
+    char text[512];
+    snprintf(text, sizeof(text), "fun f:\npop a\npop b\n%sendfun\n", body);
+    return tac_read(text, strlen(text), "test.tac");
+}
+
+// rule must fire in the given run; f must return the same and not grow
+static void check(const char *rule, unsigned run, const char *body) {
+    TACProgram *before = read_body(body);
+    TACProgram *program = read_body(body);
+    size_t r = rule_index(rule);
+    if (!before || !program || r == peephole_rule_count) {
+        printf("FAIL %s: no such rule or unreadable body\n", rule);
+        failures++;
+        tac_program_free(before);
+        tac_program_free(program);
+        return;
+    }
+    PeepholeStats stats = {0};
+    peephole_program(program, run, &stats);
+
+    static const int args[][2] = { { -3, 5 }, { 7, 7 }, { INT_MIN, 2 }, { 0, -1 } };
+    int ok = 1;
+    for (size_t k = 0; ok && k < sizeof(args) / sizeof(args[0]); k++) {
+        int result, expected;
+        ok = tac_run(before, "f", args[k], 2, &expected) && tac_run(program, "f", args[k], 2, &result)
+             && result == expected;
+    }
+    if (stats.hits[r] == 0) {
+        printf("FAIL %s: did not fire\n", rule);
+        failures++;
+    } else if (!ok) {
+        printf("FAIL %s: f returns something else\n", rule);
+        failures++;
+    } else if (program->functions[0].count > before->functions[0].count) {
+        printf("FAIL %s: f grew\n", rule);
+        failures++;
+    } else {
+        printf("ok   %s\n", rule);
+        fired[r] = 1;
+    }
+    tac_program_free(before);
+    tac_program_free(program);
+}
+
+// The body must come out of the run as it went in
+static void unchanged(const char *what, unsigned run, const char *body) {
+    TACProgram *before = read_body(body);
+    TACProgram *program = read_body(body);
+    if (program) peephole_program(program, run, NULL);
+    int ok = before && program && tac_program_equal(before, program);
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    failures += !ok;
+    tac_program_free(before);
+    tac_program_free(program);
+}
+
+int main(void) {
+    // 1) Every rule in the table
+    check("add-zero",        PEEPHOLE_EARLY, "t0 ← 0 + a\nreturn t0\n");
+    check("mul-one",         PEEPHOLE_EARLY, "t0 ← a * 1\nreturn t0\n");
+    check("mul-zero",        PEEPHOLE_EARLY, "t0 ← 0 * a\nreturn t0\n");
+    check("mul-two",         PEEPHOLE_LATE,  "t0 ← a * 2\nreturn t0\n");
+    check("mul-pow2",        PEEPHOLE_LATE,  "t0 ← 8 * a\nreturn t0\n");
+    check("sub-self",        PEEPHOLE_EARLY, "t0 ← a - a\nreturn t0\n");
+    check("double-negation", PEEPHOLE_EARLY, "t0 ← - a\nt1 ← - t0\nreturn t1\n");
+    check("double-negation", PEEPHOLE_EARLY, "t0 ← ! a\nt1 ← ! t0\nreturn t1\n");
+    check("not-relation",    PEEPHOLE_EARLY, "t0 ← a < b\nt1 ← ! t0\nreturn t1\n");
+    check("forward-temp",    PEEPHOLE_EARLY, "t0 ← a + b\nx ← t0\nreturn x\n");
+    check("forward-copy",    PEEPHOLE_EARLY, "t0 ← a\nt1 ← t0 + b\nreturn t1\n");
+    check("self-copy",       PEEPHOLE_EARLY, "a ← a\nreturn a\n");
+    check("dead-temp",       PEEPHOLE_EARLY, "t0 ← a + b\nt1 ← a / 2\nreturn a\n");
+    check("jump-to-next",    PEEPHOLE_EARLY, "if_lt a b goto L0\nL0:\nreturn a\n");
+
+    size_t missed = 0;
+    for (size_t r = 0; r < peephole_rule_count; r++) missed += !fired[r];
+    printf("%s every rule fired\n", missed ? "FAIL" : "ok  ");
+    failures += missed > 0;
+
+    // 2) What the rules must leave alone
+    unchanged("mul-two only late", PEEPHOLE_EARLY, "t0 ← a * 2\nreturn t0\n");
+    unchanged("mul-pow2 only late", PEEPHOLE_EARLY, "t0 ← a * 8\nreturn t0\n");
+    unchanged("dead x / 0 kept", PEEPHOLE_LATE, "t0 ← a / 0\nreturn a\n");
+    unchanged("dead x / -1 kept", PEEPHOLE_LATE, "t0 ← a / -1\nreturn a\n");
+    unchanged("dead x % b kept", PEEPHOLE_LATE, "t0 ← a % b\nreturn a\n");
+    unchanged("dead call kept", PEEPHOLE_LATE, "t0 ← call f 0\nreturn a\n");
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+// Loop rotation: a while loop becomes a guard in front of a do-while whose
+// only back edge is the copied test; a test longer than ROTATE_MAX_TEST
+// stays at the top. f returns the same as before.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_rotate.c -o test_rotate
+//   ./test_rotate
+#include "compiler.h"
+#include "front_end.h"
+#include "tac_run.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+static const TACOperand *jump_target(const TACInstr *instr) {
+    switch (instr->kind) {
+        case TAC_GOTO:   return &instr->arg1;
+        case TAC_IFZ:    return &instr->arg2;
+        case TAC_IF_CMP: return &instr->dst;
+        default:         return NULL;
+    }
+}
+
+// A conditional jump past the loop, then the body with a conditional jump
+// back to its top as the only back edge, ending where the guard goes
+static int rotated(const TACFunction *fn) {
+    size_t guard = fn->count, back = fn->count, back_edges = 0;
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACOperand *label = jump_target(&fn->instrs[i]);
+        if (!label) continue;
+        size_t target = tac_function_label_index(fn, label->literal);
+        if (target < i) {
+            back = i;
+            back_edges++;
+        } else if (guard == fn->count) {
+            guard = i;
+        }
+    }
+    if (guard == fn->count || back_edges != 1 || fn->instrs[back].kind == TAC_GOTO) return 0;
+    size_t top = tac_function_label_index(fn, jump_target(&fn->instrs[back])->literal);
+    size_t exit = tac_function_label_index(fn, jump_target(&fn->instrs[guard])->literal);
+    return guard < top && top < back && exit == back + 1;
+}
+
+// f(n) after rotation, run for n = -1 .. 6
+static void check(const char *what, const char *code, int expect_rotated) {
+    TACProgram *before = front_end(code);
+    TACProgram *program = front_end(code);
+    RotateStats stats = {0};
+    rotate_program(program, &stats);
+
+    int ok = 1;
+    for (int n = -1; ok && n < 7; n++) {
+        int result, expected;
+        ok = tac_run(before, "f", &n, 1, &expected) && tac_run(program, "f", &n, 1, &result)
+             && result == expected;
+    }
+    if (!ok) {
+        printf("FAIL %s: f returns something else\n", what);
+        failures++;
+    } else if (rotated(&program->functions[0]) != expect_rotated || stats.loops != (size_t)expect_rotated) {
+        printf("FAIL %s: %s\n", what, expect_rotated ? "not rotated" : "rotated");
+        failures++;
+    } else {
+        printf("ok   %s\n", what);
+    }
+    tac_program_free(before);
+    tac_program_free(program);
+}
+
+int main(void) {
+    // 1) The test is one if_<rel>, or a few instructions computing it
+    check("single test",
+          "fn f(n) { def s = 0; def i = 0; while (i < n) { s = s + i; i = i + 1; } return s; }\n", 1);
+    check("computed test",
+          "fn f(n) { def s = 0; def i = 0; while (i * i + 1 < n) { s = s + i; i = i + 1; } return s; }\n", 1);
+    check("branch in the body",
+          "fn f(n) {\n"
+          "  def s = 0;\n"
+          "  def i = 0;\n"
+          "  while (i < n) { if (i > 2) { s = s + i; i = i + 1; } else { i = i + 2; } }\n"
+          "  return s;\n"
+          "}\n", 1);
+
+    // 2) Copying this test would cost more than the jump it saves
+    check("long test",
+          "fn f(n) { def s = 0; def i = 0; while (i * i * i + i * 2 + 1 < n) { s = s + i; i = i + 1; } return s; }\n", 0);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+// Sparse conditional constant propagation: constants are folded into their
+// readers, branches they decide go with the code only they reached, and
+// what would trap is left for run time. main returns the same throughout.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_sccp.c -o test_sccp
+//   ./test_sccp
+#include "compiler.h"
+#include "tac_run.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void check(const char *what, int ok) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    failures += !ok;
+}
+
+static size_t count_kind(const TACFunction *fn, TACOpKind kind) {
+    size_t count = 0;
+    for (size_t i = 0; i < fn->count; i++) count += fn->instrs[i].kind == kind;
+    return count;
+}
+
+// The operand of the function's only return, or TAC_NONE
+static TACOperand returned(const TACFunction *fn) {
+    if (count_kind(fn, TAC_RETURN) != 1) return TAC_NONE;
+    for (size_t i = 0; i < fn->count; i++) {
+        if (fn->instrs[i].kind == TAC_RETURN) return fn->instrs[i].arg1;
+    }
+    return TAC_NONE;
+}
+
+// Runs SCCP on text in SSA form; main must still return expected
+static TACProgram *run_sccp(const char *what, const char *text, int expected, SCCPStats *stats) {
+    TACProgram *program = tac_read(text, strlen(text), "test.tac");
+    if (!program) return NULL;
+    ssa_construct_program(program);
+    sccp_program(program, stats);
+    int result = 0;
+    check(what, ssa_verify_program(program) == 0 && tac_run(program, "main", NULL, 0, &result)
+                && result == expected);
+    return program;
+}
+
+int main(void) {
+    // 1) n * 2 folds, the branch on it is decided and return 1 goes
+    SCCPStats stats = {0};
+    TACProgram *program = run_sccp("fold runs",
+        "fun main:\n"
+        "define n = 5\n"
+        "t0 ← n * 2\n"
+        "if_gt t0 5 goto L0\n"
+        "return 1\n"
+        "L0:\n"
+        "return t0\n"
+        "endfun\n", 10, &stats);
+    if (program) {
+        const TACFunction *fn = &program->functions[0];
+        check("fold", tac_operand_equal(returned(fn), tac_literal(10)));
+        check("branch removed", count_kind(fn, TAC_IF_CMP) == 0);
+        check("stats", stats.constants >= 2 && stats.branches == 1 && stats.blocks == 1);
+        tac_program_free(program);
+    }
+
+    // 2) Both ways into L1 bring 3, whatever a is
+    program = run_sccp("phi of one constant runs",
+        "fun f:\n"
+        "pop a\n"
+        "define x = 3\n"
+        "ifz a goto L1\n"
+        "x ← 1 + 2\n"
+        "L1:\n"
+        "return x\n"
+        "endfun\n"
+        "fun main:\n"
+        "push 4\n"
+        "t0 ← call f 1\n"
+        "return t0\n"
+        "endfun\n", 3, NULL);
+    if (program) {
+        check("phi of one constant", tac_operand_equal(returned(&program->functions[0]), tac_literal(3)));
+        tac_program_free(program);
+    }
+
+    // 3) The division never runs, as the branch over it is decided
+    program = run_sccp("trap on a dead path runs",
+        "fun main:\n"
+        "define z = 0\n"
+        "if_eq z 0 goto L0\n"
+        "t0 ← 1 / z\n"
+        "return t0\n"
+        "L0:\n"
+        "return 2\n"
+        "endfun\n", 2, NULL);
+    if (program) {
+        check("trap on a dead path", count_kind(&program->functions[0], TAC_BINARY_OP) == 0);
+        tac_program_free(program);
+    }
+
+    // 4) Reached, it stays to trap at run time
+    const char *division = "fun main:\ndefine z = 0\nt0 ← 1 / z\nreturn t0\nendfun\n";
+    program = tac_read(division, strlen(division), "test.tac");
+    if (program) {
+        ssa_construct_program(program);
+        sccp_program(program, NULL);
+        const TACFunction *fn = &program->functions[0];
+        check("division by zero kept", count_kind(fn, TAC_BINARY_OP) == 1
+                                       && tac_operand_equal(returned(fn), tac_temp(0)));
+        tac_program_free(program);
+    }
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
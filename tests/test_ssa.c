@@ -0,0 +1,100 @@
+// SSA form: construction passes the verifier, and the program returns the
+// same in SSA form and once destruction has turned the phis into copies.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_ssa.c -o test_ssa
+//   ./test_ssa
+#include "compiler.h"
+#include "front_end.h"
+#include "tac_run.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+static size_t count_kind(const TACProgram *program, TACOpKind kind) {
+    size_t count = 0;
+    for (size_t f = 0; f < program->count; f++) {
+        const TACFunction *fn = &program->functions[f];
+        for (size_t i = 0; i < fn->count; i++) count += fn->instrs[i].kind == kind;
+    }
+    return count;
+}
+
+// main must return expected before, in and after SSA form
+static void check(const char *what, const char *code, int expected) {
+    TACProgram *program = front_end(code);
+    int before = 0, in_ssa = 0, after = 0;
+    int ran = tac_run(program, "main", NULL, 0, &before);
+    ssa_construct_program(program);
+    size_t problems = ssa_verify_program(program);
+    size_t phis = count_kind(program, TAC_PHI);
+    ran = ran && tac_run(program, "main", NULL, 0, &in_ssa);
+    ssa_destruct_program(program);
+    ran = ran && tac_run(program, "main", NULL, 0, &after);
+
+    if (!ran) {
+        printf("FAIL %s: the program did not return\n", what);
+        failures++;
+    } else if (problems > 0 || phis == 0) {
+        printf("FAIL %s: %zu verifier problems, %zu phis\n", what, problems, phis);
+        failures++;
+    } else if (count_kind(program, TAC_PHI) > 0) {
+        printf("FAIL %s: phis left after destruction\n", what);
+        failures++;
+    } else if (before != expected || in_ssa != expected || after != expected) {
+        printf("FAIL %s: main returned %d, %d in SSA form and %d after, expected %d\n",
+               what, before, in_ssa, after, expected);
+        failures++;
+    } else {
+        printf("ok   %s\n", what);
+    }
+    tac_program_free(program);
+}
+
+int main(void) {
+    // 1) x is written in both arms of a branch inside the loop
+    check("both arms in a loop",
+          "fn f(n) {\n"
+          "  def x = 0;\n"
+          "  def i = 0;\n"
+          "  while (i < n) {\n"
+          "    if (i > 2) { x = x + i; } else { x = x - 1; }\n"
+          "    i = i + 1;\n"
+          "  }\n"
+          "  return x;\n"
+          "}\n"
+          "fn main() { return f(6); }\n", 9);
+
+    // 2) The phis of a and b read each other: destruction must swap them
+    check("swap",
+          "fn main() {\n"
+          "  def a = 1;\n"
+          "  def b = 2;\n"
+          "  def i = 0;\n"
+          "  while (i < 3) {\n"
+          "    def t = a;\n"
+          "    a = b;\n"
+          "    b = t;\n"
+          "    i = i + 1;\n"
+          "  }\n"
+          "  return a * 10 + b;\n"
+          "}\n", 21);
+
+    // 3) Nested loops, the inner one's phis fed from the outer
+    check("nested loops",
+          "fn main() {\n"
+          "  def s = 0;\n"
+          "  def i = 0;\n"
+          "  while (i < 4) {\n"
+          "    def j = 0;\n"
+          "    while (j < i) { s = s + j; j = j + 1; }\n"
+          "    i = i + 1;\n"
+          "  }\n"
+          "  return s;\n"
+          "}\n", 4);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
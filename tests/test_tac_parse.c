@@ -0,0 +1,54 @@
+// Lowering declarations: an initializer reading the name it declares reads
+// the variable declared before, not the new one.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_tac_parse.c -o test_tac_parse
+//   ./test_tac_parse
+#include "compiler.h"
+#include "front_end.h"
+#include "tac_run.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+static void check(const char *what, const char *code, int expected) {
+    TACProgram *program = front_end(code);
+    int result;
+    if (!tac_run(program, "main", NULL, 0, &result)) {
+        printf("FAIL %s: the program did not return\n", what);
+        failures++;
+    } else if (result != expected) {
+        printf("FAIL %s: main returned %d, expected %d\n", what, result, expected);
+        failures++;
+    } else {
+        printf("ok   %s\n", what);
+    }
+    tac_program_free(program);
+}
+
+int main(void) {
+    // 1) Computed straight into the variable
+    check("computed initializer",
+          "fn f(a) { return a * 2; }\n"
+          "fn main() { def g = 5; def h = f(g) + 1; return h; }\n", 11);
+
+    // 2) The g of the enclosing block, then the new one
+    check("initializer reading the declared name",
+          "fn main() {\n"
+          "  def g = 5;\n"
+          "  if (g > 0) { def g = g + 1; return g; }\n"
+          "  return 0;\n"
+          "}\n", 6);
+    check("declared name passed to a call",
+          "fn f(a) { return a * 2; }\n"
+          "fn main() {\n"
+          "  def g = 5;\n"
+          "  if (g > 0) { def g = f(g); return g; }\n"
+          "  return 0;\n"
+          "}\n", 10);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
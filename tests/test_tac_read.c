@@ -0,0 +1,103 @@
+// Reading textual TAC: the counts in the "fun" header are kept; jumps to
+// labels that are never defined, labels defined twice and numbers beyond
+// int are rejected.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_tac_read.c -o test_tac_read
+//   ./test_tac_read
+#include "compiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+static int failures = 0;
+
+static void check(const char *what, int ok) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    failures += !ok;
+}
+
+static TACProgram *read_text(const char *text) {
+    return tac_read(text, strlen(text), "test.tac");
+}
+
+// L1 is counted by the header though nothing uses it any more
+static const char *with_header =
+    "fun f: ; 3 temps, 2 labels\n"
+    "pop a\n"
+    "t0 ← a + 1\n"
+    "ifz t0 goto L0\n"
+    "return t0\n"
+    "L0:\n"
+    "return 0\n"
+    "endfun\n";
+
+static const char *without_header =
+    "fun f:\n"
+    "t4 ← 1\n"
+    "goto L2\n"
+    "L2:\n"
+    "return t4\n"
+    "endfun\n";
+
+// A header below the ids used is raised to cover them
+static const char *short_header =
+    "fun f: ; 1 temps, 0 labels\n"
+    "t2 ← 1\n"
+    "goto L1\n"
+    "L1:\n"
+    "return t2\n"
+    "endfun\n";
+
+int main(void) {
+    // 1) Counts from the header, not from the ids used
+    TACProgram *program = read_text(with_header);
+    check("header read", program != NULL);
+    if (program) {
+        const TACFunction *fn = &program->functions[0];
+        check("header temps", fn->temp_count == 3);
+        check("header labels", fn->label_count == 2);
+        check("header synced", fn->instrs[0].arg1.literal == 3 && fn->instrs[0].arg2.literal == 2);
+        tac_program_free(program);
+    }
+
+    // 2) Counts from the ids used
+    program = read_text(without_header);
+    check("no header read", program != NULL);
+    if (program) {
+        check("no header counts", program->functions[0].temp_count == 5 && program->functions[0].label_count == 3);
+        tac_program_free(program);
+    }
+    program = read_text(short_header);
+    check("short header read", program != NULL);
+    if (program) {
+        check("short header counts", program->functions[0].temp_count == 3 && program->functions[0].label_count == 2);
+        tac_program_free(program);
+    }
+
+    // 3) Jumps to labels that are not there, or only in another function
+    check("undefined goto", read_text("fun f:\ngoto L3\nendfun\n") == NULL);
+    check("undefined ifz", read_text("fun f:\nL0:\nifz a goto L1\nendfun\n") == NULL);
+    check("undefined if_lt", read_text("fun f:\nif_lt a b goto L0\nendfun\n") == NULL);
+    check("label of another function",
+          read_text("fun f:\nL0:\nreturn\nendfun\nfun g:\ngoto L0\nendfun\n") == NULL);
+
+    // 4) Labels defined twice
+    check("duplicate label", read_text("fun f:\nL0:\nreturn\nL0:\nreturn\nendfun\n") == NULL);
+
+    // 5) Numbers past int, not wrapped around to another temp or value
+    check("temp past int", read_text("fun f:\nt2147483648 ← 7\nendfun\n") == NULL);
+    check("temp wrapping to t0", read_text("fun f:\nt4294967296 ← 7\nreturn t0\nendfun\n") == NULL);
+    check("label past int", read_text("fun f:\nL2147483648:\nendfun\n") == NULL);
+    check("literal past int", read_text("fun f:\nreturn 2147483648\nendfun\n") == NULL);
+    check("header past int", read_text("fun f: ; 4294967297 temps, 0 labels\nendfun\n") == NULL);
+    check("negative header", read_text("fun f: ; -1 temps, 0 labels\nendfun\n") == NULL);
+    program = read_text("fun f:\nreturn -2147483648\nendfun\n");
+    check("smallest int", program && program->functions[0].instrs[1].arg1.literal == INT_MIN);
+    tac_program_free(program);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+// Tail calls: a function returning the result of calling itself runs in
+// one frame, a self call with the wrong number of arguments stays a call,
+// and only calls whose result is returned right away are marked.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_tail_call.c -o test_tail_call
+//   ./test_tail_call
+#include "compiler.h"
+#include "tac_run.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void check(const char *what, int ok) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    failures += !ok;
+}
+
+// The function's calls, and how many of them are marked
+static size_t calls(const TACProgram *program, const char *name, size_t *marked) {
+    size_t count = 0;
+    *marked = 0;
+    for (size_t f = 0; f < program->count; f++) {
+        const TACFunction *fn = &program->functions[f];
+        if (fn->count == 0 || fn->instrs[0].kind != TAC_FUNCTION || fn->instrs[0].dst.sym != intern(name)) continue;
+        for (size_t i = 0; i < fn->count; i++) {
+            if (fn->instrs[i].kind != TAC_CALL) continue;
+            count++;
+            *marked += fn->instrs[i].op.tail != 0;
+        }
+    }
+    return count;
+}
+
+// sum(n, acc) = acc + n + (n - 1) + ... + 1; bad passes sum one argument
+static const char *text =
+    "fun sum:\n"
+    "pop n\n"
+    "pop acc\n"
+    "ifz n goto L0\n"
+    "t0 ← acc + n\n"
+    "t1 ← n - 1\n"
+    "push t1\n"
+    "push t0\n"
+    "t2 ← call sum 2\n"
+    "return t2\n"
+    "L0:\n"
+    "return acc\n"
+    "endfun\n"
+    "fun bad:\n"
+    "pop n\n"
+    "pop acc\n"
+    "ifz n goto L0\n"
+    "t1 ← n - 1\n"
+    "push t1\n"
+    "t2 ← call bad 1\n"
+    "return t2\n"
+    "L0:\n"
+    "return acc\n"
+    "endfun\n"
+    "fun g:\n"
+    "pop n\n"
+    "push n\n"
+    "push 0\n"
+    "t0 ← call sum 2\n"
+    "return t0\n"
+    "endfun\n"
+    "fun h:\n"
+    "pop n\n"
+    "push n\n"
+    "push 0\n"
+    "t0 ← call sum 2\n"
+    "t1 ← t0 + 1\n"
+    "return t1\n"
+    "endfun\n";
+
+int main(void) {
+    TACProgram *program = tac_read(text, strlen(text), "test.tac");
+    check("read", program != NULL);
+    if (!program) return EXIT_FAILURE;
+    int deep[2] = { 5000, 0 }, result = 0;
+    check("too deep before", !tac_run(program, "sum", deep, 2, &result));
+
+    // 1) sum loops; bad's call would leave acc without its argument
+    TailCallStats stats = {0};
+    tail_call_eliminate_program(program, &stats);
+    size_t marked;
+    check("self call eliminated", stats.self == 1 && calls(program, "sum", &marked) == 0);
+    check("one frame", tac_run(program, "sum", deep, 2, &result) && result == 5000 * 5001 / 2);
+    check("wrong argument count kept", calls(program, "bad", &marked) == 1);
+
+    // 2) Marking
+    tail_call_mark_program(program, &stats);
+    check("returned call marked", calls(program, "g", &marked) == 1 && marked == 1);
+    check("wrong argument count marked", calls(program, "bad", &marked) == 1 && marked == 1);
+    check("used call not marked", calls(program, "h", &marked) == 1 && marked == 0);
+    check("stats", stats.marked == 2);
+    tac_program_free(program);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
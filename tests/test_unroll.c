@@ -0,0 +1,88 @@
+// Loop unrolling: loops running 0 or 1 times become straight-line code,
+// longer ones run four copies per test, with a remainder loop unless the
+// trip count is a multiple of four. f returns the same as before.
+//
+//   gcc -Iinclude $(ls src/*.c | grep -v main.c) tests/test_unroll.c -o test_unroll
+//   ./test_unroll
+#include "compiler.h"
+#include "front_end.h"
+#include "tac_run.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+// Jumps back to a label defined above them
+static size_t back_edges(const TACFunction *fn) {
+    size_t count = 0;
+    for (size_t i = 0; i < fn->count; i++) {
+        const TACInstr *instr = &fn->instrs[i];
+        const TACOperand *label = instr->kind == TAC_GOTO ? &instr->arg1
+                                : instr->kind == TAC_IFZ ? &instr->arg2
+                                : instr->kind == TAC_IF_CMP ? &instr->dst : NULL;
+        if (label && tac_function_label_index(fn, label->literal) < i) count++;
+    }
+    return count;
+}
+
+// f(n) with the loop unrolled by 4, run for n = 0 .. 9 and for an n that
+// an adjusted bound n - 3 would wrap around
+static void check(const char *what, const char *code, UnrollStats expected, size_t loops) {
+    TACProgram *before = front_end(code);
+    TACProgram *program = front_end(code);
+    UnrollStats stats = {0};
+    unroll_program(program, 4, &stats);
+
+    int ok = 1;
+    for (int k = 0; ok && k < 11; k++) {
+        int n = k < 10 ? k : INT_MIN + 1, result, expected_result;
+        ok = tac_run(before, "f", &n, 1, &expected_result) && tac_run(program, "f", &n, 1, &result)
+             && result == expected_result;
+    }
+    if (!ok) {
+        printf("FAIL %s: f returns something else\n", what);
+        failures++;
+    } else if (stats.full != expected.full || stats.partial != expected.partial
+               || stats.remainders != expected.remainders || stats.copies != expected.copies) {
+        printf("FAIL %s: %zu full, %zu partial, %zu remainders, %zu copies\n", what,
+               stats.full, stats.partial, stats.remainders, stats.copies);
+        failures++;
+    } else if (back_edges(&program->functions[0]) != loops) {
+        printf("FAIL %s: %zu loops left\n", what, back_edges(&program->functions[0]));
+        failures++;
+    } else {
+        printf("ok   %s\n", what);
+    }
+    tac_program_free(before);
+    tac_program_free(program);
+}
+
+int main(void) {
+    // 1) Known trip counts: 0, 1, 10 and 12
+    check("no trips",
+          "fn f(n) { def s = 0; def i = 5; while (i < 3) { s = s + i; i = i + 1; } return s; }\n",
+          (UnrollStats){ .full = 1 }, 0);
+    check("one trip",
+          "fn f(n) { def s = 0; def i = 0; while (i < 1) { s = s + i + 7; i = i + 1; } return s; }\n",
+          (UnrollStats){ .full = 1, .copies = 1 }, 0);
+    check("trips not a multiple of the factor",
+          "fn f(n) { def s = 0; def i = 0; while (i < 10) { s = s + i; i = i + 1; } return s; }\n",
+          (UnrollStats){ .partial = 1, .remainders = 1, .copies = 4 }, 2);
+    check("trips a multiple of the factor",
+          "fn f(n) { def s = 0; def i = 0; while (i < 12) { s = s + i; i = i + 1; } return s; }\n",
+          (UnrollStats){ .partial = 1, .copies = 4 }, 1);
+
+    // 2) Any trip count, including 0 and 1
+    check("unknown trips",
+          "fn f(n) { def s = 0; def i = 0; while (i < n) { s = s + i; i = i + 1; } return s; }\n",
+          (UnrollStats){ .partial = 1, .remainders = 1, .copies = 4 }, 2);
+    check("step of 2",
+          "fn f(n) { def s = 0; def i = 1; while (i < n) { s = s + i; i = i + 2; } return s; }\n",
+          (UnrollStats){ .partial = 1, .remainders = 1, .copies = 4 }, 2);
+
+    tac_phi_free();
+    intern_free();
+    printf("%s\n", failures ? "FAILED" : "all passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}